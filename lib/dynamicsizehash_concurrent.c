@@ -243,7 +243,7 @@ resize_master(NAME *htab) {
 
     /* Change state to NO_RESIZING */
     assert(atomic_load(&htab->resizing_state) == CLEANING);
-    atomic_init(&htab->resizing_state, NO_RESIZING);
+    atomic_store(&htab->resizing_state, NO_RESIZING);
 
 }
 
@@ -362,7 +362,9 @@ INSERT(NAME) (NAME *htab, HASHTYPE hval, TYPE data)
                 /* Master thread */
                 pthread_rwlock_unlock(&htab->resize_rwl);
 
-                pthread_rwlock_rdlock(&htab->resize_rwl);
+                /* Readers must not look at the table while it is
+                   being replaced, they help moving entries instead.  */
+                pthread_rwlock_wrlock(&htab->resize_rwl);
                 resize_master(htab);
                 pthread_rwlock_unlock(&htab->resize_rwl);
 
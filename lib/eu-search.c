@@ -0,0 +1,84 @@
+/* Calls for thread-safe tsearch/tfind.
+   This file is part of elfutils.
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of either
+
+     * the GNU Lesser General Public License as published by the Free
+       Software Foundation; either version 3 of the License, or (at
+       your option) any later version
+
+   or
+
+     * the GNU General Public License as published by the Free
+       Software Foundation; either version 2 of the License, or (at
+       your option) any later version
+
+   or both in parallel, as here.
+
+   elfutils is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received copies of the GNU General Public License and
+   the GNU Lesser General Public License along with this program.  If
+   not, see <http://www.gnu.org/licenses/>.  */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include "eu-search.h"
+
+
+void
+eu_search_tree_init (search_tree *tree)
+{
+  tree->root = NULL;
+  pthread_rwlock_init (&tree->lock, NULL);
+}
+
+
+static void
+noop_free (void *arg __attribute__ ((unused)))
+{
+}
+
+
+void
+eu_search_tree_fini (search_tree *tree, void (*free_node) (void *))
+{
+  tdestroy (tree->root, free_node != NULL ? free_node : noop_free);
+  tree->root = NULL;
+  pthread_rwlock_destroy (&tree->lock);
+}
+
+
+void *
+eu_tsearch (const void *key, search_tree *tree,
+	    int (*compare) (const void *, const void *))
+{
+  /* Most calls find an existing entry, only take the write lock when
+     the key really needs to be added.  */
+  void *ret = eu_tfind (key, tree, compare);
+  if (ret != NULL)
+    return ret;
+
+  pthread_rwlock_wrlock (&tree->lock);
+  ret = tsearch (key, &tree->root, compare);
+  pthread_rwlock_unlock (&tree->lock);
+  return ret;
+}
+
+
+void *
+eu_tfind (const void *key, search_tree *tree,
+	  int (*compare) (const void *, const void *))
+{
+  pthread_rwlock_rdlock (&tree->lock);
+  void *ret = tfind (key, &tree->root, compare);
+  pthread_rwlock_unlock (&tree->lock);
+  return ret;
+}
+
@@ -0,0 +1,63 @@
+/* Calls for thread-safe tsearch/tfind.
+   This file is part of elfutils.
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of either
+
+     * the GNU Lesser General Public License as published by the Free
+       Software Foundation; either version 3 of the License, or (at
+       your option) any later version
+
+   or
+
+     * the GNU General Public License as published by the Free
+       Software Foundation; either version 2 of the License, or (at
+       your option) any later version
+
+   or both in parallel, as here.
+
+   elfutils is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received copies of the GNU General Public License and
+   the GNU Lesser General Public License along with this program.  If
+   not, see <http://www.gnu.org/licenses/>.  */
+
+#ifndef EU_SEARCH_H
+#define EU_SEARCH_H 1
+
+#include <search.h>
+#include <pthread.h>
+
+/* A tsearch tree together with the lock that protects it.  Lookups
+   take the lock for reading, insertions take it for writing.  The
+   nodes returned by eu_tsearch and eu_tfind stay valid until the tree
+   is destroyed, so the found keys can be used without holding the
+   lock.  */
+typedef struct
+{
+  void *root;
+  pthread_rwlock_t lock;
+} search_tree;
+
+/* Initialize an empty tree.  */
+extern void eu_search_tree_init (search_tree *tree);
+
+/* Destroy the tree and its lock, calling FREE_NODE on every key.
+   FREE_NODE can be NULL if the keys are owned elsewhere.  */
+extern void eu_search_tree_fini (search_tree *tree,
+				 void (*free_node) (void *));
+
+/* Like tsearch, but safe against concurrent eu_tsearch/eu_tfind calls
+   on the same tree.  An already present key is found without taking
+   the write lock.  */
+extern void *eu_tsearch (const void *key, search_tree *tree,
+			 int (*compare) (const void *, const void *));
+
+/* Like tfind, but safe against concurrent eu_tsearch calls.  */
+extern void *eu_tfind (const void *key, search_tree *tree,
+		       int (*compare) (const void *, const void *));
+
+#endif /* EU_SEARCH_H */
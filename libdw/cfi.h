@@ -89,14 +89,17 @@ struct Dwarf_CFI_s
   /* Location of next unread entry in the section.  */
   Dwarf_Off next_offset;
 
-  /* Search tree for the CIEs, indexed by CIE_pointer (section offset).  */
+  /* Search tree for the CIEs, indexed by CIE_pointer (section offset).
+     Protected by cie_lock, dwarf_cfi_build_fde_index reads CIEs while
+     other threads might look them up.  */
   void *cie_tree;
+  pthread_mutex_t cie_lock;
 
   /* Search tree for the FDEs, indexed by PC address.  */
   void *fde_tree;
 
   /* Search tree for parsed DWARF expressions, indexed by raw pointer.  */
-  void *expr_tree;
+  search_tree expr_tree;
 
   /* Backend hook.  */
   struct ebl *ebl;
@@ -108,6 +111,21 @@ struct Dwarf_CFI_s
   size_t search_table_entries;
   uint8_t search_table_encoding;
 
+  /* Address ranges of all FDEs sorted by start address, built by
+     dwarf_cfi_build_fde_index under fde_index_lock.  NULL if not built.
+     Published with a release store after fde_index_entries is set.  */
+  _Atomic (struct dwarf_fde_range *) fde_index;
+  size_t fde_index_entries;
+  pthread_mutex_t fde_index_lock;
+
+  /* The frames most recently returned by dwarf_cfi_addrframe, allocated
+     on first use.  Protected by frame_cache_lock, like the counters.  */
+  struct dwarf_cached_frame *frame_cache;
+  uint64_t frame_cache_clock;
+  uint64_t frame_cache_hits;
+  uint64_t frame_cache_misses;
+  pthread_mutex_t frame_cache_lock;
+
   /* True if the file has a byte order different from the host.  */
   bool other_byte_order;
 
@@ -129,6 +147,25 @@ enum dwarf_frame_rule
     reg_val_expression,		/* DW_CFA_val_expression */
   };
 
+/* The address range and section offset of one FDE.  */
+struct dwarf_fde_range
+{
+  Dwarf_Addr start;
+  Dwarf_Addr end;
+  Dwarf_Off offset;
+};
+
+/* Number of frames dwarf_cfi_addrframe remembers for each Dwarf_CFI.  */
+#define CFI_FRAME_CACHE_SIZE	64
+
+/* A remembered frame and the frame_cache_clock value when it was last
+   looked up.  Empty slots have a NULL frame.  */
+struct dwarf_cached_frame
+{
+  Dwarf_Frame *frame;
+  uint64_t last_used;
+};
+
 /* This describes what we know about an individual register.  */
 struct dwarf_frame_register
 {
@@ -160,9 +160,15 @@ internal_function
 __libdw_find_cie (Dwarf_CFI *cache, Dwarf_Off offset)
 {
   const struct dwarf_cie cie_key = { .offset = offset };
+  struct dwarf_cie *cie;
+
+  pthread_mutex_lock (&cache->cie_lock);
   struct dwarf_cie **found = tfind (&cie_key, &cache->cie_tree, &compare_cie);
   if (found != NULL)
-    return *found;
+    {
+      cie = *found;
+      goto out;
+    }
 
   /* We have not read this CIE yet.  Go find it.  */
   Dwarf_Off next_offset = offset;
@@ -173,14 +179,19 @@ __libdw_find_cie (Dwarf_CFI *cache, Dwarf_Off offset)
   if (result != 0 || entry.cie.CIE_id != DW_CIE_ID_64)
     {
       __libdw_seterrno (DWARF_E_INVALID_DWARF);
-      return NULL;
+      cie = NULL;
+      goto out;
     }
 
   /* If this happened to be what we would have read next, notice it.  */
   if (cache->next_offset == offset)
     cache->next_offset = next_offset;
 
-  return intern_new_cie (cache, offset, &entry.cie);
+  cie = intern_new_cie (cache, offset, &entry.cie);
+
+out:
+  pthread_mutex_unlock (&cache->cie_lock);
+  return cie;
 }
 
 /* Enter a CIE encountered while reading through for FDEs.  */
@@ -189,8 +200,10 @@ internal_function
 __libdw_intern_cie (Dwarf_CFI *cache, Dwarf_Off offset, const Dwarf_CIE *info)
 {
   const struct dwarf_cie cie_key = { .offset = offset };
+  pthread_mutex_lock (&cache->cie_lock);
   struct dwarf_cie **found = tfind (&cie_key, &cache->cie_tree, &compare_cie);
   if (found == NULL)
     /* We have not read this CIE yet.  Enter it.  */
     (void) intern_new_cie (cache, offset, info);
+  pthread_mutex_unlock (&cache->cie_lock);
 }
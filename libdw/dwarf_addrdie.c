@@ -37,11 +37,12 @@
 Dwarf_Die *
 dwarf_addrdie (Dwarf *dbg, Dwarf_Addr addr, Dwarf_Die *result)
 {
-  Dwarf_Aranges *aranges;
-  size_t naranges;
+  /* Not just dwarf_getaranges, .debug_aranges might not cover all
+     units or be missing altogether.  */
+  Dwarf_Aranges *aranges = __libdw_addr_map (dbg);
   Dwarf_Off off;
 
-  if (INTUSE(dwarf_getaranges) (dbg, &aranges, &naranges) != 0
+  if (aranges == NULL
       || INTUSE(dwarf_getarangeinfo) (INTUSE(dwarf_getarange_addr) (aranges,
 								    addr),
 				      NULL, NULL, &off) != 0)
@@ -66,6 +66,8 @@ static const char dwarf_scnnames[IDX_last][19] =
   [IDX_debug_macro] = ".debug_macro",
   [IDX_debug_ranges] = ".debug_ranges",
   [IDX_debug_rnglists] = ".debug_rnglists",
+  [IDX_debug_names] = ".debug_names",
+  [IDX_gdb_index] = ".gdb_index",
   [IDX_gnu_debugaltlink] = ".gnu_debugaltlink"
 };
 #define ndwarf_scnnames (sizeof (dwarf_scnnames) / sizeof (dwarf_scnnames[0]))
@@ -235,6 +237,12 @@ valid_p (Dwarf *result)
 	{
 	  result->fake_loc_cu->sec_idx = IDX_debug_loc;
 	  result->fake_loc_cu->dbg = result;
+	  pthread_mutex_init (&result->fake_loc_cu->abbrev_lock, NULL);
+	  pthread_mutex_init (&result->fake_loc_cu->src_lock, NULL);
+	  eu_search_tree_init (&result->fake_loc_cu->locs);
+	  atomic_init (&result->fake_loc_cu->sibling_hash, NULL);
+	  atomic_init (&result->fake_loc_cu->die_index, NULL);
+	  pthread_mutex_init (&result->fake_loc_cu->die_index_lock, NULL);
 	  result->fake_loc_cu->startp
 	    = result->sectiondata[IDX_debug_loc]->d_buf;
 	  result->fake_loc_cu->endp
@@ -258,6 +266,12 @@ valid_p (Dwarf *result)
 	{
 	  result->fake_loclists_cu->sec_idx = IDX_debug_loclists;
 	  result->fake_loclists_cu->dbg = result;
+	  pthread_mutex_init (&result->fake_loclists_cu->abbrev_lock, NULL);
+	  pthread_mutex_init (&result->fake_loclists_cu->src_lock, NULL);
+	  eu_search_tree_init (&result->fake_loclists_cu->locs);
+	  atomic_init (&result->fake_loclists_cu->sibling_hash, NULL);
+	  atomic_init (&result->fake_loclists_cu->die_index, NULL);
+	  pthread_mutex_init (&result->fake_loclists_cu->die_index_lock, NULL);
 	  result->fake_loclists_cu->startp
 	    = result->sectiondata[IDX_debug_loclists]->d_buf;
 	  result->fake_loclists_cu->endp
@@ -286,6 +300,12 @@ valid_p (Dwarf *result)
 	{
 	  result->fake_addr_cu->sec_idx = IDX_debug_addr;
 	  result->fake_addr_cu->dbg = result;
+	  pthread_mutex_init (&result->fake_addr_cu->abbrev_lock, NULL);
+	  pthread_mutex_init (&result->fake_addr_cu->src_lock, NULL);
+	  eu_search_tree_init (&result->fake_addr_cu->locs);
+	  atomic_init (&result->fake_addr_cu->sibling_hash, NULL);
+	  atomic_init (&result->fake_addr_cu->die_index, NULL);
+	  pthread_mutex_init (&result->fake_addr_cu->die_index_lock, NULL);
 	  result->fake_addr_cu->startp
 	    = result->sectiondata[IDX_debug_addr]->d_buf;
 	  result->fake_addr_cu->endp
@@ -417,14 +437,15 @@ dwarf_begin_elf (Elf *elf, Dwarf_Cmd cmd, Elf_Scn *scngrp)
   /* Initialize the memory handling.  */
   result->mem_default_size = mem_default_size;
   result->oom_handler = __libdw_oom;
-  pthread_rwlock_init(&result->mem_rwl, NULL);
-  result->mem_stacks = 1;
-  result->mem_tails = malloc (sizeof (struct libdw_memblock *));
-  result->mem_tails[0] = (struct libdw_memblock *) (result + 1);
-  result->mem_tails[0]->size = (result->mem_default_size
-			       - offsetof (struct libdw_memblock, mem));
-  result->mem_tails[0]->remaining = result->mem_tails[0]->size;
-  result->mem_tails[0]->prev = NULL;
+  __libdw_alloc_init (result);
+
+  pthread_mutex_init (&result->cu_lock, NULL);
+  pthread_mutex_init (&result->split_lock, NULL);
+  pthread_mutex_init (&result->dwarf_lock, NULL);
+  pthread_mutex_init (&result->name_index_lock, NULL);
+  eu_search_tree_init (&result->split_tree);
+  eu_search_tree_init (&result->macro_ops);
+  eu_search_tree_init (&result->files_lines);
 
   if (cmd == DWARF_C_READ || cmd == DWARF_C_RDWR)
     {
@@ -1,4 +1,4 @@
-/* Compute frame state at PC.
+/* Compute frame state at PC, remembering recently used frames.
    Copyright (C) 2009 Red Hat, Inc.
    This file is part of elfutils.
 
@@ -31,6 +31,85 @@
 #endif
 
 #include "cfi.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Frames are remembered for the whole PC range [start, end) they
+   describe, so one entry serves every address in that row.  When the
+   cache is full, the least recently looked up frame is replaced.  */
+
+static Dwarf_Frame *
+copy_frame (const Dwarf_Frame *frame)
+{
+  size_t size = offsetof (Dwarf_Frame, regs[frame->nregs]);
+  Dwarf_Frame *copy = malloc (size);
+  if (likely (copy != NULL))
+    memcpy (copy, frame, size);
+  return copy;
+}
+
+/* Return a copy of the remembered frame covering ADDRESS, or NULL.  */
+static Dwarf_Frame *
+lookup_cached_frame (Dwarf_CFI *cache, Dwarf_Addr address)
+{
+  Dwarf_Frame *result = NULL;
+  pthread_mutex_lock (&cache->frame_cache_lock);
+  struct dwarf_cached_frame *entries = cache->frame_cache;
+  for (size_t i = 0; entries != NULL && i < CFI_FRAME_CACHE_SIZE; i++)
+    {
+      Dwarf_Frame *frame = entries[i].frame;
+      if (frame != NULL && frame->start <= address && address < frame->end)
+	{
+	  result = copy_frame (frame);
+	  if (result != NULL)
+	    {
+	      entries[i].last_used = ++cache->frame_cache_clock;
+	      cache->frame_cache_hits++;
+	    }
+	  break;
+	}
+    }
+  if (result == NULL)
+    cache->frame_cache_misses++;
+  pthread_mutex_unlock (&cache->frame_cache_lock);
+  return result;
+}
+
+/* Remember a copy of FRAME, evicting the least recently used entry.
+   Failure to allocate just means FRAME is not remembered.  */
+static void
+remember_frame (Dwarf_CFI *cache, const Dwarf_Frame *frame)
+{
+  Dwarf_Frame *copy = copy_frame (frame);
+  if (copy == NULL)
+    return;
+
+  pthread_mutex_lock (&cache->frame_cache_lock);
+  if (cache->frame_cache == NULL)
+    cache->frame_cache = calloc (CFI_FRAME_CACHE_SIZE,
+				 sizeof cache->frame_cache[0]);
+  struct dwarf_cached_frame *entries = cache->frame_cache;
+  if (entries != NULL)
+    {
+      struct dwarf_cached_frame *victim = &entries[0];
+      for (size_t i = 0; i < CFI_FRAME_CACHE_SIZE; i++)
+	{
+	  if (entries[i].frame == NULL)
+	    {
+	      victim = &entries[i];
+	      break;
+	    }
+	  if (entries[i].last_used < victim->last_used)
+	    victim = &entries[i];
+	}
+      free (victim->frame);
+      victim->frame = copy;
+      victim->last_used = ++cache->frame_cache_clock;
+      copy = NULL;
+    }
+  pthread_mutex_unlock (&cache->frame_cache_lock);
+  free (copy);
+}
 
 int
 dwarf_cfi_addrframe (Dwarf_CFI *cache, Dwarf_Addr address, Dwarf_Frame **frame)
@@ -39,6 +118,13 @@ dwarf_cfi_addrframe (Dwarf_CFI *cache, Dwarf_Addr address, Dwarf_Frame **frame)
   if (cache == NULL)
     return -1;
 
+  Dwarf_Frame *cached = lookup_cached_frame (cache, address);
+  if (cached != NULL)
+    {
+      *frame = cached;
+      return 0;
+    }
+
   struct dwarf_fde *fde = __libdw_find_fde (cache, address);
   if (fde == NULL)
     return -1;
@@ -49,6 +135,24 @@ dwarf_cfi_addrframe (Dwarf_CFI *cache, Dwarf_Addr address, Dwarf_Frame **frame)
       __libdw_seterrno (error);
       return -1;
     }
+
+  remember_frame (cache, *frame);
   return 0;
 }
 INTDEF (dwarf_cfi_addrframe)
+
+int
+dwarf_cfi_frame_cache_stats (Dwarf_CFI *cache, uint64_t *hits,
+			     uint64_t *misses)
+{
+  if (cache == NULL)
+    return -1;
+
+  pthread_mutex_lock (&cache->frame_cache_lock);
+  if (hits != NULL)
+    *hits = cache->frame_cache_hits;
+  if (misses != NULL)
+    *misses = cache->frame_cache_misses;
+  pthread_mutex_unlock (&cache->frame_cache_lock);
+  return 0;
+}
@@ -0,0 +1,208 @@
+/* Read all FDEs into a table sorted by address.
+   This file is part of elfutils.
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of either
+
+     * the GNU Lesser General Public License as published by the Free
+       Software Foundation; either version 3 of the License, or (at
+       your option) any later version
+
+   or
+
+     * the GNU General Public License as published by the Free
+       Software Foundation; either version 2 of the License, or (at
+       your option) any later version
+
+   or both in parallel, as here.
+
+   elfutils is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received copies of the GNU General Public License and
+   the GNU Lesser General Public License along with this program.  If
+   not, see <http://www.gnu.org/licenses/>.  */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include "cfi.h"
+#include <stdlib.h>
+
+#include "encoded-value.h"
+
+
+static int
+compare_ranges (const void *a, const void *b)
+{
+  const struct dwarf_fde_range *r1 = a;
+  const struct dwarf_fde_range *r2 = b;
+
+  if (r1->start != r2->start)
+    return r1->start < r2->start ? -1 : 1;
+
+  return r1->offset < r2->offset ? -1 : r1->offset > r2->offset;
+}
+
+/* Whether some allocated section of the file the CFI came from starts
+   at address zero.  The linker leaves the FDEs of code it dropped with
+   --gc-sections in .debug_frame, relocated to zero.  Relocatable files
+   have all their sections at zero.  Without section headers there is
+   nothing to go by, code isn't at zero in linked files.  */
+static bool
+maps_address_zero (Dwarf_CFI *cache)
+{
+  Elf *elf = cache->data->s->elf;
+  GElf_Ehdr ehdr_mem;
+  GElf_Ehdr *ehdr = gelf_getehdr (elf, &ehdr_mem);
+  if (ehdr == NULL || ehdr->e_type == ET_REL)
+    return true;
+
+  Elf_Scn *scn = NULL;
+  while ((scn = elf_nextscn (elf, scn)) != NULL)
+    {
+      GElf_Shdr shdr_mem;
+      GElf_Shdr *shdr = gelf_getshdr (scn, &shdr_mem);
+      if (shdr != NULL && (shdr->sh_flags & SHF_ALLOC) != 0
+	  && shdr->sh_addr == 0 && shdr->sh_size > 0)
+	return true;
+    }
+
+  return false;
+}
+
+/* Read the FDE ranges of CACHE, sorted and without overlaps.  Stores
+   the number of them in *NP.  */
+static struct dwarf_fde_range *
+build_fde_index (Dwarf_CFI *cache, size_t *np)
+{
+  struct dwarf_fde_range *ranges = NULL;
+  size_t nranges = 0;
+  size_t nalloc = 0;
+  bool skip_zero = ! maps_address_zero (cache);
+
+  /* Like the search in __libdw_find_fde, but only decode the address
+     range of each FDE.  The instructions are read when the FDE is
+     used.  */
+  Dwarf_Off offset = 0;
+  while (1)
+    {
+      Dwarf_Off next_offset = offset;
+      Dwarf_CFI_Entry entry;
+      int result = INTUSE(dwarf_next_cfi) (cache->e_ident,
+					   &cache->data->d, CFI_IS_EH (cache),
+					   offset, &next_offset, &entry);
+      if (result > 0)
+	break;
+      if (result < 0)
+	{
+	  if (next_offset == offset)
+	    /* We couldn't progress past the bogus FDE.  */
+	    break;
+	  /* Skip the loser and look at the next entry.  */
+	  offset = next_offset;
+	  continue;
+	}
+
+      if (dwarf_cfi_cie_p (&entry))
+	{
+	  /* The FDEs that follow will usually refer to this CIE.  */
+	  __libdw_intern_cie (cache, offset, &entry.cie);
+	  offset = next_offset;
+	  continue;
+	}
+
+      /* Entries with a bad CIE or without real code range are
+	 skipped, as intern_fde does, and those of dropped code.  */
+      struct dwarf_cie *cie = __libdw_find_cie (cache, entry.fde.CIE_pointer);
+      const uint8_t *p = entry.fde.start;
+      Dwarf_Addr start, length;
+      if (cie != NULL
+	  && read_encoded_value (cache, cie->fde_encoding, &p, &start) == 0
+	  && read_encoded_value (cache, cie->fde_encoding & 0x0f,
+				 &p, &length) == 0
+	  && start + length > start
+	  && (start != 0 || ! skip_zero))
+	{
+	  if (nranges == nalloc)
+	    {
+	      nalloc = nalloc == 0 ? 64 : 2 * nalloc;
+	      struct dwarf_fde_range *newp = realloc (ranges, (nalloc
+							       * sizeof newp[0]));
+	      if (unlikely (newp == NULL))
+		{
+		  free (ranges);
+		  __libdw_seterrno (DWARF_E_NOMEM);
+		  return NULL;
+		}
+	      ranges = newp;
+	    }
+
+	  ranges[nranges].start = start;
+	  ranges[nranges].end = start + length;
+	  ranges[nranges].offset = offset;
+	  nranges++;
+	}
+
+      offset = next_offset;
+    }
+
+  qsort (ranges, nranges, sizeof ranges[0], compare_ranges);
+
+  /* The search tree can't hold overlapping FDEs either, whichever is
+     read first covers the addresses of both there.  Keep the one that
+     starts first.  */
+  size_t n = 0;
+  for (size_t i = 0; i < nranges; i++)
+    if (n == 0 || ranges[i].start >= ranges[n - 1].end)
+      ranges[n++] = ranges[i];
+
+  /* Even an empty index tells __libdw_find_fde there is nothing more
+     to find.  */
+  struct dwarf_fde_range *index = realloc (ranges, ((n ?: 1)
+						    * sizeof index[0]));
+  if (unlikely (index == NULL))
+    {
+      if (ranges == NULL)
+	{
+	  __libdw_seterrno (DWARF_E_NOMEM);
+	  return NULL;
+	}
+      index = ranges;
+    }
+
+  *np = n;
+  return index;
+}
+
+int
+dwarf_cfi_build_fde_index (Dwarf_CFI *cache)
+{
+  if (cache == NULL)
+    return -1;
+
+  if (atomic_load_explicit (&cache->fde_index, memory_order_acquire) != NULL)
+    return 0;
+
+  int result = 0;
+  pthread_mutex_lock (&cache->fde_index_lock);
+  if (atomic_load_explicit (&cache->fde_index, memory_order_relaxed) == NULL)
+    {
+      size_t n;
+      struct dwarf_fde_range *index = build_fde_index (cache, &n);
+      if (index == NULL)
+	result = -1;
+      else
+	{
+	  cache->fde_index_entries = n;
+	  atomic_store_explicit (&cache->fde_index, index,
+				 memory_order_release);
+	}
+    }
+  pthread_mutex_unlock (&cache->fde_index_lock);
+
+  return result;
+}
@@ -34,8 +34,67 @@
 #include "libdwP.h"
 #include <string.h>
 
-/* Some arbitrary value not conflicting with any existing code.  */
-#define INVALID 0xffffe444
+
+/* Find the attribute using the decoded attribute table of the
+   abbreviation.  Values of attributes in the fixed length prefix are
+   found directly, only later ones need to skip the values before.  */
+static unsigned char *
+find_attr_table (Dwarf_Die *die, Dwarf_Abbrev *abbrevp,
+		 const unsigned char *readp, unsigned int search_name,
+		 unsigned int *codep, unsigned int *formp)
+{
+  const struct Dwarf_Abbrev_Attr *attrs = abbrevp->attrs;
+  size_t nattrs = abbrevp->nattrs;
+  size_t idx = nattrs;
+  if (search_name != INVALID)
+    for (idx = 0; idx < nattrs; idx++)
+      if (attrs[idx].name == search_name)
+	break;
+
+  if (idx < nattrs)
+    {
+      if (codep != NULL)
+	*codep = attrs[idx].name;
+      if (formp != NULL)
+	*formp = attrs[idx].form;
+
+      /* Normally the attribute data comes from the DIE/info,
+	 except for implicit_form, where it comes from the abbrev.  */
+      if (attrs[idx].form == DW_FORM_implicit_const)
+	return abbrevp->attrp + attrs[idx].offset;
+    }
+  else
+    {
+      // XXX Do we need other values?
+      if (codep != NULL)
+	*codep = INVALID;
+      if (formp != NULL)
+	*formp = INVALID;
+    }
+
+  if (idx < abbrevp->nfixed)
+    return (unsigned char *) readp + attrs[idx].offset;
+
+  /* Skip the values from the first one with a variable length.  */
+  readp += abbrevp->fixed_len;
+  for (size_t i = abbrevp->nfixed; i < idx; i++)
+    {
+      size_t len = __libdw_form_val_len (die->cu, attrs[i].form, readp);
+      if (unlikely (len == (size_t) -1l))
+	{
+	  if (codep != NULL)
+	    *codep = INVALID;
+	  if (formp != NULL)
+	    *formp = INVALID;
+	  return NULL;
+	}
+
+      // __libdw_form_val_len will have done a bounds check.
+      readp += len;
+    }
+
+  return (unsigned char *) readp;
+}
 
 
 unsigned char *
@@ -53,6 +112,13 @@ __libdw_find_attr (Dwarf_Die *die, unsigned int search_name,
       return NULL;
     }
 
+  /* Use the decoded attributes if the fixed length values are all
+     inside the CU.  Otherwise the loop below reports the error.  */
+  if (likely (abbrevp->attrs != NULL)
+      && likely (abbrevp->fixed_len
+		 <= (size_t) ((const unsigned char *) die->cu->endp - readp)))
+    return find_attr_table (die, abbrevp, readp, search_name, codep, formp);
+
   /* Search the name attribute.  Attribute has been checked when
      Dwarf_Abbrev was created, we can read unchecked.  */
   const unsigned char *attrp = abbrevp->attrp;
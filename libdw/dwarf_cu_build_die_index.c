@@ -0,0 +1,193 @@
+/* Build an index of all DIEs of a unit.
+   This file is part of elfutils.
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of either
+
+     * the GNU Lesser General Public License as published by the Free
+       Software Foundation; either version 3 of the License, or (at
+       your option) any later version
+
+   or
+
+     * the GNU General Public License as published by the Free
+       Software Foundation; either version 2 of the License, or (at
+       your option) any later version
+
+   or both in parallel, as here.
+
+   elfutils is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received copies of the GNU General Public License and
+   the GNU Lesser General Public License along with this program.  If
+   not, see <http://www.gnu.org/licenses/>.  */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "libdwP.h"
+
+
+struct die_entry
+{
+  Dwarf_Off offset;
+  size_t parent;
+  size_t sibling;
+  Dwarf_Abbrev *abbrev;
+  unsigned int depth;
+};
+
+
+static Dwarf_Die_Index *
+build_index (Dwarf_CU *cu)
+{
+  size_t count = 0;
+  size_t nalloc = 64;
+  struct die_entry *entries = malloc (nalloc * sizeof entries[0]);
+  if (entries == NULL)
+    {
+      __libdw_seterrno (DWARF_E_NOMEM);
+      return NULL;
+    }
+
+  /* The DIE whose children we are reading and the last DIE read on
+     that level, whose next sibling is the next DIE on that level.  */
+  size_t parent = (size_t) -1;
+  size_t last = (size_t) -1;
+  unsigned int depth = 0;
+
+  Dwarf_Die die = CUDIE (cu);
+  unsigned char *addr = die.addr;
+  unsigned char *endp = cu->endp;
+  while (addr < endp)
+    {
+      if (*addr == '\0')
+	{
+	  /* End of the children of PARENT.  Anything after the unit
+	     DIE is padding.  */
+	  if (parent == (size_t) -1)
+	    break;
+	  last = parent;
+	  parent = entries[parent].parent;
+	  --depth;
+	  ++addr;
+	  if (parent == (size_t) -1)
+	    break;
+	  continue;
+	}
+
+      /* There is only one DIE at the top level.  */
+      if (count > 0 && parent == (size_t) -1)
+	break;
+
+      die.addr = addr;
+      die.abbrev = NULL;
+      unsigned char *next = __libdw_find_attr (&die, INVALID, NULL, NULL);
+      if (unlikely (next == NULL))
+	{
+	  free (entries);
+	  return NULL;
+	}
+
+      if (count == nalloc)
+	{
+	  nalloc *= 2;
+	  struct die_entry *newp = realloc (entries,
+					    nalloc * sizeof entries[0]);
+	  if (newp == NULL)
+	    {
+	      free (entries);
+	      __libdw_seterrno (DWARF_E_NOMEM);
+	      return NULL;
+	    }
+	  entries = newp;
+	}
+
+      entries[count].offset = (cu->start
+			       + (addr - (unsigned char *) cu->startp));
+      entries[count].parent = parent;
+      entries[count].sibling = (size_t) -1;
+      entries[count].abbrev = die.abbrev;
+      entries[count].depth = depth;
+      if (last != (size_t) -1)
+	entries[last].sibling = count;
+
+      if (die.abbrev->has_children)
+	{
+	  parent = count;
+	  last = (size_t) -1;
+	  ++depth;
+	}
+      else
+	last = count;
+
+      ++count;
+      addr = next;
+    }
+
+  /* Copy the arrays into the Dwarf's memory, they live as long as
+     the unit.  */
+  Dwarf *dbg = cu->dbg;
+  Dwarf_Off *offset = libdw_alloc (dbg, Dwarf_Off, sizeof (Dwarf_Off),
+				   count);
+  size_t *parents = libdw_alloc (dbg, size_t, sizeof (size_t), count);
+  size_t *siblings = libdw_alloc (dbg, size_t, sizeof (size_t), count);
+  int *tags = libdw_alloc (dbg, int, sizeof (int), count);
+  unsigned int *depths = libdw_alloc (dbg, unsigned int,
+				      sizeof (unsigned int), count);
+  Dwarf_Abbrev **abbrevs = libdw_alloc (dbg, Dwarf_Abbrev *,
+					sizeof (Dwarf_Abbrev *), count);
+  for (size_t i = 0; i < count; ++i)
+    {
+      offset[i] = entries[i].offset;
+      parents[i] = entries[i].parent;
+      siblings[i] = entries[i].sibling;
+      tags[i] = entries[i].abbrev->tag;
+      depths[i] = entries[i].depth;
+      abbrevs[i] = entries[i].abbrev;
+    }
+  free (entries);
+
+  Dwarf_Die_Index *index = libdw_typed_alloc (dbg, Dwarf_Die_Index);
+  index->cu = cu;
+  index->count = count;
+  index->offset = offset;
+  index->parent = parents;
+  index->sibling = siblings;
+  index->tag = tags;
+  index->depth = depths;
+  index->abbrev = abbrevs;
+  return index;
+}
+
+
+const Dwarf_Die_Index *
+dwarf_cu_build_die_index (Dwarf_CU *cu)
+{
+  if (cu == NULL)
+    return NULL;
+
+  Dwarf_Die_Index *index = atomic_load_explicit (&cu->die_index,
+						 memory_order_acquire);
+  if (index != NULL)
+    return index;
+
+  pthread_mutex_lock (&cu->die_index_lock);
+  index = atomic_load_explicit (&cu->die_index, memory_order_relaxed);
+  if (index == NULL)
+    {
+      index = build_index (cu);
+      if (index != NULL)
+	atomic_store_explicit (&cu->die_index, index, memory_order_release);
+    }
+  pthread_mutex_unlock (&cu->die_index_lock);
+
+  return index;
+}
@@ -0,0 +1,81 @@
+/* Return the DIE index of a unit.
+   This file is part of elfutils.
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of either
+
+     * the GNU Lesser General Public License as published by the Free
+       Software Foundation; either version 3 of the License, or (at
+       your option) any later version
+
+   or
+
+     * the GNU General Public License as published by the Free
+       Software Foundation; either version 2 of the License, or (at
+       your option) any later version
+
+   or both in parallel, as here.
+
+   elfutils is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received copies of the GNU General Public License and
+   the GNU Lesser General Public License along with this program.  If
+   not, see <http://www.gnu.org/licenses/>.  */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include "libdwP.h"
+
+
+const Dwarf_Die_Index *
+dwarf_cu_die_index (Dwarf_CU *cu)
+{
+  if (cu == NULL)
+    return NULL;
+
+  return atomic_load_explicit (&cu->die_index, memory_order_acquire);
+}
+INTDEF (dwarf_cu_die_index)
+
+
+const Dwarf_Die_Index *
+internal_function
+__libdw_die_index_lookup (Dwarf_Die *die, size_t *np)
+{
+  const Dwarf_Die_Index *index = INTUSE(dwarf_cu_die_index) (die->cu);
+  if (index == NULL || index->count == 0)
+    return NULL;
+
+  /* Most walks start at the unit DIE.  */
+  Dwarf_Off offset = (die->cu->start
+		      + ((unsigned char *) die->addr
+			 - (unsigned char *) die->cu->startp));
+  if (index->offset[0] == offset)
+    {
+      *np = 0;
+      return index;
+    }
+
+  size_t l = 1;
+  size_t u = index->count;
+  while (l < u)
+    {
+      size_t n = (l + u) / 2;
+      if (offset < index->offset[n])
+	u = n;
+      else if (offset > index->offset[n])
+	l = n + 1;
+      else
+	{
+	  *np = n;
+	  return index;
+	}
+    }
+
+  return NULL;
+}
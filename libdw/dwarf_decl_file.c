@@ -31,7 +31,6 @@
 # include <config.h>
 #endif
 
-#include <assert.h>
 #include <dwarf.h>
 #include "libdwP.h"
 
@@ -54,20 +53,12 @@ dwarf_decl_file (Dwarf_Die *die)
       return NULL;
     }
 
-  /* Get the array of source files for the CU.  */
+  /* Get the array of source files for the CU.  This takes the CU's
+     source lock, so don't look at CU->files directly.  */
   struct Dwarf_CU *cu = die->cu;
-  if (cu->lines == NULL)
-    {
-      Dwarf_Lines *lines;
-      size_t nlines;
-
-      /* Let the more generic function do the work.  It'll create more
-	 data but that will be needed in an real program anyway.  */
-      (void) INTUSE(dwarf_getsrclines) (&CUDIE (cu), &lines, &nlines);
-      assert (cu->lines != NULL);
-    }
-
-  if (cu->lines == (void *) -1l)
+  Dwarf_Files *files;
+  size_t nfiles;
+  if (INTUSE(dwarf_getsrcfiles) (&CUDIE (cu), &files, &nfiles) != 0)
     {
       /* If the file index is not zero, there must be file information
 	 available.  */
@@ -75,15 +66,13 @@ dwarf_decl_file (Dwarf_Die *die)
       return NULL;
     }
 
-  assert (cu->files != NULL && cu->files != (void *) -1l);
-
-  if (idx >= cu->files->nfiles)
+  if (idx >= nfiles)
     {
       __libdw_seterrno (DWARF_E_INVALID_DWARF);
       return NULL;
     }
 
-  return cu->files->info[idx].name;
+  return files->info[idx].name;
 }
 OLD_VERSION (dwarf_decl_file, ELFUTILS_0.122)
 NEW_VERSION (dwarf_decl_file, ELFUTILS_0.143)
@@ -0,0 +1,59 @@
+/* Return a DIE from the DIE index of a unit.
+   This file is part of elfutils.
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of either
+
+     * the GNU Lesser General Public License as published by the Free
+       Software Foundation; either version 3 of the License, or (at
+       your option) any later version
+
+   or
+
+     * the GNU General Public License as published by the Free
+       Software Foundation; either version 2 of the License, or (at
+       your option) any later version
+
+   or both in parallel, as here.
+
+   elfutils is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received copies of the GNU General Public License and
+   the GNU Lesser General Public License along with this program.  If
+   not, see <http://www.gnu.org/licenses/>.  */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <string.h>
+
+#include "libdwP.h"
+
+
+Dwarf_Die *
+dwarf_die_index_die (const Dwarf_Die_Index *index, size_t n,
+		     Dwarf_Die *result)
+{
+  if (index == NULL)
+    return NULL;
+
+  if (unlikely (n >= index->count))
+    {
+      __libdw_seterrno (DWARF_E_INVALID_OFFSET);
+      return NULL;
+    }
+
+  Dwarf_CU *cu = index->cu;
+  memset (result, '\0', sizeof (Dwarf_Die));
+  result->addr = (unsigned char *) cu->startp + (index->offset[n] - cu->start);
+  result->cu = cu;
+  /* We already know the abbreviation, no need to decode it again.  */
+  result->abbrev = index->abbrev[n];
+
+  return result;
+}
+INTDEF (dwarf_die_index_die)
@@ -41,20 +41,25 @@
 #include "cfi.h"
 
 
-static void
-noop_free (void *arg __attribute__ ((unused)))
-{
-}
-
-
 static void
 cu_free (void *arg)
 {
   struct Dwarf_CU *p = (struct Dwarf_CU *) arg;
 
   Dwarf_Abbrev_Hash_free (&p->abbrev_hash);
+  pthread_mutex_destroy (&p->abbrev_lock);
 
-  tdestroy (p->locs, noop_free);
+  eu_search_tree_fini (&p->locs, NULL);
+  pthread_mutex_destroy (&p->src_lock);
+
+  Dwarf_Sibling_Hash *sibling_hash
+    = atomic_load_explicit (&p->sibling_hash, memory_order_relaxed);
+  if (sibling_hash != NULL)
+    {
+      Dwarf_Sibling_Hash_free (sibling_hash);
+      free (sibling_hash);
+    }
+  pthread_mutex_destroy (&p->die_index_lock);
 
   /* Free split dwarf one way (from skeleton to split).  */
   if (p->unit_type == DW_UT_skeleton
@@ -68,6 +73,27 @@ cu_free (void *arg)
 }
 
 
+static void
+cu_table_free (struct Dwarf_CU_Table *table)
+{
+  struct Dwarf_CU **units = atomic_load_explicit (&table->units,
+						  memory_order_relaxed);
+  size_t nunits = atomic_load_explicit (&table->nunits,
+					memory_order_relaxed);
+  for (size_t i = 0; i < nunits; i++)
+    cu_free (units[i]);
+  free (units);
+
+  while (table->old != NULL)
+    {
+      struct Dwarf_CU_Table_Old *old = table->old;
+      table->old = old->next;
+      free (old->units);
+      free (old);
+    }
+}
+
+
 int
 dwarf_end (Dwarf *dwarf)
 {
@@ -79,41 +105,35 @@ dwarf_end (Dwarf *dwarf)
 
       Dwarf_Sig8_Hash_free (&dwarf->sig8_hash);
 
-      /* The search tree for the CUs.  NB: the CU data itself is
-	 allocated separately, but the abbreviation hash tables need
-	 to be handled.  */
-      tdestroy (dwarf->cu_tree, cu_free);
-      tdestroy (dwarf->tu_tree, cu_free);
+      /* The tables of the CUs.  NB: the CU data itself is allocated
+	 separately, but the abbreviation hash tables need to be
+	 handled.  */
+      cu_table_free (&dwarf->cu_table);
+      cu_table_free (&dwarf->tu_table);
+      pthread_mutex_destroy (&dwarf->cu_lock);
 
       /* Search tree for macro opcode tables.  */
-      tdestroy (dwarf->macro_ops, noop_free);
+      eu_search_tree_fini (&dwarf->macro_ops, NULL);
 
       /* Search tree for decoded .debug_lines units.  */
-      tdestroy (dwarf->files_lines, noop_free);
+      eu_search_tree_fini (&dwarf->files_lines, NULL);
 
       /* And the split Dwarf.  */
-      tdestroy (dwarf->split_tree, noop_free);
-
-      for (size_t i = 0; i < dwarf->mem_stacks; i++)
-        {
-          struct libdw_memblock *memp = dwarf->mem_tails[i];
-          /* The first block is allocated together with the Dwarf object.  */
-          while (memp != NULL && memp->prev != NULL)
-	    {
-	      struct libdw_memblock *prevp = memp->prev;
-	      free (memp);
-	      memp = prevp;
-	    }
-          /* Only for stack 0 though, the others are allocated individually.  */
-          if (memp != NULL && i > 0)
-            free (memp);
-        }
-      free (dwarf->mem_tails);
-      pthread_rwlock_destroy (&dwarf->mem_rwl);
+      eu_search_tree_fini (&dwarf->split_tree, NULL);
+      pthread_mutex_destroy (&dwarf->split_lock);
+      pthread_mutex_destroy (&dwarf->dwarf_lock);
+      pthread_mutex_destroy (&dwarf->name_index_lock);
+
+      /* Free the memory blocks.  */
+      __libdw_alloc_free (dwarf);
 
       /* Free the pubnames helper structure.  */
       free (dwarf->pubnames_sets);
 
+      /* Free the name index.  */
+      __libdw_name_index_free (atomic_load_explicit (&dwarf->name_index,
+						     memory_order_relaxed));
+
       /* Free the ELF descriptor if necessary.  */
       if (dwarf->free_elf)
 	elf_end (dwarf->elf);
@@ -32,9 +32,129 @@
 #endif
 
 #include <dwarf.h>
+#include <limits.h>
 #include "libdwP.h"
 
 
+/* Returns the length of the value of FORM in CU if it is the same for
+   every DIE, or -1 if it has to be read from the DIE.  */
+static size_t
+fixed_form_len (struct Dwarf_CU *cu, unsigned int form)
+{
+  switch (form)
+    {
+    case DW_FORM_flag_present:
+    case DW_FORM_implicit_const:
+      return 0;
+
+    case DW_FORM_flag:
+    case DW_FORM_data1:
+    case DW_FORM_ref1:
+    case DW_FORM_addrx1:
+    case DW_FORM_strx1:
+      return 1;
+
+    case DW_FORM_data2:
+    case DW_FORM_ref2:
+    case DW_FORM_addrx2:
+    case DW_FORM_strx2:
+      return 2;
+
+    case DW_FORM_addrx3:
+    case DW_FORM_strx3:
+      return 3;
+
+    case DW_FORM_data4:
+    case DW_FORM_ref4:
+    case DW_FORM_ref_sup4:
+    case DW_FORM_addrx4:
+    case DW_FORM_strx4:
+      return 4;
+
+    case DW_FORM_ref_sig8:
+    case DW_FORM_data8:
+    case DW_FORM_ref8:
+    case DW_FORM_ref_sup8:
+      return 8;
+
+    case DW_FORM_data16:
+      return 16;
+
+    case DW_FORM_addr:
+      return cu->address_size;
+
+    case DW_FORM_ref_addr:
+      return cu->version == 2 ? cu->address_size : cu->offset_size;
+
+    case DW_FORM_strp:
+    case DW_FORM_strp_sup:
+    case DW_FORM_line_strp:
+    case DW_FORM_sec_offset:
+    case DW_FORM_GNU_ref_alt:
+    case DW_FORM_GNU_strp_alt:
+      return cu->offset_size;
+
+    default:
+      return (size_t) -1;
+    }
+}
+
+/* Decode the NATTRS attribute name/form pairs of ABB, which have
+   already been checked, and record where their values are as long as
+   all values before them have a fixed length.  */
+static void
+decode_attrs (Dwarf *dbg, struct Dwarf_CU *cu, Dwarf_Abbrev *abb,
+	      size_t nattrs)
+{
+  static const struct Dwarf_Abbrev_Attr no_attrs[1];
+  if (nattrs == 0)
+    {
+      abb->attrs = no_attrs;
+      abb->nattrs = abb->nfixed = abb->fixed_len = 0;
+      return;
+    }
+
+  struct Dwarf_Abbrev_Attr *attrs
+    = libdw_alloc (dbg, struct Dwarf_Abbrev_Attr,
+		   sizeof (struct Dwarf_Abbrev_Attr), nattrs);
+
+  const unsigned char *attrp = abb->attrp;
+  size_t offset = 0;
+  size_t nfixed = 0;
+  bool fixed = true;
+  for (size_t i = 0; i < nattrs; i++)
+    {
+      get_uleb128_unchecked (attrs[i].name, attrp);
+      get_uleb128_unchecked (attrs[i].form, attrp);
+      if (attrs[i].form == DW_FORM_implicit_const)
+	{
+	  attrs[i].offset = attrp - abb->attrp;
+	  int64_t formval __attribute__((__unused__));
+	  get_sleb128_unchecked (formval, attrp);
+	}
+      else
+	attrs[i].offset = offset;
+
+      if (fixed)
+	{
+	  size_t len = fixed_form_len (cu, attrs[i].form);
+	  if (len == (size_t) -1 || offset + len > UINT_MAX)
+	    fixed = false;
+	  else
+	    {
+	      nfixed++;
+	      offset += len;
+	    }
+	}
+    }
+
+  abb->attrs = attrs;
+  abb->nattrs = nattrs;
+  abb->nfixed = nfixed;
+  abb->fixed_len = offset;
+}
+
+
 Dwarf_Abbrev *
 internal_function
 __libdw_getabbrev (Dwarf *dbg, struct Dwarf_CU *cu, Dwarf_Off offset,
@@ -124,6 +244,7 @@ __libdw_getabbrev (Dwarf *dbg, struct Dwarf_CU *cu, Dwarf_Off offset,
   /* Skip over all the attributes and check rest of the abbrev is valid.  */
   unsigned int attrname;
   unsigned int attrform;
+  size_t nattrs = 0;
   do
     {
       if (abbrevp >= end)
@@ -139,8 +260,20 @@ __libdw_getabbrev (Dwarf *dbg, struct Dwarf_CU *cu, Dwarf_Off offset,
 	    goto invalid;
 	  get_sleb128 (formval, abbrevp, end);
 	}
+      nattrs++;
     }
   while (attrname != 0 || attrform != 0);
+  nattrs--;
+
+  /* Abbreviations of a CU get an attribute table for __libdw_find_attr.
+     One found in the hash table already has it.  */
+  if (cu != NULL && result == NULL)
+    {
+      if (! foundit)
+	decode_attrs (dbg, cu, abb, nattrs);
+    }
+  else
+    abb->attrs = NULL;
 
   /* Return the length to the caller if she asked for it.  */
   if (lengthp != NULL)
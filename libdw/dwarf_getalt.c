@@ -163,22 +163,24 @@ find_debug_altlink (Dwarf *dbg)
 Dwarf *
 dwarf_getalt (Dwarf *main)
 {
-  /* Only try once.  */
-  if (main == NULL || main->alt_dwarf == (void *) -1)
+  if (main == NULL)
     return NULL;
 
-  if (main->alt_dwarf != NULL)
-    return main->alt_dwarf;
-
-  find_debug_altlink (main);
+  pthread_mutex_lock (&main->dwarf_lock);
 
-  /* If we found nothing, make sure we don't try again.  */
+  /* Only try once.  */
   if (main->alt_dwarf == NULL)
     {
-      main->alt_dwarf = (void *) -1;
-      return NULL;
+      find_debug_altlink (main);
+
+      /* If we found nothing, make sure we don't try again.  */
+      if (main->alt_dwarf == NULL)
+	main->alt_dwarf = (void *) -1;
     }
 
-  return main->alt_dwarf;
+  Dwarf *alt = main->alt_dwarf;
+  pthread_mutex_unlock (&main->dwarf_lock);
+
+  return alt == (void *) -1 ? NULL : alt;
 }
 INTDEF (dwarf_getalt)
@@ -53,12 +53,9 @@ compare_aranges (const void *a, const void *b)
   return 0;
 }
 
-int
-dwarf_getaranges (Dwarf *dbg, Dwarf_Aranges **aranges, size_t *naranges)
+static int
+getaranges (Dwarf *dbg, Dwarf_Aranges **aranges, size_t *naranges)
 {
-  if (dbg == NULL)
-    return -1;
-
   if (dbg->aranges != NULL)
     {
       *aranges = dbg->aranges;
@@ -274,4 +271,17 @@ dwarf_getaranges (Dwarf *dbg, Dwarf_Aranges **aranges, size_t *naranges)
 
   return 0;
 }
+
+int
+dwarf_getaranges (Dwarf *dbg, Dwarf_Aranges **aranges, size_t *naranges)
+{
+  if (dbg == NULL)
+    return -1;
+
+  /* The table is read only once, other threads wait for it.  */
+  pthread_mutex_lock (&dbg->dwarf_lock);
+  int res = getaranges (dbg, aranges, naranges);
+  pthread_mutex_unlock (&dbg->dwarf_lock);
+  return res;
+}
 INTDEF(dwarf_getaranges)
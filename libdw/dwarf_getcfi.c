@@ -40,6 +40,7 @@ dwarf_getcfi (Dwarf *dbg)
   if (dbg == NULL)
     return NULL;
 
+  pthread_mutex_lock (&dbg->dwarf_lock);
   if (dbg->cfi == NULL && dbg->sectiondata[IDX_debug_frame] != NULL)
     {
       Dwarf_CFI *cfi = libdw_typed_alloc (dbg, Dwarf_CFI);
@@ -52,6 +53,16 @@ dwarf_getcfi (Dwarf *dbg)
       cfi->search_table_entries = 0;
       cfi->search_table_encoding = DW_EH_PE_omit;
 
+      atomic_init (&cfi->fde_index, NULL);
+      cfi->fde_index_entries = 0;
+      pthread_mutex_init (&cfi->fde_index_lock, NULL);
+
+      cfi->frame_cache = NULL;
+      cfi->frame_cache_clock = 0;
+      cfi->frame_cache_hits = 0;
+      cfi->frame_cache_misses = 0;
+      pthread_mutex_init (&cfi->frame_cache_lock, NULL);
+
       cfi->frame_vaddr = 0;
       cfi->textrel = 0;
       cfi->datarel = 0;
@@ -60,13 +71,17 @@ dwarf_getcfi (Dwarf *dbg)
       cfi->other_byte_order = dbg->other_byte_order;
 
       cfi->next_offset = 0;
-      cfi->cie_tree = cfi->fde_tree = cfi->expr_tree = NULL;
+      cfi->cie_tree = cfi->fde_tree = NULL;
+      pthread_mutex_init (&cfi->cie_lock, NULL);
+      eu_search_tree_init (&cfi->expr_tree);
 
       cfi->ebl = NULL;
 
       dbg->cfi = cfi;
     }
+  Dwarf_CFI *cfi = dbg->cfi;
+  pthread_mutex_unlock (&dbg->dwarf_lock);
 
-  return dbg->cfi;
+  return cfi;
 }
 INTDEF (dwarf_getcfi)
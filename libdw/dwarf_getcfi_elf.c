@@ -62,6 +62,11 @@ allocate_cfi (Elf *elf, GElf_Addr vaddr)
       || (BYTE_ORDER == BIG_ENDIAN && cfi->e_ident[EI_DATA] == ELFDATA2LSB))
     cfi->other_byte_order = true;
 
+  eu_search_tree_init (&cfi->expr_tree);
+  pthread_mutex_init (&cfi->cie_lock, NULL);
+  pthread_mutex_init (&cfi->fde_index_lock, NULL);
+  pthread_mutex_init (&cfi->frame_cache_lock, NULL);
+
   cfi->frame_vaddr = vaddr;
   cfi->textrel = 0;		/* XXX ? */
   cfi->datarel = 0;		/* XXX ? */
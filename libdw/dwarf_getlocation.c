@@ -123,7 +123,7 @@ loc_compare (const void *p1, const void *p2)
    This points us directly to the block data for later fetching.
    Returns zero on success, -1 on bad DWARF or 1 if tsearch failed.  */
 static int
-store_implicit_value (Dwarf *dbg, void **cache, Dwarf_Op *op)
+store_implicit_value (Dwarf *dbg, search_tree *cache, Dwarf_Op *op)
 {
   struct loc_block_s *block = libdw_alloc (dbg, struct loc_block_s,
 					   sizeof (struct loc_block_s), 1);
@@ -134,7 +134,7 @@ store_implicit_value (Dwarf *dbg, void **cache, Dwarf_Op *op)
   block->addr = op;
   block->data = (unsigned char *) data;
   block->length = op->number;
-  if (unlikely (tsearch (block, cache, loc_compare) == NULL))
+  if (unlikely (eu_tsearch (block, cache, loc_compare) == NULL))
     return 1;
   return 0;
 }
@@ -147,7 +147,8 @@ dwarf_getlocation_implicit_value (Dwarf_Attribute *attr, const Dwarf_Op *op,
     return -1;
 
   struct loc_block_s fake = { .addr = (void *) op };
-  struct loc_block_s **found = tfind (&fake, &attr->cu->locs, loc_compare);
+  struct loc_block_s **found = eu_tfind (&fake, &attr->cu->locs,
+					  loc_compare);
   if (unlikely (found == NULL))
     {
       __libdw_seterrno (DWARF_E_NO_BLOCK);
@@ -187,7 +188,7 @@ check_constant_offset (Dwarf_Attribute *attr,
 
   /* Check whether we already cached this location.  */
   struct loc_s fake = { .addr = attr->valp };
-  struct loc_s **found = tfind (&fake, &attr->cu->locs, loc_compare);
+  struct loc_s **found = eu_tfind (&fake, &attr->cu->locs, loc_compare);
 
   if (found == NULL)
     {
@@ -211,7 +212,7 @@ check_constant_offset (Dwarf_Attribute *attr,
       newp->loc = result;
       newp->nloc = 1;
 
-      found = tsearch (newp, &attr->cu->locs, loc_compare);
+      found = eu_tsearch (newp, &attr->cu->locs, loc_compare);
     }
 
   assert ((*found)->nloc == 1);
@@ -229,7 +230,7 @@ int
 internal_function
 __libdw_intern_expression (Dwarf *dbg, bool other_byte_order,
 			   unsigned int address_size, unsigned int ref_size,
-			   void **cache, const Dwarf_Block *block,
+			   search_tree *cache, const Dwarf_Block *block,
 			   bool cfap, bool valuep,
 			   Dwarf_Op **llbuf, size_t *listlen, int sec_index)
 {
@@ -242,7 +243,7 @@ __libdw_intern_expression (Dwarf *dbg, bool other_byte_order,
 
   /* Check whether we already looked at this list.  */
   struct loc_s fake = { .addr = block->data };
-  struct loc_s **found = tfind (&fake, cache, loc_compare);
+  struct loc_s **found = eu_tfind (&fake, cache, loc_compare);
   if (found != NULL)
     {
       /* We already saw it.  */
@@ -630,7 +631,20 @@ __libdw_intern_expression (Dwarf *dbg, bool other_byte_order,
   newp->addr = block->data;
   newp->loc = result;
   newp->nloc = *listlen;
-  (void) tsearch (newp, cache, loc_compare);
+  found = eu_tsearch (newp, cache, loc_compare);
+
+  /* Another thread might have decoded the same expression first.
+     Use that one, so all callers see the same ops.  */
+  if (found != NULL && *found != newp)
+    {
+      if (dbg == NULL)
+	{
+	  free (newp);
+	  free (result);
+	}
+      *llbuf = (*found)->loc;
+      *listlen = (*found)->nloc;
+    }
 
   /* We did it.  */
   return 0;
@@ -680,14 +694,15 @@ dwarf_getlocation (Dwarf_Attribute *attr, Dwarf_Op **llbuf, size_t *listlen)
 
   return getlocation (attr->cu, &block, llbuf, listlen, cu_sec_idx (attr->cu));
 }
+INTDEF (dwarf_getlocation)
 
 Dwarf_Addr
 __libdw_cu_base_address (Dwarf_CU *cu)
 {
-  if (cu->base_address == (Dwarf_Addr) -1)
+  Dwarf_Addr base = atomic_load_explicit (&cu->base_address,
+					  memory_order_relaxed);
+  if (base == (Dwarf_Addr) -1)
     {
-      Dwarf_Addr base;
-
       /* Fetch the CU's base address.  */
       Dwarf_Die cudie = CUDIE (cu);
 
@@ -708,10 +723,10 @@ __libdw_cu_base_address (Dwarf_CU *cu)
 	     addresses in the location list and no DW_AT_ranges.  */
 	   base = 0;
 	}
-      cu->base_address = base;
+      atomic_store_explicit (&cu->base_address, base, memory_order_relaxed);
     }
 
-  return cu->base_address;
+  return base;
 }
 
 static int
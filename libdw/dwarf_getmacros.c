@@ -275,8 +275,8 @@ cache_op_table (Dwarf *dbg, int sec_index, Dwarf_Off macoff,
 		Dwarf_Die *cudie)
 {
   Dwarf_Macro_Op_Table fake = { .offset = macoff, .sec_index = sec_index };
-  Dwarf_Macro_Op_Table **found = tfind (&fake, &dbg->macro_ops,
-					macro_op_compare);
+  Dwarf_Macro_Op_Table **found = eu_tfind (&fake, &dbg->macro_ops,
+					   macro_op_compare);
   if (found != NULL)
     return *found;
 
@@ -287,8 +287,10 @@ cache_op_table (Dwarf *dbg, int sec_index, Dwarf_Off macoff,
   if (table == NULL)
     return NULL;
 
-  Dwarf_Macro_Op_Table **ret = tsearch (table, &dbg->macro_ops,
-					macro_op_compare);
+  /* If another thread read the same table first, this finds that
+     one instead.  */
+  Dwarf_Macro_Op_Table **ret = eu_tsearch (table, &dbg->macro_ops,
+					   macro_op_compare);
   if (unlikely (ret == NULL))
     {
       __libdw_seterrno (DWARF_E_NOMEM);
@@ -369,8 +371,9 @@ read_macros (Dwarf *dbg, int sec_index,
 	.sec_idx = sec_index,
 	.version = table->version,
 	.offset_size = table->is_64bit ? 8 : 4,
-	.str_off_base = str_offsets_base_off (dbg, (cudie != NULL
-						    ? cudie->cu: NULL)),
+	.str_off_base = ATOMIC_VAR_INIT (str_offsets_base_off
+					 (dbg, (cudie != NULL
+						? cudie->cu: NULL))),
 	.startp = (void *) startp + offset,
 	.endp = (void *) endp,
       };
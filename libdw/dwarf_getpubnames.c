@@ -161,7 +161,10 @@ dwarf_getpubnames (Dwarf *dbg,
     return 0;
 
   /* If necessary read the set information.  */
-  if (dbg->pubnames_nsets == 0 && unlikely (get_offsets (dbg) != 0))
+  pthread_mutex_lock (&dbg->dwarf_lock);
+  int res = dbg->pubnames_nsets == 0 ? get_offsets (dbg) : 0;
+  pthread_mutex_unlock (&dbg->dwarf_lock);
+  if (unlikely (res != 0))
     return -1l;
 
   /* Find the place where to start.  */
@@ -116,6 +116,41 @@ origin_match (unsigned int depth, struct Dwarf_Die_Chain *die, void *arg)
   return a->nscopes;
 }
 
+/* Finds the scopes containing the abstract definition with the DIE
+   index of the unit, instead of walking the scopes around DIE.  Returns
+   zero if there is no index or the walk wouldn't use the index.  */
+static int
+origin_match_index (struct args *a, struct Dwarf_Die_Chain *die)
+{
+  while (die->parent != NULL)
+    die = die->parent;
+
+  size_t n;
+  const Dwarf_Die_Index *index = __libdw_die_index_lookup (&die->die, &n);
+  if (index == NULL || n != 0
+      || a->inlined_origin.cu != index->cu
+      || __libdw_die_index_lookup (&a->inlined_origin, &n) == NULL
+      || __libdw_die_index_scope_depth (index, n) == 0)
+    return 0;
+
+  unsigned int nscopes = a->nscopes + index->depth[n];
+  Dwarf_Die *scopes = realloc (a->scopes, nscopes * sizeof scopes[0]);
+  if (scopes == NULL)
+    {
+      free (a->scopes);
+      __libdw_seterrno (DWARF_E_NOMEM);
+      return -1;
+    }
+
+  a->scopes = scopes;
+  while (a->nscopes < nscopes)
+    {
+      n = index->parent[n];
+      INTUSE(dwarf_die_index_die) (index, n, &scopes[a->nscopes++]);
+    }
+  return a->nscopes;
+}
+
 /* Postorder visitor: first (innermost) call wins.  */
 static int
 pc_record (unsigned int depth, struct Dwarf_Die_Chain *die, void *arg)
@@ -178,6 +213,9 @@ pc_record (unsigned int depth, struct Dwarf_Die_Chain *die, void *arg)
      If we don't find it, return to search the containing scope.
      If we do find it, the nonzero return value will bail us out
      of the postorder traversal.  */
+  int result = origin_match_index (a, die);
+  if (result != 0)
+    return result;
   return __libdw_visit_scopes (depth, die, NULL, &origin_match, NULL, a);
 }
 
@@ -201,3 +239,4 @@ dwarf_getscopes (Dwarf_Die *cudie, Dwarf_Addr pc, Dwarf_Die **scopes)
 
   return result;
 }
+INTDEF (dwarf_getscopes)
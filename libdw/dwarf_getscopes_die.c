@@ -65,6 +65,27 @@ dwarf_getscopes_die (Dwarf_Die *die, Dwarf_Die **scopes)
   if (die == NULL)
     return -1;
 
+  /* With a DIE index the parents are known without a walk.  */
+  size_t n;
+  const Dwarf_Die_Index *index = __libdw_die_index_lookup (die, &n);
+  unsigned int depth = (index != NULL
+			? __libdw_die_index_scope_depth (index, n) : 0);
+  if (depth > 0)
+    {
+      Dwarf_Die *result = malloc (depth * sizeof result[0]);
+      if (result == NULL)
+	{
+	  __libdw_seterrno (DWARF_E_NOMEM);
+	  return -1;
+	}
+
+      for (unsigned int i = 0; i < depth; ++i, n = index->parent[n])
+	INTUSE(dwarf_die_index_die) (index, n, &result[i]);
+
+      *scopes = result;
+      return depth;
+    }
+
   struct Dwarf_Die_Chain cu = { .die = CUDIE (die->cu), .parent = NULL };
   void *info = die->addr;
   int result = __libdw_visit_scopes (1, &cu, NULL, &scope_visitor, NULL, &info);
@@ -50,6 +50,7 @@ dwarf_getsrcfiles (Dwarf_Die *cudie, Dwarf_Files **files, size_t *nfiles)
 
   /* Get the information if it is not already known.  */
   struct Dwarf_CU *const cu = cudie->cu;
+  pthread_mutex_lock (&cu->src_lock);
   if (cu->files == NULL)
     {
       /* For split units there might be a simple file table (without lines).
@@ -78,7 +79,8 @@ dwarf_getsrcfiles (Dwarf_Die *cudie, Dwarf_Files **files, size_t *nfiles)
 		{
 		  Dwarf_Die skeldie = CUDIE (skel);
 		  res = INTUSE(dwarf_getsrcfiles) (&skeldie, files, nfiles);
-		  cu->files = skel->files;
+		  if (res == 0)
+		    cu->files = *files;
 		}
 	    }
 	}
@@ -88,8 +90,11 @@ dwarf_getsrcfiles (Dwarf_Die *cudie, Dwarf_Files **files, size_t *nfiles)
 	  size_t nlines;
 
 	  /* Let the more generic function do the work.  It'll create more
-	     data but that will be needed in an real program anyway.  */
+	     data but that will be needed in an real program anyway.
+	     It takes the lock itself.  */
+	  pthread_mutex_unlock (&cu->src_lock);
 	  res = INTUSE(dwarf_getsrclines) (cudie, &lines, &nlines);
+	  pthread_mutex_lock (&cu->src_lock);
 	}
     }
   else if (cu->files != (void *) -1l)
@@ -104,7 +109,7 @@ dwarf_getsrcfiles (Dwarf_Die *cudie, Dwarf_Files **files, size_t *nfiles)
 	*nfiles = cu->files->nfiles;
     }
 
-  // XXX Eventually: unlocking here.
+  pthread_mutex_unlock (&cu->src_lock);
 
   return res;
 }
@@ -45,36 +45,56 @@ struct filelist
   struct filelist *next;
 };
 
-struct linelist
+/* Sort key of a decoded row.  IDX is the position in the line
+   program, which maintains a stable sort.  */
+struct line_order
 {
-  Dwarf_Line line;
-  struct linelist *next;
-  size_t sequence;
+  Dwarf_Addr addr;
+  size_t idx;
+  bool end_sequence;
 };
 
+/* Compare by address.  An end_sequence marker precedes a normal record
+   at the same address.  Otherwise the program order is kept.  */
+static inline int
+compare_order (Dwarf_Addr addr1, bool end1, size_t idx1,
+	       Dwarf_Addr addr2, bool end2, size_t idx2)
+{
+  if (addr1 != addr2)
+    return (addr1 < addr2) ? -1 : 1;
+
+  if (end1 != end2)
+    return end1 ? -1 : 1;
+
+  return (idx1 < idx2) ? -1 : (idx1 > idx2) ? 1 : 0;
+}
 
-/* Compare by Dwarf_Line.addr, given pointers into an array of pointers.  */
 static int
 compare_lines (const void *a, const void *b)
 {
-  struct linelist *const *p1 = a;
-  struct linelist *const *p2 = b;
-  struct linelist *list1 = *p1;
-  struct linelist *list2 = *p2;
-  Dwarf_Line *line1 = &list1->line;
-  Dwarf_Line *line2 = &list2->line;
-
-  if (line1->addr != line2->addr)
-    return (line1->addr < line2->addr) ? -1 : 1;
-
-  /* An end_sequence marker precedes a normal record at the same address.  */
-  if (line1->end_sequence != line2->end_sequence)
-    return line2->end_sequence - line1->end_sequence;
-
-  /* Otherwise, the linelist sequence maintains a stable sort.  */
-  return (list1->sequence < list2->sequence) ? -1
-    : (list1->sequence > list2->sequence) ? 1
-    : 0;
+  const struct line_order *o1 = a;
+  const struct line_order *o2 = b;
+  return compare_order (o1->addr, o1->end_sequence, o1->idx,
+			o2->addr, o2->end_sequence, o2->idx);
+}
+
+/* A run of rows ending in an end_sequence marker, sorted by its
+   first row.  */
+struct line_sequence
+{
+  Dwarf_Addr addr;
+  size_t start;
+  size_t n;
+  bool end_sequence;
+};
+
+static int
+compare_sequences (const void *a, const void *b)
+{
+  const struct line_sequence *s1 = a;
+  const struct line_sequence *s2 = b;
+  return compare_order (s1->addr, s1->end_sequence, s1->start,
+			s2->addr, s2->end_sequence, s2->start);
 }
 
 struct line_state
@@ -90,8 +110,9 @@ struct line_state
   bool epilogue_begin;
   unsigned int isa;
   unsigned int discriminator;
-  struct linelist *linelist;
-  size_t nlinelist;
+  Dwarf_Line *lines;
+  size_t nlines;
+  size_t nalloc;
   unsigned int end_sequence;
 };
 
@@ -104,17 +125,36 @@ run_advance_pc (struct line_state *state, unsigned int op_advance,
   state->op_index = (state->op_index + op_advance) % max_ops_per_instr;
 }
 
+/* Makes room for more rows.  The first rows are stored in STACK,
+   which is copied when it is full.  */
+static bool
+grow_lines (struct line_state *state, Dwarf_Line *stack)
+{
+  if (state->nalloc > SIZE_MAX / 2 / sizeof (Dwarf_Line))
+    return true;
+
+  size_t nalloc = state->nalloc * 2;
+  Dwarf_Line *lines;
+  if (state->lines == stack)
+    {
+      lines = malloc (nalloc * sizeof (Dwarf_Line));
+      if (lines != NULL)
+	memcpy (lines, stack, state->nlines * sizeof (Dwarf_Line));
+    }
+  else
+    lines = realloc (state->lines, nalloc * sizeof (Dwarf_Line));
+  if (unlikely (lines == NULL))
+    return true;
+
+  state->lines = lines;
+  state->nalloc = nalloc;
+  return false;
+}
+
 static inline bool
-add_new_line (struct line_state *state, struct linelist *new_line)
+add_new_line (struct line_state *state)
 {
-  /* Set the line information.  For some fields we use bitfields,
-     so we would lose information if the encoded values are too large.
-     Check just for paranoia, and call the data "invalid" if it
-     violates our assumptions on reasonable limits for the values.  */
-  new_line->next = state->linelist;
-  new_line->sequence = state->nlinelist;
-  state->linelist = new_line;
-  ++(state->nlinelist);
+  Dwarf_Line *new_line = &state->lines[state->nlines++];
 
   /* Set the line information.  For some fields we use bitfields,
      so we would lose information if the encoded values are too large.
@@ -122,8 +162,8 @@ add_new_line (struct line_state *state, struct linelist *new_line)
      violates our assumptions on reasonable limits for the values.  */
 #define SET(field)						      \
   do {								      \
-     new_line->line.field = state->field;			      \
-     if (unlikely (new_line->line.field != state->field))	      \
+     new_line->field = state->field;				      \
+     if (unlikely (new_line->field != state->field))		      \
        return true;						      \
    } while (0)
 
@@ -145,6 +185,89 @@ add_new_line (struct line_state *state, struct linelist *new_line)
   return false;
 }
 
+/* Copies the N ROWS to SORTED ordered by sequences.  Returns 1 if
+   that didn't give all rows in order, because the sequences overlap
+   or the addresses in a sequence don't ascend, -1 if out of memory
+   and 0 on success.  */
+static int
+sort_sequences (const Dwarf_Line *rows, size_t n, Dwarf_Line *sorted)
+{
+  size_t nseqs = 0;
+  for (size_t i = 0; i < n; i++)
+    if (rows[i].end_sequence || i == n - 1)
+      nseqs++;
+  if (nseqs == 0)
+    return 0;
+
+  struct line_sequence *seqs = malloc (nseqs * sizeof seqs[0]);
+  if (unlikely (seqs == NULL))
+    return -1;
+
+  size_t start = 0;
+  nseqs = 0;
+  for (size_t i = 0; i < n; i++)
+    if (rows[i].end_sequence || i == n - 1)
+      {
+	seqs[nseqs].addr = rows[start].addr;
+	seqs[nseqs].start = start;
+	seqs[nseqs].n = i + 1 - start;
+	seqs[nseqs].end_sequence = rows[start].end_sequence;
+	nseqs++;
+	start = i + 1;
+      }
+
+  if (nseqs > 1)
+    qsort (seqs, nseqs, sizeof seqs[0], compare_sequences);
+
+  int res = 0;
+  size_t k = 0;
+  size_t prev = 0;
+  for (size_t s = 0; s < nseqs && res == 0; s++)
+    for (size_t i = seqs[s].start; i < seqs[s].start + seqs[s].n; i++)
+      {
+	if (k > 0 && compare_order (rows[prev].addr, rows[prev].end_sequence,
+				    prev, rows[i].addr, rows[i].end_sequence,
+				    i) > 0)
+	  {
+	    res = 1;
+	    break;
+	  }
+	sorted[k++] = rows[i];
+	prev = i;
+      }
+
+  free (seqs);
+  return res;
+}
+
+/* Copies the N ROWS to SORTED ordered by address.  Returns -1 if out
+   of memory and 0 on success.  */
+static int
+sort_lines (const Dwarf_Line *rows, size_t n, Dwarf_Line *sorted)
+{
+  if (n == 0)
+    return 0;
+
+  struct line_order *order = malloc (n * sizeof order[0]);
+  if (unlikely (order == NULL))
+    return -1;
+
+  for (size_t i = 0; i < n; i++)
+    {
+      order[i].addr = rows[i].addr;
+      order[i].idx = i;
+      order[i].end_sequence = rows[i].end_sequence;
+    }
+
+  qsort (order, n, sizeof order[0], compare_lines);
+
+  for (size_t i = 0; i < n; i++)
+    sorted[i] = rows[order[i].idx];
+
+  free (order);
+  return 0;
+}
+
 static int
 read_srclines (Dwarf *dbg,
 	       const unsigned char *linep, const unsigned char *lineendp,
@@ -168,8 +291,9 @@ read_srclines (Dwarf *dbg,
   /* Initial statement program state (except for stmt_list, see below).  */
   struct line_state state =
     {
-      .linelist = NULL,
-      .nlinelist = 0,
+      .lines = NULL,
+      .nlines = 0,
+      .nalloc = 0,
       .addr = 0,
       .op_index = 0,
       .file = 1,
@@ -667,18 +791,18 @@ read_srclines (Dwarf *dbg,
 
   /* Process the instructions.  */
 
-  /* Adds a new line to the matrix.  For the first MAX_STACK_LINES
-     entries just return a slot in the preallocated stack array.  */
-  struct linelist llstack[MAX_STACK_LINES];
+  /* Adds a new line to the matrix.  The rows are appended to one
+     array, the first MAX_STACK_LINES of them on the stack.  */
+  Dwarf_Line llstack[MAX_STACK_LINES];
+  state.lines = llstack;
+  state.nalloc = MAX_STACK_LINES;
 #define NEW_LINE(end_seq)						\
   do {								\
-    struct linelist *ll = (state.nlinelist < MAX_STACK_LINES	\
-			   ? &llstack[state.nlinelist]		\
-			   : malloc (sizeof (struct linelist)));	\
-    if (unlikely (ll == NULL))					\
+    if (unlikely (state.nlines == state.nalloc)			\
+	&& unlikely (grow_lines (&state, llstack)))		\
       goto no_mem;						\
     state.end_sequence = end_seq;				\
-    if (unlikely (add_new_line (&state, ll)))			\
+    if (unlikely (add_new_line (&state)))			\
       goto invalid_data;						\
   } while (0)
 
@@ -1014,47 +1138,28 @@ read_srclines (Dwarf *dbg,
   if (filesp != NULL)
     *filesp = files;
 
-  size_t buf_size = (sizeof (Dwarf_Lines)
-		     + (sizeof (Dwarf_Line) * state.nlinelist));
-  void *buf = libdw_alloc (dbg, Dwarf_Lines, buf_size, 1);
-
-  /* First use the buffer for the pointers, and sort the entries.
-     We'll write the pointers in the end of the buffer, and then
-     copy into the buffer from the beginning so the overlap works.  */
-  assert (sizeof (Dwarf_Line) >= sizeof (struct linelist *));
-  struct linelist **sortlines = (buf + buf_size
-				 - sizeof (struct linelist **) * state.nlinelist);
-
-  /* The list is in LIFO order and usually they come in clumps with
-     ascending addresses.  So fill from the back to probably start with
-     runs already in order before we sort.  */
-  struct linelist *lineslist = state.linelist;
-  for (size_t i = state.nlinelist; i-- > 0; )
-    {
-      sortlines[i] = lineslist;
-      lineslist = lineslist->next;
-    }
-  assert (lineslist == NULL);
+  Dwarf_Lines *lines = libdw_alloc (dbg, Dwarf_Lines,
+				    (sizeof (Dwarf_Lines)
+				     + sizeof (Dwarf_Line) * state.nlines),
+				    1);
+  lines->nlines = state.nlines;
 
-  /* Sort by ascending address.  */
-  qsort (sortlines, state.nlinelist, sizeof sortlines[0], &compare_lines);
+  /* Sort by ascending address.  The rows of a sequence normally are in
+     order already, then it is enough to sort the sequences.  */
+  int sorted = sort_sequences (state.lines, state.nlines, lines->info);
+  if (sorted > 0)
+    sorted = sort_lines (state.lines, state.nlines, lines->info);
+  if (unlikely (sorted < 0))
+    goto no_mem;
 
-  /* Now that they are sorted, put them in the final array.
-     The buffers overlap, so we've clobbered the early elements
-     of SORTLINES by the time we're reading the later ones.  */
-  Dwarf_Lines *lines = buf;
-  lines->nlines = state.nlinelist;
-  for (size_t i = 0; i < state.nlinelist; ++i)
-    {
-      lines->info[i] = sortlines[i]->line;
-      lines->info[i].files = files;
-    }
+  for (size_t i = 0; i < state.nlines; ++i)
+    lines->info[i].files = files;
 
   /* Make sure the highest address for the CU is marked as end_sequence.
      This is required by the DWARF spec, but some compilers forget and
      dwfl_module_getsrc depends on it.  */
-  if (state.nlinelist > 0)
-    lines->info[state.nlinelist - 1].end_sequence = 1;
+  if (state.nlines > 0)
+    lines->info[state.nlines - 1].end_sequence = 1;
 
   /* Pass the line structure back to the caller.  */
   if (linesp != NULL)
@@ -1065,12 +1170,8 @@ read_srclines (Dwarf *dbg,
 
  out:
   /* Free malloced line records, if any.  */
-  for (size_t i = MAX_STACK_LINES; i < state.nlinelist; i++)
-    {
-      struct linelist *ll = state.linelist->next;
-      free (state.linelist);
-      state.linelist = ll;
-    }
+  if (state.lines != llstack)
+    free (state.lines);
   if (dirarray != dirstack)
     free (dirarray);
   for (size_t i = MAX_STACK_FILES; i < nfilelist; i++)
@@ -1104,8 +1205,8 @@ __libdw_getsrclines (Dwarf *dbg, Dwarf_Off debug_line_offset,
 		     Dwarf_Lines **linesp, Dwarf_Files **filesp)
 {
   struct files_lines_s fake = { .debug_line_offset = debug_line_offset };
-  struct files_lines_s **found = tfind (&fake, &dbg->files_lines,
-					files_lines_compare);
+  struct files_lines_s **found = eu_tfind (&fake, &dbg->files_lines,
+					   files_lines_compare);
   if (found == NULL)
     {
       Elf_Data *data = __libdw_checked_get_data (dbg, IDX_debug_line);
@@ -1126,7 +1227,9 @@ __libdw_getsrclines (Dwarf *dbg, Dwarf_Off debug_line_offset,
 
       node->debug_line_offset = debug_line_offset;
 
-      found = tsearch (node, &dbg->files_lines, files_lines_compare);
+      /* The table is decoded without holding the lock.  If another
+	 thread got there first, eu_tsearch returns the existing node.  */
+      found = eu_tsearch (node, &dbg->files_lines, files_lines_compare);
       if (found == NULL)
 	{
 	  __libdw_seterrno (DWARF_E_NOMEM);
@@ -1165,8 +1268,11 @@ dwarf_getsrclines (Dwarf_Die *cudie, Dwarf_Lines **lines, size_t *nlines)
       return -1;
     }
 
+  int res = -1;
+
   /* Get the information if it is not already known.  */
   struct Dwarf_CU *const cu = cudie->cu;
+  pthread_mutex_lock (&cu->src_lock);
   if (cu->lines == NULL)
     {
       /* For split units always pick the lines from the skeleton.  */
@@ -1180,18 +1286,13 @@ dwarf_getsrclines (Dwarf_Die *cudie, Dwarf_Lines **lines, size_t *nlines)
 	  if (skel != NULL)
 	    {
 	      Dwarf_Die skeldie = CUDIE (skel);
-	      int res = INTUSE(dwarf_getsrclines) (&skeldie, lines, nlines);
+	      res = INTUSE(dwarf_getsrclines) (&skeldie, lines, nlines);
 	      if (res == 0)
-		{
-		  cu->lines = skel->lines;
-		  *lines = cu->lines;
-		  *nlines = cu->lines->nlines;
-		}
-	      return res;
+		cu->lines = *lines;
 	    }
-
-	  __libdw_seterrno (DWARF_E_NO_DEBUG_LINE);
-	  return -1;
+	  else
+	    __libdw_seterrno (DWARF_E_NO_DEBUG_LINE);
+	  goto out;
 	}
 
       /* Failsafe mode: no data found.  */
@@ -1208,21 +1309,22 @@ dwarf_getsrclines (Dwarf_Die *cudie, Dwarf_Lines **lines, size_t *nlines)
       Dwarf_Off debug_line_offset;
       if (__libdw_formptr (stmt_list, IDX_debug_line, DWARF_E_NO_DEBUG_LINE,
 			   NULL, &debug_line_offset) == NULL)
-	return -1;
+	goto out;
 
       if (__libdw_getsrclines (cu->dbg, debug_line_offset,
 			       __libdw_getcompdir (cudie),
 			       cu->address_size, &cu->lines, &cu->files) < 0)
-	return -1;
+	goto out;
     }
   else if (cu->lines == (void *) -1l)
-    return -1;
+    goto out;
 
   *lines = cu->lines;
   *nlines = cu->lines->nlines;
+  res = 0;
 
-  // XXX Eventually: unlocking here.
-
-  return 0;
+ out:
+  pthread_mutex_unlock (&cu->src_lock);
+  return res;
 }
 INTDEF(dwarf_getsrclines)
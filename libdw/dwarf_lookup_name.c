@@ -0,0 +1,1006 @@
+/* Look up DIEs by name through .debug_names, .gdb_index or a scan.
+   This file is part of elfutils.
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of either
+
+     * the GNU Lesser General Public License as published by the Free
+       Software Foundation; either version 3 of the License, or (at
+       your option) any later version
+
+   or
+
+     * the GNU General Public License as published by the Free
+       Software Foundation; either version 2 of the License, or (at
+       your option) any later version
+
+   or both in parallel, as here.
+
+   elfutils is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received copies of the GNU General Public License and
+   the GNU Lesser General Public License along with this program.  If
+   not, see <http://www.gnu.org/licenses/>.  */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <ctype.h>
+#include <endian.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libdwP.h"
+#include <dwarf.h>
+#include <system.h>
+
+
+/* A decoded .debug_names abbreviation.  */
+struct names_abbrev
+{
+  Dwarf_Word code;
+  Dwarf_Word tag;
+  const unsigned char *attrs;	/* DW_IDX/DW_FORM pairs, ending in 0/0.  */
+};
+
+/* One name index (unit) of the .debug_names section.  */
+struct names_unit
+{
+  uint8_t offset_size;
+  uint32_t comp_unit_count;
+  uint32_t local_type_unit_count;
+  uint32_t bucket_count;
+  uint32_t name_count;
+  const unsigned char *cu_list;
+  const unsigned char *tu_list;
+  const unsigned char *buckets;
+  const unsigned char *hashes;
+  const unsigned char *str_offsets;
+  const unsigned char *entry_offsets;
+  const unsigned char *entry_pool;
+  const unsigned char *end;
+  size_t nabbrevs;
+  struct names_abbrev *abbrevs;
+};
+
+/* An entry in the index built by scanning all DIEs.  */
+struct scan_entry
+{
+  uint32_t hash;
+  const char *name;
+  Dwarf_Off cu_offset;
+  Dwarf_Off die_offset;
+};
+
+struct Dwarf_Name_Index
+{
+  enum
+  {
+    name_index_debug_names,
+    name_index_gdb_index,
+    name_index_scan
+  } kind;
+
+  union
+  {
+    /* .debug_names, one or more concatenated name indexes.  */
+    struct
+    {
+      size_t nunits;
+      struct names_unit *units;
+    } names;
+
+    /* .gdb_index, always little endian.  */
+    struct
+    {
+      uint32_t version;
+      const unsigned char *cu_list;
+      uint32_t ncus;
+      const unsigned char *symtab;
+      uint32_t nslots;
+      const unsigned char *pool;
+      const unsigned char *end;
+    } gdb;
+
+    /* Open addressing hash table over all named DIEs.  SLOTS holds
+       an index into ENTRIES plus one, or zero for an empty slot.  */
+    struct
+    {
+      size_t nentries;
+      struct scan_entry *entries;
+      size_t nslots;
+      size_t *slots;
+    } scan;
+  };
+};
+
+
+void
+internal_function
+__libdw_name_index_free (struct Dwarf_Name_Index *index)
+{
+  if (index == NULL)
+    return;
+
+  switch (index->kind)
+    {
+    case name_index_debug_names:
+      for (size_t i = 0; i < index->names.nunits; i++)
+	free (index->names.units[i].abbrevs);
+      free (index->names.units);
+      break;
+    case name_index_gdb_index:
+      break;
+    case name_index_scan:
+      free (index->scan.entries);
+      free (index->scan.slots);
+      break;
+    }
+  free (index);
+}
+
+
+/* The .debug_names hash function, DJB with (ASCII) case folding.  */
+static uint32_t
+names_hash (const char *name)
+{
+  uint32_t hash = 5381;
+  for (const unsigned char *s = (const unsigned char *) name; *s != '\0'; s++)
+    hash = hash * 33 + (*s < 0x80 ? tolower (*s) : *s);
+  return hash;
+}
+
+/* The .gdb_index hash function, mapped_index_string_hash in gdb.  */
+static uint32_t
+gdb_index_hash (uint32_t version, const char *name)
+{
+  uint32_t hash = 0;
+  for (const unsigned char *s = (const unsigned char *) name; *s != '\0'; s++)
+    hash = hash * 67 + (version >= 5 ? tolower (*s) : *s) - 113;
+  return hash;
+}
+
+static Dwarf_Off
+read_offset (Dwarf *dbg, const unsigned char *p, uint8_t offset_size)
+{
+  return (offset_size == 4
+	  ? read_4ubyte_unaligned (dbg, p)
+	  : read_8ubyte_unaligned (dbg, p));
+}
+
+/* Read a .debug_names attribute value.  Returns false for unknown forms.  */
+static bool
+read_form (Dwarf *dbg, unsigned int form, uint8_t offset_size,
+	   const unsigned char **pp, const unsigned char *end,
+	   Dwarf_Word *value)
+{
+  const unsigned char *p = *pp;
+  size_t len;
+  switch (form)
+    {
+    case DW_FORM_flag_present:
+      *value = 1;
+      return true;
+    case DW_FORM_data1:
+    case DW_FORM_ref1:
+    case DW_FORM_flag:
+      len = 1;
+      break;
+    case DW_FORM_data2:
+    case DW_FORM_ref2:
+      len = 2;
+      break;
+    case DW_FORM_data4:
+    case DW_FORM_ref4:
+      len = 4;
+      break;
+    case DW_FORM_data8:
+    case DW_FORM_ref8:
+    case DW_FORM_ref_sig8:
+      len = 8;
+      break;
+    case DW_FORM_sec_offset:
+      len = offset_size;
+      break;
+    case DW_FORM_udata:
+    case DW_FORM_ref_udata:
+      if (p >= end)
+	return false;
+      get_uleb128 (*value, p, end);
+      *pp = p;
+      return true;
+    default:
+      return false;
+    }
+
+  if ((size_t) (end - p) < len)
+    return false;
+  switch (len)
+    {
+    case 1:
+      *value = *p;
+      break;
+    case 2:
+      *value = read_2ubyte_unaligned (dbg, p);
+      break;
+    case 4:
+      *value = read_4ubyte_unaligned (dbg, p);
+      break;
+    default:
+      *value = read_8ubyte_unaligned (dbg, p);
+      break;
+    }
+  *pp = p + len;
+  return true;
+}
+
+/* Parse the header and abbreviation table of one .debug_names name
+   index starting at *READP.  */
+static bool
+load_names_unit (Dwarf *dbg, const unsigned char **readp,
+		 const unsigned char *secend, struct names_unit *unit)
+{
+  const unsigned char *p = *readp;
+  if (secend - p < 4)
+    return false;
+
+  Dwarf_Word len = read_4ubyte_unaligned_inc (dbg, p);
+  unit->offset_size = 4;
+  if (len == DWARF3_LENGTH_64_BIT)
+    {
+      if (secend - p < 8)
+	return false;
+      len = read_8ubyte_unaligned_inc (dbg, p);
+      unit->offset_size = 8;
+    }
+  else if (unlikely (len >= DWARF3_LENGTH_MIN_ESCAPE_CODE
+		     && len <= DWARF3_LENGTH_MAX_ESCAPE_CODE))
+    return false;
+
+  if (len > (size_t) (secend - p) || len < 2 + 2 + 7 * 4)
+    return false;
+  const unsigned char *end = p + len;
+
+  uint16_t version = read_2ubyte_unaligned_inc (dbg, p);
+  if (version != 5)
+    return false;
+  p += 2; /* Padding.  */
+
+  unit->comp_unit_count = read_4ubyte_unaligned_inc (dbg, p);
+  unit->local_type_unit_count = read_4ubyte_unaligned_inc (dbg, p);
+  uint32_t foreign_type_unit_count = read_4ubyte_unaligned_inc (dbg, p);
+  unit->bucket_count = read_4ubyte_unaligned_inc (dbg, p);
+  unit->name_count = read_4ubyte_unaligned_inc (dbg, p);
+  uint32_t abbrev_table_size = read_4ubyte_unaligned_inc (dbg, p);
+  uint32_t augmentation_string_size = read_4ubyte_unaligned_inc (dbg, p);
+  uint8_t off = unit->offset_size;
+
+  /* Check that all the tables fit, in 64-bit to avoid overflow.  */
+  uint64_t need = ((uint64_t) ((augmentation_string_size + 3) & ~3u)
+		   + (uint64_t) unit->comp_unit_count * off
+		   + (uint64_t) unit->local_type_unit_count * off
+		   + (uint64_t) foreign_type_unit_count * 8
+		   + (uint64_t) unit->bucket_count * 4
+		   + (uint64_t) unit->name_count * (4 + 2 * off)
+		   + abbrev_table_size);
+  if (unit->bucket_count == 0)
+    need -= (uint64_t) unit->name_count * 4;
+  if (need > (uint64_t) (end - p))
+    return false;
+
+  p += (augmentation_string_size + 3) & ~3u;
+  unit->cu_list = p;
+  p += (size_t) unit->comp_unit_count * off;
+  unit->tu_list = p;
+  p += (size_t) unit->local_type_unit_count * off;
+  p += (size_t) foreign_type_unit_count * 8;
+  unit->buckets = p;
+  p += (size_t) unit->bucket_count * 4;
+  unit->hashes = p;
+  if (unit->bucket_count > 0)
+    p += (size_t) unit->name_count * 4;
+  unit->str_offsets = p;
+  p += (size_t) unit->name_count * off;
+  unit->entry_offsets = p;
+  p += (size_t) unit->name_count * off;
+
+  const unsigned char *abbrevp = p;
+  const unsigned char *abbrevend = p + abbrev_table_size;
+  unit->entry_pool = abbrevend;
+  unit->end = end;
+
+  /* Decode the abbreviations, so entries can be read without searching.  */
+  size_t nalloc = 0;
+  unit->nabbrevs = 0;
+  unit->abbrevs = NULL;
+  while (abbrevp < abbrevend)
+    {
+      Dwarf_Word code;
+      get_uleb128 (code, abbrevp, abbrevend);
+      if (code == 0)
+	break;
+
+      if (unit->nabbrevs == nalloc)
+	{
+	  nalloc = nalloc == 0 ? 16 : 2 * nalloc;
+	  struct names_abbrev *newp = realloc (unit->abbrevs,
+					       nalloc * sizeof newp[0]);
+	  if (unlikely (newp == NULL))
+	    goto invalid;
+	  unit->abbrevs = newp;
+	}
+
+      struct names_abbrev *abbrev = &unit->abbrevs[unit->nabbrevs++];
+      abbrev->code = code;
+      if (abbrevp >= abbrevend)
+	goto invalid;
+      get_uleb128 (abbrev->tag, abbrevp, abbrevend);
+      abbrev->attrs = abbrevp;
+
+      Dwarf_Word attr, form;
+      do
+	{
+	  if (abbrevp >= abbrevend)
+	    goto invalid;
+	  get_uleb128 (attr, abbrevp, abbrevend);
+	  if (abbrevp >= abbrevend)
+	    goto invalid;
+	  get_uleb128 (form, abbrevp, abbrevend);
+	}
+      while (attr != 0 || form != 0);
+    }
+
+  *readp = end;
+  return true;
+
+ invalid:
+  free (unit->abbrevs);
+  unit->abbrevs = NULL;
+  return false;
+}
+
+static struct Dwarf_Name_Index *
+load_debug_names (Dwarf *dbg)
+{
+  Elf_Data *data = dbg->sectiondata[IDX_debug_names];
+  if (data == NULL || dbg->sectiondata[IDX_debug_str] == NULL
+      || dbg->sectiondata[IDX_debug_info] == NULL)
+    return NULL;
+
+  struct Dwarf_Name_Index *index = calloc (1, sizeof *index);
+  if (unlikely (index == NULL))
+    {
+      __libdw_seterrno (DWARF_E_NOMEM);
+      return NULL;
+    }
+  index->kind = name_index_debug_names;
+
+  const unsigned char *readp = data->d_buf;
+  const unsigned char *endp = readp + data->d_size;
+  size_t nalloc = 0;
+  while (readp < endp)
+    {
+      if (index->names.nunits == nalloc)
+	{
+	  nalloc = nalloc == 0 ? 4 : 2 * nalloc;
+	  struct names_unit *newp = realloc (index->names.units,
+					     nalloc * sizeof newp[0]);
+	  if (unlikely (newp == NULL))
+	    {
+	      __libdw_seterrno (DWARF_E_NOMEM);
+	      goto fail;
+	    }
+	  index->names.units = newp;
+	}
+
+      if (! load_names_unit (dbg, &readp, endp,
+			     &index->names.units[index->names.nunits]))
+	goto fail;
+      index->names.nunits++;
+    }
+
+  return index;
+
+ fail:
+  __libdw_name_index_free (index);
+  return NULL;
+}
+
+static struct Dwarf_Name_Index *
+load_gdb_index (Dwarf *dbg)
+{
+  Elf_Data *data = dbg->sectiondata[IDX_gdb_index];
+  if (data == NULL || data->d_size < 6 * 4)
+    return NULL;
+
+  const unsigned char *start = data->d_buf;
+  uint32_t version = le32toh (read_4ubyte_unaligned_noncvt (start));
+  /* The symbol kinds were added in version 7, older versions from 5 on
+     use the same layout and hash function.  */
+  if (version < 5 || version > 8)
+    return NULL;
+
+  uint32_t cu_list_off = le32toh (read_4ubyte_unaligned_noncvt (start + 4));
+  uint32_t types_off = le32toh (read_4ubyte_unaligned_noncvt (start + 8));
+  uint32_t symtab_off = le32toh (read_4ubyte_unaligned_noncvt (start + 16));
+  uint32_t pool_off = le32toh (read_4ubyte_unaligned_noncvt (start + 20));
+  /* The CU list entries are read through NCUS, so the tables must be
+     in order and inside the section.  */
+  if (cu_list_off < 6 * 4 || cu_list_off > types_off
+      || types_off > symtab_off || symtab_off > pool_off
+      || pool_off > data->d_size
+      || (types_off - cu_list_off) % 16 != 0)
+    return NULL;
+
+  uint32_t nslots = (pool_off - symtab_off) / 8;
+  if (nslots == 0 || (nslots & (nslots - 1)) != 0)
+    return NULL;
+
+  struct Dwarf_Name_Index *index = calloc (1, sizeof *index);
+  if (unlikely (index == NULL))
+    {
+      __libdw_seterrno (DWARF_E_NOMEM);
+      return NULL;
+    }
+
+  index->kind = name_index_gdb_index;
+  index->gdb.version = version;
+  index->gdb.cu_list = start + cu_list_off;
+  index->gdb.ncus = (types_off - cu_list_off) / 16;
+  index->gdb.symtab = start + symtab_off;
+  index->gdb.nslots = nslots;
+  index->gdb.pool = start + pool_off;
+  index->gdb.end = start + data->d_size;
+  return index;
+}
+
+
+/* Tags that .debug_names would index, see DWARF5 section 6.1.1.1.  */
+static bool
+indexed_tag (int tag)
+{
+  switch (tag)
+    {
+    case DW_TAG_base_type:
+    case DW_TAG_class_type:
+    case DW_TAG_constant:
+    case DW_TAG_enumeration_type:
+    case DW_TAG_enumerator:
+    case DW_TAG_imported_declaration:
+    case DW_TAG_inlined_subroutine:
+    case DW_TAG_interface_type:
+    case DW_TAG_label:
+    case DW_TAG_module:
+    case DW_TAG_namespace:
+    case DW_TAG_ptr_to_member_type:
+    case DW_TAG_string_type:
+    case DW_TAG_structure_type:
+    case DW_TAG_subprogram:
+    case DW_TAG_subrange_type:
+    case DW_TAG_typedef:
+    case DW_TAG_union_type:
+    case DW_TAG_unspecified_type:
+    case DW_TAG_variable:
+      return true;
+    default:
+      return false;
+    }
+}
+
+/* Whether DIE has code, only then subprograms, inlined subroutines and
+   labels are indexed.  */
+static bool
+has_address (Dwarf_Die *die)
+{
+  return (INTUSE(dwarf_hasattr) (die, DW_AT_low_pc)
+	  || INTUSE(dwarf_hasattr) (die, DW_AT_high_pc)
+	  || INTUSE(dwarf_hasattr) (die, DW_AT_ranges)
+	  || INTUSE(dwarf_hasattr) (die, DW_AT_entry_pc));
+}
+
+/* Whether the location of variable DIE is a static or thread local
+   address.  Local variables on the stack or in registers are not
+   indexed.  */
+static bool
+has_static_location (Dwarf_Die *die)
+{
+  Dwarf_Attribute attr;
+  Dwarf_Op *expr;
+  size_t len;
+  if (INTUSE(dwarf_attr) (die, DW_AT_location, &attr) == NULL
+      || INTUSE(dwarf_getlocation) (&attr, &expr, &len) != 0)
+    return false;
+
+  for (size_t i = 0; i < len; i++)
+    switch (expr[i].atom)
+      {
+      case DW_OP_addr:
+      case DW_OP_addrx:
+      case DW_OP_GNU_addr_index:
+      case DW_OP_form_tls_address:
+      case DW_OP_GNU_push_tls_address:
+	return true;
+      default:
+	break;
+      }
+  return false;
+}
+
+struct scan_state
+{
+  struct Dwarf_Name_Index *index;
+  size_t nalloc;
+  Dwarf_Off cu_offset;
+};
+
+static bool
+scan_add (struct scan_state *state, Dwarf_Die *die, const char *name)
+{
+  struct Dwarf_Name_Index *index = state->index;
+  if (index->scan.nentries == state->nalloc)
+    {
+      state->nalloc = state->nalloc == 0 ? 1024 : 2 * state->nalloc;
+      struct scan_entry *newp = realloc (index->scan.entries,
+					 state->nalloc * sizeof newp[0]);
+      if (unlikely (newp == NULL))
+	{
+	  __libdw_seterrno (DWARF_E_NOMEM);
+	  return false;
+	}
+      index->scan.entries = newp;
+    }
+
+  struct scan_entry *entry = &index->scan.entries[index->scan.nentries++];
+  entry->hash = names_hash (name);
+  entry->name = name;
+  entry->cu_offset = state->cu_offset;
+  entry->die_offset = INTUSE(dwarf_dieoffset) (die);
+  return true;
+}
+
+/* Index DIE like .debug_names would.  */
+static bool
+scan_die (struct scan_state *state, Dwarf_Die *die)
+{
+  int tag = INTUSE(dwarf_tag) (die);
+  if (! indexed_tag (tag) || INTUSE(dwarf_hasattr) (die, DW_AT_declaration))
+    return true;
+
+  bool code = (tag == DW_TAG_subprogram
+	       || tag == DW_TAG_inlined_subroutine);
+  if ((code || tag == DW_TAG_label) && ! has_address (die))
+    return true;
+  if (tag == DW_TAG_variable && ! has_static_location (die))
+    return true;
+
+  /* Inlined subroutines get their names from the abstract origin.  */
+  const char *name = INTUSE(dwarf_diename) (die);
+  if (name == NULL && tag == DW_TAG_namespace)
+    name = "(anonymous namespace)";
+  if (name != NULL && ! scan_add (state, die, name))
+    return false;
+
+  /* Code is also found by its linkage name.  */
+  if (code)
+    {
+      Dwarf_Attribute attr;
+      const char *linkage_name
+	= INTUSE(dwarf_formstring) (INTUSE(dwarf_attr_integrate)
+				    (die, DW_AT_linkage_name, &attr)
+				    ?: INTUSE(dwarf_attr_integrate)
+				    (die, DW_AT_MIPS_linkage_name, &attr));
+      if (linkage_name != NULL
+	  && (name == NULL || strcmp (linkage_name, name) != 0)
+	  && ! scan_add (state, die, linkage_name))
+	return false;
+    }
+
+  return true;
+}
+
+static bool
+scan_dies (struct scan_state *state, Dwarf_Die *parent)
+{
+  Dwarf_Die die;
+  int res = INTUSE(dwarf_child) (parent, &die);
+  while (res == 0)
+    {
+      if (! scan_die (state, &die))
+	return false;
+
+      if (INTUSE(dwarf_haschildren) (&die) && ! scan_dies (state, &die))
+	return false;
+
+      res = INTUSE(dwarf_siblingof) (&die, &die);
+    }
+
+  return res >= 0;
+}
+
+/* Without an index section, look at all DIEs once and hash their names.
+   Returns NULL with the error set when the DWARF cannot be read or
+   memory runs out.  */
+static struct Dwarf_Name_Index *
+build_scan_index (Dwarf *dbg)
+{
+  struct Dwarf_Name_Index *index = calloc (1, sizeof *index);
+  if (unlikely (index == NULL))
+    {
+      __libdw_seterrno (DWARF_E_NOMEM);
+      return NULL;
+    }
+  index->kind = name_index_scan;
+
+  struct scan_state state = { .index = index, .nalloc = 0 };
+  Dwarf_CU *cu = NULL;
+  Dwarf_Die cudie;
+  int res = 1;
+  if (dbg->sectiondata[IDX_debug_info] != NULL)
+    while ((res = INTUSE(dwarf_get_units) (dbg, cu, &cu, NULL, NULL,
+					   &cudie, NULL)) == 0)
+      {
+	/* Only .debug_info offsets can be reported.  */
+	if (cu->sec_idx != IDX_debug_info)
+	  break;
+
+	if (cudie.addr == NULL)
+	  continue;
+	state.cu_offset = INTUSE(dwarf_dieoffset) (&cudie);
+	if (! scan_dies (&state, &cudie))
+	  goto fail;
+      }
+  if (res < 0)
+    goto fail;
+
+  size_t nslots = 16;
+  while (nslots < 2 * index->scan.nentries)
+    nslots *= 2;
+  index->scan.nslots = nslots;
+  index->scan.slots = calloc (nslots, sizeof index->scan.slots[0]);
+  if (unlikely (index->scan.slots == NULL))
+    {
+      __libdw_seterrno (DWARF_E_NOMEM);
+      goto fail;
+    }
+
+  for (size_t i = 0; i < index->scan.nentries; i++)
+    {
+      size_t slot = index->scan.entries[i].hash & (nslots - 1);
+      while (index->scan.slots[slot] != 0)
+	slot = (slot + 1) & (nslots - 1);
+      index->scan.slots[slot] = i + 1;
+    }
+
+  return index;
+
+ fail:
+  __libdw_name_index_free (index);
+  return NULL;
+}
+
+
+struct lookup_state
+{
+  Dwarf *dbg;
+  const char *name;
+  int (*callback) (Dwarf *, Dwarf_Global *, void *);
+  void *arg;
+  int count;
+};
+
+/* Report one match.  Returns false when the callback wants to stop.  */
+static bool
+report (struct lookup_state *state, Dwarf_Off cu_offset,
+	Dwarf_Off die_offset, const char *name)
+{
+  Dwarf_Global gl =
+    {
+      .cu_offset = cu_offset,
+      .die_offset = die_offset,
+      .name = name
+    };
+
+  state->count++;
+  return state->callback (state->dbg, &gl, state->arg) == DWARF_CB_OK;
+}
+
+/* Return the offset of the first DIE of the unit at UNIT_OFF, looking
+   only at the unit header.  */
+static bool
+unit_die_offset (Dwarf *dbg, Dwarf_Off unit_off, Dwarf_Off *die_off)
+{
+  Dwarf_Off next;
+  size_t header_size;
+  if (__libdw_next_unit (dbg, false, unit_off, &next, &header_size,
+			 NULL, NULL, NULL, NULL, NULL, NULL, NULL) != 0)
+    return false;
+  *die_off = unit_off + header_size;
+  return true;
+}
+
+/* Report all entries of the name at index NDX in UNIT.  */
+static bool
+names_report_entries (struct lookup_state *state,
+		      const struct names_unit *unit, uint32_t ndx,
+		      const char *name)
+{
+  Dwarf *dbg = state->dbg;
+  uint8_t off = unit->offset_size;
+  Dwarf_Off entry_off = read_offset (dbg, unit->entry_offsets + ndx * off,
+				     off);
+  if (entry_off >= (size_t) (unit->end - unit->entry_pool))
+    return true;
+
+  const unsigned char *p = unit->entry_pool + entry_off;
+  while (p < unit->end)
+    {
+      Dwarf_Word code;
+      get_uleb128 (code, p, unit->end);
+      if (code == 0)
+	break;
+
+      const struct names_abbrev *abbrev = NULL;
+      for (size_t i = 0; i < unit->nabbrevs; i++)
+	if (unit->abbrevs[i].code == code)
+	  {
+	    abbrev = &unit->abbrevs[i];
+	    break;
+	  }
+      if (abbrev == NULL)
+	break;
+
+      Dwarf_Word cu_index = 0, tu_index = 0, die_off = 0;
+      bool have_tu = false, have_die = false;
+      const unsigned char *ap = abbrev->attrs;
+      while (1)
+	{
+	  Dwarf_Word attr, form, value;
+	  get_uleb128_unchecked (attr, ap);
+	  get_uleb128_unchecked (form, ap);
+	  if (attr == 0 && form == 0)
+	    break;
+	  if (! read_form (dbg, form, off, &p, unit->end, &value))
+	    return true;
+	  switch (attr)
+	    {
+	    case DW_IDX_compile_unit:
+	      cu_index = value;
+	      break;
+	    case DW_IDX_type_unit:
+	      tu_index = value;
+	      have_tu = true;
+	      break;
+	    case DW_IDX_die_offset:
+	      die_off = value;
+	      have_die = true;
+	      break;
+	    default:
+	      break;
+	    }
+	}
+
+      if (! have_die)
+	continue;
+
+      /* Foreign type units live in other (split) files.  */
+      Dwarf_Off unit_off;
+      if (have_tu)
+	{
+	  if (tu_index >= unit->local_type_unit_count)
+	    continue;
+	  unit_off = read_offset (dbg, unit->tu_list + tu_index * off, off);
+	}
+      else
+	{
+	  if (cu_index >= unit->comp_unit_count)
+	    continue;
+	  unit_off = read_offset (dbg, unit->cu_list + cu_index * off, off);
+	}
+
+      Dwarf_Off cu_die_off;
+      if (! unit_die_offset (dbg, unit_off, &cu_die_off))
+	continue;
+
+      if (! report (state, cu_die_off, unit_off + die_off, name))
+	return false;
+    }
+
+  return true;
+}
+
+static bool
+names_lookup (struct lookup_state *state, const struct names_unit *unit)
+{
+  Dwarf *dbg = state->dbg;
+  Elf_Data *strdata = dbg->sectiondata[IDX_debug_str];
+  uint8_t off = unit->offset_size;
+
+  uint32_t first = 0, last = unit->name_count;
+  uint32_t hash = 0;
+  if (unit->bucket_count > 0)
+    {
+      hash = names_hash (state->name);
+      uint32_t bucket = hash % unit->bucket_count;
+      first = read_4ubyte_unaligned (dbg, unit->buckets + bucket * 4);
+      if (first == 0)
+	return true;
+      /* Bucket entries are one based.  */
+      first--;
+    }
+
+  for (uint32_t i = first; i < last; i++)
+    {
+      if (unit->bucket_count > 0)
+	{
+	  uint32_t h = read_4ubyte_unaligned (dbg, unit->hashes + i * 4);
+	  if (h % unit->bucket_count != hash % unit->bucket_count)
+	    break;
+	  if (h != hash)
+	    continue;
+	}
+
+      Dwarf_Off str_off = read_offset (dbg, unit->str_offsets + i * off, off);
+      if (str_off >= strdata->d_size)
+	continue;
+      const char *str = (const char *) strdata->d_buf + str_off;
+      if (strncmp (str, state->name, strdata->d_size - str_off) == 0
+	  && memchr (str, '\0', strdata->d_size - str_off) != NULL
+	  && ! names_report_entries (state, unit, i, str))
+	return false;
+    }
+
+  return true;
+}
+
+static void
+gdb_index_lookup (struct lookup_state *state,
+		  const struct Dwarf_Name_Index *index)
+{
+  Dwarf *dbg = state->dbg;
+  uint32_t hash = gdb_index_hash (index->gdb.version, state->name);
+  uint32_t mask = index->gdb.nslots - 1;
+  uint32_t slot = hash & mask;
+  uint32_t step = ((hash * 17) & mask) | 1;
+  size_t poolsize = index->gdb.end - index->gdb.pool;
+
+  for (uint32_t n = 0; n < index->gdb.nslots; n++)
+    {
+      const unsigned char *p = index->gdb.symtab + slot * 8;
+      uint32_t name_off = le32toh (read_4ubyte_unaligned_noncvt (p));
+      uint32_t vec_off = le32toh (read_4ubyte_unaligned_noncvt (p + 4));
+      if (name_off == 0 && vec_off == 0)
+	return;
+
+      if (name_off < poolsize && vec_off < poolsize
+	  && poolsize - vec_off >= 4)
+	{
+	  const char *str = (const char *) index->gdb.pool + name_off;
+	  if (strncmp (str, state->name, poolsize - name_off) == 0
+	      && memchr (str, '\0', poolsize - name_off) != NULL)
+	    {
+	      const unsigned char *vec = index->gdb.pool + vec_off;
+	      uint32_t cnt = le32toh (read_4ubyte_unaligned_noncvt (vec));
+	      if (cnt > (poolsize - vec_off - 4) / 4)
+		return;
+
+	      uint32_t last_cu = (uint32_t) -1;
+	      for (uint32_t i = 0; i < cnt; i++)
+		{
+		  uint32_t cu_index = (le32toh (read_4ubyte_unaligned_noncvt
+						(vec + 4 + i * 4))
+				       & 0xffffff);
+		  /* Type units are in .debug_types, only report CUs.
+		     Names are listed once for each symbol kind.  */
+		  if (cu_index >= index->gdb.ncus || cu_index == last_cu)
+		    continue;
+		  last_cu = cu_index;
+
+		  Dwarf_Off unit_off
+		    = le64toh (read_8ubyte_unaligned_noncvt (index->gdb.cu_list
+							     + cu_index * 16));
+		  Dwarf_Off cu_die_off;
+		  if (! unit_die_offset (dbg, unit_off, &cu_die_off))
+		    continue;
+
+		  /* .gdb_index only knows the CU.  */
+		  if (! report (state, cu_die_off, cu_die_off, str))
+		    return;
+		}
+	      return;
+	    }
+	}
+
+      slot = (slot + step) & mask;
+    }
+}
+
+static void
+scan_lookup (struct lookup_state *state,
+	     const struct Dwarf_Name_Index *index)
+{
+  uint32_t hash = names_hash (state->name);
+  size_t mask = index->scan.nslots - 1;
+  for (size_t slot = hash & mask;
+       index->scan.slots[slot] != 0;
+       slot = (slot + 1) & mask)
+    {
+      const struct scan_entry *entry
+	= &index->scan.entries[index->scan.slots[slot] - 1];
+      if (entry->hash == hash && strcmp (entry->name, state->name) == 0
+	  && ! report (state, entry->cu_offset, entry->die_offset,
+		       entry->name))
+	return;
+    }
+}
+
+
+/* Load or build the name index on first use.  Returns NULL with the
+   error of build_scan_index set if there is none.  An index section
+   that cannot be used falls back to the next way of finding names.  */
+static const struct Dwarf_Name_Index *
+get_name_index (Dwarf *dbg)
+{
+  struct Dwarf_Name_Index *index
+    = atomic_load_explicit (&dbg->name_index, memory_order_acquire);
+  if (index != NULL)
+    return index;
+
+  pthread_mutex_lock (&dbg->name_index_lock);
+  index = atomic_load_explicit (&dbg->name_index, memory_order_relaxed);
+  if (index == NULL)
+    {
+      index = load_debug_names (dbg);
+      if (index == NULL)
+	index = load_gdb_index (dbg);
+      if (index == NULL)
+	index = build_scan_index (dbg);
+      if (index != NULL)
+	atomic_store_explicit (&dbg->name_index, index, memory_order_release);
+    }
+  pthread_mutex_unlock (&dbg->name_index_lock);
+
+  return index;
+}
+
+int
+dwarf_lookup_name (Dwarf *dbg, const char *name,
+		   int (*callback) (Dwarf *, Dwarf_Global *, void *),
+		   void *arg)
+{
+  if (dbg == NULL)
+    return -1;
+
+  const struct Dwarf_Name_Index *index = get_name_index (dbg);
+  if (index == NULL)
+    return -1;
+
+  struct lookup_state state =
+    {
+      .dbg = dbg,
+      .name = name,
+      .callback = callback,
+      .arg = arg,
+      .count = 0
+    };
+
+  switch (index->kind)
+    {
+    case name_index_debug_names:
+      for (size_t i = 0; i < index->names.nunits; i++)
+	if (! names_lookup (&state, &index->names.units[i]))
+	  break;
+      break;
+    case name_index_gdb_index:
+      gdb_index_lookup (&state, index);
+      break;
+    case name_index_scan:
+      scan_lookup (&state, index);
+      break;
+    }
+
+  return state.count;
+}
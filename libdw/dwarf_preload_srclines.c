@@ -0,0 +1,62 @@
+/* Decode the line tables of all units, using multiple threads.
+   This file is part of elfutils.
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of either
+
+     * the GNU Lesser General Public License as published by the Free
+       Software Foundation; either version 3 of the License, or (at
+       your option) any later version
+
+   or
+
+     * the GNU General Public License as published by the Free
+       Software Foundation; either version 2 of the License, or (at
+       your option) any later version
+
+   or both in parallel, as here.
+
+   elfutils is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received copies of the GNU General Public License and
+   the GNU Lesser General Public License along with this program.  If
+   not, see <http://www.gnu.org/licenses/>.  */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include "libdwP.h"
+#include <dwarf.h>
+
+
+void
+internal_function
+__libdw_preload_srclines (Dwarf_CU *cu)
+{
+  /* Split units get their line table from the skeleton.  */
+  if (cu->unit_type == DW_UT_split_compile
+      || cu->unit_type == DW_UT_split_type)
+    return;
+
+  Dwarf_Die cudie = CUDIE (cu);
+  Dwarf_Lines *lines;
+  size_t nlines;
+  if (INTUSE(dwarf_hasattr) (&cudie, DW_AT_stmt_list))
+    (void) INTUSE(dwarf_getsrclines) (&cudie, &lines, &nlines);
+}
+
+
+int
+dwarf_preload_srclines (Dwarf *dwarf, unsigned int nthreads)
+{
+  if (dwarf == NULL)
+    return -1;
+
+  return __libdw_preload_units (dwarf, nthreads, false,
+				__libdw_preload_srclines);
+}
+INTDEF(dwarf_preload_srclines)
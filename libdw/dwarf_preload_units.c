@@ -0,0 +1,132 @@
+/* Read and decode all units up front, using multiple threads.
+   This file is part of elfutils.
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of either
+
+     * the GNU Lesser General Public License as published by the Free
+       Software Foundation; either version 3 of the License, or (at
+       your option) any later version
+
+   or
+
+     * the GNU General Public License as published by the Free
+       Software Foundation; either version 2 of the License, or (at
+       your option) any later version
+
+   or both in parallel, as here.
+
+   elfutils is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received copies of the GNU General Public License and
+   the GNU Lesser General Public License along with this program.  If
+   not, see <http://www.gnu.org/licenses/>.  */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <limits.h>
+#include <stdlib.h>
+
+#include "libdwP.h"
+
+
+struct preload_state
+{
+  Dwarf_CU **cus;
+  size_t ncus;
+  void (*preload) (Dwarf_CU *cu);
+};
+
+
+/* Do everything that would otherwise be done lazily for CU.  Errors
+   are ignored, they will be reported again when the data is used.  */
+static void
+preload_unit (Dwarf_CU *cu)
+{
+  /* Read the whole abbreviation table, there is no such code.  */
+  (void) __libdw_findabbrev (cu, UINT_MAX);
+
+  (void) __libdw_cu_str_off_base (cu);
+  (void) __libdw_cu_addr_base (cu);
+  (void) __libdw_cu_ranges_base (cu);
+  (void) __libdw_cu_locs_base (cu);
+  (void) __libdw_cu_base_address (cu);
+
+  __libdw_preload_srclines (cu);
+}
+
+static int
+preload_one (void *arg, size_t idx)
+{
+  struct preload_state *state = arg;
+  state->preload (state->cus[idx]);
+  return 0;
+}
+
+
+int
+internal_function
+__libdw_preload_units (Dwarf *dwarf, unsigned int nthreads,
+		       bool split_units, void (*preload) (Dwarf_CU *cu))
+{
+  /* Reading the unit headers is cheap but sequential.  So is linking
+     the skeleton units with their split units, which opens files.  */
+  struct preload_state state = { .cus = NULL, .ncus = 0,
+				 .preload = preload };
+  size_t nalloc = 0;
+  Dwarf_CU *cu = NULL;
+  int res;
+  while ((res = INTUSE(dwarf_get_units) (dwarf, cu, &cu, NULL, NULL,
+					  NULL, NULL)) == 0)
+    {
+      Dwarf_CU *split = NULL;
+      if (split_units && cu->unit_type == DW_UT_skeleton)
+	split = __libdw_find_split_unit (cu);
+
+      if (state.ncus + 2 > nalloc)
+	{
+	  nalloc = nalloc == 0 ? 64 : 2 * nalloc;
+	  Dwarf_CU **newp = realloc (state.cus, nalloc * sizeof newp[0]);
+	  if (unlikely (newp == NULL))
+	    {
+	      free (state.cus);
+	      __libdw_seterrno (DWARF_E_NOMEM);
+	      return -1;
+	    }
+	  state.cus = newp;
+	}
+
+      state.cus[state.ncus++] = cu;
+      if (split != NULL)
+	state.cus[state.ncus++] = split;
+    }
+
+  if (res < 0)
+    {
+      free (state.cus);
+      return -1;
+    }
+
+  __libdw_parallel (nthreads, state.ncus, preload_one, &state);
+
+  free (state.cus);
+  return 0;
+}
+
+
+int
+dwarf_preload_units (Dwarf *dwarf, unsigned int nthreads)
+{
+  if (dwarf == NULL)
+    return -1;
+
+  /* The alternate file is shared by all units, look it up first.  */
+  (void) INTUSE(dwarf_getalt) (dwarf);
+
+  return __libdw_preload_units (dwarf, nthreads, true, preload_unit);
+}
@@ -37,6 +37,7 @@
 void
 dwarf_setalt (Dwarf *main, Dwarf *alt)
 {
+  pthread_mutex_lock (&main->dwarf_lock);
   if (main->alt_fd != -1)
     {
       INTUSE(dwarf_end) (main->alt_dwarf);
@@ -45,5 +46,6 @@ dwarf_setalt (Dwarf *main, Dwarf *alt)
     }
 
   main->alt_dwarf = alt;
+  pthread_mutex_unlock (&main->dwarf_lock);
 }
 INTDEF (dwarf_setalt)
@@ -0,0 +1,41 @@
+/* Hash table for the ends of DIE subtrees.
+   This file is part of elfutils.
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of either
+
+     * the GNU Lesser General Public License as published by the Free
+       Software Foundation; either version 3 of the License, or (at
+       your option) any later version
+
+   or
+
+     * the GNU General Public License as published by the Free
+       Software Foundation; either version 2 of the License, or (at
+       your option) any later version
+
+   or both in parallel, as here.
+
+   elfutils is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received copies of the GNU General Public License and
+   the GNU Lesser General Public License along with this program.  If
+   not, see <http://www.gnu.org/licenses/>.  */
+
+#ifndef _DWARF_SIBLING_HASH_H
+#define _DWARF_SIBLING_HASH_H	1
+
+#include <pthread.h>
+
+/* Maps the unit offset of a DIE with children to the address just
+   past its subtree, the address of its next sibling.  */
+#define NAME Dwarf_Sibling_Hash
+#define TYPE unsigned char *
+#define COMPARE(a, b) (0)
+
+#include <dynamicsizehash_concurrent.h>
+
+#endif	/* dwarf_sibling_hash.h */
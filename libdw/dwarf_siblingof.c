@@ -33,9 +33,47 @@
 
 #include "libdwP.h"
 #include <dwarf.h>
+#include <stdlib.h>
 #include <string.h>
 
 
+/* Record that the subtree of the DIE at OFFSET in CU ends at ADDR.
+   The table is only created here, threads racing to do that keep the
+   first one published.  Nothing is recorded without memory, the table
+   is only a shortcut.  */
+static void
+record_sibling (Dwarf_CU *cu, size_t offset, unsigned char *addr)
+{
+  Dwarf_Sibling_Hash *htab
+    = atomic_load_explicit (&cu->sibling_hash, memory_order_acquire);
+  if (htab == NULL)
+    {
+      Dwarf_Sibling_Hash *newp = malloc (sizeof *newp);
+      if (unlikely (newp == NULL))
+	return;
+      if (unlikely (Dwarf_Sibling_Hash_init (newp, 31) != 0))
+	{
+	  Dwarf_Sibling_Hash_free (newp);
+	  free (newp);
+	  return;
+	}
+
+      if (atomic_compare_exchange_strong_explicit (&cu->sibling_hash,
+						   &htab, newp,
+						   memory_order_acq_rel,
+						   memory_order_acquire))
+	htab = newp;
+      else
+	{
+	  Dwarf_Sibling_Hash_free (newp);
+	  free (newp);
+	}
+    }
+
+  Dwarf_Sibling_Hash_insert (htab, offset, addr);
+}
+
+
 int
 dwarf_siblingof (Dwarf_Die *die, Dwarf_Die *result)
 {
@@ -49,6 +87,9 @@ dwarf_siblingof (Dwarf_Die *die, Dwarf_Die *result)
     result->addr = NULL;
 
   unsigned int level = 0;
+  /* The DIEs whose children we are skipping over, to remember where
+     their subtrees end.  Deeper nesting is walked but not recorded.  */
+  void *parents[32];
 
   /* Copy of the current DIE.  */
   Dwarf_Die this_die = *die;
@@ -63,10 +104,23 @@ dwarf_siblingof (Dwarf_Die *die, Dwarf_Die *result)
      must not return the dies for children of the given die.  */
   do
     {
+      /* If we walked over the children of this DIE before we know
+	 where its subtree ends.  */
+      Dwarf_Abbrev *abbrev = __libdw_dieabbrev (&this_die, NULL);
+      Dwarf_Sibling_Hash *sibling_hash;
+      if (abbrev != NULL && abbrev != DWARF_END_ABBREV
+	  && abbrev->has_children
+	  && (sibling_hash = atomic_load_explicit (&sibattr.cu->sibling_hash,
+						   memory_order_acquire)) != NULL
+	  && (addr = Dwarf_Sibling_Hash_find (sibling_hash,
+					      this_die.addr
+					      - sibattr.cu->startp,
+					      NULL)) != NULL)
+	;
       /* Find the end of the DIE or the sibling attribute.  */
-      addr = __libdw_find_attr (&this_die, DW_AT_sibling, &sibattr.code,
-				&sibattr.form);
-      if (addr != NULL && sibattr.code == DW_AT_sibling)
+      else if ((addr = __libdw_find_attr (&this_die, DW_AT_sibling,
+					  &sibattr.code, &sibattr.form)) != NULL
+	       && sibattr.code == DW_AT_sibling)
 	{
 	  Dwarf_Off offset;
 	  sibattr.valp = addr;
@@ -91,8 +145,12 @@ dwarf_siblingof (Dwarf_Die *die, Dwarf_Die *result)
 	       || unlikely (this_die.abbrev == DWARF_END_ABBREV))
 	return -1;
       else if (this_die.abbrev->has_children)
-	/* This abbreviation has children.  */
-	++level;
+	{
+	  /* This abbreviation has children.  */
+	  if (level < sizeof parents / sizeof parents[0])
+	    parents[level] = this_die.addr;
+	  ++level;
+	}
 
       /* End of the buffer.  */
       unsigned char *endp = sibattr.cu->endp;
@@ -116,6 +174,11 @@ dwarf_siblingof (Dwarf_Die *die, Dwarf_Die *result)
 	    }
 
 	  ++addr;
+
+	  /* This ends the children of PARENTS[LEVEL].  */
+	  if (level < sizeof parents / sizeof parents[0])
+	    record_sibling (sibattr.cu, parents[level] - sibattr.cu->startp,
+			    addr);
 	}
 
       /* Initialize the 'current DIE'.  */
@@ -242,6 +242,26 @@ binary_search_fde (Dwarf_CFI *cache, Dwarf_Addr address)
   return (Dwarf_Off) -1l;
 }
 
+/* Use the table of dwarf_cfi_build_fde_index, yield an FDE offset.  */
+static Dwarf_Off
+index_search_fde (Dwarf_CFI *cache, const struct dwarf_fde_range *index,
+		  Dwarf_Addr address)
+{
+  size_t l = 0, u = cache->fde_index_entries;
+  while (l < u)
+    {
+      size_t idx = (l + u) / 2;
+      if (address < index[idx].start)
+	u = idx;
+      else if (address >= index[idx].end)
+	l = idx + 1;
+      else
+	return index[idx].offset;
+    }
+
+  return (Dwarf_Off) -1l;
+}
+
 struct dwarf_fde *
 internal_function
 __libdw_find_fde (Dwarf_CFI *cache, Dwarf_Addr address)
@@ -253,6 +273,22 @@ __libdw_find_fde (Dwarf_CFI *cache, Dwarf_Addr address)
   if (found != NULL)
     return *found;
 
+  /* Use our own index if it was built, it knows the FDE lengths.  */
+  const struct dwarf_fde_range *index
+    = atomic_load_explicit (&cache->fde_index, memory_order_acquire);
+  if (index != NULL)
+    {
+      Dwarf_Off offset = index_search_fde (cache, index, address);
+      if (offset == (Dwarf_Off) -1l)
+	goto no_match;
+      struct dwarf_fde *fde = __libdw_fde_by_offset (cache, offset);
+      /* An overlapping FDE might already be cached for this range.  */
+      if (likely (fde != NULL)
+	  && unlikely (address < fde->start || address >= fde->end))
+	goto no_match;
+      return fde;
+    }
+
   /* Use .eh_frame_hdr binary search table if possible.  */
   if (cache->search_table != NULL)
     {
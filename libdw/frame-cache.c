@@ -63,7 +63,16 @@ __libdw_destroy_frame_cache (Dwarf_CFI *cache)
   /* Most of the data is in our two search trees.  */
   tdestroy (cache->fde_tree, free_fde);
   tdestroy (cache->cie_tree, free_cie);
-  tdestroy (cache->expr_tree, free_expr);
+  eu_search_tree_fini (&cache->expr_tree, free_expr);
+  free (atomic_load_explicit (&cache->fde_index, memory_order_relaxed));
+  pthread_mutex_destroy (&cache->fde_index_lock);
+  pthread_mutex_destroy (&cache->cie_lock);
+
+  if (cache->frame_cache != NULL)
+    for (size_t i = 0; i < CFI_FRAME_CACHE_SIZE; i++)
+      free (cache->frame_cache[i].frame);
+  free (cache->frame_cache);
+  pthread_mutex_destroy (&cache->frame_cache_lock);
 
   if (cache->ebl != NULL && cache->ebl != (void *) -1l)
     ebl_closebackend (cache->ebl);
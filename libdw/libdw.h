@@ -134,6 +134,22 @@ typedef struct
 #define DWARF_END_DIE ((Dwarf_Die *) -1l)
 
 
+/* Index of all DIEs of a unit, see dwarf_cu_build_die_index.  The DIEs
+   are numbered in the order they appear in the unit, the unit DIE is
+   number zero.  Each array has COUNT entries.  */
+typedef struct
+{
+  struct Dwarf_CU *cu;
+  size_t count;
+  const Dwarf_Off *offset;	/* Section offset of the DIE.  */
+  const size_t *parent;		/* Parent DIE, -1 for the unit DIE.  */
+  const size_t *sibling;	/* Next sibling DIE, -1 if none.  */
+  const int *tag;		/* Tag of the DIE.  */
+  const unsigned int *depth;	/* Number of parents.  */
+  Dwarf_Abbrev *const *abbrev;	/* Abbreviation of the DIE.  */
+} Dwarf_Die_Index;
+
+
 /* Global symbol information.  */
 typedef struct
 {
@@ -301,6 +317,26 @@ extern int dwarf_get_units (Dwarf *dwarf, Dwarf_CU *cu, Dwarf_CU **next_cu,
 			    Dwarf_Die *cudie, Dwarf_Die *subdie)
      __nonnull_attribute__ (3);
 
+/* Reads all units and does the work that is otherwise done lazily
+   when a unit is first used: parsing the abbreviations, looking up
+   the str_offsets, addr, ranges and locs bases, linking skeleton and
+   split units and decoding the line tables.  The unit headers are read
+   sequentially, the rest is done by NTHREADS threads (including the
+   calling thread).  If NTHREADS is zero the number of online CPUs is
+   used.  DWARF must not be used by other threads during the call.
+   Returns 0 on success, -1 if the units couldn't be read.  */
+extern int dwarf_preload_units (Dwarf *dwarf, unsigned int nthreads);
+
+/* Decodes the line tables of all units, like dwarf_getsrclines would
+   when first called for each of them, using NTHREADS threads
+   (including the calling thread).  If NTHREADS is zero the number of
+   online CPUs is used.  Split units aren't looked up, they use the
+   line table of their skeleton unit.  DWARF must not be used by other
+   threads during the call.  Returns 0 on success, -1 if the units
+   couldn't be read.  Errors decoding a line table are reported again
+   by dwarf_getsrclines.  */
+extern int dwarf_preload_srclines (Dwarf *dwarf, unsigned int nthreads);
+
 /* Provides information and DIEs associated with the given Dwarf_CU
    unit.  Returns -1 on error, zero on success. Arguments not needed
    may be NULL.  If they are NULL and aren't known yet, they won't be
@@ -313,6 +349,22 @@ extern int dwarf_cu_info (Dwarf_CU *cu,
 			  uint64_t *unit_id,
 			  uint8_t *address_size, uint8_t *offset_size);
 
+/* Builds an index of all DIEs of the given unit in one pass over its
+   DIEs.  The index is kept with the unit, later calls return the same
+   index.  Returns NULL on error.  */
+extern const Dwarf_Die_Index *dwarf_cu_build_die_index (Dwarf_CU *cu);
+
+/* Returns the DIE index of the given unit if it has been built, NULL
+   otherwise.  Functions that walk the DIE tree, like dwarf_getscopes
+   and dwarf_getfuncs, use the index when it is available.  */
+extern const Dwarf_Die_Index *dwarf_cu_die_index (Dwarf_CU *cu);
+
+/* Fills in RESULT for the DIE with number N in INDEX.  Returns RESULT
+   or NULL if there is no such DIE.  */
+extern Dwarf_Die *dwarf_die_index_die (const Dwarf_Die_Index *index,
+				       size_t n, Dwarf_Die *result)
+     __nonnull_attribute__ (3);
+
 /* Decode one DWARF CFI entry (CIE or FDE) from the raw section data.
    The E_IDENT from the originating ELF file indicates the address
    size and byte order used in the CFI section contained in DATA;
@@ -353,6 +405,17 @@ extern Dwarf_CFI *dwarf_getcfi_elf (Elf *elf);
 /* Release resources allocated by dwarf_getcfi_elf.  */
 extern int dwarf_cfi_end (Dwarf_CFI *cache);
 
+/* Read all FDEs of CACHE up front into a table sorted by address, so
+   that finding the FDE for an address is a binary search.  Without
+   it, FDEs are read in section order until the one covering the
+   address is found, unless there is an .eh_frame_hdr search table,
+   which .debug_frame never has.  FDEs at address zero are left out
+   when the file has no section there, they are what the linker leaves
+   of code it dropped.  Of overlapping FDEs the one starting first is
+   used.  Can be called from several threads.  Returns 0 on success,
+   -1 on error.  */
+extern int dwarf_cfi_build_fde_index (Dwarf_CFI *cache);
+
 
 /* Return DIE at given offset in .debug_info section.  */
 extern Dwarf_Die *dwarf_offdie (Dwarf *dbg, Dwarf_Off offset,
@@ -622,6 +685,17 @@ extern ptrdiff_t dwarf_getpubnames (Dwarf *dbg,
 				    void *arg, ptrdiff_t offset)
      __nonnull_attribute__ (2);
 
+/* Call CALLBACK for each DIE called NAME.  The index in .debug_names
+   or .gdb_index is used when present, otherwise all DIEs are scanned
+   once and their names hashed.  Only the CU DIE is known for names
+   found through .gdb_index, then the die_offset equals the cu_offset.
+   Returns the number of entries reported, or -1 on error.  */
+extern int dwarf_lookup_name (Dwarf *dbg, const char *name,
+			      int (*callback) (Dwarf *, Dwarf_Global *,
+					       void *),
+			      void *arg)
+     __nonnull_attribute__ (2, 3);
+
 
 /* Get source file information for CU.  */
 extern int dwarf_getsrclines (Dwarf_Die *cudie, Dwarf_Lines **lines,
@@ -1012,11 +1086,20 @@ extern int dwarf_macro_param2 (Dwarf_Macro *macro, Dwarf_Word *paramp,
 
 /* Compute what's known about a call frame when the PC is at ADDRESS.
    Returns 0 for success or -1 for errors.
-   On success, *FRAME is a malloc'd pointer.  */
+   On success, *FRAME is a malloc'd pointer.  The most recently used
+   frames are remembered in CACHE, so looking up an address in the same
+   PC range again does not run the CFI instructions again.  */
 extern int dwarf_cfi_addrframe (Dwarf_CFI *cache,
 				Dwarf_Addr address, Dwarf_Frame **frame)
   __nonnull_attribute__ (3);
 
+/* Fill in the number of dwarf_cfi_addrframe calls on CACHE that were
+   answered from remembered frames (*HITS) and that had to run the CFI
+   instructions (*MISSES).  Either pointer can be null.  Returns 0 for
+   success or -1 if CACHE is null.  */
+extern int dwarf_cfi_frame_cache_stats (Dwarf_CFI *cache, uint64_t *hits,
+					uint64_t *misses);
+
 /* Return the DWARF register number used in FRAME to denote
    the return address in FRAME's caller frame.  The remaining
    arguments can be non-null to fill in more information.
@@ -35,6 +35,7 @@
 
 #include <libdw.h>
 #include <dwarf.h>
+#include "eu-search.h"
 
 
 /* gettext helper macros.  */
@@ -87,6 +88,8 @@ enum
     IDX_debug_macro,
     IDX_debug_ranges,
     IDX_debug_rnglists,
+    IDX_debug_names,
+    IDX_gdb_index,
     IDX_gnu_debugaltlink,
     IDX_last
   };
@@ -147,6 +150,44 @@ enum
 
 
 #include "dwarf_sig8_hash.h"
+#include "dwarf_sibling_hash.h"
+#include "stdatomic.h"
+
+/* The units read so far from one section, in increasing offset order.
+   New units are only appended, with cu_lock held.  Lookups don't take
+   the lock, so an array that was replaced by a larger one is kept
+   around until dwarf_end.  */
+struct Dwarf_CU_Table
+{
+  _Atomic (struct Dwarf_CU **) units;
+  atomic_size_t nunits;
+  size_t alloc;
+  struct Dwarf_CU_Table_Old
+  {
+    struct Dwarf_CU_Table_Old *next;
+    struct Dwarf_CU **units;
+  } *old;
+};
+
+/* Block of memory for libdw_alloc.  */
+struct libdw_memblock
+{
+  size_t size;
+  size_t remaining;
+  struct libdw_memblock *prev;
+  char mem[0];
+};
+
+/* Table of per-thread memory block tails, indexed by thread id.  The
+   tails live in chunks which never move.  A table isn't changed once
+   it is published, a larger copy replaces it.  */
+#define LIBDW_MEMTAILS_CHUNK 64
+struct libdw_memtails
+{
+  struct libdw_memtails *prev;	/* Smaller table this one replaced.  */
+  size_t nchunks;
+  struct libdw_memblock **chunks[0];
+};
 
 /* This is the structure representing the debugging state.  */
 struct Dwarf
@@ -185,27 +226,46 @@ struct Dwarf
   } *pubnames_sets;
   size_t pubnames_nsets;
 
-  /* Search tree for the CUs.  */
-  void *cu_tree;
+  /* Table of the CUs.  */
+  struct Dwarf_CU_Table cu_table;
   Dwarf_Off next_cu_offset;
 
-  /* Search tree and sig8 hash table for .debug_types type units.  */
-  void *tu_tree;
+  /* Table and sig8 hash table for .debug_types type units.  */
+  struct Dwarf_CU_Table tu_table;
   Dwarf_Off next_tu_offset;
   Dwarf_Sig8_Hash sig8_hash;
 
+  /* Held while reading new units into the tables.  */
+  pthread_mutex_t cu_lock;
+
   /* Search tree for split Dwarf associated with CUs in this debug.  */
-  void *split_tree;
+  search_tree split_tree;
+
+  /* Held while looking for and linking the split unit of a CU.  */
+  pthread_mutex_t split_lock;
+
+  /* Held while setting up ALT_DWARF, ARANGES, PUBNAMES_SETS and CFI.  */
+  pthread_mutex_t dwarf_lock;
 
   /* Search tree for .debug_macro operator tables.  */
-  void *macro_ops;
+  search_tree macro_ops;
 
   /* Search tree for decoded .debug_line units.  */
-  void *files_lines;
+  search_tree files_lines;
+
+  /* Name index for dwarf_lookup_name, from .debug_names, .gdb_index
+     or built by scanning all DIEs.  Set once under NAME_INDEX_LOCK.  */
+  _Atomic (struct Dwarf_Name_Index *) name_index;
+  pthread_mutex_t name_index_lock;
 
   /* Address ranges.  */
   Dwarf_Aranges *aranges;
 
+  /* Sorted, non-overlapping address ranges of all units from the
+     aranges and the unit DIEs, see __libdw_addr_map.  Set once under
+     DWARF_LOCK, read without it.  */
+  _Atomic (Dwarf_Aranges *) addr_map;
+
   /* Cached info from the CFI section.  */
   struct Dwarf_CFI_s *cfi;
 
@@ -221,16 +281,16 @@ struct Dwarf
 
   /* Internal memory handling.  This is basically a simplified thread-local
      reimplementation of obstacks.  Unfortunately the standard obstack
-     implementation is not usable in libraries.  */
-  pthread_rwlock_t mem_rwl;
-  size_t mem_stacks;
-  struct libdw_memblock
-  {
-    size_t size;
-    size_t remaining;
-    struct libdw_memblock *prev;
-    char mem[0];
-  } **mem_tails;
+     implementation is not usable in libraries.  Every thread has its
+     own stack of blocks, the tails are found in MEM_TAILS by thread id.
+     MEM_LOCK is only taken to grow MEM_TAILS.  MEM_GEN is unique for
+     each Dwarf, threads use it to check their cached tail.  */
+  pthread_mutex_t mem_lock;
+  _Atomic (struct libdw_memtails *) mem_tails;
+  size_t mem_gen;
+
+  /* Whether the block allocated together with the Dwarf is in use.  */
+  atomic_bool mem_first_used;
 
   /* Default size of allocated memory blocks.  */
   size_t mem_default_size;
@@ -240,6 +300,17 @@ struct Dwarf
 };
 
 
+/* Decoded attribute name/form pair of an abbreviation.  */
+struct Dwarf_Abbrev_Attr
+{
+  unsigned int name;
+  unsigned int form;
+  /* Offset of the value from the first attribute value of the DIE.
+     Only valid for the first NFIXED + 1 attributes of the abbreviation.
+     For DW_FORM_implicit_const the offset of the value from ATTRP.  */
+  unsigned int offset;
+};
+
 /* Abbreviation representation.  */
 struct Dwarf_Abbrev
 {
@@ -248,6 +319,11 @@ struct Dwarf_Abbrev
   bool has_children : 1;  /* Whether or not the DIE has children. */
   unsigned int code : 31; /* The (unique) abbrev code.  */
   unsigned int tag;	  /* The tag of the DIE. */
+  /* The decoded attributes, NULL if not available.  */
+  const struct Dwarf_Abbrev_Attr *attrs;
+  unsigned int nattrs;	  /* Number of ATTRS.  */
+  unsigned int nfixed;	  /* Leading ATTRS with fixed length values.  */
+  unsigned int fixed_len; /* Length of the values of those.  */
 } attribute_packed;
 
 #include "dwarf_abbrev_hash.h"
@@ -347,6 +423,8 @@ struct Dwarf_CU
   size_t orig_abbrev_offset;
   /* Offset past last read abbreviation.  */
   size_t last_abbrev_offset;
+  /* Held while reading abbreviations from LAST_ABBREV_OFFSET.  */
+  pthread_mutex_t abbrev_lock;
 
   /* The srcline information.  */
   Dwarf_Lines *lines;
@@ -354,29 +432,45 @@ struct Dwarf_CU
   /* The source file information.  */
   Dwarf_Files *files;
 
+  /* Held while LINES and FILES are looked up.  */
+  pthread_mutex_t src_lock;
+
   /* Known location lists.  */
-  void *locs;
+  search_tree locs;
+
+  /* Ends of the subtrees dwarf_siblingof had to walk over.  Allocated
+     when the first one is recorded, most CUs are never walked.  */
+  _Atomic (Dwarf_Sibling_Hash *) sibling_hash;
+
+  /* Index of all DIEs, set once by dwarf_cu_build_die_index under
+     DIE_INDEX_LOCK.  */
+  _Atomic (Dwarf_Die_Index *) die_index;
+  pthread_mutex_t die_index_lock;
+
+  /* The following bases are filled in on first use.  Threads racing
+     to do that all compute the same value, so they are only atomic to
+     make the concurrent stores well defined.  */
 
   /* Base address for use with ranges and locs.
      Don't access directly, call __libdw_cu_base_address.  */
-  Dwarf_Addr base_address;
+  _Atomic (Dwarf_Addr) base_address;
 
   /* The offset into the .debug_addr section where index zero begins.
      Don't access directly, call __libdw_cu_addr_base.  */
-  Dwarf_Off addr_base;
+  _Atomic (Dwarf_Off) addr_base;
 
   /* The offset into the .debug_str_offsets section where index zero begins.
      Don't access directly, call __libdw_cu_str_off_base.  */
-  Dwarf_Off str_off_base;
+  _Atomic (Dwarf_Off) str_off_base;
 
   /* The offset into the .debug_ranges section to use for GNU
      DebugFission split units.  Don't access directly, call
      __libdw_cu_ranges_base.  */
-  Dwarf_Off ranges_base;
+  _Atomic (Dwarf_Off) ranges_base;
 
   /* The start of the offset table in .debug_loclists.
      Don't access directly, call __libdw_cu_locs_base.  */
-  Dwarf_Off locs_base;
+  _Atomic (Dwarf_Off) locs_base;
 
   /* Memory boundaries of this CU.  */
   void *startp;
@@ -594,6 +688,13 @@ extern void __libdw_seterrno (int value) internal_function;
 #define libdw_typed_alloc(dbg, type) \
   libdw_alloc (dbg, type, sizeof (type), 1)
 
+/* Set up the memory handling of a new Dwarf.  The first block is
+   allocated together with DBG, right after it.  */
+extern void __libdw_alloc_init (Dwarf *dbg) internal_function;
+
+/* Free all memory blocks of DBG.  */
+extern void __libdw_alloc_free (Dwarf *dbg) internal_function;
+
 /* Callback to choose a thread-local memory allocation stack.  */
 extern struct libdw_memblock *__libdw_alloc_tail (Dwarf* dbg)
      __nonnull_attribute__ (1);
@@ -621,6 +722,10 @@ __libdw_next_unit (Dwarf *dbg, bool v4_debug_types, Dwarf_Off off,
 extern struct Dwarf_CU *__libdw_intern_next_unit (Dwarf *dbg, bool debug_types)
      __nonnull_attribute__ (1) internal_function;
 
+/* Free the name index used by dwarf_lookup_name.  */
+extern void __libdw_name_index_free (struct Dwarf_Name_Index *index)
+     internal_function;
+
 /* Find CU for given offset.  */
 extern struct Dwarf_CU *__libdw_findcu (Dwarf *dbg, Dwarf_Off offset, bool tu)
      __nonnull_attribute__ (1) internal_function;
@@ -737,6 +842,10 @@ extern int __libdw_formref (Dwarf_Attribute *attr, Dwarf_Off *return_offset)
      __nonnull_attribute__ (1, 2) internal_function;
 
 
+/* Some arbitrary attribute name not conflicting with any existing code.
+   Searching for it with __libdw_find_attr returns the end of the DIE.  */
+#define INVALID 0xffffe444
+
 /* Helper function to locate attribute.  */
 extern unsigned char *__libdw_find_attr (Dwarf_Die *die,
 					 unsigned int search_name,
@@ -767,13 +876,70 @@ extern int __libdw_visit_scopes (unsigned int depth,
 				 void *arg)
   __nonnull_attribute__ (2, 4) internal_function;
 
+/* Calls WORK (ARG, IDX) for every IDX below N from NTHREADS threads,
+   or as many as there are CPUs if zero, including the calling thread.
+   Once a call returns nonzero no further items are started.  Returns
+   the first nonzero result, or zero.  */
+extern int __libdw_parallel (unsigned int nthreads, size_t n,
+			     int (*work) (void *arg, size_t idx), void *arg)
+  __nonnull_attribute__ (3) internal_function;
+
+/* Calls PRELOAD for all units of DWARF, and their split units if
+   SPLIT_UNITS, from NTHREADS threads.  See dwarf_preload_units.  */
+extern int __libdw_preload_units (Dwarf *dwarf, unsigned int nthreads,
+				  bool split_units,
+				  void (*preload) (Dwarf_CU *cu))
+  __nonnull_attribute__ (1, 4) internal_function;
+
+/* Decodes the line table of CU unless it is a split unit.  Errors are
+   ignored.  */
+extern void __libdw_preload_srclines (Dwarf_CU *cu)
+  __nonnull_attribute__ (1) internal_function;
+
+/* Returns the address ranges of all units in .debug_info.  Units
+   listed in .debug_aranges use those ranges, the ranges of the other
+   units come from the DW_AT_low_pc, DW_AT_high_pc and DW_AT_ranges of
+   their unit DIE, or the split unit DIE for skeleton units.  Ranges
+   outside the allocated sections, left behind for code the linker
+   dropped, are ignored.  Where ranges overlap the narrower one wins.
+   Built on first use and cached in DBG.  Returns NULL on error.  */
+extern Dwarf_Aranges *__libdw_addr_map (Dwarf *dbg)
+  __nonnull_attribute__ (1) internal_function;
+
+/* Uses the N RANGES, copied from a map __libdw_addr_map built earlier
+   for the same file, instead of building it.  Returns the map now in
+   use by DBG, which is the one built already if there is one.  Returns
+   NULL if RANGES overlap or point to something that isn't a unit.  */
+extern Dwarf_Aranges *__libdw_set_addr_map (Dwarf *dbg,
+					    const Dwarf_Arange *ranges,
+					    size_t n)
+  __nonnull_attribute__ (1) internal_function;
+
+/* Whether __libdw_visit_scopes descends into the children of DIEs
+   with this tag.  */
+extern bool __libdw_may_have_scopes (int tag) internal_function;
+
+/* If __libdw_visit_scopes from the unit DIE gets to DIE number N in
+   INDEX, returns the number of DIEs from it up to the unit DIE.
+   Returns zero otherwise.  */
+extern unsigned int __libdw_die_index_scope_depth (const Dwarf_Die_Index *,
+						   size_t n)
+  __nonnull_attribute__ (1) internal_function;
+
+/* Returns the DIE index of the unit of DIE and sets *NP to the number
+   of DIE in it.  Returns NULL if the unit has no index.  */
+extern const Dwarf_Die_Index *__libdw_die_index_lookup (Dwarf_Die *die,
+							size_t *np)
+  __nonnull_attribute__ (1, 2) internal_function;
+
 /* Parse a DWARF Dwarf_Block into an array of Dwarf_Op's,
    and cache the result (via tsearch).  */
 extern int __libdw_intern_expression (Dwarf *dbg,
 				      bool other_byte_order,
 				      unsigned int address_size,
 				      unsigned int ref_size,
-				      void **cache, const Dwarf_Block *block,
+				      search_tree *cache,
+				      const Dwarf_Block *block,
 				      bool cfap, bool valuep,
 				      Dwarf_Op **llbuf, size_t *listlen,
 				      int sec_index)
@@ -980,7 +1146,9 @@ Dwarf_Addr __libdw_cu_base_address (Dwarf_CU *cu);
 static inline Dwarf_Off
 __libdw_cu_addr_base (Dwarf_CU *cu)
 {
-  if (cu->addr_base == (Dwarf_Off) -1)
+  Dwarf_Off base = atomic_load_explicit (&cu->addr_base,
+					 memory_order_relaxed);
+  if (base == (Dwarf_Off) -1)
     {
       Dwarf_Die cu_die = CUDIE(cu);
       Dwarf_Attribute attr;
@@ -992,10 +1160,11 @@ __libdw_cu_addr_base (Dwarf_CU *cu)
 	  if (dwarf_formudata (&attr, &off) == 0)
 	    offset = off;
 	}
-      cu->addr_base = offset;
+      base = offset;
+      atomic_store_explicit (&cu->addr_base, base, memory_order_relaxed);
     }
 
-  return cu->addr_base;
+  return base;
 }
 
 /* Gets the .debug_str_offsets base offset to use.  static inline to
@@ -1021,7 +1190,9 @@ str_offsets_base_off (Dwarf *dbg, Dwarf_CU *cu)
 
   if (cu != NULL)
     {
-      if (cu->str_off_base == (Dwarf_Off) -1)
+      Dwarf_Off base = atomic_load_explicit (&cu->str_off_base,
+					     memory_order_relaxed);
+      if (base == (Dwarf_Off) -1)
 	{
 	  Dwarf_Die cu_die = CUDIE(cu);
 	  Dwarf_Attribute attr;
@@ -1030,22 +1201,24 @@ str_offsets_base_off (Dwarf *dbg, Dwarf_CU *cu)
 	      Dwarf_Word off;
 	      if (dwarf_formudata (&attr, &off) == 0)
 		{
-		  cu->str_off_base = off;
-		  return cu->str_off_base;
+		  atomic_store_explicit (&cu->str_off_base, off,
+					 memory_order_relaxed);
+		  return off;
 		}
 	    }
 	  /* For older DWARF simply assume zero (no header).  */
 	  if (cu->version < 5)
 	    {
-	      cu->str_off_base = 0;
-	      return cu->str_off_base;
+	      atomic_store_explicit (&cu->str_off_base, 0,
+				     memory_order_relaxed);
+	      return 0;
 	    }
 
 	  if (dbg == NULL)
 	    dbg = cu->dbg;
 	}
       else
-	return cu->str_off_base;
+	return base;
     }
 
   /* No str_offsets_base attribute, we have to assume "zero".
@@ -1096,7 +1269,7 @@ str_offsets_base_off (Dwarf *dbg, Dwarf_CU *cu)
 
  no_header:
   if (cu != NULL)
-    cu->str_off_base = off;
+    atomic_store_explicit (&cu->str_off_base, off, memory_order_relaxed);
 
   return off;
 }
@@ -1114,7 +1287,9 @@ static inline Dwarf_Off __libdw_cu_str_off_base (Dwarf_CU *cu)
 static inline Dwarf_Off
 __libdw_cu_ranges_base (Dwarf_CU *cu)
 {
-  if (cu->ranges_base == (Dwarf_Off) -1)
+  Dwarf_Off base = atomic_load_explicit (&cu->ranges_base,
+					 memory_order_relaxed);
+  if (base == (Dwarf_Off) -1)
     {
       Dwarf_Off offset = 0;
       Dwarf_Die cu_die = CUDIE(cu);
@@ -1192,10 +1367,11 @@ __libdw_cu_ranges_base (Dwarf_CU *cu)
 	    }
 	}
     no_header:
-      cu->ranges_base = offset;
+      base = offset;
+      atomic_store_explicit (&cu->ranges_base, base, memory_order_relaxed);
     }
 
-  return cu->ranges_base;
+  return base;
 }
 
 
@@ -1203,7 +1379,9 @@ __libdw_cu_ranges_base (Dwarf_CU *cu)
 static inline Dwarf_Off
 __libdw_cu_locs_base (Dwarf_CU *cu)
 {
-  if (cu->locs_base == (Dwarf_Off) -1)
+  Dwarf_Off base = atomic_load_explicit (&cu->locs_base,
+					 memory_order_relaxed);
+  if (base == (Dwarf_Off) -1)
     {
       Dwarf_Off offset = 0;
       Dwarf_Die cu_die = CUDIE(cu);
@@ -1270,10 +1448,11 @@ __libdw_cu_locs_base (Dwarf_CU *cu)
 	}
 
     no_header:
-      cu->locs_base = offset;
+      base = offset;
+      atomic_store_explicit (&cu->locs_base, base, memory_order_relaxed);
     }
 
-  return cu->locs_base;
+  return base;
 }
 
 /* Helper function for tsearch/tfind split_tree Dwarf.  */
@@ -1296,7 +1475,8 @@ __libdw_link_skel_split (Dwarf_CU *skel, Dwarf_CU *split)
     {
       sdbg->sectiondata[IDX_debug_addr]
 	= dbg->sectiondata[IDX_debug_addr];
-      split->addr_base = __libdw_cu_addr_base (skel);
+      atomic_store_explicit (&split->addr_base, __libdw_cu_addr_base (skel),
+			     memory_order_relaxed);
       sdbg->fake_addr_cu = dbg->fake_addr_cu;
     }
 }
@@ -1337,9 +1517,11 @@ INTDECL (dwarf_attr_integrate)
 INTDECL (dwarf_begin)
 INTDECL (dwarf_begin_elf)
 INTDECL (dwarf_child)
+INTDECL (dwarf_cu_die_index)
 INTDECL (dwarf_default_lower_bound)
 INTDECL (dwarf_dieoffset)
 INTDECL (dwarf_diename)
+INTDECL (dwarf_die_index_die)
 INTDECL (dwarf_end)
 INTDECL (dwarf_entrypc)
 INTDECL (dwarf_errmsg)
@@ -1349,12 +1531,15 @@ INTDECL (dwarf_formref_die)
 INTDECL (dwarf_formsdata)
 INTDECL (dwarf_formstring)
 INTDECL (dwarf_formudata)
+INTDECL (dwarf_get_units)
 INTDECL (dwarf_getabbrevattr_data)
 INTDECL (dwarf_getalt)
 INTDECL (dwarf_getarange_addr)
 INTDECL (dwarf_getarangeinfo)
 INTDECL (dwarf_getaranges)
+INTDECL (dwarf_getlocation)
 INTDECL (dwarf_getlocation_die)
+INTDECL (dwarf_getscopes)
 INTDECL (dwarf_getsrcfiles)
 INTDECL (dwarf_getsrclines)
 INTDECL (dwarf_hasattr)
@@ -1366,6 +1551,7 @@ INTDECL (dwarf_nextcu)
 INTDECL (dwarf_next_unit)
 INTDECL (dwarf_offdie)
 INTDECL (dwarf_peel_type)
+INTDECL (dwarf_preload_srclines)
 INTDECL (dwarf_ranges)
 INTDECL (dwarf_setalt)
 INTDECL (dwarf_siblingof)
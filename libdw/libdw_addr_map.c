@@ -0,0 +1,497 @@
+/* Map addresses to units using aranges and unit DIE ranges.
+   This file is part of elfutils.
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of either
+
+     * the GNU Lesser General Public License as published by the Free
+       Software Foundation; either version 3 of the License, or (at
+       your option) any later version
+
+   or
+
+     * the GNU General Public License as published by the Free
+       Software Foundation; either version 2 of the License, or (at
+       your option) any later version
+
+   or both in parallel, as here.
+
+   elfutils is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received copies of the GNU General Public License and
+   the GNU Lesser General Public License along with this program.  If
+   not, see <http://www.gnu.org/licenses/>.  */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "libdwP.h"
+#include <dwarf.h>
+
+
+/* One address range of a unit, before overlaps are resolved.  */
+struct unit_range
+{
+  Dwarf_Addr addr;
+  Dwarf_Addr end;
+  Dwarf_Off offset;
+  bool aranges;			/* From .debug_aranges.  */
+};
+
+struct section_range
+{
+  GElf_Addr start;
+  GElf_Addr end;
+};
+
+struct range_list
+{
+  struct unit_range *ranges;
+  size_t n;
+  size_t nalloc;
+
+  /* Sorted, merged address ranges of the allocated sections, or NULL
+     if addresses are not checked against the sections.  */
+  struct section_range *sections;
+  size_t nsections;
+  bool check_zero;
+};
+
+static int
+compare_sections (const void *a, const void *b)
+{
+  const struct section_range *s1 = a, *s2 = b;
+  if (s1->start != s2->start)
+    return s1->start < s2->start ? -1 : 1;
+  return s1->end < s2->end ? -1 : s1->end > s2->end;
+}
+
+/* Collect the address ranges of the allocated sections of DBG's ELF
+   file.  A linker that dropped the code of a unit with --gc-sections
+   leaves its ranges behind starting at zero (or another tombstone
+   value), those don't lie inside any section.  Relocatable files have
+   all sections at zero, their addresses are not checked.  */
+static int
+collect_sections (Dwarf *dbg, struct range_list *list)
+{
+  GElf_Ehdr ehdr_mem;
+  GElf_Ehdr *ehdr = gelf_getehdr (dbg->elf, &ehdr_mem);
+  if (ehdr == NULL || ehdr->e_type == ET_REL)
+    return 0;
+
+  /* Without section headers, at least drop the ranges at zero.  */
+  list->check_zero = true;
+
+  size_t nalloc = 0;
+  Elf_Scn *scn = NULL;
+  while ((scn = elf_nextscn (dbg->elf, scn)) != NULL)
+    {
+      GElf_Shdr shdr_mem;
+      GElf_Shdr *shdr = gelf_getshdr (scn, &shdr_mem);
+      /* Separate debug files keep the sections as SHT_NOBITS.  */
+      if (shdr == NULL || (shdr->sh_flags & SHF_ALLOC) == 0
+	  || shdr->sh_size == 0)
+	continue;
+
+      if (list->nsections == nalloc)
+	{
+	  nalloc = nalloc == 0 ? 32 : 2 * nalloc;
+	  struct section_range *newp = realloc (list->sections,
+						nalloc * sizeof newp[0]);
+	  if (newp == NULL)
+	    return -1;
+	  list->sections = newp;
+	}
+      list->sections[list->nsections].start = shdr->sh_addr;
+      list->sections[list->nsections].end = shdr->sh_addr + shdr->sh_size;
+      list->nsections++;
+    }
+
+  if (list->nsections == 0)
+    return 0;
+
+  /* A unit may span adjacent sections, like .text.startup and .text.  */
+  qsort (list->sections, list->nsections, sizeof list->sections[0],
+	 compare_sections);
+  size_t n = 0;
+  for (size_t i = 0; i < list->nsections; i++)
+    if (n > 0 && list->sections[i].start <= list->sections[n - 1].end)
+      {
+	if (list->sections[i].end > list->sections[n - 1].end)
+	  list->sections[n - 1].end = list->sections[i].end;
+      }
+    else
+      list->sections[n++] = list->sections[i];
+  list->nsections = n;
+  return 0;
+}
+
+/* Whether [ADDR, END) lies inside the allocated sections.  */
+static bool
+valid_range (const struct range_list *list, Dwarf_Addr addr, Dwarf_Addr end)
+{
+  if (list->nsections == 0)
+    return ! list->check_zero || addr != 0;
+
+  size_t l = 0, u = list->nsections;
+  while (l < u)
+    {
+      size_t idx = (l + u) / 2;
+      if (addr < list->sections[idx].start)
+	u = idx;
+      else if (addr >= list->sections[idx].end)
+	l = idx + 1;
+      else
+	return end <= list->sections[idx].end;
+    }
+  return false;
+}
+
+static int
+add_range (struct range_list *list, Dwarf_Addr addr, Dwarf_Word length,
+	   Dwarf_Off offset, bool aranges)
+{
+  Dwarf_Addr end = addr + length;
+  if (end < addr)
+    end = (Dwarf_Addr) -1;
+  if (! valid_range (list, addr, end))
+    return 0;
+
+  if (list->n == list->nalloc)
+    {
+      size_t nalloc = list->nalloc == 0 ? 64 : 2 * list->nalloc;
+      struct unit_range *ranges = realloc (list->ranges,
+					   nalloc * sizeof ranges[0]);
+      if (ranges == NULL)
+	return -1;
+      list->ranges = ranges;
+      list->nalloc = nalloc;
+    }
+
+  list->ranges[list->n].addr = addr;
+  list->ranges[list->n].end = end;
+  list->ranges[list->n].offset = offset;
+  list->ranges[list->n].aranges = aranges;
+  list->n++;
+  return 0;
+}
+
+/* Adds the ranges of DIE for the unit DIE at OFFSET.  Returns the
+   number of ranges added or -1 if we ran out of memory.  Broken
+   ranges just end the list, the unit is then as good as unknown.  */
+static ptrdiff_t
+add_die_ranges (struct range_list *list, Dwarf_Die *die, Dwarf_Off offset)
+{
+  ptrdiff_t n = 0;
+  ptrdiff_t off = 0;
+  Dwarf_Addr base, start, end;
+  while ((off = INTUSE(dwarf_ranges) (die, off, &base, &start, &end)) > 0)
+    if (end > start)
+      {
+	if (add_range (list, start, end - start, offset, false) != 0)
+	  return -1;
+	n++;
+      }
+  return n;
+}
+
+static int
+compare_offsets (const void *a, const void *b)
+{
+  const Dwarf_Off *p1 = a, *p2 = b;
+  return *p1 < *p2 ? -1 : *p1 > *p2;
+}
+
+static int
+compare_addrs (const void *a, const void *b)
+{
+  const Dwarf_Addr *p1 = a, *p2 = b;
+  return *p1 < *p2 ? -1 : *p1 > *p2;
+}
+
+static int
+compare_starts (const void *a, const void *b)
+{
+  const struct unit_range *r1 = a, *r2 = b;
+  return r1->addr < r2->addr ? -1 : r1->addr > r2->addr;
+}
+
+/* Whether R wins over S where they overlap.  The narrower range is
+   the more specific one, then .debug_aranges is trusted over the unit
+   DIEs.  */
+static bool
+better_range (const struct unit_range *r, const struct unit_range *s)
+{
+  if (r->end - r->addr != s->end - s->addr)
+    return r->end - r->addr < s->end - s->addr;
+  if (r->aranges != s->aranges)
+    return r->aranges;
+  return r->offset < s->offset;
+}
+
+/* Collects the ranges of all units in LIST.  */
+static int
+collect_ranges (Dwarf *dbg, struct range_list *list)
+{
+  if (collect_sections (dbg, list) != 0)
+    return -1;
+
+  /* A broken .debug_aranges is as good as none.  */
+  Dwarf_Aranges *aranges;
+  size_t naranges;
+  if (INTUSE(dwarf_getaranges) (dbg, &aranges, &naranges) != 0)
+    naranges = 0;
+
+  /* The unit DIEs the aranges cover.  */
+  Dwarf_Off *covered = NULL;
+  if (naranges > 0)
+    {
+      covered = malloc (naranges * sizeof covered[0]);
+      if (covered == NULL)
+	return -1;
+      for (size_t i = 0; i < naranges; i++)
+	{
+	  const Dwarf_Arange *r = &aranges->info[i];
+	  covered[i] = r->offset;
+	  if (r->length > 0
+	      && add_range (list, r->addr, r->length, r->offset, true) != 0)
+	    {
+	      free (covered);
+	      return -1;
+	    }
+	}
+      qsort (covered, naranges, sizeof covered[0], compare_offsets);
+    }
+
+  Dwarf_CU *cu = NULL;
+  uint8_t unit_type;
+  Dwarf_Die cudie, subdie;
+  while (INTUSE(dwarf_get_units) (dbg, cu, &cu, NULL, &unit_type,
+				  &cudie, &subdie) == 0)
+    {
+      /* Type units from .debug_types have no code, and their offsets
+	 would be taken as .debug_info offsets.  */
+      if (cu->sec_idx != IDX_debug_info)
+	continue;
+
+      Dwarf_Off offset = INTUSE(dwarf_dieoffset) (&cudie);
+      if (naranges > 0
+	  && bsearch (&offset, covered, naranges, sizeof covered[0],
+		      compare_offsets) != NULL)
+	continue;
+
+      ptrdiff_t n = add_die_ranges (list, &cudie, offset);
+      if (n == 0 && unit_type == DW_UT_skeleton
+	  && INTUSE(dwarf_tag) (&subdie) != DW_TAG_invalid)
+	n = add_die_ranges (list, &subdie, offset);
+      if (n < 0)
+	{
+	  free (covered);
+	  return -1;
+	}
+    }
+  free (covered);
+  return 0;
+}
+
+/* Min-heap of indexes into RANGES, the best range on top.  */
+static void
+heap_push (size_t *heap, size_t *n, const struct unit_range *ranges,
+	   size_t r)
+{
+  size_t i = (*n)++;
+  while (i > 0 && better_range (&ranges[r], &ranges[heap[(i - 1) / 2]]))
+    {
+      heap[i] = heap[(i - 1) / 2];
+      i = (i - 1) / 2;
+    }
+  heap[i] = r;
+}
+
+static void
+heap_pop (size_t *heap, size_t *n, const struct unit_range *ranges)
+{
+  size_t r = heap[--*n];
+  size_t i = 0;
+  while (2 * i + 1 < *n)
+    {
+      size_t c = 2 * i + 1;
+      if (c + 1 < *n && better_range (&ranges[heap[c + 1]], &ranges[heap[c]]))
+	c++;
+      if (! better_range (&ranges[heap[c]], &ranges[r]))
+	break;
+      heap[i] = heap[c];
+      i = c;
+    }
+  heap[i] = r;
+}
+
+/* Turn the overlapping ranges of LIST into sorted, non-overlapping
+   ones in MAP.  Every piece of the address space goes to the best
+   range covering it, so a wide range only fills the gaps the more
+   specific ones leave.  Adjacent pieces of the same unit are merged.
+   MAP needs room for twice as many ranges as LIST has.  */
+static size_t
+resolve_ranges (struct range_list *list, Dwarf_Addr *bounds, size_t *heap,
+		Dwarf_Arange *map)
+{
+  qsort (list->ranges, list->n, sizeof list->ranges[0], compare_starts);
+
+  size_t nbounds = 0;
+  for (size_t i = 0; i < list->n; i++)
+    {
+      bounds[nbounds++] = list->ranges[i].addr;
+      bounds[nbounds++] = list->ranges[i].end;
+    }
+  qsort (bounds, nbounds, sizeof bounds[0], compare_addrs);
+
+  size_t n = 0;
+  size_t nheap = 0;
+  size_t next = 0;
+  for (size_t b = 0; b + 1 < nbounds; b++)
+    {
+      Dwarf_Addr start = bounds[b];
+      Dwarf_Addr end = bounds[b + 1];
+      if (start == end)
+	continue;
+
+      while (next < list->n && list->ranges[next].addr <= start)
+	heap_push (heap, &nheap, list->ranges, next++);
+      while (nheap > 0 && list->ranges[heap[0]].end <= start)
+	heap_pop (heap, &nheap, list->ranges);
+      if (nheap == 0)
+	continue;
+
+      Dwarf_Off offset = list->ranges[heap[0]].offset;
+      if (n > 0 && map[n - 1].offset == offset
+	  && map[n - 1].addr + map[n - 1].length == start)
+	map[n - 1].length += end - start;
+      else
+	{
+	  map[n].addr = start;
+	  map[n].length = end - start;
+	  map[n].offset = offset;
+	  n++;
+	}
+    }
+
+  return n;
+}
+
+static Dwarf_Aranges *
+build_addr_map (Dwarf *dbg)
+{
+  struct range_list list = { .ranges = NULL, .sections = NULL };
+  Dwarf_Addr *bounds = NULL;
+  size_t *heap = NULL;
+  Dwarf_Arange *ranges = NULL;
+  Dwarf_Aranges *map = NULL;
+  size_t n = 0;
+
+  /* Collecting the ranges uses the locked aranges and might need to
+     read split units, so it is done without the lock.  Racing threads
+     all compute the same map, the first one to finish wins.  */
+  if (collect_ranges (dbg, &list) != 0)
+    goto nomem;
+
+  if (list.n > 0)
+    {
+      bounds = malloc (2 * list.n * sizeof bounds[0]);
+      heap = malloc (list.n * sizeof heap[0]);
+      ranges = malloc (2 * list.n * sizeof ranges[0]);
+      if (bounds == NULL || heap == NULL || ranges == NULL)
+	goto nomem;
+      n = resolve_ranges (&list, bounds, heap, ranges);
+    }
+
+  pthread_mutex_lock (&dbg->dwarf_lock);
+  map = atomic_load_explicit (&dbg->addr_map, memory_order_relaxed);
+  if (map == NULL)
+    {
+      map = libdw_alloc (dbg, Dwarf_Aranges,
+			 sizeof (Dwarf_Aranges) + n * sizeof (Dwarf_Arange),
+			 1);
+      map->dbg = dbg;
+      map->naranges = n;
+      if (n > 0)
+	memcpy (map->info, ranges, n * sizeof (Dwarf_Arange));
+      atomic_store_explicit (&dbg->addr_map, map, memory_order_release);
+    }
+  pthread_mutex_unlock (&dbg->dwarf_lock);
+  goto out;
+
+ nomem:
+  __libdw_seterrno (DWARF_E_NOMEM);
+ out:
+  free (ranges);
+  free (heap);
+  free (bounds);
+  free (list.sections);
+  free (list.ranges);
+  return map;
+}
+
+Dwarf_Aranges *
+internal_function
+__libdw_addr_map (Dwarf *dbg)
+{
+  /* Once built the map never changes.  */
+  Dwarf_Aranges *map = atomic_load_explicit (&dbg->addr_map,
+					     memory_order_acquire);
+  if (map != NULL)
+    return map;
+
+  return build_addr_map (dbg);
+}
+
+Dwarf_Aranges *
+internal_function
+__libdw_set_addr_map (Dwarf *dbg, const Dwarf_Arange *ranges, size_t n)
+{
+  /* The ranges must be sorted and not overlap, and each must point to
+     the DIE of a unit.  */
+  Dwarf_Off last_offset = (Dwarf_Off) -1;
+  for (size_t i = 0; i < n; i++)
+    {
+      if (ranges[i].length == 0
+	  || ranges[i].addr + ranges[i].length < ranges[i].addr
+	  || (i > 0 && ranges[i].addr < (ranges[i - 1].addr
+					 + ranges[i - 1].length)))
+	goto invalid;
+
+      if (ranges[i].offset == last_offset)
+	continue;
+      last_offset = ranges[i].offset;
+      struct Dwarf_CU *cu = __libdw_findcu (dbg, last_offset, false);
+      if (cu == NULL || __libdw_first_die_off_from_cu (cu) != last_offset)
+	goto invalid;
+    }
+
+  pthread_mutex_lock (&dbg->dwarf_lock);
+  Dwarf_Aranges *map = atomic_load_explicit (&dbg->addr_map,
+					     memory_order_relaxed);
+  if (map == NULL)
+    {
+      map = libdw_alloc (dbg, Dwarf_Aranges,
+			 sizeof (Dwarf_Aranges) + n * sizeof (Dwarf_Arange),
+			 1);
+      map->dbg = dbg;
+      map->naranges = n;
+      if (n > 0)
+	memcpy (map->info, ranges, n * sizeof (Dwarf_Arange));
+      atomic_store_explicit (&dbg->addr_map, map, memory_order_release);
+    }
+  pthread_mutex_unlock (&dbg->dwarf_lock);
+  return map;
+
+ invalid:
+  __libdw_seterrno (DWARF_E_INVALID_DWARF);
+  return NULL;
+}
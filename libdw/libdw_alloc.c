@@ -48,56 +48,232 @@
 
 #define thread_local __thread
 
-static thread_local int initialized = 0;
-static thread_local size_t thread_id;
-static atomic_size_t next_id = ATOMIC_VAR_INIT(0);
+#define THREAD_ID_UNSET ((size_t) -1)
 
-struct libdw_memblock *
-__libdw_alloc_tail (Dwarf *dbg)
+/* Thread ids index the per-Dwarf tables of memory block tails.  The
+   id of a thread that exits is given to the next new thread, which
+   then continues to use the blocks of the old thread.  So the tables
+   only grow with the number of threads that run at the same time,
+   and no partially used blocks are left behind by finished threads.  */
+static thread_local size_t thread_id = THREAD_ID_UNSET;
+static pthread_mutex_t thread_ids_lock = PTHREAD_MUTEX_INITIALIZER;
+static size_t next_id;
+static size_t *free_ids;
+static size_t nfree_ids;
+static size_t nfree_ids_alloc;
+static pthread_key_t thread_id_key;
+static bool have_thread_id_key;
+
+/* Tail of the last Dwarf this thread allocated from.  Checked against
+   the generation, since a new Dwarf might be allocated at the same
+   address as an old one.  */
+static thread_local struct
 {
-  if (!initialized)
+  Dwarf *dbg;
+  size_t gen;
+  struct libdw_memblock **tailp;
+} cached_tail;
+
+static atomic_size_t next_gen = ATOMIC_VAR_INIT(0);
+
+static void
+release_thread_id (void *arg)
+{
+  size_t id = (uintptr_t) arg - 1;
+
+  pthread_mutex_lock (&thread_ids_lock);
+  if (nfree_ids == nfree_ids_alloc)
     {
-      thread_id = atomic_fetch_add (&next_id, 1);
-      initialized = 1;
+      size_t newalloc = nfree_ids_alloc == 0 ? 16 : 2 * nfree_ids_alloc;
+      size_t *newp = realloc (free_ids, newalloc * sizeof newp[0]);
+      if (newp != NULL)
+	{
+	  free_ids = newp;
+	  nfree_ids_alloc = newalloc;
+	}
     }
+  /* If there is no memory the id just isn't used again.  */
+  if (nfree_ids < nfree_ids_alloc)
+    free_ids[nfree_ids++] = id;
+  pthread_mutex_unlock (&thread_ids_lock);
 
-  pthread_rwlock_rdlock (&dbg->mem_rwl);
-  if (thread_id >= dbg->mem_stacks)
+  thread_id = THREAD_ID_UNSET;
+  cached_tail.dbg = NULL;
+}
+
+static __attribute__ ((constructor)) void
+init_thread_id_key (void)
+{
+  have_thread_id_key = pthread_key_create (&thread_id_key,
+					   release_thread_id) == 0;
+}
+
+/* Don't call release_thread_id anymore once libdw is unloaded.  */
+static __attribute__ ((destructor)) void
+fini_thread_id_key (void)
+{
+  if (have_thread_id_key)
+    pthread_key_delete (thread_id_key);
+}
+
+static size_t
+get_thread_id (void)
+{
+  if (thread_id == THREAD_ID_UNSET)
+    {
+      size_t id;
+      pthread_mutex_lock (&thread_ids_lock);
+      if (nfree_ids > 0)
+	id = free_ids[--nfree_ids];
+      else
+	id = next_id++;
+      pthread_mutex_unlock (&thread_ids_lock);
+
+      /* Without the key the id is never released, which only wastes
+	 some memory.  */
+      if (have_thread_id_key)
+	pthread_setspecific (thread_id_key, (void *) (uintptr_t) (id + 1));
+      thread_id = id;
+    }
+
+  return thread_id;
+}
+
+/* Make sure the table has a slot for thread ID.  */
+static struct libdw_memtails *
+grow_tails (Dwarf *dbg, size_t id)
+{
+  pthread_mutex_lock (&dbg->mem_lock);
+
+  struct libdw_memtails *tails
+    = atomic_load_explicit (&dbg->mem_tails, memory_order_relaxed);
+  size_t nchunks = id / LIBDW_MEMTAILS_CHUNK + 1;
+  if (tails == NULL || tails->nchunks < nchunks)
     {
-      pthread_rwlock_unlock (&dbg->mem_rwl);
-      pthread_rwlock_wrlock (&dbg->mem_rwl);
-
-      /* Another thread may have already reallocated. In theory using an
-         atomic would be faster, but given that this only happens once per
-         thread per Dwarf, some minor slowdown should be fine.  */
-      if (thread_id >= dbg->mem_stacks)
-        {
-          dbg->mem_tails = realloc (dbg->mem_tails, (thread_id+1)
-                                    * sizeof (struct libdw_memblock *));
-          assert(dbg->mem_tails);
-          for (size_t i = dbg->mem_stacks; i <= thread_id; i++)
-            dbg->mem_tails[i] = NULL;
-          dbg->mem_stacks = thread_id + 1;
-          ANNOTATE_HAPPENS_BEFORE (&dbg->mem_tails);
-        }
-
-      pthread_rwlock_unlock (&dbg->mem_rwl);
-      pthread_rwlock_rdlock (&dbg->mem_rwl);
+      size_t oldchunks = tails == NULL ? 0 : tails->nchunks;
+      struct libdw_memtails *newp
+	= malloc (sizeof *newp + nchunks * sizeof newp->chunks[0]);
+      if (unlikely (newp == NULL))
+	dbg->oom_handler ();
+
+      for (size_t i = 0; i < oldchunks; i++)
+	newp->chunks[i] = tails->chunks[i];
+      for (size_t i = oldchunks; i < nchunks; i++)
+	{
+	  newp->chunks[i] = calloc (LIBDW_MEMTAILS_CHUNK,
+				    sizeof (struct libdw_memblock *));
+	  if (unlikely (newp->chunks[i] == NULL))
+	    dbg->oom_handler ();
+	}
+      newp->nchunks = nchunks;
+
+      /* Threads might still be reading the old table.  */
+      newp->prev = tails;
+      tails = newp;
+      ANNOTATE_HAPPENS_BEFORE (&dbg->mem_tails);
+      atomic_store_explicit (&dbg->mem_tails, tails, memory_order_release);
     }
 
-  /* At this point, we have an entry in the tail array.  */
+  pthread_mutex_unlock (&dbg->mem_lock);
+  return tails;
+}
+
+/* Return where the tail of the current thread's blocks is stored.  Only
+   this thread writes there, so no locking is needed.  */
+static inline struct libdw_memblock **
+get_tailp (Dwarf *dbg)
+{
+  if (likely (cached_tail.dbg == dbg && cached_tail.gen == dbg->mem_gen))
+    return cached_tail.tailp;
+
+  size_t id = get_thread_id ();
+  struct libdw_memtails *tails
+    = atomic_load_explicit (&dbg->mem_tails, memory_order_acquire);
   ANNOTATE_HAPPENS_AFTER (&dbg->mem_tails);
-  struct libdw_memblock *result = dbg->mem_tails[thread_id];
+  if (tails == NULL || id / LIBDW_MEMTAILS_CHUNK >= tails->nchunks)
+    tails = grow_tails (dbg, id);
+
+  cached_tail.dbg = dbg;
+  cached_tail.gen = dbg->mem_gen;
+  cached_tail.tailp = &tails->chunks[id / LIBDW_MEMTAILS_CHUNK]
+				    [id % LIBDW_MEMTAILS_CHUNK];
+  return cached_tail.tailp;
+}
+
+void
+internal_function
+__libdw_alloc_init (Dwarf *dbg)
+{
+  pthread_mutex_init (&dbg->mem_lock, NULL);
+  atomic_init (&dbg->mem_tails, NULL);
+  dbg->mem_gen = atomic_fetch_add (&next_gen, 1);
+  atomic_init (&dbg->mem_first_used, false);
+
+  struct libdw_memblock *first = (struct libdw_memblock *) (dbg + 1);
+  first->size = dbg->mem_default_size - offsetof (struct libdw_memblock, mem);
+  first->remaining = first->size;
+  first->prev = NULL;
+}
+
+void
+internal_function
+__libdw_alloc_free (Dwarf *dbg)
+{
+  struct libdw_memblock *first = (struct libdw_memblock *) (dbg + 1);
+  struct libdw_memtails *tails
+    = atomic_load_explicit (&dbg->mem_tails, memory_order_relaxed);
+
+  /* The newest table has all chunks.  */
+  if (tails != NULL)
+    for (size_t i = 0; i < tails->nchunks; i++)
+      {
+	for (size_t j = 0; j < LIBDW_MEMTAILS_CHUNK; j++)
+	  {
+	    struct libdw_memblock *memp = tails->chunks[i][j];
+	    while (memp != NULL)
+	      {
+		struct libdw_memblock *prevp = memp->prev;
+		/* The first block is allocated together with the Dwarf.  */
+		if (memp != first)
+		  free (memp);
+		memp = prevp;
+	      }
+	  }
+	free (tails->chunks[i]);
+      }
+
+  while (tails != NULL)
+    {
+      struct libdw_memtails *prev = tails->prev;
+      free (tails);
+      tails = prev;
+    }
+
+  pthread_mutex_destroy (&dbg->mem_lock);
+}
+
+struct libdw_memblock *
+__libdw_alloc_tail (Dwarf *dbg)
+{
+  struct libdw_memblock **tailp = get_tailp (dbg);
+  struct libdw_memblock *result = *tailp;
   if (result == NULL)
     {
-      result = malloc (dbg->mem_default_size);
-      result->size = dbg->mem_default_size
-                     - offsetof (struct libdw_memblock, mem);
-      result->remaining = result->size;
-      result->prev = NULL;
-      dbg->mem_tails[thread_id] = result;
+      /* The first thread gets the block allocated with the Dwarf.  */
+      if (! atomic_exchange (&dbg->mem_first_used, true))
+	result = (struct libdw_memblock *) (dbg + 1);
+      else
+	{
+	  result = malloc (dbg->mem_default_size);
+	  if (unlikely (result == NULL))
+	    dbg->oom_handler ();
+	  result->size = dbg->mem_default_size
+			 - offsetof (struct libdw_memblock, mem);
+	  result->remaining = result->size;
+	  result->prev = NULL;
+	}
+      *tailp = result;
     }
-  pthread_rwlock_unlock (&dbg->mem_rwl);
   return result;
 }
 
@@ -116,10 +292,9 @@ __libdw_allocate (Dwarf *dbg, size_t minsize, size_t align)
   newp->size = size - offsetof (struct libdw_memblock, mem);
   newp->remaining = (uintptr_t) newp + size - (result + minsize);
 
-  pthread_rwlock_rdlock (&dbg->mem_rwl);
-  newp->prev = dbg->mem_tails[thread_id];
-  dbg->mem_tails[thread_id] = newp;
-  pthread_rwlock_unlock (&dbg->mem_rwl);
+  struct libdw_memblock **tailp = get_tailp (dbg);
+  newp->prev = *tailp;
+  *tailp = newp;
 
   return (void *) result;
 }
@@ -58,8 +58,8 @@ try_split_file (Dwarf_CU *cu, const char *dwo_path)
 	      if (split->unit_type == DW_UT_split_compile
 		  && cu->unit_id8 == split->unit_id8)
 		{
-		  if (tsearch (split->dbg, &cu->dbg->split_tree,
-			       __libdw_finddbg_cb) == NULL)
+		  if (eu_tsearch (split->dbg, &cu->dbg->split_tree,
+				  __libdw_finddbg_cb) == NULL)
 		    {
 		      /* Something went wrong.  Don't link.  */
 		      __libdw_seterrno (DWARF_E_NOMEM);
@@ -86,9 +86,8 @@ try_split_file (Dwarf_CU *cu, const char *dwo_path)
     }
 }
 
-Dwarf_CU *
-internal_function
-__libdw_find_split_unit (Dwarf_CU *cu)
+static Dwarf_CU *
+find_split_unit (Dwarf_CU *cu)
 {
   /* Only try once.  */
   if (cu->split != (Dwarf_CU *) -1)
@@ -145,3 +144,15 @@ __libdw_find_split_unit (Dwarf_CU *cu)
 
   return cu->split;
 }
+
+Dwarf_CU *
+internal_function
+__libdw_find_split_unit (Dwarf_CU *cu)
+{
+  /* The split unit is searched for and linked with the split lock of
+     the skeleton Dwarf held, so only one thread opens the dwo file.  */
+  pthread_mutex_lock (&cu->dbg->split_lock);
+  Dwarf_CU *split = find_split_unit (cu);
+  pthread_mutex_unlock (&cu->dbg->split_lock);
+  return split;
+}
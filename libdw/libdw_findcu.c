@@ -33,32 +33,86 @@
 
 #include <assert.h>
 #include <search.h>
+#include <stdlib.h>
+#include <string.h>
 #include "libdwP.h"
 
-static int
-findcu_cb (const void *arg1, const void *arg2)
+/* Find the unit in TABLE containing OFFSET.  Safe to call while
+   another thread appends a unit.  */
+static struct Dwarf_CU *
+cu_table_find (struct Dwarf_CU_Table *table, Dwarf_Off offset)
 {
-  struct Dwarf_CU *cu1 = (struct Dwarf_CU *) arg1;
-  struct Dwarf_CU *cu2 = (struct Dwarf_CU *) arg2;
-
-  /* Find out which of the two arguments is the search value.  It has
-     end offset 0.  */
-  if (cu1->end == 0)
+  size_t nunits = atomic_load_explicit (&table->nunits,
+					memory_order_acquire);
+  if (nunits == 0)
+    return NULL;
+  struct Dwarf_CU **units = atomic_load_explicit (&table->units,
+						  memory_order_acquire);
+
+  /* Units are mostly looked up while being read in order, so try the
+     last one first.  */
+  struct Dwarf_CU *cu = units[nunits - 1];
+  if (offset >= cu->start)
+    return offset < cu->end ? cu : NULL;
+
+  /* Find the last unit starting at or before OFFSET.  */
+  size_t l = 0;
+  size_t u = nunits - 1;
+  while (l < u)
     {
-      if (cu1->start < cu2->start)
-	return -1;
-      if (cu1->start >= cu2->end)
-	return 1;
+      size_t idx = (l + u + 1) / 2;
+      if (units[idx]->start <= offset)
+	l = idx;
+      else
+	u = idx - 1;
     }
-  else
+
+  cu = units[l];
+  if (offset >= cu->start && offset < cu->end)
+    return cu;
+
+  return NULL;
+}
+
+/* Append NEWP to TABLE.  Must be called with cu_lock held.  */
+static bool
+cu_table_add (struct Dwarf_CU_Table *table, struct Dwarf_CU *newp)
+{
+  size_t nunits = atomic_load_explicit (&table->nunits,
+					memory_order_relaxed);
+  struct Dwarf_CU **units = atomic_load_explicit (&table->units,
+						  memory_order_relaxed);
+  if (nunits == table->alloc)
     {
-      if (cu2->start < cu1->start)
-	return 1;
-      if (cu2->start >= cu1->end)
-	return -1;
+      /* Readers might still be looking at the current array, so make
+	 a copy and keep the old one.  */
+      size_t newalloc = table->alloc == 0 ? 16 : 2 * table->alloc;
+      struct Dwarf_CU **newunits = malloc (newalloc * sizeof newunits[0]);
+      if (unlikely (newunits == NULL))
+	return false;
+
+      if (units != NULL)
+	{
+	  struct Dwarf_CU_Table_Old *old = malloc (sizeof *old);
+	  if (unlikely (old == NULL))
+	    {
+	      free (newunits);
+	      return false;
+	    }
+	  old->units = units;
+	  old->next = table->old;
+	  table->old = old;
+	  memcpy (newunits, units, nunits * sizeof units[0]);
+	}
+
+      units = newunits;
+      table->alloc = newalloc;
+      atomic_store_explicit (&table->units, units, memory_order_release);
     }
 
-  return 0;
+  units[nunits] = newp;
+  atomic_store_explicit (&table->nunits, nunits + 1, memory_order_release);
+  return true;
 }
 
 int
@@ -95,13 +149,14 @@ __libdw_finddbg_cb (const void *arg1, const void *arg2)
   return 0;
 }
 
-struct Dwarf_CU *
-internal_function
-__libdw_intern_next_unit (Dwarf *dbg, bool debug_types)
+/* Read the next unit, with cu_lock held.  */
+static struct Dwarf_CU *
+intern_next_unit (Dwarf *dbg, bool debug_types)
 {
   Dwarf_Off *const offsetp
     = debug_types ? &dbg->next_tu_offset : &dbg->next_cu_offset;
-  void **tree = debug_types ? &dbg->tu_tree : &dbg->cu_tree;
+  struct Dwarf_CU_Table *table
+    = debug_types ? &dbg->tu_table : &dbg->cu_table;
 
   Dwarf_Off oldoff = *offsetp;
   uint16_t version;
@@ -157,15 +212,20 @@ __libdw_intern_next_unit (Dwarf *dbg, bool debug_types)
   newp->subdie_offset = subdie_offset;
   Dwarf_Abbrev_Hash_init (&newp->abbrev_hash, 41);
   newp->orig_abbrev_offset = newp->last_abbrev_offset = abbrev_offset;
+  pthread_mutex_init (&newp->abbrev_lock, NULL);
   newp->files = NULL;
   newp->lines = NULL;
-  newp->locs = NULL;
+  pthread_mutex_init (&newp->src_lock, NULL);
+  eu_search_tree_init (&newp->locs);
+  atomic_init (&newp->sibling_hash, NULL);
+  atomic_init (&newp->die_index, NULL);
+  pthread_mutex_init (&newp->die_index_lock, NULL);
   newp->split = (Dwarf_CU *) -1;
-  newp->base_address = (Dwarf_Addr) -1;
-  newp->addr_base = (Dwarf_Off) -1;
-  newp->str_off_base = (Dwarf_Off) -1;
-  newp->ranges_base = (Dwarf_Off) -1;
-  newp->locs_base = (Dwarf_Off) -1;
+  atomic_init (&newp->base_address, (Dwarf_Addr) -1);
+  atomic_init (&newp->addr_base, (Dwarf_Off) -1);
+  atomic_init (&newp->str_off_base, (Dwarf_Off) -1);
+  atomic_init (&newp->ranges_base, (Dwarf_Off) -1);
+  atomic_init (&newp->locs_base, (Dwarf_Off) -1);
 
   newp->startp = data->d_buf + newp->start;
   newp->endp = data->d_buf + newp->end;
@@ -212,8 +272,8 @@ __libdw_intern_next_unit (Dwarf *dbg, bool debug_types)
   if (unit_type == DW_UT_type || unit_type == DW_UT_split_type)
     Dwarf_Sig8_Hash_insert (&dbg->sig8_hash, unit_id8, newp);
 
-  /* Add the new entry to the search tree.  */
-  if (tsearch (newp, tree, findcu_cb) == NULL)
+  /* Add the new entry to the table.  */
+  if (! cu_table_add (table, newp))
     {
       /* Something went wrong.  Undo the operation.  */
       *offsetp = oldoff;
@@ -224,51 +284,61 @@ __libdw_intern_next_unit (Dwarf *dbg, bool debug_types)
   return newp;
 }
 
+struct Dwarf_CU *
+internal_function
+__libdw_intern_next_unit (Dwarf *dbg, bool debug_types)
+{
+  pthread_mutex_lock (&dbg->cu_lock);
+  struct Dwarf_CU *newp = intern_next_unit (dbg, debug_types);
+  pthread_mutex_unlock (&dbg->cu_lock);
+  return newp;
+}
+
 struct Dwarf_CU *
 internal_function
 __libdw_findcu (Dwarf *dbg, Dwarf_Off start, bool v4_debug_types)
 {
-  void **tree = v4_debug_types ? &dbg->tu_tree : &dbg->cu_tree;
+  struct Dwarf_CU_Table *table
+    = v4_debug_types ? &dbg->tu_table : &dbg->cu_table;
   Dwarf_Off *next_offset
     = v4_debug_types ? &dbg->next_tu_offset : &dbg->next_cu_offset;
 
   /* Maybe we already know that CU.  */
-  struct Dwarf_CU fake = { .start = start, .end = 0 };
-  struct Dwarf_CU **found = tfind (&fake, tree, findcu_cb);
+  struct Dwarf_CU *found = cu_table_find (table, start);
   if (found != NULL)
-    return *found;
+    return found;
 
-  if (start < *next_offset)
-    {
-      __libdw_seterrno (DWARF_E_INVALID_DWARF);
-      return NULL;
-    }
+  pthread_mutex_lock (&dbg->cu_lock);
 
-  /* No.  Then read more CUs.  */
-  while (1)
+  /* Another thread might have read it in the meantime.  */
+  found = cu_table_find (table, start);
+  if (found == NULL)
     {
-      struct Dwarf_CU *newp = __libdw_intern_next_unit (dbg, v4_debug_types);
-      if (newp == NULL)
-	return NULL;
-
-      /* Is this the one we are looking for?  */
-      if (start < *next_offset || start == newp->start)
-	return newp;
+      if (start < *next_offset)
+	__libdw_seterrno (DWARF_E_INVALID_DWARF);
+      else
+	/* No.  Then read more CUs.  */
+	while ((found = intern_next_unit (dbg, v4_debug_types)) != NULL)
+	  /* Is this the one we are looking for?  */
+	  if (start < *next_offset || start == found->start)
+	    break;
     }
-  /* NOTREACHED */
+
+  pthread_mutex_unlock (&dbg->cu_lock);
+  return found;
 }
 
 struct Dwarf_CU *
 internal_function
 __libdw_findcu_addr (Dwarf *dbg, void *addr)
 {
-  void **tree;
+  struct Dwarf_CU_Table *table;
   Dwarf_Off start;
   if (addr >= dbg->sectiondata[IDX_debug_info]->d_buf
       && addr < (dbg->sectiondata[IDX_debug_info]->d_buf
 		 + dbg->sectiondata[IDX_debug_info]->d_size))
     {
-      tree = &dbg->cu_tree;
+      table = &dbg->cu_table;
       start = addr - dbg->sectiondata[IDX_debug_info]->d_buf;
     }
   else if (dbg->sectiondata[IDX_debug_types] != NULL
@@ -276,19 +346,13 @@ __libdw_findcu_addr (Dwarf *dbg, void *addr)
 	   && addr < (dbg->sectiondata[IDX_debug_types]->d_buf
 		      + dbg->sectiondata[IDX_debug_types]->d_size))
     {
-      tree = &dbg->tu_tree;
+      table = &dbg->tu_table;
       start = addr - dbg->sectiondata[IDX_debug_types]->d_buf;
     }
   else
     return NULL;
 
-  struct Dwarf_CU fake = { .start = start, .end = 0 };
-  struct Dwarf_CU **found = tfind (&fake, tree, findcu_cb);
-
-  if (found != NULL)
-    return *found;
-
-  return NULL;
+  return cu_table_find (table, start);
 }
 
 Dwarf *
@@ -298,7 +362,7 @@ __libdw_find_split_dbg_addr (Dwarf *dbg, void *addr)
   /* XXX Assumes split DWARF only has CUs in main IDX_debug_info.  */
   Elf_Data fake_data = { .d_buf = addr, .d_size = 0 };
   Dwarf fake = { .sectiondata[IDX_debug_info] = &fake_data };
-  Dwarf **found = tfind (&fake, &dbg->split_tree, __libdw_finddbg_cb);
+  Dwarf **found = eu_tfind (&fake, &dbg->split_tree, __libdw_finddbg_cb);
 
   if (found != NULL)
     return *found;
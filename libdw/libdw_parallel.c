@@ -0,0 +1,119 @@
+/* Distribute independent work items over several threads.
+   This file is part of elfutils.
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of either
+
+     * the GNU Lesser General Public License as published by the Free
+       Software Foundation; either version 3 of the License, or (at
+       your option) any later version
+
+   or
+
+     * the GNU General Public License as published by the Free
+       Software Foundation; either version 2 of the License, or (at
+       your option) any later version
+
+   or both in parallel, as here.
+
+   elfutils is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received copies of the GNU General Public License and
+   the GNU Lesser General Public License along with this program.  If
+   not, see <http://www.gnu.org/licenses/>.  */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "libdwP.h"
+#include "stdatomic.h"
+
+
+struct parallel_state
+{
+  size_t n;
+  atomic_size_t next;
+  int (*work) (void *arg, size_t idx);
+  void *arg;
+  /* Set once WORK didn't return zero, no new items are started then.  */
+  atomic_bool stop;
+  pthread_mutex_t lock;
+  int result;
+};
+
+
+static void *
+parallel_worker (void *arg)
+{
+  struct parallel_state *state = arg;
+
+  /* The libelf version is per thread, WORK might open files.  */
+  elf_version (EV_CURRENT);
+
+  size_t idx;
+  while (! atomic_load (&state->stop)
+	 && (idx = atomic_fetch_add (&state->next, 1)) < state->n)
+    {
+      int result = state->work (state->arg, idx);
+      if (result != 0)
+	{
+	  pthread_mutex_lock (&state->lock);
+	  if (state->result == 0)
+	    state->result = result;
+	  pthread_mutex_unlock (&state->lock);
+	  atomic_store (&state->stop, true);
+	}
+    }
+
+  return NULL;
+}
+
+
+int
+internal_function
+__libdw_parallel (unsigned int nthreads, size_t n,
+		  int (*work) (void *arg, size_t idx), void *arg)
+{
+  if (nthreads == 0)
+    {
+      long int ncpus = sysconf (_SC_NPROCESSORS_ONLN);
+      nthreads = ncpus > 0 ? ncpus : 1;
+    }
+  if (nthreads > n)
+    nthreads = n;
+
+  struct parallel_state state = { .n = n, .work = work, .arg = arg,
+				  .result = 0 };
+  atomic_init (&state.next, 0);
+  atomic_init (&state.stop, false);
+  pthread_mutex_init (&state.lock, NULL);
+
+  /* The calling thread also does work, so it isn't a problem if not
+     all helper threads can be created.  */
+  pthread_t *threads = NULL;
+  size_t nstarted = 0;
+  if (nthreads > 1)
+    threads = malloc ((nthreads - 1) * sizeof threads[0]);
+  if (threads != NULL)
+    while (nstarted < nthreads - 1
+	   && pthread_create (&threads[nstarted], NULL,
+			      parallel_worker, &state) == 0)
+      nstarted++;
+
+  parallel_worker (&state);
+
+  for (size_t i = 0; i < nstarted; i++)
+    pthread_join (threads[i], NULL);
+
+  free (threads);
+  pthread_mutex_destroy (&state.lock);
+  return state.result;
+}
@@ -34,10 +34,11 @@
 #include <dwarf.h>
 
 
-static bool
-may_have_scopes (Dwarf_Die *die)
+bool
+internal_function
+__libdw_may_have_scopes (int tag)
 {
-  switch (INTUSE(dwarf_tag) (die))
+  switch (tag)
     {
       /* DIEs with addresses we can try to match.  */
     case DW_TAG_compile_unit:
@@ -64,6 +65,20 @@ may_have_scopes (Dwarf_Die *die)
   return false;
 }
 
+unsigned int
+internal_function
+__libdw_die_index_scope_depth (const Dwarf_Die_Index *index, size_t n)
+{
+  if (n == 0 || n >= index->count)
+    return 0;
+
+  for (size_t p = index->parent[n]; p != 0; p = index->parent[p])
+    if (! __libdw_may_have_scopes (index->tag[p]))
+      return 0;
+
+  return index->depth[n] + 1;
+}
+
 struct walk_children_state
 {
   /* Parameters of __libdw_visit_scopes. */
@@ -74,22 +89,68 @@ struct walk_children_state
   void *arg;
   /* Extra local variables for the walker. */
   struct Dwarf_Die_Chain child;
+  /* The DIE index of the unit of CHILD, if available, and the number
+     of CHILD in it.  */
+  const Dwarf_Die_Index *index;
+  size_t child_n;
 };
 
 static inline int
 walk_children (struct walk_children_state *state);
 
-int
-internal_function
-__libdw_visit_scopes (unsigned int depth, struct Dwarf_Die_Chain *root,
-		      struct Dwarf_Die_Chain *imports,
-		      int (*previsit) (unsigned int,
-				       struct Dwarf_Die_Chain *,
-				       void *),
-		      int (*postvisit) (unsigned int,
-					struct Dwarf_Die_Chain *,
-					void *),
-		      void *arg)
+/* Sets STATE->child to the first child of DIE, which is number N in
+   STATE->index if there is an index.  */
+static int
+first_child (struct walk_children_state *state, Dwarf_Die *die, size_t n)
+{
+  if (state->index == NULL)
+    return INTUSE(dwarf_child) (die, &state->child.die);
+
+  const Dwarf_Die_Index *index = state->index;
+  if (n + 1 >= index->count || index->parent[n + 1] != n)
+    return 1;
+
+  state->child_n = n + 1;
+  INTUSE(dwarf_die_index_die) (index, n + 1, &state->child.die);
+  return 0;
+}
+
+/* Sets STATE->child to the first child of the imported UNIT_DIE,
+   switching to the DIE index of its unit.  */
+static int
+import_first_child (struct walk_children_state *state, Dwarf_Die *unit_die)
+{
+  size_t n = 0;
+  state->index = __libdw_die_index_lookup (unit_die, &n);
+  return first_child (state, unit_die, n);
+}
+
+/* Sets STATE->child to the next sibling of DIE, which is number N in
+   STATE->index if there is an index.  */
+static int
+next_sibling (struct walk_children_state *state, Dwarf_Die *die, size_t n)
+{
+  if (state->index == NULL)
+    return INTUSE(dwarf_siblingof) (die, &state->child.die);
+
+  size_t sibling = state->index->sibling[n];
+  if (sibling == (size_t) -1)
+    return 1;
+
+  state->child_n = sibling;
+  INTUSE(dwarf_die_index_die) (state->index, sibling, &state->child.die);
+  return 0;
+}
+
+static int
+visit_scopes (unsigned int depth, struct Dwarf_Die_Chain *root,
+	      const Dwarf_Die_Index *index, size_t root_n,
+	      struct Dwarf_Die_Chain *imports,
+	      int (*previsit) (unsigned int, struct Dwarf_Die_Chain *,
+			       void *),
+	      int (*postvisit) (unsigned int, struct Dwarf_Die_Chain *,
+				void *),
+	      void *arg)
 {
   struct walk_children_state state =
     {
@@ -97,17 +158,37 @@ __libdw_visit_scopes (unsigned int depth, struct Dwarf_Die_Chain *root,
       .imports = imports,
       .previsit = previsit,
       .postvisit = postvisit,
-      .arg = arg
+      .arg = arg,
+      .index = index
     };
 
   state.child.parent = root;
   int ret;
-  if ((ret = INTUSE(dwarf_child) (&root->die, &state.child.die)) != 0)
+  if ((ret = first_child (&state, &root->die, root_n)) != 0)
     return ret < 0 ? -1 : 0; // Having zero children is legal.
 
   return walk_children (&state);
 }
 
+int
+internal_function
+__libdw_visit_scopes (unsigned int depth, struct Dwarf_Die_Chain *root,
+		      struct Dwarf_Die_Chain *imports,
+		      int (*previsit) (unsigned int,
+				       struct Dwarf_Die_Chain *,
+				       void *),
+		      int (*postvisit) (unsigned int,
+					struct Dwarf_Die_Chain *,
+					void *),
+		      void *arg)
+{
+  size_t root_n = 0;
+  const Dwarf_Die_Index *index = __libdw_die_index_lookup (&root->die,
+							   &root_n);
+  return visit_scopes (depth, root, index, root_n, imports,
+		       previsit, postvisit, arg);
+}
+
 static inline int
 walk_children (struct walk_children_state *state)
 {
@@ -121,12 +202,15 @@ walk_children (struct walk_children_state *state)
       while (INTUSE(dwarf_tag) (&state->child.die) == DW_TAG_imported_unit)
 	{
 	  Dwarf_Die orig_child_die = state->child.die;
+	  const Dwarf_Die_Index *orig_index = state->index;
+	  size_t orig_child_n = state->child_n;
 	  Dwarf_Attribute attr_mem;
 	  Dwarf_Attribute *attr = INTUSE(dwarf_attr) (&state->child.die,
 						      DW_AT_import,
 						      &attr_mem);
-	  if (INTUSE(dwarf_formref_die) (attr, &state->child.die) != NULL
-	      && INTUSE(dwarf_child) (&state->child.die, &state->child.die) == 0)
+	  Dwarf_Die unit_die;
+	  if (INTUSE(dwarf_formref_die) (attr, &unit_die) != NULL
+	      && import_first_child (state, &unit_die) == 0)
 	    {
 	      /* Checks the given DIE hasn't been imported yet
 	         to prevent cycles.  */
@@ -154,8 +238,8 @@ walk_children (struct walk_children_state *state)
 	    }
 
 	  /* Any "real" children left?  */
-	  if ((ret = INTUSE(dwarf_siblingof) (&orig_child_die,
-					      &state->child.die)) != 0)
+	  state->index = orig_index;
+	  if ((ret = next_sibling (state, &orig_child_die, orig_child_n)) != 0)
 	    return ret < 0 ? -1 : 0;
 	};
 
@@ -166,11 +250,13 @@ walk_children (struct walk_children_state *state)
 	if (result != DWARF_CB_OK)
 	  return result;
 
-	if (!state->child.prune && may_have_scopes (&state->child.die)
+	if (!state->child.prune
+	    && __libdw_may_have_scopes (INTUSE(dwarf_tag) (&state->child.die))
 	    && INTUSE(dwarf_haschildren) (&state->child.die))
 	  {
-	    result = __libdw_visit_scopes (state->depth + 1, &state->child, state->imports,
-				           state->previsit, state->postvisit, state->arg);
+	    result = visit_scopes (state->depth + 1, &state->child,
+				   state->index, state->child_n, state->imports,
+				   state->previsit, state->postvisit, state->arg);
 	    if (result != DWARF_CB_OK)
 	      return result;
 	  }
@@ -182,7 +268,8 @@ walk_children (struct walk_children_state *state)
 	      return result;
 	  }
     }
-  while ((ret = INTUSE(dwarf_siblingof) (&state->child.die, &state->child.die)) == 0);
+  while ((ret = next_sibling (state, &state->child.die,
+			      state->child_n)) == 0);
 
   return ret < 0 ? -1 : 0;
 }
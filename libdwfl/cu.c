@@ -33,26 +33,96 @@
 #include "libdwflP.h"
 #include "../libdw/libdwP.h"
 #include "../libdw/memory-access.h"
+#include "system.h"
 #include <search.h>
+#include <sys/mman.h>
 
 
 static inline Dwarf_Arange *
 dwar (Dwfl_Module *mod, unsigned int idx)
 {
-  return &mod->dw->aranges->info[mod->aranges[idx].arange];
+  return &__libdw_addr_map (mod->dw)->info[mod->aranges[idx].arange];
 }
 
 
+/* Start of the index cache file holding the address to CU map, the
+   Dwarf_Arange entries of the map follow.  */
+struct cu_map_cache
+{
+  uint32_t entry_size;		/* sizeof (Dwarf_Arange).  */
+  uint32_t pad;
+  uint64_t info_size;		/* Size of .debug_info the map is for.  */
+  uint64_t naranges;
+};
+
+/* The address to CU map of MOD's Dwarf.  With an index cache it is read
+   from there, or stored there after building it.  The map holds unit
+   DIE offsets, the units are only read when first looked up.  */
+static Dwarf_Aranges *
+cu_map (Dwfl_Module *mod)
+{
+  Dwarf *dw = mod->dw;
+  if (mod->dwfl->index_cache_dir == NULL
+      || atomic_load_explicit (&dw->addr_map, memory_order_acquire) != NULL)
+    return __libdw_addr_map (dw);
+
+  Elf_Data *info = dw->sectiondata[IDX_debug_info];
+  struct cu_map_cache expected =
+    {
+      .entry_size = sizeof (Dwarf_Arange),
+      .info_size = info != NULL ? info->d_size : 0
+    };
+
+  size_t size;
+  void *map;
+  size_t map_size;
+  const struct cu_map_cache *cache
+    = __libdwfl_index_cache_map (mod, "cumap", &size, &map, &map_size);
+  if (cache != NULL)
+    {
+      Dwarf_Aranges *aranges = NULL;
+      if (size >= sizeof *cache
+	  && cache->entry_size == expected.entry_size
+	  && cache->info_size == expected.info_size
+	  && cache->naranges <= size / sizeof (Dwarf_Arange)
+	  && size == sizeof *cache + cache->naranges * sizeof (Dwarf_Arange))
+	aranges = __libdw_set_addr_map (dw, (const Dwarf_Arange *) (cache + 1),
+					cache->naranges);
+      munmap (map, map_size);
+      if (aranges != NULL)
+	return aranges;
+    }
+
+  Dwarf_Aranges *aranges = __libdw_addr_map (dw);
+  if (aranges != NULL)
+    {
+      expected.naranges = aranges->naranges;
+      const void *parts[] = { &expected, aranges->info };
+      const size_t sizes[] =
+	{
+	  sizeof expected,
+	  aranges->naranges * sizeof (Dwarf_Arange)
+	};
+      __libdwfl_index_cache_store (mod, "cumap", parts, sizes, 2);
+    }
+  return aranges;
+}
+
+
+/* Find the arange containing ADDR, looking only at MOD->aranges from
+   index *IDXP on.  Updates *IDXP to the index of the arange found.  */
 static Dwfl_Error
-addrarange (Dwfl_Module *mod, Dwarf_Addr addr, struct dwfl_arange **arange)
+addrarange (Dwfl_Module *mod, Dwarf_Addr addr, size_t *idxp,
+	    struct dwfl_arange **arange)
 {
   if (mod->aranges == NULL)
     {
       struct dwfl_arange *aranges = NULL;
-      Dwarf_Aranges *dwaranges = NULL;
-      size_t naranges;
-      if (INTUSE(dwarf_getaranges) (mod->dw, &dwaranges, &naranges) != 0)
+      /* This covers the units missing from .debug_aranges too.  */
+      Dwarf_Aranges *dwaranges = cu_map (mod);
+      if (dwaranges == NULL)
 	return DWFL_E_LIBDW;
+      size_t naranges = dwaranges->naranges;
 
       /* If the module has no aranges (when no code is included) we
 	 allocate nothing.  */
@@ -92,7 +162,21 @@ addrarange (Dwfl_Module *mod, Dwarf_Addr addr, struct dwfl_arange **arange)
   addr = dwfl_deadjust_dwarf_addr (mod, addr);
 
   /* The ranges are sorted by address, so we can use binary search.  */
-  size_t l = 0, u = mod->naranges;
+  size_t l = *idxp, u = mod->naranges;
+  if (l > 0 && l < u && addr >= dwar (mod, l)->addr)
+    {
+      /* Gallop ahead from the hint, addresses usually come close
+	 together.  */
+      size_t step = 1;
+      while (l + step < u && addr >= dwar (mod, l + step)->addr)
+	{
+	  l += step;
+	  step *= 2;
+	}
+      u = MIN (u, l + step);
+    }
+  else
+    l = 0;
   while (l < u)
     {
       size_t idx = (l + u) / 2;
@@ -115,13 +199,14 @@ addrarange (Dwfl_Module *mod, Dwarf_Addr addr, struct dwfl_arange **arange)
 	  else
 	    {
 	      /* It might be in the last range.  */
-	      const Dwarf_Arange *last
-		= &mod->dw->aranges->info[mod->dw->aranges->naranges - 1];
+	      const Dwarf_Aranges *map = __libdw_addr_map (mod->dw);
+	      const Dwarf_Arange *last = &map->info[map->naranges - 1];
 	      if (addr > last->addr + last->length)
 		break;
 	    }
 	}
 
+      *idxp = idx;
       *arange = &mod->aranges[idx];
       return DWFL_E_NOERROR;
     }
@@ -293,7 +378,8 @@ arangecu (Dwfl_Module *mod, struct dwfl_arange *arange, struct dwfl_cu **cu)
 {
   if (arange->cu == NULL)
     {
-      const Dwarf_Arange *dwarange = &mod->dw->aranges->info[arange->arange];
+      const Dwarf_Arange *dwarange
+	= &__libdw_addr_map (mod->dw)->info[arange->arange];
       Dwfl_Error result = intern_cu (mod, dwarange->offset, &arange->cu);
       if (result != DWFL_E_NOERROR)
 	return result;
@@ -310,5 +396,15 @@ internal_function
 __libdwfl_addrcu (Dwfl_Module *mod, Dwarf_Addr addr, struct dwfl_cu **cu)
 {
   struct dwfl_arange *arange;
-  return addrarange (mod, addr, &arange) ?: arangecu (mod, arange, cu);
+  size_t idx = 0;
+  return addrarange (mod, addr, &idx, &arange) ?: arangecu (mod, arange, cu);
+}
+
+Dwfl_Error
+internal_function
+__libdwfl_addrcu_next (Dwfl_Module *mod, Dwarf_Addr addr, size_t *hint,
+		       struct dwfl_cu **cu)
+{
+  struct dwfl_arange *arange;
+  return addrarange (mod, addr, hint, &arange) ?: arangecu (mod, arange, cu);
 }
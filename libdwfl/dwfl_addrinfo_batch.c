@@ -0,0 +1,231 @@
+/* Look up many addresses in one pass.
+   This file is part of elfutils.
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of either
+
+     * the GNU Lesser General Public License as published by the Free
+       Software Foundation; either version 3 of the License, or (at
+       your option) any later version
+
+   or
+
+     * the GNU General Public License as published by the Free
+       Software Foundation; either version 2 of the License, or (at
+       your option) any later version
+
+   or both in parallel, as here.
+
+   elfutils is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received copies of the GNU General Public License and
+   the GNU Lesser General Public License along with this program.  If
+   not, see <http://www.gnu.org/licenses/>.  */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include "libdwflP.h"
+#include "../libdw/libdwP.h"
+#include "system.h"
+
+struct batch_addr
+{
+  Dwarf_Addr addr;
+  size_t ndx;
+};
+
+static int
+compare_batch_addr (const void *a, const void *b)
+{
+  const struct batch_addr *p1 = a;
+  const struct batch_addr *p2 = b;
+
+  if (p1->addr != p2->addr)
+    return p1->addr < p2->addr ? -1 : 1;
+  return p1->ndx < p2->ndx ? -1 : p1->ndx > p2->ndx;
+}
+
+/* Same as the search in dwfl_module_getsrc, but start at *HINT, the
+   line found for a lower address in the same CU, and update it.  */
+static Dwfl_Line *
+find_line (struct dwfl_cu *cu, Dwarf_Addr addr, size_t *hint)
+{
+  Dwarf_Lines *lines = cu->die.cu->lines;
+  size_t nlines = lines->nlines;
+  if (nlines == 0)
+    return NULL;
+
+  /* This is guaranteed for us by libdw read_srclines.  */
+  assert (lines->info[nlines - 1].end_sequence);
+
+  size_t l = 0, u = nlines - 1;
+  if (*hint < nlines && lines->info[*hint].addr <= addr)
+    {
+      /* Gallop ahead, the next address is usually close by.  */
+      size_t step = 1;
+      l = *hint;
+      while (l + step <= u && lines->info[l + step].addr <= addr)
+	{
+	  l += step;
+	  step *= 2;
+	}
+      u = MIN (u, l + step - 1);
+    }
+
+  while (l < u)
+    {
+      size_t idx = u - (u - l) / 2;
+      Dwarf_Line *line = &lines->info[idx];
+      if (addr < line->addr)
+	u = idx - 1;
+      else
+	l = idx;
+    }
+  *hint = l;
+
+  Dwarf_Line *line = &lines->info[l];
+  if (! line->end_sequence && line->addr <= addr)
+    return &cu->lines->idx[l];
+
+  return NULL;
+}
+
+/* Free the scopes of the first N addresses handled.  */
+static void
+free_scopes (Dwfl_Addrinfo *info, const struct batch_addr *order, size_t n)
+{
+  for (size_t i = 0; i < n; ++i)
+    {
+      Dwfl_Addrinfo *ai = &info[order != NULL ? order[i].ndx : i];
+      free (ai->scopes);
+      ai->scopes = NULL;
+      ai->nscopes = 0;
+    }
+}
+
+int
+dwfl_addrinfo_batch (Dwfl *dwfl, const Dwarf_Addr *addrs, size_t naddrs,
+		     Dwfl_Addrinfo *info, bool scopes)
+{
+  if (dwfl == NULL)
+    return -1;
+
+  /* Only sort when the addresses are not already in increasing order.  */
+  struct batch_addr *order = NULL;
+  for (size_t i = 1; i < naddrs; ++i)
+    if (addrs[i] < addrs[i - 1])
+      {
+	order = malloc (naddrs * sizeof order[0]);
+	if (unlikely (order == NULL))
+	  {
+	    __libdwfl_seterrno (DWFL_E_NOMEM);
+	    return -1;
+	  }
+	for (size_t j = 0; j < naddrs; ++j)
+	  {
+	    order[j].addr = addrs[j];
+	    order[j].ndx = j;
+	  }
+	qsort (order, naddrs, sizeof order[0], compare_batch_addr);
+	break;
+      }
+
+  Dwfl_Module *mod = NULL;
+  Dwarf_Addr bias = 0;
+  bool have_dwarf = false;
+  size_t cu_hint = 0;
+  struct dwfl_cu *cu = NULL;
+  size_t line_hint = 0;
+  const Dwfl_Addrinfo *last = NULL;
+
+  size_t i;
+  for (i = 0; i < naddrs; ++i)
+    {
+      size_t ndx = order != NULL ? order[i].ndx : i;
+      Dwarf_Addr addr = addrs[ndx];
+      Dwfl_Addrinfo *ai = &info[ndx];
+
+      /* Duplicate addresses are common in sample buffers.  */
+      if (last != NULL && addr == addrs[last - info])
+	{
+	  *ai = *last;
+	  if (last->scopes != NULL)
+	    {
+	      ai->scopes = malloc (last->nscopes * sizeof last->scopes[0]);
+	      if (unlikely (ai->scopes == NULL))
+		goto nomem;
+	      memcpy (ai->scopes, last->scopes,
+		      last->nscopes * sizeof last->scopes[0]);
+	    }
+	  continue;
+	}
+      last = ai;
+
+      memset (ai, 0, sizeof *ai);
+
+      if (mod == NULL || addr < mod->low_addr || addr >= mod->high_addr)
+	{
+	  mod = INTUSE(dwfl_addrmodule) (dwfl, addr);
+	  if (mod == NULL)
+	    continue;
+	  have_dwarf = INTUSE(dwfl_module_getdwarf) (mod, &bias) != NULL;
+	  cu_hint = 0;
+	  cu = NULL;
+	}
+      ai->module = mod;
+
+      GElf_Sym sym;
+      ai->symbol = INTUSE(dwfl_module_addrinfo) (mod, addr, &ai->offset, &sym,
+						  NULL, NULL, NULL);
+
+      struct dwfl_cu *addrcu;
+      if (! have_dwarf
+	  || __libdwfl_addrcu_next (mod, addr, &cu_hint,
+				    &addrcu) != DWFL_E_NOERROR)
+	continue;
+
+      if (__libdwfl_cu_getsrclines (addrcu) == DWFL_E_NOERROR)
+	{
+	  if (addrcu != cu)
+	    {
+	      cu = addrcu;
+	      line_hint = 0;
+	    }
+	  ai->line = find_line (cu, addr - bias, &line_hint);
+	  if (ai->line != NULL)
+	    ai->file = INTUSE(dwfl_lineinfo) (ai->line, NULL, &ai->lineno,
+					      &ai->column, NULL, NULL);
+	}
+
+      if (scopes)
+	{
+	  ai->nscopes = INTUSE(dwarf_getscopes) (&addrcu->die, addr - bias,
+						 &ai->scopes);
+	  if (ai->nscopes <= 0)
+	    {
+	      bool failed = (ai->nscopes < 0
+			     && INTUSE(dwarf_errno) () == DWARF_E_NOMEM);
+	      ai->nscopes = 0;
+	      ai->scopes = NULL;
+	      if (unlikely (failed))
+		goto nomem;
+	    }
+	}
+    }
+
+  free (order);
+  return 0;
+
+ nomem:
+  /* Entry I has no scopes of its own yet.  */
+  info[order != NULL ? order[i].ndx : i].scopes = NULL;
+  free_scopes (info, order, i);
+  free (order);
+  __libdwfl_seterrno (DWFL_E_NOMEM);
+  return -1;
+}
@@ -88,6 +88,15 @@ __libdwfl_open_by_build_id (Dwfl_Module *mod, bool debug, char **file_name,
       if (dir[0] != '/')
 	continue;
 
+      if (mod->dwfl->build_id_session != 0
+	  && __libdwfl_build_id_index_absent (mod->dwfl, dir, id[0],
+					      &id_name[sizeof "/.build-id/"
+						       - 1 + 3]))
+	{
+	  errno = ENOENT;
+	  continue;
+	}
+
       size_t dirlen = strlen (dir);
       char *name = malloc (dirlen + sizeof id_name);
       if (unlikely (name == NULL))
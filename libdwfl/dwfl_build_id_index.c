@@ -0,0 +1,218 @@
+/* Index of the .build-id directories in the debuginfo path.
+   This file is part of elfutils.
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of either
+
+     * the GNU Lesser General Public License as published by the Free
+       Software Foundation; either version 3 of the License, or (at
+       your option) any later version
+
+   or
+
+     * the GNU General Public License as published by the Free
+       Software Foundation; either version 2 of the License, or (at
+       your option) any later version
+
+   or both in parallel, as here.
+
+   elfutils is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received copies of the GNU General Public License and
+   the GNU Lesser General Public License along with this program.  If
+   not, see <http://www.gnu.org/licenses/>.  */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include "libdwflP.h"
+#include <dirent.h>
+#include <inttypes.h>
+#include <sys/stat.h>
+#include <time.h>
+
+/* The names in one DIR/.build-id/XX directory.  */
+struct build_id_subdir
+{
+  unsigned int session;		/* Session that last checked MTIME.  */
+  bool racy;			/* Changed while it was read, read again.  */
+  struct timespec mtime;	/* Of the directory when NAMES were read.  */
+  size_t nnames;
+  char **names;			/* Sorted.  */
+};
+
+struct build_id_dir
+{
+  struct build_id_dir *next;
+  char *name;
+  struct build_id_subdir subdirs[256];
+};
+
+/* Shared by all Dwfl sessions, never freed.  */
+static pthread_mutex_t build_id_index_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct build_id_dir *build_id_dirs;
+static unsigned int build_id_sessions;
+
+int
+dwfl_set_build_id_index (Dwfl *dwfl, bool enable)
+{
+  if (dwfl == NULL)
+    return -1;
+
+  if (! enable)
+    dwfl->build_id_session = 0;
+  else if (dwfl->build_id_session == 0)
+    {
+      pthread_mutex_lock (&build_id_index_lock);
+      if (++build_id_sessions == 0)
+	++build_id_sessions;
+      dwfl->build_id_session = build_id_sessions;
+      pthread_mutex_unlock (&build_id_index_lock);
+    }
+  return 0;
+}
+
+static int
+compare_names (const void *a, const void *b)
+{
+  return strcmp (*(const char **) a, *(const char **) b);
+}
+
+static void
+free_names (struct build_id_subdir *subdir)
+{
+  for (size_t i = 0; i < subdir->nnames; ++i)
+    free (subdir->names[i]);
+  free (subdir->names);
+  subdir->names = NULL;
+  subdir->nnames = 0;
+}
+
+/* Read the names in PATH into SUBDIR.  False if that failed.  */
+static bool
+read_subdir (struct build_id_subdir *subdir, const char *path)
+{
+  free_names (subdir);
+
+  DIR *dir = opendir (path);
+  if (dir == NULL)
+    return false;
+
+  size_t nalloc = 0;
+  bool ok = true;
+  struct dirent *de;
+  while (ok && (de = readdir (dir)) != NULL)
+    {
+      if (de->d_name[0] == '.')
+	continue;
+      if (subdir->nnames == nalloc)
+	{
+	  nalloc = nalloc == 0 ? 64 : nalloc * 2;
+	  char **names = realloc (subdir->names, nalloc * sizeof names[0]);
+	  if (names == NULL)
+	    {
+	      ok = false;
+	      break;
+	    }
+	  subdir->names = names;
+	}
+      char *name = strdup (de->d_name);
+      if (name == NULL)
+	ok = false;
+      else
+	subdir->names[subdir->nnames++] = name;
+    }
+  closedir (dir);
+
+  if (! ok)
+    {
+      free_names (subdir);
+      return false;
+    }
+  qsort (subdir->names, subdir->nnames, sizeof subdir->names[0],
+	 compare_names);
+  return true;
+}
+
+/* Make SUBDIR match DIR/.build-id/XX, unless SESSION already did.
+   False if it cannot be used.  */
+static bool
+check_subdir (struct build_id_subdir *subdir, unsigned int session,
+	      const char *dir, uint8_t id0)
+{
+  if (subdir->session == session)
+    return true;
+
+  char *path;
+  if (asprintf (&path, "%s/.build-id/%02" PRIx8, dir, id0) < 0)
+    return false;
+
+  /* Taken before looking at the directory, a change after that might
+     still have the same time stamp.  */
+  struct timespec now;
+  clock_gettime (CLOCK_REALTIME, &now);
+
+  bool ok = true;
+  struct stat st;
+  if (stat (path, &st) != 0)
+    {
+      /* Nothing there yet.  */
+      free_names (subdir);
+      subdir->racy = false;
+      subdir->mtime.tv_sec = 0;
+      subdir->mtime.tv_nsec = 0;
+    }
+  else if (subdir->racy
+	   || st.st_mtim.tv_sec != subdir->mtime.tv_sec
+	   || st.st_mtim.tv_nsec != subdir->mtime.tv_nsec)
+    {
+      ok = read_subdir (subdir, path);
+      subdir->mtime = st.st_mtim;
+      subdir->racy = st.st_mtim.tv_sec >= now.tv_sec - 1;
+    }
+  free (path);
+
+  subdir->session = ok ? session : 0;
+  return ok;
+}
+
+bool
+internal_function
+__libdwfl_build_id_index_absent (Dwfl *dwfl, const char *dir, uint8_t id0,
+				 const char *name)
+{
+  bool absent = false;
+  pthread_mutex_lock (&build_id_index_lock);
+
+  struct build_id_dir *d = build_id_dirs;
+  while (d != NULL && strcmp (d->name, dir) != 0)
+    d = d->next;
+  if (d == NULL)
+    {
+      d = calloc (1, sizeof *d);
+      if (d == NULL)
+	goto out;
+      d->name = strdup (dir);
+      if (d->name == NULL)
+	{
+	  free (d);
+	  goto out;
+	}
+      d->next = build_id_dirs;
+      build_id_dirs = d;
+    }
+
+  struct build_id_subdir *subdir = &d->subdirs[id0];
+  if (check_subdir (subdir, dwfl->build_id_session, dir, id0))
+    absent = (subdir->nnames == 0
+	      || bsearch (&name, subdir->names, subdir->nnames,
+			  sizeof subdir->names[0], compare_names) == NULL);
+
+out:
+  pthread_mutex_unlock (&build_id_index_lock);
+  return absent;
+}
@@ -32,6 +32,7 @@
 
 #include "libdwflP.h"
 #include <unistd.h>
+#include "stdatomic.h"
 
 /* Set STATE->pc_set from STATE->regs according to the backend.  Return true on
    success, false on error.  */
@@ -119,6 +120,7 @@ __libdwfl_process_free (Dwfl_Process *process)
   dwfl->process = NULL;
   if (process->ebl_close)
     ebl_closebackend (process->ebl);
+  pthread_mutex_destroy (&process->lock);
   free (process);
   dwfl->attacherr = DWFL_E_NOERROR;
 }
@@ -131,6 +133,7 @@ process_alloc (Dwfl *dwfl)
   if (process == NULL)
     return;
   process->dwfl = dwfl;
+  pthread_mutex_init (&process->lock, NULL);
   dwfl->process = process;
 }
 
@@ -303,6 +306,110 @@ dwfl_getthreads (Dwfl *dwfl, int (*callback) (Dwfl_Thread *thread, void *arg),
 }
 INTDEF(dwfl_getthreads)
 
+struct parallel_state
+{
+  Dwfl *dwfl;
+  pid_t *tids;
+  size_t ntids;
+  int (*callback) (Dwfl_Thread *thread, void *arg);
+  void *arg;
+  /* The error of the first callback that returned -1.  */
+  atomic_int error;
+};
+
+static int
+parallel_one (void *arg, size_t idx)
+{
+  struct parallel_state *state = arg;
+  Dwfl_Process *process = state->dwfl->process;
+
+  Dwfl_Thread thread;
+  thread.process = process;
+  thread.unwound = NULL;
+  thread.callbacks_arg = NULL;
+  thread.tid = state->tids[idx];
+  /* Skip threads that exited since they were listed.  */
+  if (! process->callbacks->get_thread (state->dwfl, thread.tid,
+					process->callbacks_arg,
+					&thread.callbacks_arg))
+    return DWARF_CB_OK;
+
+  int err = state->callback (&thread, state->arg);
+  thread_free_all_states (&thread);
+  if (err == -1)
+    {
+      int expected = DWFL_E_NOERROR;
+      atomic_compare_exchange_strong (&state->error, &expected,
+				      (int) dwfl_errno ());
+    }
+  return err;
+}
+
+int
+dwfl_getthreads_parallel (Dwfl *dwfl, unsigned int nthreads,
+			  int (*callback) (Dwfl_Thread *thread, void *arg),
+			  void *arg)
+{
+  if (dwfl->attacherr != DWFL_E_NOERROR)
+    {
+      __libdwfl_seterrno (dwfl->attacherr);
+      return -1;
+    }
+
+  Dwfl_Process *process = dwfl->process;
+  if (process == NULL)
+    {
+      __libdwfl_seterrno (DWFL_E_NO_ATTACH_STATE);
+      return -1;
+    }
+
+  /* Without get_thread the thread arguments of next_thread might only
+     be valid until the next call.  */
+  if (nthreads == 1 || process->callbacks->get_thread == NULL)
+    return INTUSE(dwfl_getthreads) (dwfl, callback, arg);
+
+  /* Listing the threads is sequential.  */
+  struct parallel_state state = { .dwfl = dwfl, .tids = NULL, .ntids = 0,
+				  .callback = callback, .arg = arg };
+  size_t nalloc = 0;
+  void *thread_arg = NULL;
+  pid_t tid;
+  while ((tid = process->callbacks->next_thread (dwfl,
+						 process->callbacks_arg,
+						 &thread_arg)) > 0)
+    {
+      if (state.ntids == nalloc)
+	{
+	  nalloc = nalloc == 0 ? 64 : 2 * nalloc;
+	  pid_t *newp = realloc (state.tids, nalloc * sizeof newp[0]);
+	  if (unlikely (newp == NULL))
+	    {
+	      free (state.tids);
+	      __libdwfl_seterrno (DWFL_E_NOMEM);
+	      return -1;
+	    }
+	  state.tids = newp;
+	}
+      state.tids[state.ntids++] = tid;
+    }
+  if (tid < 0)
+    {
+      free (state.tids);
+      return -1;
+    }
+
+  atomic_init (&state.error, DWFL_E_NOERROR);
+  int result = __libdw_parallel (nthreads, state.ntids, parallel_one,
+				 &state);
+  free (state.tids);
+
+  if (result == -1)
+    __libdwfl_seterrno (atomic_load (&state.error));
+  else if (result == DWARF_CB_OK)
+    __libdwfl_seterrno (DWFL_E_NOERROR);
+  return result;
+}
+
 struct one_arg
 {
   pid_t tid;
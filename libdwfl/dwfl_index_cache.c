@@ -0,0 +1,223 @@
+/* Keep module indexes in files named after their build ID.
+   This file is part of elfutils.
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of either
+
+     * the GNU Lesser General Public License as published by the Free
+       Software Foundation; either version 3 of the License, or (at
+       your option) any later version
+
+   or
+
+     * the GNU General Public License as published by the Free
+       Software Foundation; either version 2 of the License, or (at
+       your option) any later version
+
+   or both in parallel, as here.
+
+   elfutils is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received copies of the GNU General Public License and
+   the GNU Lesser General Public License along with this program.  If
+   not, see <http://www.gnu.org/licenses/>.  */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include "libdwflP.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <system.h>
+
+/* Bumped whenever the layout of any index changes.  */
+#define INDEX_CACHE_VERSION	1
+
+/* Written in native byte order, files from another host don't match.  */
+#define INDEX_CACHE_BYTE_ORDER	0x01020304
+
+/* Start of every cache file.  The build ID follows, padded to a
+   multiple of 8 bytes, and then SIZE bytes of data for the index.  */
+struct index_cache_header
+{
+  char magic[8];		/* "ELFUIDX\0".  */
+  uint32_t version;
+  uint32_t byte_order;
+  uint32_t build_id_len;
+  uint32_t pad;
+  uint64_t size;
+};
+
+static const char index_cache_magic[8] = "ELFUIDX";
+
+int
+dwfl_set_index_cache (Dwfl *dwfl, const char *dir)
+{
+  if (dwfl == NULL)
+    return -1;
+
+  char *copy = NULL;
+  if (dir != NULL)
+    {
+      copy = strdup (dir);
+      if (copy == NULL)
+	{
+	  __libdwfl_seterrno (DWFL_E_NOMEM);
+	  return -1;
+	}
+    }
+  free (dwfl->index_cache_dir);
+  dwfl->index_cache_dir = copy;
+  return 0;
+}
+
+/* Return the malloc'd name of the file holding index KIND of MOD, or
+   NULL.  Sets *BITS and *LEN to the build ID.  */
+static char *
+cache_file_name (Dwfl_Module *mod, const char *kind,
+		 const unsigned char **bits, int *len)
+{
+  const char *dir = mod->dwfl->index_cache_dir;
+  if (dir == NULL)
+    return NULL;
+
+  GElf_Addr vaddr;
+  *len = INTUSE(dwfl_module_build_id) (mod, bits, &vaddr);
+  if (*len <= 0)
+    return NULL;
+
+  size_t dirlen = strlen (dir);
+  char *name = malloc (dirlen + 1 + 2 * *len + 1 + strlen (kind) + 1);
+  if (name == NULL)
+    return NULL;
+
+  char *p = mempcpy (name, dir, dirlen);
+  *p++ = '/';
+  for (int i = 0; i < *len; ++i)
+    {
+      static const char hex[] = "0123456789abcdef";
+      *p++ = hex[(*bits)[i] >> 4];
+      *p++ = hex[(*bits)[i] & 0xf];
+    }
+  *p++ = '.';
+  strcpy (p, kind);
+  return name;
+}
+
+static size_t
+header_size (int build_id_len)
+{
+  return sizeof (struct index_cache_header) + ((build_id_len + 7) & -8);
+}
+
+const void *
+internal_function
+__libdwfl_index_cache_map (Dwfl_Module *mod, const char *kind,
+			   size_t *sizep, void **mapp, size_t *map_sizep)
+{
+  const unsigned char *bits;
+  int len;
+  char *name = cache_file_name (mod, kind, &bits, &len);
+  if (name == NULL)
+    return NULL;
+
+  int fd = open (name, O_RDONLY);
+  free (name);
+  if (fd < 0)
+    return NULL;
+
+  struct stat st;
+  void *map = MAP_FAILED;
+  if (fstat (fd, &st) == 0 && (size_t) st.st_size >= header_size (len))
+    map = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close (fd);
+  if (map == MAP_FAILED)
+    return NULL;
+
+  const struct index_cache_header *header = map;
+  size_t start = header_size (len);
+  if (memcmp (header->magic, index_cache_magic, sizeof header->magic) != 0
+      || header->version != INDEX_CACHE_VERSION
+      || header->byte_order != INDEX_CACHE_BYTE_ORDER
+      || header->build_id_len != (uint32_t) len
+      || memcmp (header + 1, bits, len) != 0
+      || header->size != (uint64_t) st.st_size - start)
+    {
+      munmap (map, st.st_size);
+      return NULL;
+    }
+
+  *sizep = header->size;
+  *mapp = map;
+  *map_sizep = st.st_size;
+  return (const char *) map + start;
+}
+
+void
+internal_function
+__libdwfl_index_cache_store (Dwfl_Module *mod, const char *kind,
+			     const void *parts[], const size_t sizes[],
+			     size_t nparts)
+{
+  const unsigned char *bits;
+  int len;
+  char *name = cache_file_name (mod, kind, &bits, &len);
+  if (name == NULL)
+    return;
+
+  /* Written under a temporary name and renamed, so readers never see
+     a partial file.  The cache is for any process, so the file is made
+     readable by all as far as the umask allows, which mkstemp doesn't.
+     Threads of this process writing the same file use other names.  */
+  char *tmpname = NULL;
+  int fd = -1;
+  for (unsigned int i = 0; fd < 0 && i < 100; ++i)
+    {
+      free (tmpname);
+      if (asprintf (&tmpname, "%s.%ld.%u", name, (long) getpid (), i) < 0)
+	{
+	  tmpname = NULL;
+	  break;
+	}
+      fd = open (tmpname, O_WRONLY | O_CREAT | O_EXCL, 0644);
+      if (fd < 0 && errno != EEXIST)
+	break;
+    }
+  if (fd < 0)
+    {
+      free (tmpname);
+      free (name);
+      return;
+    }
+
+  struct index_cache_header header;
+  memset (&header, 0, sizeof header);
+  memcpy (header.magic, index_cache_magic, sizeof header.magic);
+  header.version = INDEX_CACHE_VERSION;
+  header.byte_order = INDEX_CACHE_BYTE_ORDER;
+  header.build_id_len = len;
+  header.size = 0;
+  for (size_t i = 0; i < nparts; ++i)
+    header.size += sizes[i];
+
+  static const char zeros[8];
+  bool ok = (write_retry (fd, &header, sizeof header) == sizeof header
+	     && write_retry (fd, bits, len) == len
+	     && (write_retry (fd, zeros, -len & 7)
+		 == (ssize_t) (-len & 7)));
+  for (size_t i = 0; ok && i < nparts; ++i)
+    ok = write_retry (fd, parts[i], sizes[i]) == (ssize_t) sizes[i];
+  if (close (fd) != 0)
+    ok = false;
+
+  if (! ok || rename (tmpname, name) != 0)
+    unlink (tmpname);
+  free (tmpname);
+  free (name);
+}
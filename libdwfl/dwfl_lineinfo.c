@@ -63,3 +63,4 @@ dwfl_lineinfo (Dwfl_Line *line, Dwarf_Addr *addr, int *linep, int *colp,
     *length = file->length;
   return file->name;
 }
+INTDEF (dwfl_lineinfo)
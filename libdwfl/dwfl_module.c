@@ -68,6 +68,12 @@ __libdwfl_module_free (Dwfl_Module *mod)
   if (mod->aranges != NULL)
     free (mod->aranges);
 
+  free (mod->line_index);
+  free (mod->text_ranges);
+
+  __libdwfl_symindex_free (mod->symindex[0]);
+  __libdwfl_symindex_free (mod->symindex[1]);
+
   if (mod->cu != NULL)
     {
       for (size_t i = 0; i < mod->ncu; ++i)
@@ -137,6 +143,7 @@ dwfl_report_begin (Dwfl *dwfl)
 {
   /* Clear the segment lookup table.  */
   dwfl->lookup_elts = 0;
+  dwfl->lookup_unsorted = false;
 
   for (Dwfl_Module *m = dwfl->modulelist; m != NULL; m = m->next)
     m->gc = true;
@@ -238,6 +245,12 @@ dwfl_report_end (Dwfl *dwfl,
 	tailp = &m->next;
     }
 
+  if (unlikely (__libdwfl_segment_sort (dwfl)))
+    {
+      __libdwfl_seterrno (DWFL_E_NOMEM);
+      return -1;
+    }
+
   return 0;
 }
 INTDEF (dwfl_report_end)
@@ -31,6 +31,8 @@
 #endif
 
 #include "libdwflP.h"
+#include "system.h"
+#include <sys/mman.h>
 
 struct search_state
 {
@@ -234,6 +236,449 @@ search_table (struct search_state *state, int start, int end)
 	}
 }
 
+/* One entry in the sorted address index of a symbol table range.
+   Each symbol search_table would consider contributes one entry for
+   its (possibly resolved) value, plus a second one for its adjusted
+   st_value when that was resolved to something different.  */
+struct symindex_entry
+{
+  /* Lowest ADDR for which search_table would try this entry.  For the
+     adjusted st_value entry this also includes the resolved value,
+     which must lie below ADDR too.  */
+  GElf_Addr key;
+  GElf_Addr value;		/* Value passed to try_sym_value.  */
+  GElf_Xword size;		/* st_size of the symbol.  */
+  GElf_Addr max_end;		/* Highest value + size up to this entry.  */
+  int ndx;			/* Index passed to __libdwfl_getsym.  */
+  bool adjusted;		/* VALUE is the adjusted st_value.  */
+};
+
+/* Entries for the symbol table range [START, END), sorted by key,
+   then by symbol table order.  */
+struct symindex_table
+{
+  int start;
+  int end;
+  size_t nentries;
+  struct symindex_entry *entries;
+};
+
+struct dwfl_symindex
+{
+  struct symindex_table globals;
+  struct symindex_table locals;
+  /* The index cache file the entries are in, see load_symindex.  NULL
+     if they were malloc'd.  */
+  void *map;
+  size_t map_size;
+};
+
+/* Start of a symbol index in the index cache, followed by the entries
+   of the globals and then those of the locals.  An index is only used
+   for the same symbol tables, which the build ID alone doesn't tell
+   (the debug file might not have been found when it was written).  */
+struct symindex_cache
+{
+  uint32_t entry_size;		/* sizeof (struct symindex_entry).  */
+  uint32_t symfile_is_debug;	/* mod->symfile == &mod->debug.  */
+  int32_t syments;
+  int32_t first_global;
+  int32_t aux_syments;
+  int32_t aux_first_global;
+  int32_t globals_start;
+  int32_t globals_end;
+  int32_t locals_start;
+  int32_t locals_end;
+  uint64_t bias;		/* mod->main_bias the entries are for.  */
+  uint64_t nglobals;
+  uint64_t nlocals;
+};
+
+void
+internal_function
+__libdwfl_symindex_free (struct dwfl_symindex *index)
+{
+  if (index == NULL)
+    return;
+  if (index->map != NULL)
+    munmap (index->map, index->map_size);
+  else
+    {
+      free (index->globals.entries);
+      free (index->locals.entries);
+    }
+  free (index);
+}
+
+static int
+compare_symindex_entries (const void *a, const void *b)
+{
+  const struct symindex_entry *p1 = a;
+  const struct symindex_entry *p2 = b;
+
+  if (p1->key != p2->key)
+    return p1->key < p2->key ? -1 : 1;
+  if (p1->ndx != p2->ndx)
+    return p1->ndx < p2->ndx ? -1 : 1;
+  return (int) p1->adjusted - (int) p2->adjusted;
+}
+
+static bool
+symindex_add (struct symindex_table *table, size_t *nalloc,
+	      GElf_Addr key, GElf_Addr value, GElf_Xword size,
+	      int ndx, bool adjusted)
+{
+  if (table->nentries == *nalloc)
+    {
+      size_t n = *nalloc == 0 ? 64 : *nalloc * 2;
+      struct symindex_entry *entries = realloc (table->entries,
+						n * sizeof entries[0]);
+      if (unlikely (entries == NULL))
+	return false;
+      table->entries = entries;
+      *nalloc = n;
+    }
+
+  struct symindex_entry *e = &table->entries[table->nentries++];
+  /* No uninitialized padding ends up in the index cache.  */
+  memset (e, 0, sizeof *e);
+  e->key = key;
+  e->value = value;
+  e->size = size;
+  e->ndx = ndx;
+  e->adjusted = adjusted;
+  return true;
+}
+
+/* Fill TABLE with the symbols search_table would look at for [START, END).  */
+static bool
+symindex_fill (Dwfl_Module *mod, struct symindex_table *table,
+	       int start, int end, bool adjust_st_value)
+{
+  size_t nalloc = 0;
+  table->start = start;
+  table->end = end;
+  table->nentries = 0;
+  table->entries = NULL;
+
+  for (int i = start; i < end; ++i)
+    {
+      GElf_Sym sym;
+      GElf_Addr value;
+      GElf_Word shndx;
+      Elf *elf;
+      bool resolved;
+      const char *name = __libdwfl_getsym (mod, i, &sym, &value,
+					   &shndx, &elf, NULL,
+					   &resolved, adjust_st_value);
+      if (name == NULL || name[0] == '\0'
+	  || sym.st_shndx == SHN_UNDEF
+	  || GELF_ST_TYPE (sym.st_info) == STT_SECTION
+	  || GELF_ST_TYPE (sym.st_info) == STT_FILE
+	  || GELF_ST_TYPE (sym.st_info) == STT_TLS)
+	continue;
+
+      if (! symindex_add (table, &nalloc, value, value, sym.st_size,
+			  i, false))
+	return false;
+
+      if (resolved && mod->e_type != ET_REL)
+	{
+	  GElf_Addr adjusted_st_value;
+	  adjusted_st_value = dwfl_adjusted_st_value (mod, elf,
+						      sym.st_value);
+	  if (value != adjusted_st_value
+	      && ! symindex_add (table, &nalloc,
+				 MAX (value, adjusted_st_value),
+				 adjusted_st_value, sym.st_size, i, true))
+	    return false;
+	}
+    }
+
+  qsort (table->entries, table->nentries, sizeof table->entries[0],
+	 compare_symindex_entries);
+
+  GElf_Addr max_end = 0;
+  for (size_t i = 0; i < table->nentries; ++i)
+    {
+      struct symindex_entry *e = &table->entries[i];
+      if (e->value + e->size > max_end)
+	max_end = e->value + e->size;
+      e->max_end = max_end;
+    }
+
+  return true;
+}
+
+static void
+symindex_cache_init (Dwfl_Module *mod, struct symindex_cache *cache,
+		     int first_global, int syments)
+{
+  memset (cache, 0, sizeof *cache);
+  cache->entry_size = sizeof (struct symindex_entry);
+  cache->symfile_is_debug = mod->symfile == &mod->debug;
+  cache->syments = syments;
+  cache->first_global = first_global;
+  cache->aux_syments = mod->aux_syments;
+  cache->aux_first_global = mod->aux_first_global;
+  cache->globals_start = first_global == 0 ? 1 : first_global;
+  cache->globals_end = syments;
+  cache->locals_start = 1;
+  cache->locals_end = first_global;
+  cache->bias = mod->main_bias;
+}
+
+/* Copy N entries from SRC to TABLE, moved by DELTA.  Fails if that
+   changes their order, then the index must be built again.  */
+static bool
+symindex_rebias (struct symindex_table *table,
+		 const struct symindex_entry *src, size_t n, GElf_Addr delta)
+{
+  table->nentries = n;
+  table->entries = malloc ((n ?: 1) * sizeof table->entries[0]);
+  if (unlikely (table->entries == NULL))
+    return false;
+
+  GElf_Addr max_end = 0;
+  for (size_t i = 0; i < n; ++i)
+    {
+      struct symindex_entry *e = &table->entries[i];
+      *e = src[i];
+      e->key += delta;
+      e->value += delta;
+      if (i > 0 && e->key < e[-1].key)
+	return false;
+      if (e->value + e->size > max_end)
+	max_end = e->value + e->size;
+      e->max_end = max_end;
+    }
+  return true;
+}
+
+/* Fill INDEX from the index cache if it has an index for the symbol
+   tables described by EXPECTED.  At the same load address the entries
+   are used right from the mapped file, otherwise they are copied.  */
+static bool
+load_symindex (Dwfl_Module *mod, struct dwfl_symindex *index,
+	       const char *kind, const struct symindex_cache *expected)
+{
+  size_t size;
+  void *map;
+  size_t map_size;
+  const struct symindex_cache *cache
+    = __libdwfl_index_cache_map (mod, kind, &size, &map, &map_size);
+  if (cache == NULL)
+    return false;
+
+  if (size < sizeof *cache
+      || memcmp (cache, expected, offsetof (struct symindex_cache, bias)) != 0
+      || cache->nglobals > size / sizeof (struct symindex_entry)
+      || cache->nlocals > size / sizeof (struct symindex_entry)
+      || size != (sizeof *cache + ((cache->nglobals + cache->nlocals)
+				   * sizeof (struct symindex_entry))))
+    {
+      munmap (map, map_size);
+      return false;
+    }
+
+  struct symindex_entry *entries = (struct symindex_entry *) (cache + 1);
+  index->globals.start = cache->globals_start;
+  index->globals.end = cache->globals_end;
+  index->locals.start = cache->locals_start;
+  index->locals.end = cache->locals_end;
+  if (cache->bias == expected->bias)
+    {
+      index->globals.nentries = cache->nglobals;
+      index->globals.entries = entries;
+      index->locals.nentries = cache->nlocals;
+      index->locals.entries = entries + cache->nglobals;
+      index->map = map;
+      index->map_size = map_size;
+      return true;
+    }
+
+  GElf_Addr delta = expected->bias - cache->bias;
+  bool ok = (symindex_rebias (&index->globals, entries, cache->nglobals,
+			      delta)
+	     && symindex_rebias (&index->locals, entries + cache->nglobals,
+				 cache->nlocals, delta));
+  munmap (map, map_size);
+  if (! ok)
+    {
+      free (index->globals.entries);
+      free (index->locals.entries);
+      index->globals.entries = index->locals.entries = NULL;
+    }
+  return ok;
+}
+
+static void
+store_symindex (Dwfl_Module *mod, struct dwfl_symindex *index,
+		const char *kind, struct symindex_cache *cache)
+{
+  cache->nglobals = index->globals.nentries;
+  cache->nlocals = index->locals.nentries;
+  const void *parts[] = { cache, index->globals.entries,
+			  index->locals.entries };
+  const size_t sizes[] =
+    {
+      sizeof *cache,
+      index->globals.nentries * sizeof (struct symindex_entry),
+      index->locals.nentries * sizeof (struct symindex_entry)
+    };
+  __libdwfl_index_cache_store (mod, kind, parts, sizes, 3);
+}
+
+/* Return the sorted address index of MOD's symbol table, building it
+   on first use.  Returns NULL if it cannot be built, the caller then
+   falls back to searching the symbol table linearly.  */
+static struct dwfl_symindex *
+get_symindex (Dwfl_Module *mod, int first_global, int syments,
+	      bool adjust_st_value)
+{
+  struct dwfl_symindex *index = mod->symindex[adjust_st_value];
+  if (index != NULL)
+    return index;
+
+  index = calloc (1, sizeof *index);
+  if (unlikely (index == NULL))
+    return NULL;
+
+  /* Values in ET_REL files depend on where their sections were put,
+     not only on the module's load address.  */
+  bool use_cache = (mod->dwfl->index_cache_dir != NULL
+		    && mod->e_type != ET_REL);
+  const char *kind = adjust_st_value ? "symindex1" : "symindex0";
+  struct symindex_cache cache;
+  if (use_cache)
+    {
+      symindex_cache_init (mod, &cache, first_global, syments);
+      if (load_symindex (mod, index, kind, &cache))
+	{
+	  mod->symindex[adjust_st_value] = index;
+	  return index;
+	}
+    }
+
+  if (! symindex_fill (mod, &index->globals,
+		       first_global == 0 ? 1 : first_global, syments,
+		       adjust_st_value)
+      || ! symindex_fill (mod, &index->locals, 1, first_global,
+			  adjust_st_value))
+    {
+      __libdwfl_symindex_free (index);
+      return NULL;
+    }
+
+  if (use_cache)
+    store_symindex (mod, index, kind, &cache);
+
+  mod->symindex[adjust_st_value] = index;
+  return index;
+}
+
+/* Does the same as search_table over TABLE's range, but only calls
+   try_sym_value for the entries that can influence its outcome.
+   Those are all symbols with a size that contain ADDR, and the
+   sizeless symbols placed exactly at the final min_label.  Sizeless
+   symbols below min_label can never be picked and other sized
+   symbols only raise min_label, which the index precomputes.  The
+   candidates are tried in symbol table order, so ties are broken
+   exactly like search_table does.  */
+static void
+search_index (struct search_state *state, const struct symindex_table *table)
+{
+  const struct symindex_entry *entries = table->entries;
+
+  /* Find the number of entries search_table would try for ADDR.  */
+  size_t l = 0, u = table->nentries;
+  while (l < u)
+    {
+      size_t idx = (l + u) / 2;
+      if (entries[idx].key <= state->addr)
+	l = idx + 1;
+      else
+	u = idx;
+    }
+  size_t n = l;
+  if (n == 0)
+    return;
+
+  GElf_Addr min_label = MAX (state->min_label, entries[n - 1].max_end);
+
+#define MAX_CANDIDATES 64
+  const struct symindex_entry *candidates[MAX_CANDIDATES];
+  size_t ncandidates = 0;
+
+  /* Sized symbols containing ADDR.  Stop once nothing at or below
+     this entry reaches ADDR.  */
+  for (size_t i = n; i-- > 0 && entries[i].max_end > state->addr; )
+    if (entries[i].size != 0
+	&& state->addr - entries[i].value < entries[i].size)
+      {
+	if (unlikely (ncandidates == MAX_CANDIDATES))
+	  goto linear;
+	candidates[ncandidates++] = &entries[i];
+      }
+
+  /* Sizeless symbols at min_label.  Their key lies in [min_label, ADDR].  */
+  l = 0;
+  u = n;
+  while (l < u)
+    {
+      size_t idx = (l + u) / 2;
+      if (entries[idx].key < min_label)
+	l = idx + 1;
+      else
+	u = idx;
+    }
+  for (size_t i = l; i < n; ++i)
+    if (entries[i].size == 0 && entries[i].value == min_label)
+      {
+	if (unlikely (ncandidates == MAX_CANDIDATES))
+	  goto linear;
+	candidates[ncandidates++] = &entries[i];
+      }
+
+  /* Put the candidates back in symbol table order.  */
+  for (size_t i = 1; i < ncandidates; ++i)
+    {
+      const struct symindex_entry *e = candidates[i];
+      size_t j = i;
+      while (j > 0 && (candidates[j - 1]->ndx > e->ndx
+		       || (candidates[j - 1]->ndx == e->ndx
+			   && candidates[j - 1]->adjusted > e->adjusted)))
+	{
+	  candidates[j] = candidates[j - 1];
+	  --j;
+	}
+      candidates[j] = e;
+    }
+
+  state->min_label = min_label;
+  for (size_t i = 0; i < ncandidates; ++i)
+    {
+      GElf_Sym sym;
+      GElf_Addr value;
+      GElf_Word shndx;
+      Elf *elf;
+      bool resolved;
+      const char *name = __libdwfl_getsym (state->mod, candidates[i]->ndx,
+					   &sym, &value, &shndx, &elf, NULL,
+					   &resolved, state->adjust_st_value);
+      if (unlikely (name == NULL))
+	continue;
+      try_sym_value (state, candidates[i]->value, &sym, name, shndx, elf,
+		     candidates[i]->adjusted ? false : resolved);
+    }
+  return;
+
+linear:
+  /* Too many overlapping symbols, this is no better than a scan.  */
+  search_table (state, table->start, table->end);
+#undef MAX_CANDIDATES
+}
+
 /* Returns the name of the symbol "closest" to ADDR.
    Never returns symbols at addresses above ADDR.
 
@@ -281,13 +726,23 @@ __libdwfl_addrsym (Dwfl_Module *_mod, GElf_Addr _addr, GElf_Off *off,
   int first_global = INTUSE (dwfl_module_getsymtab_first_global) (state.mod);
   if (first_global < 0)
     return NULL;
-  search_table (&state, first_global == 0 ? 1 : first_global, syments);
+  struct dwfl_symindex *index = get_symindex (state.mod, first_global,
+					      syments, _adjust_st_value);
+  if (index != NULL)
+    search_index (&state, &index->globals);
+  else
+    search_table (&state, first_global == 0 ? 1 : first_global, syments);
 
   /* If we found nothing searching the global symbols, then try the locals.
      Unless we have a global sizeless symbol that matches exactly.  */
   if (state.closest_name == NULL && first_global > 1
       && (state.sizeless_name == NULL || state.sizeless_value != state.addr))
-    search_table (&state, 1, first_global);
+    {
+      if (index != NULL)
+	search_index (&state, &index->locals);
+      else
+	search_table (&state, 1, first_global);
+    }
 
   /* If we found no proper sized symbol to use, fall back to the best
      candidate sizeless symbol we found, if any.  */
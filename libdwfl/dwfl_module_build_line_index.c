@@ -0,0 +1,194 @@
+/* Build an address index of the lines of all CUs in a module.
+   This file is part of elfutils.
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of either
+
+     * the GNU Lesser General Public License as published by the Free
+       Software Foundation; either version 3 of the License, or (at
+       your option) any later version
+
+   or
+
+     * the GNU General Public License as published by the Free
+       Software Foundation; either version 2 of the License, or (at
+       your option) any later version
+
+   or both in parallel, as here.
+
+   elfutils is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received copies of the GNU General Public License and
+   the GNU Lesser General Public License along with this program.  If
+   not, see <http://www.gnu.org/licenses/>.  */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include "libdwflP.h"
+#include "../libdw/libdwP.h"
+
+/* Adds ADDR with LINE to the index, replacing an entry at the same
+   address, the later one is what the lookup by CU finds.  */
+static bool
+add_entry (struct dwfl_line_entry **index, size_t *n, size_t *alloc,
+	   Dwarf_Addr addr, Dwfl_Line *line)
+{
+  if (*n > 0 && (*index)[*n - 1].addr == addr)
+    {
+      (*index)[*n - 1].line = line;
+      return true;
+    }
+
+  /* Nothing to end if nothing started.  */
+  if (line == NULL && (*n == 0 || (*index)[*n - 1].line == NULL))
+    return true;
+
+  if (*n == *alloc)
+    {
+      size_t newalloc = *alloc == 0 ? 64 : 2 * *alloc;
+      struct dwfl_line_entry *newindex = realloc (*index, (newalloc
+							   * sizeof **index));
+      if (unlikely (newindex == NULL))
+	return false;
+      *index = newindex;
+      *alloc = newalloc;
+    }
+
+  (*index)[*n].addr = addr;
+  (*index)[*n].line = line;
+  ++*n;
+  return true;
+}
+
+/* Adds the lines CU has in [START, END) to the index, as the lookup
+   of an address in that range through CU would find them.  */
+static Dwfl_Error
+add_cu_lines (struct dwfl_line_entry **index, size_t *n, size_t *alloc,
+	      struct dwfl_cu *cu, Dwarf_Addr start, Dwarf_Addr end)
+{
+  /* A CU without line table has no lines for its addresses.  */
+  Dwfl_Error error = __libdwfl_cu_getsrclines (cu);
+  if (error == DWFL_E_NOMEM)
+    return error;
+  Dwarf_Lines *lines = error == DWFL_E_NOERROR ? cu->die.cu->lines : NULL;
+  size_t nlines = lines != NULL ? lines->nlines : 0;
+
+  /* The last line at or before START is in effect at START.  */
+  size_t l = 0, u = nlines;
+  while (l < u)
+    {
+      size_t idx = (l + u) / 2;
+      if (start < lines->info[idx].addr)
+	u = idx;
+      else
+	l = idx + 1;
+    }
+
+  Dwfl_Line *line = NULL;
+  if (l > 0 && ! lines->info[l - 1].end_sequence)
+    line = &cu->lines->idx[l - 1];
+  if (! add_entry (index, n, alloc, start, line))
+    return DWFL_E_NOMEM;
+
+  for (size_t i = l; i < nlines && lines->info[i].addr < end; i++)
+    if (! add_entry (index, n, alloc, lines->info[i].addr,
+		     (lines->info[i].end_sequence
+		      ? NULL : &cu->lines->idx[i])))
+      return DWFL_E_NOMEM;
+
+  /* END is zero if the range goes up to the last address.  */
+  if (end != 0 && ! add_entry (index, n, alloc, end, NULL))
+    return DWFL_E_NOMEM;
+
+  return DWFL_E_NOERROR;
+}
+
+int
+dwfl_module_build_line_index (Dwfl_Module *mod, unsigned int nthreads,
+			      size_t *sizep)
+{
+  if (mod == NULL)
+    return -1;
+
+  if (mod->line_index == NULL)
+    {
+      Dwarf_Addr bias;
+      if (INTUSE(dwfl_module_getdwarf) (mod, &bias) == NULL)
+	return -1;
+
+      /* Decoding the line tables is most of the work, it can be done
+	 for all CUs at once.  */
+      if (INTUSE(dwarf_preload_srclines) (mod->dw, nthreads) != 0)
+	{
+	  __libdwfl_seterrno (DWFL_E_LIBDW);
+	  return -1;
+	}
+
+      /* dwfl_module_getsrc looks up the CU first, so only the lines
+	 of the CU covering an address are found there.  Go through the
+	 same runs of ranges of one CU the lookup does, so that ranges
+	 of code the linker dropped and overlapping line tables give the
+	 same answers.  The runs are sorted by address, so are the lines
+	 of each CU.  */
+      struct dwfl_line_entry *index = NULL;
+      size_t n = 0;
+      size_t alloc = 0;
+      Dwfl_Error error = DWFL_E_NOERROR;
+      Dwarf_Aranges *map = __libdw_addr_map (mod->dw);
+      if (map == NULL)
+	error = DWFL_E_LIBDW;
+      size_t hint = 0;
+      for (size_t i = 0; error == DWFL_E_NOERROR && i < map->naranges; )
+	{
+	  Dwarf_Addr start = map->info[i].addr;
+	  Dwarf_Off offset = map->info[i].offset;
+	  while (++i < map->naranges && map->info[i].offset == offset)
+	    ;
+
+	  /* Like the lookup, consider the gaps part of the run before
+	     and the end of the last range part of it too.  */
+	  Dwarf_Addr end;
+	  if (i < map->naranges)
+	    end = map->info[i].addr;
+	  else
+	    end = map->info[i - 1].addr + map->info[i - 1].length + 1;
+
+	  struct dwfl_cu *cu;
+	  Dwarf_Addr addr = dwfl_adjusted_dwarf_addr (mod, start);
+	  error = __libdwfl_addrcu_next (mod, addr, &hint, &cu);
+	  if (error == DWFL_E_NOERROR)
+	    error = add_cu_lines (&index, &n, &alloc, cu, start, end);
+	}
+      if (error != DWFL_E_NOERROR)
+	{
+	  free (index);
+	  __libdwfl_seterrno (error);
+	  return -1;
+	}
+
+      /* Always allocate something, an empty index is still an index.  */
+      if (n == 0)
+	{
+	  index = malloc (sizeof index[0]);
+	  if (unlikely (index == NULL))
+	    {
+	      __libdwfl_seterrno (DWFL_E_NOMEM);
+	      return -1;
+	    }
+	}
+      else
+	index = realloc (index, n * sizeof index[0]) ?: index;
+
+      mod->line_index = index;
+      mod->nline_index = n;
+    }
+
+  if (sizep != NULL)
+    *sizep = mod->nline_index * sizeof mod->line_index[0];
+  return 0;
+}
@@ -33,6 +33,29 @@
 #include "libdwflP.h"
 #include "../libdw/libdwP.h"
 
+/* Same as below, but search the lines of all CUs at once.  */
+static Dwfl_Line *
+lookup_line_index (Dwfl_Module *mod, Dwarf_Addr addr)
+{
+  const struct dwfl_line_entry *index = mod->line_index;
+  size_t l = 0, u = mod->nline_index;
+  while (l < u)
+    {
+      size_t idx = (l + u) / 2;
+      if (addr < index[idx].addr)
+	u = idx;
+      else
+	l = idx + 1;
+    }
+
+  /* The last entry at or before addr, unless that ends a sequence.  */
+  if (l > 0 && index[l - 1].line != NULL)
+    return index[l - 1].line;
+
+  __libdwfl_seterrno (DWFL_E_ADDR_OUTOFRANGE);
+  return NULL;
+}
+
 Dwfl_Line *
 dwfl_module_getsrc (Dwfl_Module *mod, Dwarf_Addr addr)
 {
@@ -40,6 +63,9 @@ dwfl_module_getsrc (Dwfl_Module *mod, Dwarf_Addr addr)
   if (INTUSE(dwfl_module_getdwarf) (mod, &bias) == NULL)
     return NULL;
 
+  if (mod->line_index != NULL)
+    return lookup_line_index (mod, addr - bias);
+
   struct dwfl_cu *cu;
   Dwfl_Error error = __libdwfl_addrcu (mod, addr, &cu);
   if (likely (error == DWFL_E_NOERROR))
@@ -0,0 +1,90 @@
+/* Open the files of all modules at once.
+   This file is part of elfutils.
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of either
+
+     * the GNU Lesser General Public License as published by the Free
+       Software Foundation; either version 3 of the License, or (at
+       your option) any later version
+
+   or
+
+     * the GNU General Public License as published by the Free
+       Software Foundation; either version 2 of the License, or (at
+       your option) any later version
+
+   or both in parallel, as here.
+
+   elfutils is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received copies of the GNU General Public License and
+   the GNU Lesser General Public License along with this program.  If
+   not, see <http://www.gnu.org/licenses/>.  */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include "libdwflP.h"
+
+struct preload_state
+{
+  Dwfl_Module **modules;
+  size_t nmodules;
+};
+
+/* Everything done here only touches the module itself.  */
+static void
+preload_module (Dwfl_Module *mod)
+{
+  __libdwfl_getelf (mod);
+  if (mod->elferr != DWFL_E_NOERROR || mod->e_type == ET_REL)
+    return;
+
+  Dwarf_Addr bias;
+  INTUSE(dwfl_module_getdwarf) (mod, &bias);
+  INTUSE(dwfl_module_getsymtab) (mod);
+}
+
+static int
+preload_one (void *arg, size_t idx)
+{
+  struct preload_state *state = arg;
+  preload_module (state->modules[idx]);
+  return 0;
+}
+
+int
+dwfl_preload_modules (Dwfl *dwfl, unsigned int nthreads)
+{
+  if (dwfl == NULL)
+    return -1;
+
+  struct preload_state state = { .modules = NULL, .nmodules = 0 };
+  for (Dwfl_Module *mod = dwfl->modulelist; mod != NULL; mod = mod->next)
+    if (! mod->gc)
+      state.nmodules++;
+  if (state.nmodules == 0)
+    return 0;
+
+  state.modules = malloc (state.nmodules * sizeof state.modules[0]);
+  if (state.modules == NULL)
+    {
+      __libdwfl_seterrno (DWFL_E_NOMEM);
+      return -1;
+    }
+  size_t n = 0;
+  for (Dwfl_Module *mod = dwfl->modulelist; mod != NULL; mod = mod->next)
+    if (! mod->gc)
+      state.modules[n++] = mod;
+
+  __libdw_parallel (nthreads, state.nmodules, preload_one, &state);
+
+  free (state.modules);
+  __libdwfl_seterrno (DWFL_E_NOERROR);
+  return 0;
+}
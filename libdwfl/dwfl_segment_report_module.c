@@ -241,6 +241,13 @@ dwfl_segment_report_module (Dwfl *dwfl, int ndx, const char *name,
 			    const void *note_file, size_t note_file_size,
 			    const struct r_debug_info *r_debug_info)
 {
+  /* The table is walked directly below.  */
+  if (unlikely (__libdwfl_segment_sort (dwfl)))
+    {
+      __libdwfl_seterrno (DWFL_E_NOMEM);
+      return -1;
+    }
+
   size_t segment = ndx;
 
   if (segment >= dwfl->lookup_elts)
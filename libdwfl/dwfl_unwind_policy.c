@@ -0,0 +1,138 @@
+/* Choose between CFI and frame pointer unwinding.
+   This file is part of elfutils.
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of either
+
+     * the GNU Lesser General Public License as published by the Free
+       Software Foundation; either version 3 of the License, or (at
+       your option) any later version
+
+   or
+
+     * the GNU General Public License as published by the Free
+       Software Foundation; either version 2 of the License, or (at
+       your option) any later version
+
+   or both in parallel, as here.
+
+   elfutils is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   General Public License for more details.
+
+   You should have received copies of the GNU General Public License and
+   the GNU Lesser General Public License along with this program.  If
+   not, see <http://www.gnu.org/licenses/>.  */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include "libdwflP.h"
+
+static bool
+valid_policy (int policy)
+{
+  switch (policy)
+    {
+    case DWFL_UNWIND_DEFAULT:
+    case DWFL_UNWIND_CFI_FIRST:
+    case DWFL_UNWIND_FP_FIRST:
+    case DWFL_UNWIND_FP_ONLY:
+      return true;
+    default:
+      __libdwfl_seterrno (DWFL_E_INVALID_ARGUMENT);
+      return false;
+    }
+}
+
+int
+dwfl_set_unwind_policy (Dwfl *dwfl, int policy)
+{
+  if (dwfl == NULL)
+    return -1;
+  if (! valid_policy (policy))
+    return -1;
+
+  dwfl->unwind_policy = policy;
+  return 0;
+}
+
+int
+dwfl_module_set_unwind_policy (Dwfl_Module *mod, int policy)
+{
+  if (mod == NULL)
+    return -1;
+  if (! valid_policy (policy))
+    return -1;
+
+  mod->unwind_policy = policy;
+  return 0;
+}
+
+int
+internal_function
+__libdwfl_unwind_policy (Dwfl *dwfl, Dwfl_Module *mod)
+{
+  if (mod != NULL && mod->unwind_policy != DWFL_UNWIND_DEFAULT)
+    return mod->unwind_policy;
+  if (dwfl->unwind_policy != DWFL_UNWIND_DEFAULT)
+    return dwfl->unwind_policy;
+  return DWFL_UNWIND_CFI_FIRST;
+}
+
+static void
+read_text_ranges (Dwfl_Module *mod)
+{
+  mod->text_ranges_read = true;
+
+  __libdwfl_getelf (mod);
+  if (mod->elferr != DWFL_E_NOERROR)
+    return;
+
+  size_t phnum;
+  if (elf_getphdrnum (mod->main.elf, &phnum) != 0 || phnum == 0)
+    return;
+
+  struct dwfl_text_range *ranges = malloc (phnum * sizeof *ranges);
+  if (ranges == NULL)
+    return;
+
+  size_t n = 0;
+  for (size_t i = 0; i < phnum; ++i)
+    {
+      GElf_Phdr phdr_mem;
+      GElf_Phdr *phdr = gelf_getphdr (mod->main.elf, i, &phdr_mem);
+      if (phdr == NULL || phdr->p_type != PT_LOAD
+	  || (phdr->p_flags & PF_X) == 0)
+	continue;
+      ranges[n].start = dwfl_adjusted_address (mod, phdr->p_vaddr);
+      ranges[n].end = ranges[n].start + phdr->p_memsz;
+      n++;
+    }
+
+  if (n == 0)
+    {
+      free (ranges);
+      return;
+    }
+  mod->text_ranges = ranges;
+  mod->ntext_ranges = n;
+}
+
+bool
+internal_function
+__libdwfl_module_text_address (Dwfl_Module *mod, Dwarf_Addr addr)
+{
+  if (! mod->text_ranges_read)
+    read_text_ranges (mod);
+
+  if (mod->text_ranges == NULL)
+    return addr >= mod->low_addr && addr < mod->high_addr;
+
+  for (size_t i = 0; i < mod->ntext_ranges; ++i)
+    if (addr >= mod->text_ranges[i].start && addr < mod->text_ranges[i].end)
+      return true;
+  return false;
+}
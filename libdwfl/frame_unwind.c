@@ -89,6 +89,98 @@ state_get_reg (Dwfl_Frame *state, unsigned regno, Dwarf_Addr *val)
   return true;
 }
 
+static bool
+state_read_mem (Dwfl_Frame *state, Dwarf_Addr addr, Dwarf_Addr *val)
+{
+  Dwfl_Process *process = state->thread->process;
+  if (process->callbacks->memory_read == NULL)
+    {
+      __libdwfl_seterrno (DWFL_E_INVALID_ARGUMENT);
+      return false;
+    }
+  return process->callbacks->memory_read (process->dwfl, addr, val,
+					  process->callbacks_arg);
+}
+
+/* The CFA of the frame being unwound, computed by get_cfa when the
+   first register rule needs it.  */
+struct frame_cfa
+{
+  Dwarf_Addr value;
+  bool computed;
+  bool valid;
+};
+
+static bool get_cfa (Dwfl_Frame *state, Dwarf_Frame *frame,
+		     struct frame_cfa *cfa, Dwarf_Addr bias);
+
+enum fast_eval
+{
+  fast_eval_ok,
+  fast_eval_error,
+  fast_eval_unsupported
+};
+
+/* Nearly all CFI expressions are a register plus an offset, maybe
+   dereferenced, like the CFA of a signal frame.  Evaluate those without
+   expr_eval.  Register rules start with the synthetized CFA, which is
+   unused then but makes the result a location.  If CFA is NULL we are
+   computing the CFA itself.  */
+
+static enum fast_eval
+fast_expr_eval (Dwfl_Frame *state, const struct frame_cfa *cfa,
+		const Dwarf_Op *ops, size_t nops, Dwarf_Addr *result)
+{
+  size_t i = 0;
+  bool is_location = false;
+  if (cfa != NULL && i < nops && ops[i].atom == DW_OP_call_frame_cfa)
+    {
+      is_location = true;
+      i++;
+    }
+
+  unsigned regno;
+  Dwarf_Word offset;
+  if (i < nops && ops[i].atom >= DW_OP_breg0 && ops[i].atom <= DW_OP_breg31)
+    {
+      regno = ops[i].atom - DW_OP_breg0;
+      offset = ops[i].number;
+    }
+  else if (i < nops && ops[i].atom == DW_OP_bregx)
+    {
+      regno = ops[i].number;
+      offset = ops[i].number2;
+    }
+  else
+    return fast_eval_unsupported;
+  i++;
+
+  bool deref = false;
+  if (i < nops && ops[i].atom == DW_OP_deref)
+    {
+      deref = true;
+      i++;
+    }
+  if (i < nops && ops[i].atom == DW_OP_stack_value)
+    {
+      is_location = false;
+      i++;
+    }
+  if (i != nops)
+    return fast_eval_unsupported;
+
+  Dwarf_Addr val;
+  if (! state_get_reg (state, regno, &val))
+    return fast_eval_error;
+  val += offset;
+  if (deref && ! state_read_mem (state, val, &val))
+    return fast_eval_error;
+  if (is_location && ! state_read_mem (state, val, &val))
+    return fast_eval_error;
+  *result = val;
+  return fast_eval_ok;
+}
+
 static int
 bra_compar (const void *key_voidp, const void *elem_voidp)
 {
@@ -140,12 +232,13 @@ do_pop (struct eval_stack *stack, Dwarf_Addr *val)
   return true;
 }
 
-/* If FRAME is NULL is are computing CFI frame base.  In such case another
+/* If CFA is NULL is are computing CFI frame base.  In such case another
    DW_OP_call_frame_cfa is no longer permitted.  */
 
 static bool
-expr_eval (Dwfl_Frame *state, Dwarf_Frame *frame, const Dwarf_Op *ops,
-	   size_t nops, Dwarf_Addr *result, Dwarf_Addr bias)
+expr_eval (Dwfl_Frame *state, Dwarf_Frame *frame, struct frame_cfa *cfa,
+	   const Dwarf_Op *ops, size_t nops, Dwarf_Addr *result,
+	   Dwarf_Addr bias)
 {
   Dwfl_Process *process = state->thread->process;
   if (nops == 0)
@@ -460,15 +553,11 @@ expr_eval (Dwfl_Frame *state, Dwarf_Frame *frame, const Dwarf_Op *ops,
 	case DW_OP_nop:
 	  break;
 	/* DW_OP_* not listed in libgcc/unwind-dw2.c execute_stack_op:  */
-	case DW_OP_call_frame_cfa:;
+	case DW_OP_call_frame_cfa:
 	  // Not used by CFI itself but it is synthetized by elfutils internation.
-	  Dwarf_Op *cfa_ops;
-	  size_t cfa_nops;
-	  Dwarf_Addr cfa;
-	  if (frame == NULL
-	      || dwarf_frame_cfa (frame, &cfa_ops, &cfa_nops) != 0
-	      || ! expr_eval (state, NULL, cfa_ops, cfa_nops, &cfa, bias)
-	      || ! push (cfa))
+	  if (cfa == NULL
+	      || ! get_cfa (state, frame, cfa, bias)
+	      || ! push (cfa->value))
 	    {
 	      __libdwfl_seterrno (DWFL_E_LIBDW);
 	      free (stack.addrs);
@@ -507,6 +596,36 @@ expr_eval (Dwfl_Frame *state, Dwarf_Frame *frame, const Dwarf_Op *ops,
 #undef pop
 }
 
+/* Compute the CFA of FRAME once for all the registers using it.  */
+
+static bool
+get_cfa (Dwfl_Frame *state, Dwarf_Frame *frame, struct frame_cfa *cfa,
+	 Dwarf_Addr bias)
+{
+  if (! cfa->computed)
+    {
+      cfa->computed = true;
+      Dwarf_Op *cfa_ops;
+      size_t cfa_nops;
+      if (dwarf_frame_cfa (frame, &cfa_ops, &cfa_nops) == 0)
+	switch (fast_expr_eval (state, NULL, cfa_ops, cfa_nops, &cfa->value))
+	  {
+	  case fast_eval_ok:
+	    cfa->valid = true;
+	    break;
+	  case fast_eval_error:
+	    break;
+	  case fast_eval_unsupported:
+	    cfa->valid = expr_eval (state, frame, NULL, cfa_ops, cfa_nops,
+				    &cfa->value, bias);
+	    break;
+	  }
+    }
+  if (! cfa->valid)
+    __libdwfl_seterrno (DWFL_E_LIBDW);
+  return cfa->valid;
+}
+
 static Dwfl_Frame *
 new_unwound (Dwfl_Frame *state)
 {
@@ -538,8 +657,12 @@ new_unwound (Dwfl_Frame *state)
 static void
 handle_cfi (Dwfl_Frame *state, Dwarf_Addr pc, Dwarf_CFI *cfi, Dwarf_Addr bias)
 {
+  Dwfl_Process *process = state->thread->process;
   Dwarf_Frame *frame;
-  if (INTUSE(dwarf_cfi_addrframe) (cfi, pc, &frame) != 0)
+  pthread_mutex_lock (&process->lock);
+  int err = INTUSE(dwarf_cfi_addrframe) (cfi, pc, &frame);
+  pthread_mutex_unlock (&process->lock);
+  if (err != 0)
     {
       __libdwfl_seterrno (DWFL_E_LIBDW);
       return;
@@ -553,8 +676,6 @@ handle_cfi (Dwfl_Frame *state, Dwarf_Addr pc, Dwarf_CFI *cfi, Dwarf_Addr bias)
     }
 
   unwound->signal_frame = frame->fde->cie->signal_frame;
-  Dwfl_Thread *thread = state->thread;
-  Dwfl_Process *process = thread->process;
   Ebl *ebl = process->ebl;
   size_t nregs = ebl_frame_nregs (ebl);
   assert (nregs > 0);
@@ -564,18 +685,40 @@ handle_cfi (Dwfl_Frame *state, Dwarf_Addr pc, Dwarf_CFI *cfi, Dwarf_Addr bias)
   bool ra_set = false;
   ebl_dwarf_to_regno (ebl, &ra);
 
+  struct frame_cfa cfa = { .computed = false, .valid = false };
+
   for (unsigned regno = 0; regno < nregs; regno++)
     {
+      /* The offset and register rules of the (cached) frame need no
+	 DWARF expression, check them first.  */
+      const struct dwarf_frame_register *reg = NULL;
+      if (regno < frame->nregs)
+	reg = &frame->regs[regno];
       Dwarf_Op reg_ops_mem[3], *reg_ops;
       size_t reg_nops;
-      if (dwarf_frame_register (frame, regno, reg_ops_mem, &reg_ops,
-				&reg_nops) != 0)
+      Dwarf_Addr regval;
+      if (reg != NULL
+	  && (reg->rule == reg_offset || reg->rule == reg_val_offset))
+	{
+	  if (! get_cfa (state, frame, &cfa, bias))
+	    continue;
+	  regval = cfa.value + reg->value;
+	  if (reg->rule == reg_offset
+	      && ! state_read_mem (state, regval, &regval))
+	    continue;
+	}
+      else if (reg != NULL && reg->rule == reg_register)
+	{
+	  if (! state_get_reg (state, reg->value, &regval))
+	    continue;
+	}
+      else if (dwarf_frame_register (frame, regno, reg_ops_mem, &reg_ops,
+				     &reg_nops) != 0)
 	{
 	  __libdwfl_seterrno (DWFL_E_LIBDW);
 	  continue;
 	}
-      Dwarf_Addr regval;
-      if (reg_nops == 0)
+      else if (reg_nops == 0)
 	{
 	  if (reg_ops == reg_ops_mem)
 	    {
@@ -596,12 +739,18 @@ handle_cfi (Dwfl_Frame *state, Dwarf_Addr pc, Dwarf_CFI *cfi, Dwarf_Addr bias)
 	      continue;
 	    }
 	}
-      else if (! expr_eval (state, frame, reg_ops, reg_nops, &regval, bias))
+      else
 	{
+	  enum fast_eval res = fast_expr_eval (state, &cfa, reg_ops, reg_nops,
+					       &regval);
 	  /* PPC32 vDSO has various invalid operations, ignore them.  The
 	     register will look as unset causing an error later, if used.
 	     But PPC32 does not use such registers.  */
-	  continue;
+	  if (res == fast_eval_error
+	      || (res == fast_eval_unsupported
+		  && ! expr_eval (state, frame, &cfa, reg_ops, reg_nops,
+				  &regval, bias)))
+	    continue;
 	}
 
       /* Some architectures encode some extra info in the return address.  */
@@ -709,6 +858,52 @@ readfunc (Dwarf_Addr addr, Dwarf_Word *datap, void *arg)
 					  process->callbacks_arg);
 }
 
+/* Unwind STATE with the backend, which follows the frame pointer if
+   there is no CFI.  With VALIDATE the caller's PC must be a return
+   address into the text of a module.  */
+static bool
+ebl_unwind_state (Dwfl_Frame *state, Dwarf_Addr pc, bool validate)
+{
+  assert (state->unwound == NULL);
+  Dwfl_Process *process = state->thread->process;
+  Ebl *ebl = process->ebl;
+  if (new_unwound (state) == NULL)
+    {
+      __libdwfl_seterrno (DWFL_E_NOMEM);
+      return false;
+    }
+  state->unwound->pc_state = DWFL_FRAME_STATE_PC_UNDEFINED;
+  // &Dwfl_Frame.signal_frame cannot be passed as it is a bitfield.
+  bool signal_frame = false;
+  bool ok = ebl_unwind (ebl, pc, setfunc, getfunc, readfunc, state,
+			&signal_frame);
+  if (ok && validate)
+    {
+      /* The return address is after the call, which might be the last
+	 instruction of a noreturn function.  */
+      Dwarf_Addr ret = state->unwound->pc - 1;
+      pthread_mutex_lock (&process->lock);
+      Dwfl_Module *mod = INTUSE(dwfl_addrmodule) (process->dwfl, ret);
+      ok = (state->unwound->pc != 0 && mod != NULL
+	    && __libdwfl_module_text_address (mod, ret));
+      pthread_mutex_unlock (&process->lock);
+      if (! ok)
+	__libdwfl_seterrno (DWFL_E_NO_MATCH);
+    }
+  if (! ok)
+    {
+      // Discard the unwind attempt.  During next __libdwfl_frame_unwind call
+      // we may have for example the appropriate Dwfl_Module already mapped.
+      assert (state->unwound->unwound == NULL);
+      free (state->unwound);
+      state->unwound = NULL;
+      return false;
+    }
+  assert (state->unwound->pc_state == DWFL_FRAME_STATE_PC_SET);
+  state->unwound->signal_frame = signal_frame;
+  return true;
+}
+
 void
 internal_function
 __libdwfl_frame_unwind (Dwfl_Frame *state)
@@ -724,20 +919,44 @@ __libdwfl_frame_unwind (Dwfl_Frame *state)
      Then we need to unwind from the original, unadjusted PC.  */
   if (! state->initial_frame && ! state->signal_frame)
     pc--;
-  Dwfl_Module *mod = INTUSE(dwfl_addrmodule) (state->thread->process->dwfl, pc);
+  /* Modules and their CFI are found and loaded lazily, which other
+     threads unwound at the same time must not see half done.  */
+  Dwfl_Process *process = state->thread->process;
+  pthread_mutex_lock (&process->lock);
+  Dwfl_Module *mod = INTUSE(dwfl_addrmodule) (process->dwfl, pc);
+  int policy = __libdwfl_unwind_policy (process->dwfl, mod);
+  pthread_mutex_unlock (&process->lock);
+  if (policy != DWFL_UNWIND_CFI_FIRST)
+    {
+      /* Checking the result against the modules' text keeps garbage
+	 found in place of a frame pointer from ending the backtrace
+	 before CFI had a chance.  */
+      if (ebl_unwind_state (state, pc, true))
+	return;
+      if (policy == DWFL_UNWIND_FP_ONLY)
+	return;
+    }
+  Dwarf_Addr bias;
+  Dwarf_CFI *cfi_eh = NULL;
+  if (mod != NULL)
+    {
+      pthread_mutex_lock (&process->lock);
+      cfi_eh = INTUSE(dwfl_module_eh_cfi) (mod, &bias);
+      pthread_mutex_unlock (&process->lock);
+    }
   if (mod == NULL)
     __libdwfl_seterrno (DWFL_E_NO_DWARF);
   else
     {
-      Dwarf_Addr bias;
-      Dwarf_CFI *cfi_eh = INTUSE(dwfl_module_eh_cfi) (mod, &bias);
       if (cfi_eh)
 	{
 	  handle_cfi (state, pc - bias, cfi_eh, bias);
 	  if (state->unwound)
 	    return;
 	}
+      pthread_mutex_lock (&process->lock);
       Dwarf_CFI *cfi_dwarf = INTUSE(dwfl_module_dwarf_cfi) (mod, &bias);
+      pthread_mutex_unlock (&process->lock);
       if (cfi_dwarf)
 	{
 	  handle_cfi (state, pc - bias, cfi_dwarf, bias);
@@ -745,28 +964,9 @@ __libdwfl_frame_unwind (Dwfl_Frame *state)
 	    return;
 	}
     }
-  assert (state->unwound == NULL);
-  Dwfl_Thread *thread = state->thread;
-  Dwfl_Process *process = thread->process;
-  Ebl *ebl = process->ebl;
-  if (new_unwound (state) == NULL)
-    {
-      __libdwfl_seterrno (DWFL_E_NOMEM);
-      return;
-    }
-  state->unwound->pc_state = DWFL_FRAME_STATE_PC_UNDEFINED;
-  // &Dwfl_Frame.signal_frame cannot be passed as it is a bitfield.
-  bool signal_frame = false;
-  if (! ebl_unwind (ebl, pc, setfunc, getfunc, readfunc, state, &signal_frame))
-    {
-      // Discard the unwind attempt.  During next __libdwfl_frame_unwind call
-      // we may have for example the appropriate Dwfl_Module already mapped.
-      assert (state->unwound->unwound == NULL);
-      free (state->unwound);
-      state->unwound = NULL;
-      // __libdwfl_seterrno has been called above.
-      return;
-    }
-  assert (state->unwound->pc_state == DWFL_FRAME_STATE_PC_SET);
-  state->unwound->signal_frame = signal_frame;
+  /* The frame pointer was tried first already.  */
+  if (policy == DWFL_UNWIND_FP_FIRST)
+    return;
+  // __libdwfl_seterrno has been called above.
+  ebl_unwind_state (state, pc, false);
 }
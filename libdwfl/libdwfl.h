@@ -225,6 +225,20 @@ extern Dwfl_Module *dwfl_addrmodule (Dwfl *dwfl, Dwarf_Addr address);
    *MOD is always set to the module containing ADDRESS, or to null.  */
 extern int dwfl_addrsegment (Dwfl *dwfl, Dwarf_Addr address, Dwfl_Module **mod);
 
+/* Open the main ELF file and the debuginfo file and load the symbol
+   table of every module of DWFL now, using up to NTHREADS threads at the
+   same time.  NTHREADS zero means one per online CPU.  This is meant to
+   be called after reporting many modules, like with
+   dwfl_linux_proc_report or dwfl_core_file_report, so the first lookups
+   that need all of them don't open the files one by one.  The
+   find_elf and find_debuginfo callbacks must be thread-safe, the
+   standard ones are.  No other dwfl function may be called for DWFL
+   until this returns.  Errors for single modules are remembered and
+   returned by later calls using the module, as usual.  ET_REL modules
+   are skipped, relocating them needs the other modules.  Returns zero
+   on success, -1 on error.  */
+extern int dwfl_preload_modules (Dwfl *dwfl, unsigned int nthreads);
+
 
 
 /* Report the known build ID bits associated with a module.
@@ -310,6 +324,18 @@ extern int dwfl_standard_find_debuginfo (Dwfl_Module *, void **,
 					 const char *, const char *,
 					 GElf_Word, char **);
 
+/* Use an index of the .build-id subdirectories of the debuginfo path
+   directories when dwfl_build_id_find_elf and dwfl_build_id_find_debuginfo
+   look for the files of DWFL's modules.  Each subdirectory is read once
+   and only opened again when its modification time changed, so IDs not
+   found there cost no system calls.  The index is shared by all Dwfl
+   sessions of the process that enable it.  Changes are noticed once per
+   session: a file installed after DWFL first looked in its subdirectory
+   is only found by later sessions.  ENABLE false (the default) probes
+   the directories for every module.  Returns zero on success, -1 on
+   error.  */
+extern int dwfl_set_build_id_index (Dwfl *dwfl, bool enable);
+
 
 /* This callback must be used when using dwfl_offline_* to report modules,
    if ET_REL is to be supported.  */
@@ -372,6 +398,18 @@ extern int dwfl_core_file_report (Dwfl *dwfl, Elf *elf, const char *executable);
    or an errno code if opening the proc files failed.  */
 extern int dwfl_linux_proc_report (Dwfl *dwfl, pid_t pid);
 
+/* Bring the modules of DWFL up to date with the files now mapped into
+   the address space of PID, in place of calling dwfl_report_begin,
+   dwfl_linux_proc_report and dwfl_report_end again.  Modules still
+   mapped at the same addresses are kept with everything loaded for
+   them, modules no longer mapped are removed (as by dwfl_report_end
+   with no callback) and new mappings are reported.  When nothing
+   changed DWFL isn't modified at all.  DWFL should only contain
+   modules of PID.  Returns
+   zero on success, -1 if dwfl_report_module failed, or an errno code
+   if opening the proc files failed.  */
+extern int dwfl_linux_proc_report_update (Dwfl *dwfl, pid_t pid);
+
 /* Similar, but reads an input stream in the format of Linux /proc/PID/maps
    files giving module layout, not the file for a live process.  */
 extern int dwfl_linux_proc_maps_report (Dwfl *dwfl, FILE *);
@@ -519,6 +557,19 @@ extern const char *dwfl_module_addrsym (Dwfl_Module *mod, GElf_Addr address,
 					GElf_Sym *sym, GElf_Word *shndxp)
   __nonnull_attribute__ (3);
 
+/* Keep the address indexes that dwfl_module_addrsym and
+   dwfl_module_addrinfo build for a module's symbol table, and the map
+   from addresses to CUs of its DWARF, in files under DIR, named after
+   the module's build ID.  Modules of DWFL with a build ID then map an
+   index written earlier (by any process) instead of building it again.
+   The files are created readable by everyone, as far as the umask
+   allows.  Files that don't match the module's symbol tables or DWARF,
+   or were written by an incompatible version, are rebuilt.  Errors
+   writing the files are ignored.  DIR must exist.  DIR NULL (the
+   default) disables the cache.  Returns zero on success, -1 if out of
+   memory.  */
+extern int dwfl_set_index_cache (Dwfl *dwfl, const char *dir);
+
 /* Find the ELF section that *ADDRESS lies inside and return it.
    On success, adjusts *ADDRESS to be relative to the section,
    and sets *BIAS to the difference between addresses used in
@@ -579,6 +630,50 @@ extern Dwfl_Line *dwfl_onesrcline (Dwarf_Die *cudie, size_t idx);
 extern Dwfl_Line *dwfl_module_getsrc (Dwfl_Module *mod, Dwarf_Addr addr);
 extern Dwfl_Line *dwfl_getsrc (Dwfl *dwfl, Dwarf_Addr addr);
 
+/* Build one address index of the lines of all CUs of MOD, after which
+   dwfl_module_getsrc and dwfl_getsrc find the line for an address by a
+   single binary search instead of looking up the CU first.  The line
+   tables are decoded by NTHREADS threads (including the calling
+   thread), the number of online CPUs if NTHREADS is zero.  Stores the
+   bytes used by the index in *SIZEP if SIZEP isn't NULL.  Does nothing
+   but that if the index was already built.  Returns 0 on success, -1
+   on error.  */
+extern int dwfl_module_build_line_index (Dwfl_Module *mod,
+					 unsigned int nthreads,
+					 size_t *sizep);
+
+/* Information about one address, as filled in by dwfl_addrinfo_batch.  */
+typedef struct
+{
+  Dwfl_Module *module;		/* Module containing the address, or NULL.  */
+  const char *symbol;		/* As returned by dwfl_module_addrinfo.  */
+  GElf_Off offset;		/* Offset of the address from SYMBOL.  */
+  Dwfl_Line *line;		/* As returned by dwfl_module_getsrc.  */
+  const char *file;		/* Source file of LINE, or NULL.  */
+  int lineno;			/* Line number of LINE, or zero.  */
+  int column;			/* Column of LINE, or zero.  */
+  Dwarf_Die *scopes;		/* As returned by dwarf_getscopes, or NULL.  */
+  int nscopes;			/* Number of SCOPES, innermost first.  */
+} Dwfl_Addrinfo;
+
+/* Look up NADDRS addresses at once, filling in INFO[I] for ADDRS[I].
+   The addresses are handled in increasing order, so the module, CU
+   and line table found for one address are reused for the next and
+   duplicate addresses are looked up only once.  This is much cheaper
+   than separate dwfl_addrmodule, dwfl_module_addrinfo and
+   dwfl_module_getsrc calls for (mostly) sorted addresses, as in
+   profile sample buffers, but ADDRS does not have to be sorted.
+   Fields that cannot be determined for an address are NULL or zero.
+   If SCOPES is true also fill in the scopes containing each address,
+   which describe its inline chain.  The caller must free each SCOPES
+   array.  Returns 0 on success, also when none of the addresses could
+   be resolved.  Returns -1 if DWFL is NULL or on running out of memory,
+   no SCOPES are left to free then.  */
+extern int dwfl_addrinfo_batch (Dwfl *dwfl, const Dwarf_Addr *addrs,
+				size_t naddrs, Dwfl_Addrinfo *info,
+				bool scopes)
+  __nonnull_attribute__ (2, 4);
+
 /* Get address for source.  */
 extern int dwfl_module_getsrc_file (Dwfl_Module *mod,
 				    const char *fname, int lineno, int column,
@@ -733,6 +828,27 @@ extern int dwfl_core_file_attach (Dwfl *dwfl, Elf *elf);
 extern int dwfl_linux_proc_attach (Dwfl *dwfl, pid_t pid,
 				   bool assume_ptrace_stopped);
 
+/* Fill in the number of words read from the memory of the process
+   attached by dwfl_linux_proc_attach while unwinding (*READS), and the
+   number of process_vm_readv and ptrace calls that were needed for
+   them (*SYSCALLS).  Reads are served from a cache of recently read
+   pages, which is cleared when a thread is detached.  Either pointer
+   can be null.  Returns zero on success, -1 if DWFL was not attached
+   by dwfl_linux_proc_attach.  */
+extern int dwfl_linux_proc_memory_stats (Dwfl *dwfl, uint64_t *reads,
+					 uint64_t *syscalls);
+
+/* Make threads of the process attached by dwfl_linux_proc_attach be
+   unwound from a snapshot.  When a thread is attached for unwinding its
+   registers and STACK_BYTES bytes of stack above its stack pointer are
+   copied, and then it is detached again right away, so it is only
+   stopped while copying.  The unwinder reads the copy, memory outside
+   of it is read from the (now running) process, which might have
+   changed it in the meantime.  STACK_BYTES zero (the default) keeps
+   threads attached while they are unwound.  Returns zero on success,
+   -1 if DWFL was not attached by dwfl_linux_proc_attach.  */
+extern int dwfl_linux_proc_set_snapshot (Dwfl *dwfl, size_t stack_bytes);
+
 /* Return PID for the process associated with DWFL.  Function returns -1 if
    dwfl_attach_state was not called for DWFL.  */
 pid_t dwfl_pid (Dwfl *dwfl)
@@ -775,6 +891,48 @@ int dwfl_getthreads (Dwfl *dwfl,
 		     void *arg)
   __nonnull_attribute__ (1, 2);
 
+/* Like dwfl_getthreads, but calls CALLBACK for up to NTHREADS threads of
+   the process at the same time, each from its own thread.  NTHREADS zero
+   means one per online CPU.  CALLBACK must be thread-safe; it may unwind
+   the thread it is passed with dwfl_thread_getframes, but the other
+   dwfl functions (in particular symbol lookups) are not thread-safe, so
+   CALLBACK should just collect the PCs for later use.  The order in which
+   threads are visited is unspecified.  When a CALLBACK does not return
+   DWARF_CB_OK no further threads are visited and its value is returned.
+   Falls back to dwfl_getthreads for states that cannot look up threads
+   by TID (like core files).  */
+int dwfl_getthreads_parallel (Dwfl *dwfl, unsigned int nthreads,
+			      int (*callback) (Dwfl_Thread *thread,
+					       void *arg),
+			      void *arg)
+  __nonnull_attribute__ (1, 3);
+
+/* Unwinding policies for dwfl_set_unwind_policy and
+   dwfl_module_set_unwind_policy.  The frame pointer is followed by the
+   architecture backend (x86_64, aarch64 and a few others); the return
+   address it finds is only used if it lies in an executable PT_LOAD
+   segment of a module.  Following the frame pointer never loads or
+   parses CFI, but it can skip a caller when unwinding from a function
+   that hasn't set up its frame yet (or never does).  */
+enum
+  {
+    DWFL_UNWIND_DEFAULT = 0,	/* For a module, the policy of its Dwfl.  */
+    DWFL_UNWIND_CFI_FIRST,	/* CFI, then the frame pointer.  Default.  */
+    DWFL_UNWIND_FP_FIRST,	/* Frame pointer, then CFI.  */
+    DWFL_UNWIND_FP_ONLY		/* Frame pointer only.  */
+  };
+
+/* Set the unwinding policy used for frames whose PC is in a module
+   without a policy of its own, or in no module at all.
+   DWFL_UNWIND_DEFAULT means DWFL_UNWIND_CFI_FIRST.  Returns zero on
+   success, -1 if POLICY is not one of the values above.  */
+extern int dwfl_set_unwind_policy (Dwfl *dwfl, int policy);
+
+/* Set the unwinding policy used for frames whose PC is in MOD.
+   DWFL_UNWIND_DEFAULT uses the policy of the Dwfl again.  Returns zero
+   on success, -1 if POLICY is not one of the values above.  */
+extern int dwfl_module_set_unwind_policy (Dwfl_Module *mod, int policy);
+
 /* Iterate through the frames for a thread.  Returns zero if all frames
    have been processed by the callback, returns -1 on error, or the value of
    the callback when not DWARF_CB_OK.  -1 returned on error will
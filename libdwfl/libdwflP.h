@@ -34,6 +34,7 @@
 #include <assert.h>
 #include <dirent.h>
 #include <errno.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
@@ -130,6 +131,8 @@ struct Dwfl
   GElf_Addr *lookup_addr;	/* Start address of segment.  */
   Dwfl_Module **lookup_module;	/* Module associated with segment, or null.  */
   int *lookup_segndx;		/* User segment index, or -1.  */
+  /* Segments were appended out of order, see __libdwfl_segment_sort.  */
+  bool lookup_unsorted;
 
   /* Cache from last dwfl_report_segment call.  */
   const void *lookup_tail_ident;
@@ -138,6 +141,14 @@ struct Dwfl
   int lookup_tail_ndx;
 
   struct Dwfl_User_Core *user_core;
+
+  int unwind_policy;		/* See dwfl_set_unwind_policy.  */
+
+  char *index_cache_dir;	/* See dwfl_set_index_cache.  */
+
+  /* Nonzero if the build ID index is used, see dwfl_set_build_id_index.
+     Unique for every session that enables it.  */
+  unsigned int build_id_session;
 };
 
 #define OFFLINE_REDZONE		0x10000
@@ -190,6 +201,11 @@ struct Dwfl_Module
   Elf_Data *symxndxdata;	/* Data in the extended section index table. */
   Elf_Data *aux_symxndxdata;	/* Data in the extended auxiliary table. */
 
+  /* Sorted address indexes of the symbol tables for symbol lookup by
+     address, built lazily.  Indexed by the adjust_st_value flag, see
+     dwfl_module_addrsym.c.  */
+  struct dwfl_symindex *symindex[2];
+
   char *elfdir;			/* The dir where we found the main Elf.  */
 
   Dwarf *dw;			/* libdw handle for its debugging info.  */
@@ -207,6 +223,10 @@ struct Dwfl_Module
 
   struct dwfl_arange *aranges;	/* Mapping of addresses in module to CUs.  */
 
+  /* Sorted lines of all CUs, built by dwfl_module_build_line_index.  */
+  struct dwfl_line_entry *line_index;
+  size_t nline_index;
+
   void *build_id_bits;		/* malloc'd copy of build ID bits.  */
   GElf_Addr build_id_vaddr;	/* Address where they reside, 0 if unknown.  */
   int build_id_len;		/* -1 for prior failure, 0 if unset.  */
@@ -218,9 +238,17 @@ struct Dwfl_Module
   Dwarf_CFI *dwarf_cfi;		/* Cached DWARF CFI for this module.  */
   Dwarf_CFI *eh_cfi;		/* Cached EH CFI for this module.  */
 
+  int unwind_policy;		/* See dwfl_module_set_unwind_policy.  */
+
+  /* Executable PT_LOAD segments of the main file, read lazily to check
+     return addresses found by following the frame pointer.  */
+  struct dwfl_text_range *text_ranges;
+  size_t ntext_ranges;
+
   int segment;			/* Index of first segment table entry.  */
   bool gc;			/* Mark/sweep flag.  */
   bool is_executable;		/* Use Dwfl::executable_for_core?  */
+  bool text_ranges_read;	/* text_ranges is set up.  */
 };
 
 /* This holds information common for all the threads/tasks/TIDs of one process
@@ -234,6 +262,9 @@ struct Dwfl_Process
   void *callbacks_arg;
   struct ebl *ebl;
   bool ebl_close:1;
+  /* Serializes the module and CFI lookups of __libdwfl_frame_unwind,
+     threads can be unwound in parallel by dwfl_getthreads_parallel.  */
+  pthread_mutex_t lock;
 };
 
 /* See its typedef in libdwfl.h.  */
@@ -290,6 +321,28 @@ bool __libdwfl_frame_reg_set (Dwfl_Frame *state, unsigned regno,
 			      Dwarf_Addr val)
   internal_function;
 
+/* Free the symbol address index built by dwfl_module_addrsym.c.  */
+extern void __libdwfl_symindex_free (struct dwfl_symindex *index)
+  internal_function;
+
+/* Map the file of MOD's index cache holding the index KIND.  Returns
+   the data stored by __libdwfl_index_cache_store and sets *SIZEP to its
+   size, or returns NULL if there is no cache directory, MOD has no
+   build ID, or the file is missing or doesn't match.  *MAPP and *MAP_SIZEP
+   are set to what has to be passed to munmap when done.  */
+extern const void *__libdwfl_index_cache_map (Dwfl_Module *mod,
+					      const char *kind,
+					      size_t *sizep, void **mapp,
+					      size_t *map_sizep)
+  internal_function;
+
+/* Replace the file of MOD's index cache holding the index KIND with one
+   holding the NPARTS PARTS of the given SIZES.  Does nothing on errors.  */
+extern void __libdwfl_index_cache_store (Dwfl_Module *mod, const char *kind,
+					 const void *parts[],
+					 const size_t sizes[], size_t nparts)
+  internal_function;
+
 /* Information cached about each CU in Dwfl_Module.dw.  */
 struct dwfl_cu
 {
@@ -403,14 +456,78 @@ struct dwfl_arange
   size_t arange;		/* Index in Dwarf_Aranges.  */
 };
 
+/* One address in the line index of a module.  Only the last line of
+   all CUs at each address is kept.  LINE is NULL for the end of a
+   sequence.  */
+struct dwfl_line_entry
+{
+  Dwarf_Addr addr;		/* Relative to the Dwarf, like Dwarf_Line.  */
+  Dwfl_Line *line;
+};
+
+/* An executable segment of a module, adjusted to the module's load
+   address.  */
+struct dwfl_text_range
+{
+  GElf_Addr start;
+  GElf_Addr end;
+};
+
 #define __LIBDWFL_REMOTE_MEM_CACHE_SIZE 4096
-/* Structure for caching remote memory reads as used by __libdwfl_pid_arg.  */
-struct __libdwfl_remote_mem_cache
+/* Number of blocks of __LIBDWFL_REMOTE_MEM_CACHE_SIZE bytes cached.  */
+#define __LIBDWFL_REMOTE_MEM_CACHE_PAGES 32
+/* Number of blocks read at once for the first read after attaching a
+   thread, which is on its stack.  */
+#define __LIBDWFL_REMOTE_MEM_STACK_PAGES 8
+/* One cached block of remote memory.  */
+struct __libdwfl_remote_mem_page
 {
   Dwarf_Addr addr; /* Remote address.  */
-  Dwarf_Off len;   /* Zero if cleared, otherwise likely 4K. */
+  uint64_t last_used; /* Value of the cache clock when last read.  */
+  bool valid; /* False if cleared or not read.  */
   unsigned char buf[__LIBDWFL_REMOTE_MEM_CACHE_SIZE]; /* The actual cache.  */
 };
+/* Structure for caching remote memory reads as used by __libdwfl_pid_arg.
+   The least recently used block is replaced when a new one is read.  */
+struct __libdwfl_remote_mem_cache
+{
+  uint64_t clock;
+  struct __libdwfl_remote_mem_page *last; /* Block of the last hit.  */
+  struct __libdwfl_remote_mem_page pages[__LIBDWFL_REMOTE_MEM_CACHE_PAGES];
+};
+
+/* A thread ptrace attached for unwinding by linux-pid-attach.  Only
+   the thread that attached can make ptrace requests, and several
+   threads may be unwound at the same time by different threads, so
+   these are kept per calling thread while attached.  */
+struct __libdwfl_pid_thread
+{
+  struct __libdwfl_pid_arg *pid_arg;
+  /* Next attached thread of the calling thread (for another Dwfl),
+     or next unused one in PID_ARG->free_threads.  */
+  struct __libdwfl_pid_thread *next;
+  pid_t tid;
+  bool tid_was_stopped;
+  /* True until the first memory read after attaching.  That read is
+     near the stack pointer, so the stack above it is read too.  */
+  bool read_stack;
+  /* Memory words read and the process_vm_readv or PTRACE_PEEKDATA calls
+     needed for them, added to PID_ARG on detachment.  */
+  uint64_t mem_reads;
+  uint64_t mem_syscalls;
+  /* Remote memory cache.  Cleared on detachment (because that makes
+     the thread runnable and the cache invalid).  */
+  struct __libdwfl_remote_mem_cache mem_cache;
+  /* Copy of SNAPSHOT_LEN bytes of the stack at remote SNAPSHOT_START,
+     taken when PID_ARG->snapshot_bytes is set.  SNAPSHOT_SIZE is the
+     allocated size of SNAPSHOT, which is kept for reuse.  */
+  unsigned char *snapshot;
+  Dwarf_Addr snapshot_start;
+  size_t snapshot_len;
+  size_t snapshot_size;
+  /* True if the thread was already detached after taking the snapshot.  */
+  bool detached;
+};
 
 /* Structure used for keeping track of ptrace attaching a thread.
    Shared by linux-pid-attach and linux-proc-maps.  If it has been setup
@@ -421,18 +538,21 @@ struct __libdwfl_pid_arg
   DIR *dir;
   /* Elf for /proc/PID/exe.  Set to NULL if it couldn't be opened.  */
   Elf *elf;
-  /* Remote memory cache, NULL if there is no memory cached.
-     Should be cleared on detachment (because that makes the thread
-     runnable and the cache invalid).  */
-  struct __libdwfl_remote_mem_cache *mem_cache;
+  /* Protects the fields below.  */
+  pthread_mutex_t lock;
+  /* Thread states to reuse, with their memory caches.  */
+  struct __libdwfl_pid_thread *free_threads;
+  /* Memory words read and the process_vm_readv or PTRACE_PEEKDATA calls
+     needed for them, see dwfl_linux_proc_memory_stats.  */
+  uint64_t mem_reads;
+  uint64_t mem_syscalls;
   /* fd for /proc/PID/exe.  Set to -1 if it couldn't be opened.  */
   int elf_fd;
-  /* It is 0 if not used.  */
-  pid_t tid_attached;
-  /* Valid only if TID_ATTACHED is not zero.  */
-  bool tid_was_stopped;
   /* True if threads are ptrace stopped by caller.  */
   bool assume_ptrace_stopped;
+  /* Bytes of stack to copy before detaching a thread, zero if threads
+     stay attached while unwound.  See dwfl_linux_proc_set_snapshot.  */
+  size_t snapshot_bytes;
 };
 
 /* If DWfl is not NULL and a Dwfl_Process has been setup that has
@@ -442,6 +562,11 @@ struct __libdwfl_pid_arg
 extern struct __libdwfl_pid_arg *__libdwfl_get_pid_arg (Dwfl *dwfl)
   internal_function;
 
+/* Returns the thread of PID_ARG the calling thread has attached for
+   unwinding, or 0 if there is none.  */
+extern pid_t __libdwfl_pid_tid_attached (struct __libdwfl_pid_arg *pid_arg)
+  internal_function;
+
 /* Makes sure the given tid is attached. On success returns true and
    sets tid_was_stopped.  */
 extern bool __libdwfl_ptrace_attach (pid_t tid, bool *tid_was_stoppedp)
@@ -465,6 +590,16 @@ extern const char *__libdwfl_getsym (Dwfl_Module *mod, int ndx, GElf_Sym *sym,
 
 extern void __libdwfl_module_free (Dwfl_Module *mod) internal_function;
 
+/* The unwinding policy for frames in MOD (which may be NULL),
+   never DWFL_UNWIND_DEFAULT.  See dwfl_module_set_unwind_policy.  */
+extern int __libdwfl_unwind_policy (Dwfl *dwfl, Dwfl_Module *mod)
+  internal_function;
+
+/* Whether ADDR is in an executable segment of MOD.  Modules whose
+   main file cannot be found only check ADDR against their bounds.  */
+extern bool __libdwfl_module_text_address (Dwfl_Module *mod, Dwarf_Addr addr)
+  internal_function;
+
 /* Find the main ELF file, update MOD->elferr and/or MOD->main.elf.  */
 extern void __libdwfl_getelf (Dwfl_Module *mod) internal_function;
 
@@ -518,6 +653,12 @@ extern Dwfl_Error __libdwfl_nextcu (Dwfl_Module *mod, struct dwfl_cu *lastcu,
 extern Dwfl_Error __libdwfl_addrcu (Dwfl_Module *mod, Dwarf_Addr addr,
 				    struct dwfl_cu **cu) internal_function;
 
+/* Find the CU by address, for addresses looked up in increasing order.
+   *HINT should start out as zero and is updated for the next lookup.  */
+extern Dwfl_Error __libdwfl_addrcu_next (Dwfl_Module *mod, Dwarf_Addr addr,
+					 size_t *hint, struct dwfl_cu **cu)
+  internal_function;
+
 /* Ensure that CU->lines (and CU->cu->lines) is set up.  */
 extern Dwfl_Error __libdwfl_cu_getsrclines (struct dwfl_cu *cu)
   internal_function;
@@ -549,6 +690,12 @@ extern int __libdwfl_open_by_build_id (Dwfl_Module *mod, bool debug,
 				       char **file_name, const size_t id_len,
 				       const uint8_t *id) internal_function;
 
+/* True if the build ID index of DWFL knows that DIR/.build-id/XX/NAME
+   does not exist, XX being the hex digits of ID0.  */
+extern bool __libdwfl_build_id_index_absent (Dwfl *dwfl, const char *dir,
+					     uint8_t id0, const char *name)
+  internal_function;
+
 extern uint32_t __libdwfl_crc32 (uint32_t crc, unsigned char *buf, size_t len)
   attribute_hidden;
 extern int __libdwfl_crc32_file (int fd, uint32_t *resp) attribute_hidden;
@@ -599,6 +746,10 @@ extern GElf_Addr __libdwfl_segment_start (Dwfl *dwfl, GElf_Addr start)
 extern GElf_Addr __libdwfl_segment_end (Dwfl *dwfl, GElf_Addr end)
   internal_function;
 
+/* Sort the segments dwfl_report_segment appended out of order into the
+   lookup table.  Returns true if out of memory.  */
+extern bool __libdwfl_segment_sort (Dwfl *dwfl) internal_function;
+
 /* Decompression wrappers: decompress whole file into memory.  */
 extern Dwfl_Error __libdw_gunzip  (int fd, off_t start_offset,
 				   void *mapped, size_t mapped_size,
@@ -720,6 +871,7 @@ INTDECL (dwfl_addrdie)
 INTDECL (dwfl_core_file_attach)
 INTDECL (dwfl_core_file_report)
 INTDECL (dwfl_getmodules)
+INTDECL (dwfl_lineinfo)
 INTDECL (dwfl_module_addrdie)
 INTDECL (dwfl_module_address_section)
 INTDECL (dwfl_module_addrinfo)
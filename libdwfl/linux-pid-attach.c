@@ -117,73 +117,288 @@ __libdwfl_ptrace_attach (pid_t tid, bool *tid_was_stoppedp)
 }
 
 #ifdef HAVE_PROCESS_VM_READV
+static struct __libdwfl_remote_mem_page *
+find_cached_page (struct __libdwfl_remote_mem_cache *mem_cache,
+		  Dwarf_Addr addr)
+{
+  struct __libdwfl_remote_mem_page *page = mem_cache->last;
+  if (page != NULL && page->valid && page->addr == addr)
+    return page;
+  for (size_t i = 0; i < __LIBDWFL_REMOTE_MEM_CACHE_PAGES; i++)
+    {
+      page = &mem_cache->pages[i];
+      if (page->valid && page->addr == addr)
+	return page;
+    }
+  return NULL;
+}
+
+/* Return the block to replace, an invalid one if there is one,
+   otherwise the least recently used one.  Blocks used after BEFORE are
+   not replaced.  */
+static struct __libdwfl_remote_mem_page *
+replace_cached_page (struct __libdwfl_remote_mem_cache *mem_cache,
+		     uint64_t before)
+{
+  struct __libdwfl_remote_mem_page *victim = NULL;
+  for (size_t i = 0; i < __LIBDWFL_REMOTE_MEM_CACHE_PAGES; i++)
+    {
+      struct __libdwfl_remote_mem_page *page = &mem_cache->pages[i];
+      if (page->last_used > before)
+	continue;
+      if (! page->valid)
+	return page;
+      if (victim == NULL || page->last_used < victim->last_used)
+	victim = page;
+    }
+  return victim;
+}
+
+/* Read the block at ADDR and up to NPAGES - 1 following blocks which
+   are not cached yet with one process_vm_readv.  Blocks after one that
+   cannot be read are left out, process_vm_readv only transfers whole
+   iovec elements.  Returns the block at ADDR or NULL.  */
+static struct __libdwfl_remote_mem_page *
+read_cached_pages (struct __libdwfl_pid_thread *pid_thread,
+		   Dwarf_Addr addr, size_t npages)
+{
+  struct __libdwfl_remote_mem_cache *mem_cache = &pid_thread->mem_cache;
+  struct __libdwfl_remote_mem_page *pages[__LIBDWFL_REMOTE_MEM_STACK_PAGES];
+  struct iovec local[__LIBDWFL_REMOTE_MEM_STACK_PAGES];
+  struct iovec remote[__LIBDWFL_REMOTE_MEM_STACK_PAGES];
+  assert (npages <= __LIBDWFL_REMOTE_MEM_STACK_PAGES);
+  uint64_t before = mem_cache->clock;
+  size_t n;
+  for (n = 0; n < npages; n++)
+    {
+      Dwarf_Addr page_addr = addr + n * __LIBDWFL_REMOTE_MEM_CACHE_SIZE;
+      if (n > 0 && (page_addr < addr
+		    || find_cached_page (mem_cache, page_addr) != NULL))
+	break;
+
+      /* Mark the block used now, so it is not picked again below.  */
+      struct __libdwfl_remote_mem_page *page
+	= replace_cached_page (mem_cache, before);
+      page->addr = page_addr;
+      page->valid = false;
+      page->last_used = ++mem_cache->clock;
+      pages[n] = page;
+      local[n].iov_base = page->buf;
+      local[n].iov_len = __LIBDWFL_REMOTE_MEM_CACHE_SIZE;
+      remote[n].iov_base = (void *) (uintptr_t) page_addr;
+      remote[n].iov_len = __LIBDWFL_REMOTE_MEM_CACHE_SIZE;
+    }
+
+  pid_thread->mem_syscalls++;
+  ssize_t res = process_vm_readv (pid_thread->tid,
+				  local, n, remote, n, 0);
+  if (res <= 0)
+    return NULL;
+
+  size_t nread = res / __LIBDWFL_REMOTE_MEM_CACHE_SIZE;
+  for (size_t i = 0; i < nread && i < n; i++)
+    pages[i]->valid = true;
+  return nread > 0 ? pages[0] : NULL;
+}
+
+/* Copy LEN bytes at ADDR, which don't cross a block boundary, from
+   the cache.  */
+static bool
+read_cached_bytes (struct __libdwfl_pid_thread *pid_thread,
+		   Dwarf_Addr addr, unsigned char *buf, size_t len)
+{
+  struct __libdwfl_remote_mem_cache *mem_cache = &pid_thread->mem_cache;
+  Dwarf_Addr page_addr
+    = addr & ~((Dwarf_Addr) __LIBDWFL_REMOTE_MEM_CACHE_SIZE - 1);
+  struct __libdwfl_remote_mem_page *page = find_cached_page (mem_cache,
+							     page_addr);
+  if (page == NULL)
+    {
+      size_t npages = 1;
+      if (pid_thread->read_stack)
+	npages = __LIBDWFL_REMOTE_MEM_STACK_PAGES;
+      pid_thread->read_stack = false;
+      page = read_cached_pages (pid_thread, page_addr, npages);
+      if (page == NULL)
+	return false;
+    }
+
+  page->last_used = ++mem_cache->clock;
+  mem_cache->last = page;
+  memcpy (buf, &page->buf[addr - page_addr], len);
+  return true;
+}
+
 /* Note that the result word size depends on the architecture word size.
    That is sizeof long. */
 static bool
-read_cached_memory (struct __libdwfl_pid_arg *pid_arg,
+read_cached_memory (struct __libdwfl_pid_thread *pid_thread,
 		    Dwarf_Addr addr, Dwarf_Word *result)
 {
-  /* Let the ptrace fallback deal with the corner case of the address
-     possibly crossing a page boundery.  */
-  if ((addr & ((Dwarf_Addr)__LIBDWFL_REMOTE_MEM_CACHE_SIZE - 1))
-      > (Dwarf_Addr)__LIBDWFL_REMOTE_MEM_CACHE_SIZE - sizeof (unsigned long))
-    return false;
-
-  struct __libdwfl_remote_mem_cache *mem_cache = pid_arg->mem_cache;
-  if (mem_cache == NULL)
+  /* A word crossing a block boundary is put together from both.  */
+  unsigned long word;
+  unsigned char *buf = (unsigned char *) &word;
+  size_t len = sizeof word;
+  size_t offset = addr & (__LIBDWFL_REMOTE_MEM_CACHE_SIZE - 1);
+  if (offset > __LIBDWFL_REMOTE_MEM_CACHE_SIZE - sizeof word)
     {
-      size_t mem_cache_size = sizeof (struct __libdwfl_remote_mem_cache);
-      mem_cache = (struct __libdwfl_remote_mem_cache *) malloc (mem_cache_size);
-      if (mem_cache == NULL)
+      size_t first = __LIBDWFL_REMOTE_MEM_CACHE_SIZE - offset;
+      if (! read_cached_bytes (pid_thread, addr, buf, first))
 	return false;
+      addr += first;
+      buf += first;
+      len -= first;
+    }
+  if (! read_cached_bytes (pid_thread, addr, buf, len))
+    return false;
+
+  *result = word;
+  return true;
+}
 
-      mem_cache->addr = 0;
-      mem_cache->len = 0;
-      pid_arg->mem_cache = mem_cache;
+/* Number of blocks read with one process_vm_readv for a snapshot.  */
+#define SNAPSHOT_IOVECS 64
+
+/* The DWARF register number of the stack pointer, or -1 if unknown.  */
+static int
+stack_pointer_regno (Ebl *ebl)
+{
+  int sp, pc, callno, args[6];
+  if (ebl_syscall_abi (ebl, &sp, &pc, &callno, args) == 0 && sp >= 0)
+    return sp;
+
+  switch (ebl_get_elfmachine (ebl))
+    {
+    case EM_AARCH64:
+      return 31;
+    case EM_ARM:
+      return 13;
+    case EM_S390:
+    case EM_68K:
+      return 15;
+    case EM_SPARC:
+    case EM_SPARCV9:
+      return 14;
+    case EM_RISCV:
+      return 2;
+    default:
+      return -1;
     }
+}
 
-  unsigned char *d;
-  if (addr >= mem_cache->addr && addr - mem_cache->addr < mem_cache->len)
+/* Copy the stack of PID_THREAD from the stack pointer of the initial
+   frame of THREAD on, then detach it.  Leaves the thread attached if
+   nothing could be copied.  */
+static void
+take_snapshot (Dwfl_Thread *thread, struct __libdwfl_pid_thread *pid_thread)
+{
+  struct __libdwfl_pid_arg *pid_arg = pid_thread->pid_arg;
+  int regno = stack_pointer_regno (thread->process->ebl);
+  Dwarf_Addr sp;
+  if (regno < 0 || ! __libdwfl_frame_reg_get (thread->unwound, regno, &sp))
+    return;
+
+  /* Start at the block holding the stack pointer, which also covers
+     a red zone below it.  */
+  Dwarf_Addr start = sp & ~((Dwarf_Addr) __LIBDWFL_REMOTE_MEM_CACHE_SIZE - 1);
+  size_t len = sp - start + pid_arg->snapshot_bytes;
+  len = ((len + __LIBDWFL_REMOTE_MEM_CACHE_SIZE - 1)
+	 & ~((size_t) __LIBDWFL_REMOTE_MEM_CACHE_SIZE - 1));
+  if (pid_thread->snapshot_size < len)
     {
-      d = &mem_cache->buf[addr - mem_cache->addr];
-      if ((((uintptr_t) d) & (sizeof (unsigned long) - 1)) == 0)
-	*result = *(unsigned long *) d;
-      else
-	memcpy (result, d, sizeof (unsigned long));
-      return true;
+      unsigned char *snapshot = realloc (pid_thread->snapshot, len);
+      if (snapshot == NULL)
+	return;
+      pid_thread->snapshot = snapshot;
+      pid_thread->snapshot_size = len;
     }
 
-  struct iovec local, remote;
-  mem_cache->addr = addr & ~((Dwarf_Addr)__LIBDWFL_REMOTE_MEM_CACHE_SIZE - 1);
-  local.iov_base = mem_cache->buf;
-  local.iov_len = __LIBDWFL_REMOTE_MEM_CACHE_SIZE;
-  remote.iov_base = (void *) (uintptr_t) mem_cache->addr;
-  remote.iov_len = __LIBDWFL_REMOTE_MEM_CACHE_SIZE;
+  /* One iovec per block, so a read stopping at the end of the stack
+     mapping still returns the blocks before it.  */
+  size_t nread = 0;
+  while (nread < len)
+    {
+      struct iovec local[SNAPSHOT_IOVECS];
+      struct iovec remote[SNAPSHOT_IOVECS];
+      size_t n;
+      size_t offset = nread;
+      for (n = 0; n < SNAPSHOT_IOVECS && offset < len; n++)
+	{
+	  local[n].iov_base = &pid_thread->snapshot[offset];
+	  local[n].iov_len = __LIBDWFL_REMOTE_MEM_CACHE_SIZE;
+	  remote[n].iov_base = (void *) (uintptr_t) (start + offset);
+	  remote[n].iov_len = __LIBDWFL_REMOTE_MEM_CACHE_SIZE;
+	  offset += __LIBDWFL_REMOTE_MEM_CACHE_SIZE;
+	}
+      pid_thread->mem_syscalls++;
+      ssize_t res = process_vm_readv (pid_thread->tid,
+				      local, n, remote, n, 0);
+      if (res <= 0)
+	break;
+      nread += res;
+      if ((size_t) res < n * __LIBDWFL_REMOTE_MEM_CACHE_SIZE)
+	break;
+    }
+  if (nread == 0)
+    return;
 
-  ssize_t res = process_vm_readv (pid_arg->tid_attached,
-				  &local, 1, &remote, 1, 0);
-  if (res != __LIBDWFL_REMOTE_MEM_CACHE_SIZE)
+  pid_thread->snapshot_start = start;
+  pid_thread->snapshot_len = nread;
+  if (! pid_arg->assume_ptrace_stopped)
     {
-      mem_cache->len = 0;
-      return false;
+      __libdwfl_ptrace_detach (pid_thread->tid, pid_thread->tid_was_stopped);
+      pid_thread->detached = true;
     }
+}
 
-  mem_cache->len = res;
-  d = &mem_cache->buf[addr - mem_cache->addr];
-  if ((((uintptr_t) d) & (sizeof (unsigned long) - 1)) == 0)
-    *result = *(unsigned long *) d;
-  else
-    memcpy (result, d, sizeof (unsigned long));
+/* Note that the result word size depends on the architecture word size.
+   That is sizeof long. */
+static bool
+read_snapshot (struct __libdwfl_pid_thread *pid_thread,
+	       Dwarf_Addr addr, Dwarf_Word *result)
+{
+  unsigned long word;
+  if (addr < pid_thread->snapshot_start
+      || addr - pid_thread->snapshot_start > pid_thread->snapshot_len
+      || (pid_thread->snapshot_len - (addr - pid_thread->snapshot_start)
+	  < sizeof word))
+    return false;
+
+  memcpy (&word, &pid_thread->snapshot[addr - pid_thread->snapshot_start],
+	  sizeof word);
+  *result = word;
   return true;
 }
 #endif /* HAVE_PROCESS_VM_READV */
 
 static void
-clear_cached_memory (struct __libdwfl_pid_arg *pid_arg)
+clear_cached_memory (struct __libdwfl_pid_thread *pid_thread)
+{
+  struct __libdwfl_remote_mem_cache *mem_cache = &pid_thread->mem_cache;
+  for (size_t i = 0; i < __LIBDWFL_REMOTE_MEM_CACHE_PAGES; i++)
+    mem_cache->pages[i].valid = false;
+  mem_cache->last = NULL;
+}
+
+/* The threads attached by the calling thread, one per Dwfl at most.  */
+static __thread struct __libdwfl_pid_thread *attached_threads;
+
+static struct __libdwfl_pid_thread *
+find_attached_thread (struct __libdwfl_pid_arg *pid_arg)
+{
+  for (struct __libdwfl_pid_thread *pid_thread = attached_threads;
+       pid_thread != NULL; pid_thread = pid_thread->next)
+    if (pid_thread->pid_arg == pid_arg)
+      return pid_thread;
+  return NULL;
+}
+
+pid_t
+internal_function
+__libdwfl_pid_tid_attached (struct __libdwfl_pid_arg *pid_arg)
 {
-  struct __libdwfl_remote_mem_cache *mem_cache = pid_arg->mem_cache;
-  if (mem_cache != NULL)
-    mem_cache->len = 0;
+  struct __libdwfl_pid_thread *pid_thread = find_attached_thread (pid_arg);
+  return pid_thread != NULL ? pid_thread->tid : 0;
 }
 
 /* Note that the result word size depends on the architecture word size.
@@ -192,19 +407,28 @@ static bool
 pid_memory_read (Dwfl *dwfl, Dwarf_Addr addr, Dwarf_Word *result, void *arg)
 {
   struct __libdwfl_pid_arg *pid_arg = arg;
-  pid_t tid = pid_arg->tid_attached;
-  assert (tid > 0);
+  struct __libdwfl_pid_thread *pid_thread = find_attached_thread (pid_arg);
+  assert (pid_thread != NULL);
+  pid_t tid = pid_thread->tid;
+  pid_thread->mem_reads++;
 
 #ifdef HAVE_PROCESS_VM_READV
-  if (read_cached_memory (pid_arg, addr, result))
+  if (read_snapshot (pid_thread, addr, result))
+    return true;
+  if (read_cached_memory (pid_thread, addr, result))
     return true;
 #endif
 
+  /* PTRACE_PEEKDATA needs the thread stopped.  */
+  if (pid_thread->detached)
+    return false;
+
   Dwfl_Process *process = dwfl->process;
   if (ebl_get_elfclass (process->ebl) == ELFCLASS64)
     {
 #if SIZEOF_LONG == 8
       errno = 0;
+      pid_thread->mem_syscalls++;
       *result = ptrace (PTRACE_PEEKDATA, tid, (void *) (uintptr_t) addr, NULL);
       return errno == 0;
 #else /* SIZEOF_LONG != 8 */
@@ -220,6 +444,7 @@ pid_memory_read (Dwfl *dwfl, Dwarf_Addr addr, Dwarf_Word *result, void *arg)
     addr -= 4;
 #endif /* SIZEOF_LONG == 8 */
   errno = 0;
+  pid_thread->mem_syscalls++;
   *result = ptrace (PTRACE_PEEKDATA, tid, (void *) (uintptr_t) addr, NULL);
   if (errno != 0)
     return false;
@@ -311,20 +536,65 @@ pid_thread_state_registers_cb (int firstreg, unsigned nregs,
   return INTUSE(dwfl_thread_state_registers) (thread, firstreg, nregs, regs);
 }
 
+static void pid_thread_detach (Dwfl_Thread *thread, void *thread_arg);
+
 static bool
 pid_set_initial_registers (Dwfl_Thread *thread, void *thread_arg)
 {
   struct __libdwfl_pid_arg *pid_arg = thread_arg;
-  assert (pid_arg->tid_attached == 0);
+  assert (find_attached_thread (pid_arg) == NULL);
   pid_t tid = INTUSE(dwfl_thread_tid) (thread);
+
+  pthread_mutex_lock (&pid_arg->lock);
+  struct __libdwfl_pid_thread *pid_thread = pid_arg->free_threads;
+  if (pid_thread != NULL)
+    pid_arg->free_threads = pid_thread->next;
+  pthread_mutex_unlock (&pid_arg->lock);
+  if (pid_thread == NULL)
+    {
+      pid_thread = calloc (1, sizeof *pid_thread);
+      if (pid_thread == NULL)
+	{
+	  __libdwfl_seterrno (DWFL_E_NOMEM);
+	  return false;
+	}
+      pid_thread->pid_arg = pid_arg;
+    }
+
+  pid_thread->tid_was_stopped = false;
   if (! pid_arg->assume_ptrace_stopped
-      && ! __libdwfl_ptrace_attach (tid, &pid_arg->tid_was_stopped))
-    return false;
-  pid_arg->tid_attached = tid;
+      && ! __libdwfl_ptrace_attach (tid, &pid_thread->tid_was_stopped))
+    {
+      pthread_mutex_lock (&pid_arg->lock);
+      pid_thread->next = pid_arg->free_threads;
+      pid_arg->free_threads = pid_thread;
+      pthread_mutex_unlock (&pid_arg->lock);
+      return false;
+    }
+  pid_thread->tid = tid;
+  /* With a snapshot the stack is read in one go already.  */
+  pid_thread->read_stack = pid_arg->snapshot_bytes == 0;
+  pid_thread->snapshot_len = 0;
+  pid_thread->detached = false;
+  pid_thread->mem_reads = 0;
+  pid_thread->mem_syscalls = 0;
+  pid_thread->next = attached_threads;
+  attached_threads = pid_thread;
+
   Dwfl_Process *process = thread->process;
   Ebl *ebl = process->ebl;
-  return ebl_set_initial_registers_tid (ebl, tid,
-					pid_thread_state_registers_cb, thread);
+  if (! ebl_set_initial_registers_tid (ebl, tid,
+				       pid_thread_state_registers_cb, thread))
+    {
+      /* dwfl_thread_getframes won't call pid_thread_detach then.  */
+      pid_thread_detach (thread, thread_arg);
+      return false;
+    }
+#ifdef HAVE_PROCESS_VM_READV
+  if (pid_arg->snapshot_bytes > 0)
+    take_snapshot (thread, pid_thread);
+#endif
+  return true;
 }
 
 static void
@@ -332,7 +602,14 @@ pid_detach (Dwfl *dwfl __attribute__ ((unused)), void *dwfl_arg)
 {
   struct __libdwfl_pid_arg *pid_arg = dwfl_arg;
   elf_end (pid_arg->elf);
-  free (pid_arg->mem_cache);
+  while (pid_arg->free_threads != NULL)
+    {
+      struct __libdwfl_pid_thread *next = pid_arg->free_threads->next;
+      free (pid_arg->free_threads->snapshot);
+      free (pid_arg->free_threads);
+      pid_arg->free_threads = next;
+    }
+  pthread_mutex_destroy (&pid_arg->lock);
   close (pid_arg->elf_fd);
   closedir (pid_arg->dir);
   free (pid_arg);
@@ -356,11 +633,24 @@ pid_thread_detach (Dwfl_Thread *thread, void *thread_arg)
 {
   struct __libdwfl_pid_arg *pid_arg = thread_arg;
   pid_t tid = INTUSE(dwfl_thread_tid) (thread);
-  assert (pid_arg->tid_attached == tid);
-  pid_arg->tid_attached = 0;
-  clear_cached_memory (pid_arg);
-  if (! pid_arg->assume_ptrace_stopped)
-    __libdwfl_ptrace_detach (tid, pid_arg->tid_was_stopped);
+  struct __libdwfl_pid_thread **prevp = &attached_threads;
+  while (*prevp != NULL && (*prevp)->pid_arg != pid_arg)
+    prevp = &(*prevp)->next;
+  struct __libdwfl_pid_thread *pid_thread = *prevp;
+  assert (pid_thread != NULL && pid_thread->tid == tid);
+  *prevp = pid_thread->next;
+
+  clear_cached_memory (pid_thread);
+  pid_thread->snapshot_len = 0;
+  if (! pid_arg->assume_ptrace_stopped && ! pid_thread->detached)
+    __libdwfl_ptrace_detach (tid, pid_thread->tid_was_stopped);
+
+  pthread_mutex_lock (&pid_arg->lock);
+  pid_arg->mem_reads += pid_thread->mem_reads;
+  pid_arg->mem_syscalls += pid_thread->mem_syscalls;
+  pid_thread->next = pid_arg->free_threads;
+  pid_arg->free_threads = pid_thread;
+  pthread_mutex_unlock (&pid_arg->lock);
 }
 
 static const Dwfl_Thread_Callbacks pid_thread_callbacks =
@@ -460,15 +750,19 @@ dwfl_linux_proc_attach (Dwfl *dwfl, pid_t pid, bool assume_ptrace_stopped)
   pid_arg->dir = dir;
   pid_arg->elf = elf;
   pid_arg->elf_fd = elf_fd;
-  pid_arg->mem_cache = NULL;
-  pid_arg->tid_attached = 0;
+  pthread_mutex_init (&pid_arg->lock, NULL);
+  pid_arg->free_threads = NULL;
+  pid_arg->mem_reads = 0;
+  pid_arg->mem_syscalls = 0;
   pid_arg->assume_ptrace_stopped = assume_ptrace_stopped;
+  pid_arg->snapshot_bytes = 0;
   if (! INTUSE(dwfl_attach_state) (dwfl, elf, pid, &pid_thread_callbacks,
 				   pid_arg))
     {
       elf_end (elf);
       close (elf_fd);
       closedir (dir);
+      pthread_mutex_destroy (&pid_arg->lock);
       free (pid_arg);
       return -1;
     }
@@ -476,6 +770,39 @@ dwfl_linux_proc_attach (Dwfl *dwfl, pid_t pid, bool assume_ptrace_stopped)
 }
 INTDEF (dwfl_linux_proc_attach)
 
+int
+dwfl_linux_proc_memory_stats (Dwfl *dwfl, uint64_t *reads, uint64_t *syscalls)
+{
+  struct __libdwfl_pid_arg *pid_arg = __libdwfl_get_pid_arg (dwfl);
+  if (pid_arg == NULL)
+    {
+      __libdwfl_seterrno (DWFL_E_NO_ATTACH_STATE);
+      return -1;
+    }
+
+  pthread_mutex_lock (&pid_arg->lock);
+  if (reads != NULL)
+    *reads = pid_arg->mem_reads;
+  if (syscalls != NULL)
+    *syscalls = pid_arg->mem_syscalls;
+  pthread_mutex_unlock (&pid_arg->lock);
+  return 0;
+}
+
+int
+dwfl_linux_proc_set_snapshot (Dwfl *dwfl, size_t stack_bytes)
+{
+  struct __libdwfl_pid_arg *pid_arg = __libdwfl_get_pid_arg (dwfl);
+  if (pid_arg == NULL)
+    {
+      __libdwfl_seterrno (DWFL_E_NO_ATTACH_STATE);
+      return -1;
+    }
+
+  pid_arg->snapshot_bytes = stack_bytes;
+  return 0;
+}
+
 struct __libdwfl_pid_arg *
 internal_function
 __libdwfl_get_pid_arg (Dwfl *dwfl)
@@ -515,6 +842,23 @@ dwfl_linux_proc_attach (Dwfl *dwfl __attribute__ ((unused)),
 }
 INTDEF (dwfl_linux_proc_attach)
 
+int
+dwfl_linux_proc_memory_stats (Dwfl *dwfl __attribute__ ((unused)),
+			      uint64_t *reads __attribute__ ((unused)),
+			      uint64_t *syscalls __attribute__ ((unused)))
+{
+  __libdwfl_seterrno (DWFL_E_NO_ATTACH_STATE);
+  return -1;
+}
+
+int
+dwfl_linux_proc_set_snapshot (Dwfl *dwfl __attribute__ ((unused)),
+			      size_t stack_bytes __attribute__ ((unused)))
+{
+  __libdwfl_seterrno (DWFL_E_NO_ATTACH_STATE);
+  return -1;
+}
+
 struct __libdwfl_pid_arg *
 internal_function
 __libdwfl_get_pid_arg (Dwfl *dwfl __attribute__ ((unused)))
@@ -522,5 +866,13 @@ __libdwfl_get_pid_arg (Dwfl *dwfl __attribute__ ((unused)))
   return NULL;
 }
 
+pid_t
+internal_function
+__libdwfl_pid_tid_attached (struct __libdwfl_pid_arg *pid_arg
+			    __attribute__ ((unused)))
+{
+  return 0;
+}
+
 #endif /* ! __linux __ */
 
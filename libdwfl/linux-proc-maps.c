@@ -179,11 +179,51 @@ grovel_auxv (pid_t pid, Dwfl *dwfl, GElf_Addr *sysinfo_ehdr)
   return ENOEXEC;
 }
 
+/* File mappings collected by proc_maps_report instead of reporting
+   them, for dwfl_linux_proc_report_update.  */
+struct proc_mapping
+{
+  char *name;
+  Dwarf_Addr low, high;
+};
+
+struct proc_mappings
+{
+  struct proc_mapping *mappings;
+  size_t n, alloc;
+};
+
 static inline bool
-do_report (Dwfl *dwfl, char **plast_file, Dwarf_Addr low, Dwarf_Addr high)
+do_report (Dwfl *dwfl, struct proc_mappings *maps, char **plast_file,
+	   Dwarf_Addr low, Dwarf_Addr high)
 {
   if (*plast_file != NULL)
     {
+      if (maps != NULL)
+	{
+	  if (maps->n == maps->alloc)
+	    {
+	      size_t n = maps->alloc == 0 ? 64 : maps->alloc * 2;
+	      struct proc_mapping *mappings
+		= realloc (maps->mappings, n * sizeof mappings[0]);
+	      if (unlikely (mappings == NULL))
+		{
+		  free (*plast_file);
+		  *plast_file = NULL;
+		  __libdwfl_seterrno (DWFL_E_NOMEM);
+		  return true;
+		}
+	      maps->mappings = mappings;
+	      maps->alloc = n;
+	    }
+	  maps->mappings[maps->n].name = *plast_file;
+	  maps->mappings[maps->n].low = low;
+	  maps->mappings[maps->n].high = high;
+	  maps->n++;
+	  *plast_file = NULL;
+	  return false;
+	}
+
       Dwfl_Module *mod = INTUSE(dwfl_report_module) (dwfl, *plast_file,
 						     low, high);
       free (*plast_file);
@@ -194,10 +234,12 @@ do_report (Dwfl *dwfl, char **plast_file, Dwarf_Addr low, Dwarf_Addr high)
   return false;
 }
 
-#define report() do_report(dwfl, &last_file, low, high)
+#define report() do_report(dwfl, maps, &last_file, low, high)
 
+/* Report the file mappings in F, or add them to MAPS if not null.  */
 static int
-proc_maps_report (Dwfl *dwfl, FILE *f, GElf_Addr sysinfo_ehdr, pid_t pid)
+proc_maps_report (Dwfl *dwfl, FILE *f, GElf_Addr sysinfo_ehdr, pid_t pid,
+		  struct proc_mappings *maps)
 {
   unsigned int last_dmajor = -1, last_dminor = -1;
   uint64_t last_ino = -1;
@@ -286,16 +328,13 @@ proc_maps_report (Dwfl *dwfl, FILE *f, GElf_Addr sysinfo_ehdr, pid_t pid)
 int
 dwfl_linux_proc_maps_report (Dwfl *dwfl, FILE *f)
 {
-  return proc_maps_report (dwfl, f, 0, 0);
+  return proc_maps_report (dwfl, f, 0, 0, NULL);
 }
 INTDEF (dwfl_linux_proc_maps_report)
 
-int
-dwfl_linux_proc_report (Dwfl *dwfl, pid_t pid)
+static int
+proc_report (Dwfl *dwfl, pid_t pid, struct proc_mappings *maps)
 {
-  if (dwfl == NULL)
-    return -1;
-
   /* We'll notice the AT_SYSINFO_EHDR address specially when we hit it.  */
   GElf_Addr sysinfo_ehdr = 0;
   int result = grovel_auxv (pid, dwfl, &sysinfo_ehdr);
@@ -313,14 +352,89 @@ dwfl_linux_proc_report (Dwfl *dwfl, pid_t pid)
 
   (void) __fsetlocking (f, FSETLOCKING_BYCALLER);
 
-  result = proc_maps_report (dwfl, f, sysinfo_ehdr, pid);
+  result = proc_maps_report (dwfl, f, sysinfo_ehdr, pid, maps);
 
   fclose (f);
 
   return result;
 }
+
+int
+dwfl_linux_proc_report (Dwfl *dwfl, pid_t pid)
+{
+  if (dwfl == NULL)
+    return -1;
+
+  return proc_report (dwfl, pid, NULL);
+}
 INTDEF (dwfl_linux_proc_report)
 
+/* Make the modules of DWFL match MAPS, which are sorted by address.  */
+static int
+update_modules (Dwfl *dwfl, struct proc_mappings *maps)
+{
+  /* The modules are listed in the order they were reported in.  If
+     that is still MAPS, nothing changed and even the segment table
+     stays.  */
+  Dwfl_Module *mod = dwfl->modulelist;
+  size_t i = 0;
+  while (i < maps->n && mod != NULL
+	 && mod->low_addr == maps->mappings[i].low
+	 && mod->high_addr == maps->mappings[i].high
+	 && strcmp (mod->name, maps->mappings[i].name) == 0)
+    {
+      mod = mod->next;
+      ++i;
+    }
+  if (i == maps->n && mod == NULL)
+    return 0;
+
+  /* Report all mappings again.  dwfl_report_module keeps the modules
+     still mapped at the same addresses, with everything loaded for
+     them, and puts them in the order of MAPS.  dwfl_report_end drops
+     the others and the segment table entries pointing to them.  */
+  INTUSE(dwfl_report_begin_add) (dwfl);
+  for (mod = dwfl->modulelist; mod != NULL; mod = mod->next)
+    mod->gc = true;
+
+  int result = 0;
+  for (i = 0; i < maps->n; ++i)
+    {
+      const struct proc_mapping *map = &maps->mappings[i];
+      if (unlikely (INTUSE(dwfl_report_module) (dwfl, map->name,
+						map->low, map->high) == NULL))
+	{
+	  /* Keep the modules not reported yet too rather than losing
+	     them.  The list stays in address order.  */
+	  for (mod = dwfl->modulelist; mod != NULL; mod = mod->next)
+	    mod->gc = false;
+	  result = -1;
+	  break;
+	}
+    }
+
+  if (INTUSE(dwfl_report_end) (dwfl, NULL, NULL) != 0)
+    result = -1;
+  return result;
+}
+
+int
+dwfl_linux_proc_report_update (Dwfl *dwfl, pid_t pid)
+{
+  if (dwfl == NULL)
+    return -1;
+
+  struct proc_mappings maps = { .mappings = NULL, .n = 0, .alloc = 0 };
+  int result = proc_report (dwfl, pid, &maps);
+  if (result == 0)
+    result = update_modules (dwfl, &maps);
+
+  for (size_t i = 0; i < maps.n; ++i)
+    free (maps.mappings[i].name);
+  free (maps.mappings);
+  return result;
+}
+
 static ssize_t
 read_proc_memory (void *arg, void *data, GElf_Addr address,
 		  size_t minread, size_t maxread)
@@ -406,7 +520,7 @@ dwfl_linux_proc_find_elf (Dwfl_Module *mod __attribute__ ((unused)),
 	  /* If any thread is already attached we are fine.  Read
 	     through that thread.  It doesn't have to be the main
 	     thread pid.  */
-	  pid_t tid = pid_arg->tid_attached;
+	  pid_t tid = __libdwfl_pid_tid_attached (pid_arg);
 	  if (tid != 0)
 	    pid = tid;
 	  else
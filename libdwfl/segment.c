@@ -50,58 +50,56 @@ __libdwfl_segment_end (Dwfl *dwfl, GElf_Addr end)
   return end;
 }
 
+/* Make room for NEED more elements in the table.  Returns true if out
+   of memory.  */
 static bool
-insert (Dwfl *dwfl, size_t i, GElf_Addr start, GElf_Addr end, int segndx)
+grow (Dwfl *dwfl, size_t need)
 {
-  bool need_start = (i == 0 || dwfl->lookup_addr[i - 1] != start);
-  bool need_end = (i + 1 >= dwfl->lookup_elts
-		   || dwfl->lookup_addr[i + 1] != end);
-  size_t need = need_start + need_end;
-  if (need == 0)
+  if (dwfl->lookup_alloc - dwfl->lookup_elts >= need)
     return false;
 
-  if (dwfl->lookup_alloc - dwfl->lookup_elts < need)
+  size_t n = dwfl->lookup_alloc == 0 ? 16 : dwfl->lookup_alloc * 2;
+  while (n - dwfl->lookup_elts < need)
+    n *= 2;
+  GElf_Addr *naddr = realloc (dwfl->lookup_addr, sizeof naddr[0] * n);
+  if (unlikely (naddr == NULL))
+    return true;
+  int *nsegndx = realloc (dwfl->lookup_segndx, sizeof nsegndx[0] * n);
+  if (unlikely (nsegndx == NULL))
     {
-      size_t n = dwfl->lookup_alloc == 0 ? 16 : dwfl->lookup_alloc * 2;
-      GElf_Addr *naddr = realloc (dwfl->lookup_addr, sizeof naddr[0] * n);
-      if (unlikely (naddr == NULL))
-	return true;
-      int *nsegndx = realloc (dwfl->lookup_segndx, sizeof nsegndx[0] * n);
-      if (unlikely (nsegndx == NULL))
-	{
-	  if (naddr != dwfl->lookup_addr)
-	    free (naddr);
-	  return true;
-	}
-      dwfl->lookup_alloc = n;
-      dwfl->lookup_addr = naddr;
-      dwfl->lookup_segndx = nsegndx;
+      if (naddr != dwfl->lookup_addr)
+	free (naddr);
+      return true;
+    }
+  dwfl->lookup_alloc = n;
+  dwfl->lookup_addr = naddr;
+  dwfl->lookup_segndx = nsegndx;
 
-      if (dwfl->lookup_module != NULL)
+  if (dwfl->lookup_module != NULL)
+    {
+      /* Make sure this array is big enough too.  */
+      Dwfl_Module **old = dwfl->lookup_module;
+      dwfl->lookup_module = realloc (dwfl->lookup_module,
+				     sizeof dwfl->lookup_module[0] * n);
+      if (unlikely (dwfl->lookup_module == NULL))
 	{
-	  /* Make sure this array is big enough too.  */
-	  Dwfl_Module **old = dwfl->lookup_module;
-	  dwfl->lookup_module = realloc (dwfl->lookup_module,
-					 sizeof dwfl->lookup_module[0] * n);
-	  if (unlikely (dwfl->lookup_module == NULL))
-	    {
-	      free (old);
-	      return true;
-	    }
+	  free (old);
+	  return true;
 	}
     }
 
-  if (unlikely (i < dwfl->lookup_elts))
-    {
-      const size_t move = dwfl->lookup_elts - i;
-      memmove (&dwfl->lookup_addr[i + need], &dwfl->lookup_addr[i],
-	       move * sizeof dwfl->lookup_addr[0]);
-      memmove (&dwfl->lookup_segndx[i + need], &dwfl->lookup_segndx[i],
-	       move * sizeof dwfl->lookup_segndx[0]);
-      if (dwfl->lookup_module != NULL)
-	memmove (&dwfl->lookup_module[i + need], &dwfl->lookup_module[i],
-		 move * sizeof dwfl->lookup_module[0]);
-    }
+  return false;
+}
+
+/* Add the segment [START, END) at the end of the table.  */
+static bool
+append (Dwfl *dwfl, GElf_Addr start, GElf_Addr end, int segndx)
+{
+  size_t i = dwfl->lookup_elts;
+  bool need_start = (i == 0 || dwfl->lookup_addr[i - 1] != start);
+  size_t need = need_start + 1;
+  if (unlikely (grow (dwfl, need)))
+    return true;
 
   if (need_start)
     {
@@ -114,16 +112,73 @@ insert (Dwfl *dwfl, size_t i, GElf_Addr start, GElf_Addr end, int segndx)
   else
     dwfl->lookup_segndx[i - 1] = segndx;
 
-  if (need_end)
+  dwfl->lookup_addr[i] = end;
+  dwfl->lookup_segndx[i] = -1;
+  if (dwfl->lookup_module != NULL)
+    dwfl->lookup_module[i] = NULL;
+
+  dwfl->lookup_elts += need;
+
+  return false;
+}
+
+struct segment_point
+{
+  GElf_Addr addr;
+  int segndx;
+  size_t seq;			/* Position in the table before sorting.  */
+};
+
+static int
+compare_segment_points (const void *a, const void *b)
+{
+  const struct segment_point *p1 = a;
+  const struct segment_point *p2 = b;
+  if (p1->addr != p2->addr)
+    return p1->addr < p2->addr ? -1 : 1;
+  return p1->seq < p2->seq ? -1 : p1->seq > p2->seq;
+}
+
+bool
+internal_function
+__libdwfl_segment_sort (Dwfl *dwfl)
+{
+  if (likely (! dwfl->lookup_unsorted))
+    return false;
+
+  const size_t n = dwfl->lookup_elts;
+  struct segment_point *points = malloc (n * sizeof points[0]);
+  if (unlikely (points == NULL))
+    return true;
+  for (size_t i = 0; i < n; ++i)
     {
-      dwfl->lookup_addr[i] = end;
-      dwfl->lookup_segndx[i] = -1;
-      if (dwfl->lookup_module != NULL)
-	dwfl->lookup_module[i] = NULL;
+      points[i].addr = dwfl->lookup_addr[i];
+      points[i].segndx = dwfl->lookup_segndx[i];
+      points[i].seq = i;
     }
+  qsort (points, n, sizeof points[0], compare_segment_points);
 
-  dwfl->lookup_elts += need;
+  /* Where segments meet, the start of one wins over the end of
+     another, and a later start over an earlier one.  That's what
+     appending them in order would have done.  */
+  size_t elts = 0;
+  for (size_t i = 0; i < n; )
+    {
+      GElf_Addr addr = points[i].addr;
+      int segndx = -1;
+      for (; i < n && points[i].addr == addr; ++i)
+	if (points[i].segndx >= 0)
+	  segndx = points[i].segndx;
+      dwfl->lookup_addr[elts] = addr;
+      dwfl->lookup_segndx[elts] = segndx;
+      ++elts;
+    }
+  free (points);
 
+  dwfl->lookup_elts = elts;
+  dwfl->lookup_unsorted = false;
+  free (dwfl->lookup_module);
+  dwfl->lookup_module = NULL;
   return false;
 }
 
@@ -154,90 +209,143 @@ lookup (Dwfl *dwfl, GElf_Addr address, int hint)
   return -1;
 }
 
+static int
+compare_modules (const void *a, const void *b)
+{
+  const Dwfl_Module *m1 = *(const Dwfl_Module **) a;
+  const Dwfl_Module *m2 = *(const Dwfl_Module **) b;
+  if (m1->low_addr != m2->low_addr)
+    return m1->low_addr < m2->low_addr ? -1 : 1;
+  return 0;
+}
+
+static int
+compare_addrs (const void *a, const void *b)
+{
+  GElf_Addr a1 = *(const GElf_Addr *) a;
+  GElf_Addr a2 = *(const GElf_Addr *) b;
+  return a1 < a2 ? -1 : a1 > a2;
+}
+
+/* Add the boundaries of all modules to the table and fill in
+   DWFL->lookup_module.  The new boundaries are collected first and
+   merged into the table in one pass.  */
 static bool
 reify_segments (Dwfl *dwfl)
 {
-  int hint = -1;
-  int highest = -1;
-  bool fixup = false;
+  if (unlikely (__libdwfl_segment_sort (dwfl)))
+    return true;
+
+  size_t nmodules = 0;
   for (Dwfl_Module *mod = dwfl->modulelist; mod != NULL; mod = mod->next)
     if (! mod->gc)
-      {
-	const GElf_Addr start = __libdwfl_segment_start (dwfl, mod->low_addr);
-	const GElf_Addr end = __libdwfl_segment_end (dwfl, mod->high_addr);
-	bool resized = false;
-
-	int idx = lookup (dwfl, start, hint);
-	if (unlikely (idx < 0))
-	  {
-	    /* Module starts below any segment.  Insert a low one.  */
-	    if (unlikely (insert (dwfl, 0, start, end, -1)))
-	      return true;
-	    idx = 0;
-	    resized = true;
-	  }
-	else if (dwfl->lookup_addr[idx] > start)
-	  {
-	    /* The module starts in the middle of this segment.  Split it.  */
-	    if (unlikely (insert (dwfl, idx + 1, start, end,
-				  dwfl->lookup_segndx[idx])))
-	      return true;
-	    ++idx;
-	    resized = true;
-	  }
-	else if (dwfl->lookup_addr[idx] < start)
-	  {
-	    /* The module starts past the end of this segment.
-	       Add a new one.  */
-	    if (unlikely (insert (dwfl, idx + 1, start, end, -1)))
-	      return true;
-	    ++idx;
-	    resized = true;
-	  }
-
-	if ((size_t) idx + 1 < dwfl->lookup_elts
-	    && end < dwfl->lookup_addr[idx + 1])
-	  {
-	    /* The module ends in the middle of this segment.  Split it.  */
-	    if (unlikely (insert (dwfl, idx + 1,
-				  end, dwfl->lookup_addr[idx + 1], -1)))
-	      return true;
-	    resized = true;
-	  }
-
-	if (dwfl->lookup_module == NULL)
-	  {
-	    dwfl->lookup_module = calloc (dwfl->lookup_alloc,
-					  sizeof dwfl->lookup_module[0]);
-	    if (unlikely (dwfl->lookup_module == NULL))
-	      return true;
-	  }
-
-	/* Cache a backpointer in the module.  */
-	mod->segment = idx;
-
-	/* Put MOD in the table for each segment that's inside it.  */
-	do
-	  dwfl->lookup_module[idx++] = mod;
-	while ((size_t) idx < dwfl->lookup_elts
-	       && dwfl->lookup_addr[idx] < end);
-	assert (dwfl->lookup_module[mod->segment] == mod);
-
-	if (resized && idx - 1 >= highest)
-	  /* Expanding the lookup tables invalidated backpointers
-	     we've already stored.  Reset those ones.  */
-	  fixup = true;
-
-	highest = idx - 1;
-	hint = (size_t) idx < dwfl->lookup_elts ? idx : -1;
-      }
-
-  if (fixup)
-    /* Reset backpointer indices invalidated by table insertions.  */
-    for (size_t idx = 0; idx < dwfl->lookup_elts; ++idx)
-      if (dwfl->lookup_module[idx] != NULL)
-	dwfl->lookup_module[idx]->segment = idx;
+      ++nmodules;
+  if (nmodules == 0)
+    return false;
 
+  Dwfl_Module **modules = malloc (nmodules * sizeof modules[0]);
+  GElf_Addr *add = malloc (2 * nmodules * sizeof add[0]);
+  if (unlikely (modules == NULL) || unlikely (add == NULL))
+    {
+      free (modules);
+      free (add);
+      return true;
+    }
+  size_t n = 0;
+  for (Dwfl_Module *mod = dwfl->modulelist; mod != NULL; mod = mod->next)
+    if (! mod->gc)
+      modules[n++] = mod;
+  qsort (modules, nmodules, sizeof modules[0], compare_modules);
+
+  /* A module starting inside a segment splits it.  So does its end,
+     unless the module continues past the next boundary.  */
+  size_t nadd = 0;
+  int hint = -1;
+  for (size_t m = 0; m < nmodules; ++m)
+    {
+      const GElf_Addr start = __libdwfl_segment_start (dwfl,
+						       modules[m]->low_addr);
+      const GElf_Addr end = __libdwfl_segment_end (dwfl,
+						   modules[m]->high_addr);
+      int idx = lookup (dwfl, start, hint);
+      if (idx < 0 || dwfl->lookup_addr[idx] != start)
+	add[nadd++] = start;
+      size_t next = idx + 1;
+      if (end != start && (next >= dwfl->lookup_elts
+			   || end < dwfl->lookup_addr[next]))
+	add[nadd++] = end;
+      if (idx >= 0)
+	hint = idx;
+    }
+
+  /* Modules may touch or overlap each other.  */
+  qsort (add, nadd, sizeof add[0], compare_addrs);
+  size_t nunique = 0;
+  for (size_t i = 0; i < nadd; ++i)
+    if (nunique == 0 || add[nunique - 1] != add[i])
+      add[nunique++] = add[i];
+  nadd = nunique;
+
+  if (unlikely (grow (dwfl, nadd)))
+    {
+      free (modules);
+      free (add);
+      return true;
+    }
+
+  /* Merge from the end, none of the new boundaries is in the table.  */
+  size_t i = dwfl->lookup_elts;
+  size_t k = dwfl->lookup_elts + nadd;
+  while (nadd > 0)
+    {
+      --k;
+      if (i > 0 && dwfl->lookup_addr[i - 1] > add[nadd - 1])
+	{
+	  --i;
+	  dwfl->lookup_addr[k] = dwfl->lookup_addr[i];
+	  dwfl->lookup_segndx[k] = dwfl->lookup_segndx[i];
+	}
+      else
+	{
+	  --nadd;
+	  dwfl->lookup_addr[k] = add[nadd];
+	  dwfl->lookup_segndx[k] = -1;
+	}
+    }
+  dwfl->lookup_elts += nunique;
+  free (add);
+
+  dwfl->lookup_module = calloc (dwfl->lookup_alloc,
+				sizeof dwfl->lookup_module[0]);
+  if (unlikely (dwfl->lookup_module == NULL))
+    {
+      free (modules);
+      return true;
+    }
+
+  hint = -1;
+  for (size_t m = 0; m < nmodules; ++m)
+    {
+      Dwfl_Module *mod = modules[m];
+      const GElf_Addr start = __libdwfl_segment_start (dwfl, mod->low_addr);
+      const GElf_Addr end = __libdwfl_segment_end (dwfl, mod->high_addr);
+      int idx = lookup (dwfl, start, hint);
+      assert (idx >= 0 && dwfl->lookup_addr[idx] == start);
+
+      /* Cache a backpointer in the module.  */
+      mod->segment = idx;
+
+      /* Put MOD in the table for each segment that's inside it.  */
+      do
+	dwfl->lookup_module[idx++] = mod;
+      while ((size_t) idx < dwfl->lookup_elts
+	     && dwfl->lookup_addr[idx] < end);
+      assert (dwfl->lookup_module[mod->segment] == mod);
+
+      hint = (size_t) idx < dwfl->lookup_elts ? idx : -1;
+    }
+
+  free (modules);
   return false;
 }
 
@@ -247,6 +355,12 @@ dwfl_addrsegment (Dwfl *dwfl, Dwarf_Addr address, Dwfl_Module **mod)
   if (unlikely (dwfl == NULL))
     return -1;
 
+  if (unlikely (__libdwfl_segment_sort (dwfl)))
+    {
+      __libdwfl_seterrno (DWFL_E_NOMEM);
+      return -1;
+    }
+
   if (unlikely (dwfl->lookup_module == NULL)
       && mod != NULL
       && unlikely (reify_segments (dwfl)))
@@ -314,13 +428,15 @@ dwfl_report_segment (Dwfl *dwfl, int ndx, const GElf_Phdr *phdr, GElf_Addr bias,
       || start != dwfl->lookup_tail_vaddr
       || phdr->p_offset != dwfl->lookup_tail_offset)
     {
-      /* Normally just appending keeps us sorted.  */
+      /* Normally just appending keeps us sorted.  Otherwise the table
+	 is sorted once when it is used next, instead of moving its tail
+	 for every segment.  */
 
       size_t i = dwfl->lookup_elts;
-      while (i > 0 && unlikely (start < dwfl->lookup_addr[i - 1]))
-	--i;
+      if (i > 0 && unlikely (start < dwfl->lookup_addr[i - 1]))
+	dwfl->lookup_unsorted = true;
 
-      if (unlikely (insert (dwfl, i, start, end, ndx)))
+      if (unlikely (append (dwfl, start, end, ndx)))
 	{
 	  __libdwfl_seterrno (DWFL_E_NOMEM);
 	  return -1;
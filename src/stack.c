@@ -20,11 +20,13 @@
 #include <argp.h>
 #include <stdlib.h>
 #include <inttypes.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdio_ext.h>
 #include <string.h>
 #include <locale.h>
 #include <fcntl.h>
+#include <pthread.h>
 #include ELFUTILS_HEADER(dwfl)
 
 #include <dwarf.h>
@@ -40,6 +42,8 @@ ARGP_PROGRAM_BUG_ADDRESS_DEF = PACKAGE_BUGREPORT;
 /* non-printable argp options.  */
 #define OPT_DEBUGINFO	0x100
 #define OPT_COREFILE	0x101
+#define OPT_SNAPSHOT	0x102
+#define OPT_UNWIND	0x103
 
 static bool show_activation = false;
 static bool show_module = false;
@@ -54,6 +58,16 @@ static bool show_inlines = false;
 
 static int maxframes = 256;
 
+/* Number of threads to unwind at the same time, 0 means one per CPU.  */
+static unsigned int jobs = 1;
+
+/* Bytes of stack to copy before detaching a thread, 0 means the thread
+   stays stopped while it is unwound.  */
+static size_t snapshot_bytes = 0;
+
+/* See dwfl_set_unwind_policy.  */
+static int unwind_policy = DWFL_UNWIND_DEFAULT;
+
 struct frame
 {
   Dwarf_Addr pc;
@@ -67,6 +81,23 @@ struct frames
   struct frame *frame;
 };
 
+/* The frames of one thread collected by parallel_thread_callback.  */
+struct thread_frames
+{
+  pid_t tid;
+  int err;
+  struct frames frames;
+};
+
+/* All threads unwound with -j, printed after the unwinding is done.  */
+struct parallel_frames
+{
+  pthread_mutex_t lock;
+  size_t count;
+  size_t allocated;
+  struct thread_frames *threads;
+};
+
 static Dwfl *dwfl = NULL;
 static pid_t pid = 0;
 static int core_fd = -1;
@@ -470,6 +501,76 @@ thread_callback (Dwfl_Thread *thread, void *thread_arg)
   return DWARF_CB_OK;
 }
 
+static void
+init_frames (struct frames *frames)
+{
+  /* When maxframes is zero, then 2048 is just the initial allocation
+     that will be increased using realloc in framecallback ().  */
+  frames->allocated = maxframes == 0 ? 2048 : maxframes;
+  frames->frames = 0;
+  frames->frame = malloc (sizeof (struct frame) * frames->allocated);
+  if (frames->frame == NULL)
+    error (EXIT_BAD, errno, "malloc frames.frame");
+}
+
+/* Called for several threads at the same time, so only unwinds and
+   leaves symbolizing and printing to print_parallel_frames.  */
+static int
+parallel_thread_callback (Dwfl_Thread *thread, void *thread_arg)
+{
+  struct parallel_frames *all = (struct parallel_frames *) thread_arg;
+  struct thread_frames tf;
+  tf.tid = dwfl_thread_tid (thread);
+  tf.err = 0;
+  init_frames (&tf.frames);
+  switch (dwfl_thread_getframes (thread, frame_callback, &tf.frames))
+    {
+    case DWARF_CB_OK:
+    case DWARF_CB_ABORT:
+      break;
+    case -1:
+      tf.err = dwfl_errno ();
+      break;
+    default:
+      abort ();
+    }
+
+  pthread_mutex_lock (&all->lock);
+  if (all->count == all->allocated)
+    {
+      all->allocated = all->allocated == 0 ? 16 : 2 * all->allocated;
+      all->threads = realloc (all->threads,
+			      sizeof (struct thread_frames) * all->allocated);
+      if (all->threads == NULL)
+	error (EXIT_BAD, errno, "realloc threads");
+    }
+  all->threads[all->count++] = tf;
+  pthread_mutex_unlock (&all->lock);
+  return DWARF_CB_OK;
+}
+
+static int
+compare_thread_frames (const void *a, const void *b)
+{
+  const struct thread_frames *t1 = a;
+  const struct thread_frames *t2 = b;
+  return t1->tid < t2->tid ? -1 : t1->tid > t2->tid;
+}
+
+static void
+print_parallel_frames (struct parallel_frames *all)
+{
+  qsort (all->threads, all->count, sizeof (struct thread_frames),
+	 compare_thread_frames);
+  for (size_t i = 0; i < all->count; i++)
+    {
+      print_frames (&all->threads[i].frames, all->threads[i].tid,
+		    all->threads[i].err, "dwfl_thread_getframes");
+      free (all->threads[i].frames.frame);
+    }
+  free (all->threads);
+}
+
 static error_t
 parse_opt (int key, char *arg __attribute__ ((unused)),
 	   struct argp_state *state)
@@ -554,6 +655,49 @@ parse_opt (int key, char *arg __attribute__ ((unused)),
       show_modules = true;
       break;
 
+    case 'j':
+      {
+	char *end;
+	unsigned long int n = strtoul (arg, &end, 10);
+	if (*arg == '\0' || *end != '\0' || n > UINT_MAX)
+	  {
+	    argp_error (state, N_("-j JOBS should be 0 or higher."));
+	    return EINVAL;
+	  }
+	jobs = n;
+      }
+      break;
+
+    case OPT_SNAPSHOT:
+      if (arg == NULL)
+	snapshot_bytes = 64 * 1024;
+      else
+	{
+	  char *end;
+	  unsigned long int n = strtoul (arg, &end, 10);
+	  if (*arg == '\0' || *end != '\0' || n == 0)
+	    {
+	      argp_error (state, N_("--snapshot BYTES should be 1 or higher."));
+	      return EINVAL;
+	    }
+	  snapshot_bytes = n;
+	}
+      break;
+
+    case OPT_UNWIND:
+      if (strcmp (arg, "cfi") == 0)
+	unwind_policy = DWFL_UNWIND_CFI_FIRST;
+      else if (strcmp (arg, "fp") == 0)
+	unwind_policy = DWFL_UNWIND_FP_FIRST;
+      else if (strcmp (arg, "fp-only") == 0)
+	unwind_policy = DWFL_UNWIND_FP_ONLY;
+      else
+	{
+	  argp_error (state, N_("--unwind should be cfi, fp or fp-only."));
+	  return EINVAL;
+	}
+      break;
+
     case ARGP_KEY_END:
       if (core == NULL && exec != NULL)
 	argp_error (state,
@@ -567,6 +711,10 @@ parse_opt (int key, char *arg __attribute__ ((unused)),
 	argp_error (state,
 		    N_("One of -p PID or --core COREFILE should be given."));
 
+      if (pid == 0 && snapshot_bytes != 0)
+	argp_error (state,
+		    N_("--snapshot needs a process given by -p."));
+
       if (pid != 0)
 	{
 	  dwfl = dwfl_begin (&proc_callbacks);
@@ -594,6 +742,9 @@ parse_opt (int key, char *arg __attribute__ ((unused)),
       if (dwfl_report_end (dwfl, NULL, NULL) != 0)
 	error (EXIT_BAD, 0, "dwfl_report_end: %s", dwfl_errmsg (-1));
 
+      if (dwfl_set_unwind_policy (dwfl, unwind_policy) != 0)
+	error (EXIT_BAD, 0, "dwfl_set_unwind_policy: %s", dwfl_errmsg (-1));
+
       if (pid != 0)
 	{
 	  int err = dwfl_linux_proc_attach (dwfl, pid, false);
@@ -603,6 +754,11 @@ parse_opt (int key, char *arg __attribute__ ((unused)),
 	  else if (err > 0)
 	    error (EXIT_BAD, err, "dwfl_linux_proc_attach pid %lld",
 		   (long long) pid);
+
+	  if (snapshot_bytes != 0
+	      && dwfl_linux_proc_set_snapshot (dwfl, snapshot_bytes) != 0)
+	    error (EXIT_BAD, 0, "dwfl_linux_proc_set_snapshot: %s",
+		   dwfl_errmsg (-1));
 	}
 
       if (core != NULL)
@@ -625,7 +781,7 @@ parse_opt (int key, char *arg __attribute__ ((unused)),
 int
 main (int argc, char **argv)
 {
-  /* We use no threads here which can interfere with handling a stream.  */
+  /* Only the main thread uses streams, -j threads just unwind.  */
   __fsetlocking (stdin, FSETLOCKING_BYCALLER);
   __fsetlocking (stdout, FSETLOCKING_BYCALLER);
   __fsetlocking (stderr, FSETLOCKING_BYCALLER);
@@ -670,6 +826,12 @@ main (int argc, char **argv)
 	N_("Show at most MAXFRAMES per thread (default 256, use 0 for unlimited)"), 0 },
       { "list-modules", 'l', NULL, 0,
 	N_("Show module memory map with build-id, elf and debug files detected"), 0 },
+      { "jobs", 'j', "JOBS", 0,
+	N_("Load modules and unwind up to JOBS threads at the same time (default 1, use 0 for one per CPU)"), 0 },
+      { "snapshot", OPT_SNAPSHOT, "BYTES", OPTION_ARG_OPTIONAL,
+	N_("Copy registers and BYTES of stack of each thread (default 65536) and let it continue before unwinding"), 0 },
+      { "unwind", OPT_UNWIND, "POLICY", 0,
+	N_("Unwind with CFI first ('cfi', the default), the frame pointer first ('fp') or only the frame pointer ('fp-only')"), 0 },
       { NULL, 0, NULL, 0, NULL, 0 }
     };
 
@@ -689,6 +851,10 @@ invoked with bad or missing arguments it will exit with return code 64.")
 
   argp_parse (&argp, argc, argv, 0, NULL, NULL);
 
+  /* Each thread needs most modules anyway, open them all at once.  */
+  if (jobs != 1 && dwfl_preload_modules (dwfl, jobs) != 0)
+    error (0, 0, "dwfl_preload_modules: %s", dwfl_errmsg (-1));
+
   if (show_modules)
     {
       printf ("PID %lld - %s module memory map\n", (long long) dwfl_pid (dwfl),
@@ -698,13 +864,7 @@ invoked with bad or missing arguments it will exit with return code 64.")
     }
 
   struct frames frames;
-  /* When maxframes is zero, then 2048 is just the initial allocation
-     that will be increased using realloc in framecallback ().  */
-  frames.allocated = maxframes == 0 ? 2048 : maxframes;
-  frames.frames = 0;
-  frames.frame = malloc (sizeof (struct frame) * frames.allocated);
-  if (frames.frame == NULL)
-    error (EXIT_BAD, errno, "malloc frames.frame");
+  init_frames (&frames);
 
   if (show_one_tid)
     {
@@ -726,16 +886,37 @@ invoked with bad or missing arguments it will exit with return code 64.")
     {
       printf ("PID %lld - %s\n", (long long) dwfl_pid (dwfl),
 	      pid != 0 ? "process" : "core");
-      switch (dwfl_getthreads (dwfl, thread_callback, &frames))
+      if (jobs == 1)
+	switch (dwfl_getthreads (dwfl, thread_callback, &frames))
+	  {
+	  case DWARF_CB_OK:
+	  case DWARF_CB_ABORT:
+	    break;
+	  case -1:
+	    error (0, 0, "dwfl_getthreads: %s", dwfl_errmsg (-1));
+	    break;
+	  default:
+	    abort ();
+	  }
+      else
 	{
-	case DWARF_CB_OK:
-	case DWARF_CB_ABORT:
-	  break;
-	case -1:
-	  error (0, 0, "dwfl_getthreads: %s", dwfl_errmsg (-1));
-	  break;
-	default:
-	  abort ();
+	  struct parallel_frames all = { .count = 0, .allocated = 0,
+					 .threads = NULL };
+	  pthread_mutex_init (&all.lock, NULL);
+	  switch (dwfl_getthreads_parallel (dwfl, jobs,
+					    parallel_thread_callback, &all))
+	    {
+	    case DWARF_CB_OK:
+	    case DWARF_CB_ABORT:
+	      break;
+	    case -1:
+	      error (0, 0, "dwfl_getthreads_parallel: %s", dwfl_errmsg (-1));
+	      break;
+	    default:
+	      abort ();
+	    }
+	  pthread_mutex_destroy (&all.lock);
+	  print_parallel_frames (&all);
 	}
     }
   free (frames.frame);
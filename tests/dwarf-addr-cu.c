@@ -0,0 +1,155 @@
+/* Check dwarf_addrdie with and without .debug_aranges.
+   This file is part of elfutils.
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   elfutils is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+#include <config.h>
+#include ELFUTILS_HEADER(dw)
+#include <dwarf.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Checks that dwarf_addrdie finds the unit for the first and last
+   address of all ranges of all units, also for units that aren't
+   in .debug_aranges and when the ranges other units left for dropped
+   code cover them.  */
+
+static int errors;
+
+/* Whether ranges at zero are left over from dropped code.  */
+static bool skip_zero;
+
+static size_t
+check_ranges (Dwarf *dbg, Dwarf_Die *die, Dwarf_Off cuoff)
+{
+  size_t n = 0;
+  ptrdiff_t off = 0;
+  Dwarf_Addr base, start, end;
+  while ((off = dwarf_ranges (die, off, &base, &start, &end)) > 0)
+    {
+      /* Code the linker dropped with --gc-sections leaves its ranges
+	 at zero, those belong to no unit.  */
+      if (end <= start || (skip_zero && start == 0))
+	continue;
+      n++;
+
+      Dwarf_Addr addrs[] = { start, end - 1 };
+      for (size_t i = 0; i < sizeof addrs / sizeof addrs[0]; i++)
+	{
+	  Dwarf_Die found;
+	  if (dwarf_addrdie (dbg, addrs[i], &found) == NULL)
+	    {
+	      if (errors++ < 10)
+		printf ("%#" PRIx64 ": no unit: %s\n", addrs[i],
+			dwarf_errmsg (-1));
+	    }
+	  else if (dwarf_dieoffset (&found) != cuoff)
+	    {
+	      if (errors++ < 10)
+		printf ("%#" PRIx64 ": unit %#" PRIx64 " instead of %#"
+			PRIx64 "\n", addrs[i], dwarf_dieoffset (&found),
+			cuoff);
+	    }
+	}
+    }
+  return n;
+}
+
+static int
+compare_offsets (const void *a, const void *b)
+{
+  const Dwarf_Off *p1 = a, *p2 = b;
+  return *p1 < *p2 ? -1 : *p1 > *p2;
+}
+
+int
+main (int argc, char *argv[])
+{
+  if (argc != 2)
+    {
+      printf ("usage: %s FILE\n", argv[0]);
+      return -1;
+    }
+
+  const char *name = argv[1];
+  int fd = open (name, O_RDONLY);
+  if (fd < 0)
+    {
+      printf ("Cannnot open '%s': %s\n", name, strerror (errno));
+      return -1;
+    }
+
+  Dwarf *dbg = dwarf_begin (fd, DWARF_C_READ);
+  if (dbg == NULL)
+    {
+      printf ("Not a Dwarf file: %s\n", dwarf_errmsg (-1));
+      return -1;
+    }
+
+  GElf_Ehdr ehdr_mem;
+  GElf_Ehdr *ehdr = gelf_getehdr (dwarf_getelf (dbg), &ehdr_mem);
+  skip_zero = ehdr != NULL && ehdr->e_type != ET_REL;
+
+  Dwarf_Aranges *aranges;
+  size_t naranges;
+  if (dwarf_getaranges (dbg, &aranges, &naranges) != 0)
+    naranges = 0;
+  Dwarf_Off *covered = malloc ((naranges + 1) * sizeof covered[0]);
+  if (covered == NULL)
+    {
+      puts ("out of memory");
+      return -1;
+    }
+  for (size_t i = 0; i < naranges; i++)
+    dwarf_getarangeinfo (dwarf_onearange (aranges, i), NULL, NULL,
+			 &covered[i]);
+  qsort (covered, naranges, sizeof covered[0], compare_offsets);
+
+  size_t units = 0;
+  size_t ranges = 0;
+  size_t missing = 0;
+  Dwarf_CU *cu = NULL;
+  Dwarf_Half version;
+  uint8_t unit_type;
+  Dwarf_Die cudie, subdie;
+  while (dwarf_get_units (dbg, cu, &cu, &version, &unit_type,
+			  &cudie, &subdie) == 0)
+    {
+      if (version < 5 && unit_type == DW_UT_type)
+	continue;
+      units++;
+
+      Dwarf_Off cuoff = dwarf_dieoffset (&cudie);
+      size_t n = check_ranges (dbg, &cudie, cuoff);
+      if (n == 0 && unit_type == DW_UT_skeleton)
+	n = check_ranges (dbg, &subdie, cuoff);
+      ranges += n;
+
+      if (n > 0 && bsearch (&cuoff, covered, naranges, sizeof covered[0],
+			    compare_offsets) == NULL)
+	missing++;
+    }
+
+  printf ("%zu units, %zu ranges, %zu units without aranges\n",
+	  units, ranges, missing);
+
+  free (covered);
+  dwarf_end (dbg);
+  close (fd);
+  return errors == 0 ? 0 : -1;
+}
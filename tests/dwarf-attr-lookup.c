@@ -0,0 +1,150 @@
+/* Check and time dwarf_attr lookups.
+   This file is part of elfutils.
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   elfutils is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#include <config.h>
+#include ELFUTILS_HEADER(dw)
+#include <dwarf.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+
+/* For every attribute of every DIE dwarf_attr must find the same value
+   that dwarf_getattrs iterates over.  With -t the lookup of some common
+   attributes, present or not, is timed over all DIEs.  */
+
+static size_t nattrs;
+static size_t nbad;
+
+static int
+attr_cb (Dwarf_Attribute *attr, void *arg)
+{
+  Dwarf_Die *die = arg;
+  Dwarf_Attribute found;
+  nattrs++;
+  /* For duplicate attributes dwarf_attr returns the first one.  */
+  if (dwarf_attr (die, attr->code, &found) == NULL
+      || (found.valp == attr->valp && found.form != attr->form)
+      || found.valp > attr->valp)
+    {
+      if (nbad++ < 10)
+	printf ("DIE %#" PRIx64 " attr %#x form %#x mismatch\n",
+		dwarf_dieoffset (die), attr->code, attr->form);
+    }
+  return DWARF_CB_OK;
+}
+
+static const unsigned int lookups[] =
+  {
+    DW_AT_name, DW_AT_type, DW_AT_decl_file, DW_AT_decl_line,
+    DW_AT_byte_size, DW_AT_data_member_location, DW_AT_external,
+    DW_AT_low_pc, DW_AT_sibling, DW_AT_declaration
+  };
+
+static size_t
+walk_dies (Dwarf_Die *die, bool timed)
+{
+  size_t n = 0;
+  do
+    {
+      n++;
+      if (timed)
+	for (size_t i = 0; i < sizeof lookups / sizeof lookups[0]; i++)
+	  {
+	    Dwarf_Attribute attr;
+	    if (dwarf_attr (die, lookups[i], &attr) != NULL)
+	      nattrs++;
+	  }
+      else
+	dwarf_getattrs (die, attr_cb, die, 0);
+
+      Dwarf_Die child;
+      if (dwarf_child (die, &child) == 0)
+	n += walk_dies (&child, timed);
+    }
+  while (dwarf_siblingof (die, die) == 0);
+  return n;
+}
+
+static size_t
+walk_units (Dwarf *dbg, bool timed)
+{
+  size_t ndies = 0;
+  Dwarf_CU *cu = NULL;
+  Dwarf_Die cudie;
+  while (dwarf_get_units (dbg, cu, &cu, NULL, NULL, &cudie, NULL) == 0)
+    if (dwarf_tag (&cudie) != DW_TAG_invalid)
+      ndies += walk_dies (&cudie, timed);
+  return ndies;
+}
+
+int
+main (int argc, char *argv[])
+{
+  bool timed = false;
+  int argi = 1;
+  if (argi < argc && strcmp (argv[argi], "-t") == 0)
+    {
+      timed = true;
+      argi++;
+    }
+
+  if (argi >= argc)
+    {
+      printf ("usage: %s [-t] FILE\n", argv[0]);
+      return -1;
+    }
+
+  const char *name = argv[argi];
+  int fd = open (name, O_RDONLY);
+  if (fd < 0)
+    {
+      printf ("Cannnot open '%s': %s\n", name, strerror (errno));
+      return -1;
+    }
+
+  Dwarf *dbg = dwarf_begin (fd, DWARF_C_READ);
+  if (dbg == NULL)
+    {
+      printf ("Not a Dwarf file: %s\n", dwarf_errmsg (-1));
+      return -1;
+    }
+
+  size_t ndies = walk_units (dbg, false);
+  printf ("%zu DIEs, %zu attributes\n", ndies, nattrs);
+
+  if (timed)
+    {
+      const int iterations = 20;
+      struct timespec start, end;
+      clock_gettime (CLOCK_MONOTONIC, &start);
+      for (int i = 0; i < iterations; i++)
+	walk_units (dbg, true);
+      clock_gettime (CLOCK_MONOTONIC, &end);
+      double ns = ((end.tv_sec - start.tv_sec) * 1e9
+		   + (end.tv_nsec - start.tv_nsec));
+      fprintf (stderr, "%.1f ns per DIE\n", ns / (iterations * ndies));
+    }
+
+  dwarf_end (dbg);
+  close (fd);
+  return nbad == 0 ? 0 : -1;
+}
@@ -0,0 +1,249 @@
+/* Concurrent use of the lazily filled libdw caches.
+   This file is part of elfutils.
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   elfutils is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#include <config.h>
+#include ELFUTILS_HEADER(dw)
+#include <dwarf.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+/* All threads walk all units of one Dwarf at the same time, so they
+   race to fill in the same caches: location expressions, line and file
+   tables, macro operator tables, split units and the aranges.  Every
+   thread must come up with the same counts.  */
+
+struct counts
+{
+  size_t units;
+  size_t dies;
+  size_t exprs;
+  size_t lines;
+  size_t files;
+  size_t decl_files;
+  size_t macros;
+  size_t aranges;
+};
+
+struct state
+{
+  Dwarf *dbg;
+  pthread_barrier_t barrier;
+};
+
+static int
+attr_cb (Dwarf_Attribute *attr, void *arg)
+{
+  struct counts *counts = arg;
+  Dwarf_Addr base, start, end;
+  Dwarf_Op *expr;
+  size_t exprlen;
+  ptrdiff_t off = 0;
+  while ((off = dwarf_getlocations (attr, off, &base, &start, &end,
+				    &expr, &exprlen)) > 0)
+    counts->exprs++;
+  return DWARF_CB_OK;
+}
+
+static void
+walk_dies (Dwarf_Die *die, struct counts *counts)
+{
+  do
+    {
+      counts->dies++;
+      dwarf_getattrs (die, attr_cb, counts, 0);
+      if (dwarf_hasattr (die, DW_AT_decl_file)
+	  && dwarf_decl_file (die) != NULL)
+	counts->decl_files++;
+      Dwarf_Die child;
+      if (dwarf_child (die, &child) == 0)
+	walk_dies (&child, counts);
+    }
+  while (dwarf_siblingof (die, die) == 0);
+}
+
+static int
+macro_cb (Dwarf_Macro *macro, void *arg)
+{
+  struct counts *counts = arg;
+  counts->macros++;
+
+  unsigned int opcode;
+  if (dwarf_macro_opcode (macro, &opcode) == 0
+      && opcode == DW_MACRO_import)
+    {
+      Dwarf_Attribute at;
+      Dwarf_Word off;
+      if (dwarf_macro_param (macro, 0, &at) == 0
+	  && dwarf_formudata (&at, &off) == 0)
+	{
+	  ptrdiff_t token = DWARF_GETMACROS_START;
+	  while ((token = dwarf_getmacros_off (dwarf_cu_getdwarf (at.cu),
+					       off, macro_cb, counts,
+					       token)) > 0)
+	    ;
+	}
+    }
+
+  return DWARF_CB_OK;
+}
+
+static void
+walk_unit (Dwarf_Die *cudie, struct counts *counts)
+{
+  Dwarf_Lines *lines;
+  size_t nlines;
+  if (dwarf_getsrclines (cudie, &lines, &nlines) == 0)
+    counts->lines += nlines;
+
+  Dwarf_Files *files;
+  size_t nfiles;
+  if (dwarf_getsrcfiles (cudie, &files, &nfiles) == 0)
+    counts->files += nfiles;
+
+  ptrdiff_t token = 0;
+  while ((token = dwarf_getmacros (cudie, macro_cb, counts, token)) > 0)
+    ;
+
+  walk_dies (cudie, counts);
+}
+
+static void *
+worker (void *arg)
+{
+  struct state *state = arg;
+  struct counts *counts = calloc (1, sizeof *counts);
+  if (counts == NULL)
+    return NULL;
+
+  pthread_barrier_wait (&state->barrier);
+
+  Dwarf_CU *cu = NULL;
+  Dwarf_Die cudie, subdie;
+  uint8_t unit_type;
+  while (dwarf_get_units (state->dbg, cu, &cu, NULL, &unit_type,
+			  &cudie, &subdie) == 0)
+    {
+      counts->units++;
+      walk_unit (&cudie, counts);
+
+      /* The split unit is found and linked on first use.  */
+      if (unit_type == DW_UT_skeleton && dwarf_tag (&subdie) != DW_TAG_invalid)
+	{
+	  counts->units++;
+	  walk_unit (&subdie, counts);
+	}
+    }
+
+  Dwarf_Aranges *aranges;
+  size_t naranges;
+  if (dwarf_getaranges (state->dbg, &aranges, &naranges) == 0)
+    counts->aranges = naranges;
+
+  return counts;
+}
+
+int
+main (int argc, char *argv[])
+{
+  unsigned int nthreads = 4;
+  int argi = 1;
+  if (argi + 1 < argc && strcmp (argv[argi], "-j") == 0)
+    {
+      nthreads = atoi (argv[argi + 1]);
+      argi += 2;
+    }
+
+  if (argi >= argc || nthreads == 0)
+    {
+      printf ("usage: %s [-j THREADS] FILE\n", argv[0]);
+      return -1;
+    }
+
+  const char *name = argv[argi];
+  int fd = open (name, O_RDONLY);
+  if (fd < 0)
+    {
+      printf ("Cannnot open '%s': %s\n", name, strerror (errno));
+      return -1;
+    }
+
+  struct state state;
+  state.dbg = dwarf_begin (fd, DWARF_C_READ);
+  if (state.dbg == NULL)
+    {
+      printf ("Not a Dwarf file: %s\n", dwarf_errmsg (-1));
+      return -1;
+    }
+  pthread_barrier_init (&state.barrier, NULL, nthreads);
+
+  pthread_t *threads = malloc (nthreads * sizeof threads[0]);
+  if (threads == NULL)
+    {
+      printf ("Out of memory\n");
+      return -1;
+    }
+  for (unsigned int i = 0; i < nthreads; i++)
+    if (pthread_create (&threads[i], NULL, worker, &state) != 0)
+      {
+	printf ("Cannot create thread\n");
+	return -1;
+      }
+
+  int result = 0;
+  struct counts *first = NULL;
+  for (unsigned int i = 0; i < nthreads; i++)
+    {
+      struct counts *counts;
+      pthread_join (threads[i], (void **) &counts);
+      if (counts == NULL)
+	{
+	  printf ("thread %u failed\n", i);
+	  result = -1;
+	}
+      else if (first == NULL)
+	first = counts;
+      else
+	{
+	  if (memcmp (first, counts, sizeof *counts) != 0)
+	    {
+	      printf ("thread %u disagrees\n", i);
+	      result = -1;
+	    }
+	  free (counts);
+	}
+    }
+
+  if (first != NULL)
+    {
+      printf ("%zu units, %zu DIEs, %zu location expressions\n",
+	      first->units, first->dies, first->exprs);
+      printf ("%zu lines, %zu files, %zu decl_files\n",
+	      first->lines, first->files, first->decl_files);
+      printf ("%zu macros, %zu aranges\n", first->macros, first->aranges);
+      free (first);
+    }
+
+  free (threads);
+  pthread_barrier_destroy (&state.barrier);
+  dwarf_end (state.dbg);
+  close (fd);
+  return result;
+}
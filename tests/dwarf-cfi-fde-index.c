@@ -0,0 +1,166 @@
+/* Test dwarf_cfi_build_fde_index.
+   This file is part of elfutils.
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   elfutils is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+#include <config.h>
+#include ELFUTILS_HEADER(dw)
+#include <errno.h>
+#include <fcntl.h>
+#include <gelf.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Looks up the frames around the start and end of every function
+   symbol in the .eh_frame and the .debug_frame CFI, once without and
+   once with an FDE index, which must give the same FDEs.  */
+
+static int errors;
+
+static void
+check_addr (Dwarf_CFI *plain, Dwarf_CFI *indexed, Dwarf_Addr addr,
+	    size_t *nframes)
+{
+  Dwarf_Frame *frame1, *frame2;
+  int res1 = dwarf_cfi_addrframe (plain, addr, &frame1);
+  int res2 = dwarf_cfi_addrframe (indexed, addr, &frame2);
+  if (res1 != res2)
+    {
+      if (errors++ < 10)
+	printf ("%#" PRIx64 ": frame found by only one lookup\n", addr);
+      if (res1 == 0)
+	free (frame1);
+      if (res2 == 0)
+	free (frame2);
+      return;
+    }
+  if (res1 != 0)
+    return;
+
+  Dwarf_Addr start1, end1, start2, end2;
+  dwarf_frame_info (frame1, &start1, &end1, NULL);
+  dwarf_frame_info (frame2, &start2, &end2, NULL);
+  if (start1 != start2 || end1 != end2)
+    {
+      if (errors++ < 10)
+	printf ("%#" PRIx64 ": frames [%#" PRIx64 ", %#" PRIx64 ") and"
+		" [%#" PRIx64 ", %#" PRIx64 ") differ\n",
+		addr, start1, end1, start2, end2);
+    }
+  (*nframes)++;
+  free (frame1);
+  free (frame2);
+}
+
+static void
+check_cfi (Elf *elf, const char *what, Dwarf_CFI *plain, Dwarf_CFI *indexed)
+{
+  if (plain == NULL || indexed == NULL)
+    {
+      printf ("%s: none\n", what);
+      return;
+    }
+
+  /* The FDEs of different sections overlap in relocatable files,
+     so addresses don't identify a single frame.  */
+  GElf_Ehdr ehdr_mem, *ehdr = gelf_getehdr (elf, &ehdr_mem);
+  if (ehdr == NULL || ehdr->e_type == ET_REL)
+    {
+      printf ("%s: relocatable\n", what);
+      return;
+    }
+
+  if (dwarf_cfi_build_fde_index (indexed) != 0)
+    {
+      printf ("%s: dwarf_cfi_build_fde_index: %s\n", what, dwarf_errmsg (-1));
+      errors++;
+      return;
+    }
+  /* Building it again does nothing.  */
+  if (dwarf_cfi_build_fde_index (indexed) != 0)
+    errors++;
+
+  size_t naddrs = 0, nframes = 0;
+  Elf_Scn *scn = NULL;
+  while ((scn = elf_nextscn (elf, scn)) != NULL)
+    {
+      GElf_Shdr shdr_mem, *shdr = gelf_getshdr (scn, &shdr_mem);
+      if (shdr == NULL || shdr->sh_type != SHT_SYMTAB || shdr->sh_entsize == 0)
+	continue;
+
+      Elf_Data *data = elf_getdata (scn, NULL);
+      size_t nsyms = shdr->sh_size / shdr->sh_entsize;
+      for (size_t i = 0; data != NULL && i < nsyms; i++)
+	{
+	  GElf_Sym sym_mem, *sym = gelf_getsym (data, i, &sym_mem);
+	  if (sym == NULL || GELF_ST_TYPE (sym->st_info) != STT_FUNC
+	      || sym->st_shndx == SHN_UNDEF)
+	    continue;
+
+	  Dwarf_Addr addrs[] = { sym->st_value - 1, sym->st_value,
+				 sym->st_value + sym->st_size / 2,
+				 sym->st_value + sym->st_size - 1,
+				 sym->st_value + sym->st_size };
+	  for (size_t j = 0; j < sizeof addrs / sizeof addrs[0]; j++)
+	    check_addr (plain, indexed, addrs[j], &nframes);
+	  naddrs += sizeof addrs / sizeof addrs[0];
+	}
+    }
+
+  printf ("%s: %zu addresses, %zu with frame\n", what, naddrs, nframes);
+}
+
+int
+main (int argc, char *argv[])
+{
+  if (argc != 2)
+    {
+      printf ("usage: %s FILE\n", argv[0]);
+      return -1;
+    }
+
+  const char *name = argv[1];
+  int fd = open (name, O_RDONLY);
+  if (fd < 0)
+    {
+      printf ("Cannnot open '%s': %s\n", name, strerror (errno));
+      return -1;
+    }
+
+  elf_version (EV_CURRENT);
+  Elf *elf = elf_begin (fd, ELF_C_READ, NULL);
+  if (elf == NULL)
+    {
+      printf ("Not an ELF file: %s\n", elf_errmsg (-1));
+      return -1;
+    }
+
+  Dwarf_CFI *eh1 = dwarf_getcfi_elf (elf);
+  Dwarf_CFI *eh2 = dwarf_getcfi_elf (elf);
+  check_cfi (elf, ".eh_frame", eh1, eh2);
+  dwarf_cfi_end (eh1);
+  dwarf_cfi_end (eh2);
+
+  Dwarf *dbg1 = dwarf_begin_elf (elf, DWARF_C_READ, NULL);
+  Dwarf *dbg2 = dwarf_begin_elf (elf, DWARF_C_READ, NULL);
+  check_cfi (elf, ".debug_frame", dwarf_getcfi (dbg1), dwarf_getcfi (dbg2));
+  dwarf_end (dbg1);
+  dwarf_end (dbg2);
+
+  elf_end (elf);
+  close (fd);
+  return errors == 0 ? 0 : -1;
+}
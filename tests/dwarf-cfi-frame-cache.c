@@ -0,0 +1,218 @@
+/* Test dwarf_cfi_addrframe remembering frames.
+   This file is part of elfutils.
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   elfutils is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+#include <config.h>
+#include ELFUTILS_HEADER(dw)
+#include <errno.h>
+#include <fcntl.h>
+#include <gelf.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Looks up the frames at the start and the middle of every function
+   symbol twice.  The second pass must give the same frames as the
+   first, and every lookup must be counted as either a hit or a miss.  */
+
+#define NREGS 32
+
+static int errors;
+
+static bool
+same_ops (Dwarf_Op *ops1, size_t nops1, Dwarf_Op *ops2, size_t nops2)
+{
+  if (nops1 != nops2)
+    return false;
+  for (size_t i = 0; i < nops1; i++)
+    if (ops1[i].atom != ops2[i].atom
+	|| ops1[i].number != ops2[i].number
+	|| ops1[i].number2 != ops2[i].number2)
+      return false;
+  return true;
+}
+
+static bool
+same_frame (Dwarf_Frame *frame1, Dwarf_Frame *frame2)
+{
+  Dwarf_Addr start1, end1, start2, end2;
+  bool signal1, signal2;
+  if (dwarf_frame_info (frame1, &start1, &end1, &signal1)
+      != dwarf_frame_info (frame2, &start2, &end2, &signal2)
+      || start1 != start2 || end1 != end2 || signal1 != signal2)
+    return false;
+
+  Dwarf_Op *ops1, *ops2;
+  size_t nops1, nops2;
+  int res1 = dwarf_frame_cfa (frame1, &ops1, &nops1);
+  int res2 = dwarf_frame_cfa (frame2, &ops2, &nops2);
+  if (res1 != res2 || (res1 == 0 && ! same_ops (ops1, nops1, ops2, nops2)))
+    return false;
+
+  for (int regno = 0; regno < NREGS; regno++)
+    {
+      Dwarf_Op mem1[3], mem2[3];
+      res1 = dwarf_frame_register (frame1, regno, mem1, &ops1, &nops1);
+      res2 = dwarf_frame_register (frame2, regno, mem2, &ops2, &nops2);
+      if (res1 != res2)
+	return false;
+      if (res1 != 0)
+	continue;
+      /* Undefined and same-value rules differ only in OPS.  */
+      if (nops1 == 0 && nops2 == 0
+	  && (ops1 == NULL) != (ops2 == NULL))
+	return false;
+      if (! same_ops (ops1, nops1, ops2, nops2))
+	return false;
+    }
+  return true;
+}
+
+static void
+check_cfi (Elf *elf, const char *what, Dwarf_CFI *cfi)
+{
+  if (cfi == NULL)
+    {
+      printf ("%s: none\n", what);
+      return;
+    }
+
+  /* The FDEs of different sections overlap in relocatable files,
+     so addresses don't identify a single frame.  */
+  GElf_Ehdr ehdr_mem, *ehdr = gelf_getehdr (elf, &ehdr_mem);
+  if (ehdr == NULL || ehdr->e_type == ET_REL)
+    {
+      printf ("%s: relocatable\n", what);
+      return;
+    }
+
+  Dwarf_Addr *addrs = NULL;
+  size_t naddrs = 0;
+  Elf_Scn *scn = NULL;
+  while ((scn = elf_nextscn (elf, scn)) != NULL)
+    {
+      GElf_Shdr shdr_mem, *shdr = gelf_getshdr (scn, &shdr_mem);
+      if (shdr == NULL || shdr->sh_type != SHT_SYMTAB || shdr->sh_entsize == 0)
+	continue;
+
+      Elf_Data *data = elf_getdata (scn, NULL);
+      size_t nsyms = shdr->sh_size / shdr->sh_entsize;
+      for (size_t i = 0; data != NULL && i < nsyms; i++)
+	{
+	  GElf_Sym sym_mem, *sym = gelf_getsym (data, i, &sym_mem);
+	  if (sym == NULL || GELF_ST_TYPE (sym->st_info) != STT_FUNC
+	      || sym->st_shndx == SHN_UNDEF)
+	    continue;
+
+	  addrs = realloc (addrs, (naddrs + 2) * sizeof addrs[0]);
+	  if (addrs == NULL)
+	    {
+	      printf ("%s: out of memory\n", what);
+	      exit (-1);
+	    }
+	  addrs[naddrs++] = sym->st_value;
+	  addrs[naddrs++] = sym->st_value + sym->st_size / 2;
+	}
+    }
+
+  Dwarf_Frame **frames = calloc (naddrs + 1, sizeof frames[0]);
+  if (frames == NULL)
+    {
+      printf ("%s: out of memory\n", what);
+      exit (-1);
+    }
+
+  size_t nframes = 0;
+  for (size_t i = 0; i < naddrs; i++)
+    if (dwarf_cfi_addrframe (cfi, addrs[i], &frames[i]) == 0)
+      nframes++;
+    else
+      frames[i] = NULL;
+
+  uint64_t hits1, misses1;
+  if (dwarf_cfi_frame_cache_stats (cfi, &hits1, &misses1) != 0)
+    errors++;
+
+  for (size_t i = 0; i < naddrs; i++)
+    {
+      Dwarf_Frame *frame;
+      int res = dwarf_cfi_addrframe (cfi, addrs[i], &frame);
+      if ((res == 0) != (frames[i] != NULL)
+	  || (res == 0 && ! same_frame (frames[i], frame)))
+	{
+	  if (errors++ < 10)
+	    printf ("%#" PRIx64 ": frame differs on second lookup\n", addrs[i]);
+	}
+      if (res == 0)
+	free (frame);
+      free (frames[i]);
+    }
+
+  uint64_t hits2, misses2;
+  if (dwarf_cfi_frame_cache_stats (cfi, &hits2, &misses2) != 0)
+    errors++;
+  if (hits1 + misses1 != naddrs || hits2 + misses2 != 2 * naddrs)
+    {
+      printf ("%s: %" PRIu64 " hits and %" PRIu64 " misses for %zu lookups\n",
+	      what, hits2, misses2, 2 * naddrs);
+      errors++;
+    }
+
+  printf ("%s: %zu addresses, %zu with frame,"
+	  " %" PRIu64 " and %" PRIu64 " hits\n",
+	  what, naddrs, nframes, hits1, hits2 - hits1);
+
+  free (frames);
+  free (addrs);
+}
+
+int
+main (int argc, char *argv[])
+{
+  if (argc != 2)
+    {
+      printf ("usage: %s FILE\n", argv[0]);
+      return -1;
+    }
+
+  const char *name = argv[1];
+  int fd = open (name, O_RDONLY);
+  if (fd < 0)
+    {
+      printf ("Cannnot open '%s': %s\n", name, strerror (errno));
+      return -1;
+    }
+
+  elf_version (EV_CURRENT);
+  Elf *elf = elf_begin (fd, ELF_C_READ, NULL);
+  if (elf == NULL)
+    {
+      printf ("Not an ELF file: %s\n", elf_errmsg (-1));
+      return -1;
+    }
+
+  Dwarf_CFI *eh = dwarf_getcfi_elf (elf);
+  check_cfi (elf, ".eh_frame", eh);
+  dwarf_cfi_end (eh);
+
+  Dwarf *dbg = dwarf_begin_elf (elf, DWARF_C_READ, NULL);
+  check_cfi (elf, ".debug_frame", dwarf_getcfi (dbg));
+  dwarf_end (dbg);
+
+  elf_end (elf);
+  close (fd);
+  return errors == 0 ? 0 : -1;
+}
@@ -0,0 +1,193 @@
+/* Test and benchmark looking up DIEs by offset in many CUs.
+   This file is part of elfutils.
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   elfutils is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#include <config.h>
+#include ELFUTILS_HEADER(dw)
+#include <dwarf.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Checks that dwarf_offdie finds the right CU for every DIE, in an
+   order that isn't the order in which the units are read.  With -t
+   the lookups are repeated and timed, which makes this a benchmark
+   for files with many CUs.  */
+
+struct die_ref
+{
+  Dwarf_Off die_off;
+  Dwarf_Off cu_off;
+  bool types;
+};
+
+static struct die_ref *refs;
+static size_t nrefs;
+static size_t arefs;
+
+static void
+add_ref (Dwarf_Die *die, Dwarf_Off cu_off, bool types)
+{
+  if (nrefs == arefs)
+    {
+      arefs = arefs == 0 ? 1024 : 2 * arefs;
+      refs = realloc (refs, arefs * sizeof refs[0]);
+      if (refs == NULL)
+	{
+	  printf ("Out of memory\n");
+	  exit (-1);
+	}
+    }
+  refs[nrefs].die_off = dwarf_dieoffset (die);
+  refs[nrefs].cu_off = cu_off;
+  refs[nrefs].types = types;
+  nrefs++;
+}
+
+static void
+collect_dies (Dwarf_Die *die, Dwarf_Off cu_off, bool types)
+{
+  do
+    {
+      add_ref (die, cu_off, types);
+      Dwarf_Die child;
+      if (dwarf_child (die, &child) == 0)
+	collect_dies (&child, cu_off, types);
+    }
+  while (dwarf_siblingof (die, die) == 0);
+}
+
+static int
+check_lookups (Dwarf *dbg)
+{
+  int res = 0;
+
+  /* Go from the last DIE to the first, with a stride, so the units
+     aren't looked up in order.  */
+  size_t stride = nrefs > 7 ? 7 : 1;
+  for (size_t start = 0; start < stride; start++)
+    for (size_t i = nrefs - 1 - start; i < nrefs; i -= stride)
+      {
+	struct die_ref *ref = &refs[i];
+	Dwarf_Die die, cudie;
+	if ((ref->types
+	     ? dwarf_offdie_types (dbg, ref->die_off, &die)
+	     : dwarf_offdie (dbg, ref->die_off, &die)) == NULL
+	    || dwarf_diecu (&die, &cudie, NULL, NULL) == NULL)
+	  {
+	    printf ("Cannot look up DIE at %" PRIx64 ": %s\n",
+		    ref->die_off, dwarf_errmsg (-1));
+	    res = -1;
+	  }
+	else if (dwarf_dieoffset (&cudie) != ref->cu_off)
+	  {
+	    printf ("Wrong CU %" PRIx64 " for DIE at %" PRIx64 "\n",
+		    dwarf_dieoffset (&cudie), ref->die_off);
+	    res = -1;
+	  }
+      }
+
+  return res;
+}
+
+int
+main (int argc, char *argv[])
+{
+  bool timed = false;
+  int iterations = 1;
+  int argi = 1;
+  if (argi < argc && strcmp (argv[argi], "-t") == 0)
+    {
+      timed = true;
+      iterations = 100;
+      argi++;
+    }
+
+  if (argi >= argc)
+    {
+      printf ("No file given.\n");
+      return -1;
+    }
+
+  const char *name = argv[argi];
+  int fd = open (name, O_RDONLY);
+  if (fd < 0)
+    {
+      printf ("Cannnot open '%s': %s\n", name, strerror (errno));
+      return -1;
+    }
+
+  Dwarf *dbg = dwarf_begin (fd, DWARF_C_READ);
+  if (dbg == NULL)
+    {
+      printf ("Not a Dwarf file '%s': %s\n", name, dwarf_errmsg (-1));
+      close (fd);
+      return -1;
+    }
+
+  size_t nunits = 0;
+  Dwarf_CU *cu = NULL;
+  Dwarf_Half version;
+  uint8_t unit_type;
+  Dwarf_Die cudie;
+  while (dwarf_get_units (dbg, cu, &cu, &version, &unit_type,
+			  &cudie, NULL) == 0)
+    {
+      nunits++;
+      if (dwarf_tag (&cudie) != DW_TAG_invalid)
+	collect_dies (&cudie, dwarf_dieoffset (&cudie),
+		      version == 4 && unit_type == DW_UT_type);
+    }
+  dwarf_end (dbg);
+
+  printf ("%s: %zu units, %zu DIEs\n", name, nunits, nrefs);
+
+  /* Use a new Dwarf, so the first lookups have to read the units.  */
+  dbg = dwarf_begin (fd, DWARF_C_READ);
+  if (dbg == NULL)
+    {
+      printf ("Not a Dwarf file '%s': %s\n", name, dwarf_errmsg (-1));
+      close (fd);
+      return -1;
+    }
+
+  int res = 0;
+  struct timespec start, end;
+  clock_gettime (CLOCK_MONOTONIC, &start);
+  for (int i = 0; i < iterations && res == 0; i++)
+    res = check_lookups (dbg);
+  clock_gettime (CLOCK_MONOTONIC, &end);
+
+  if (timed && nrefs > 0)
+    {
+      double ns = ((end.tv_sec - start.tv_sec) * 1e9
+		   + (end.tv_nsec - start.tv_nsec));
+      fprintf (stderr, "%d x %zu lookups, %.1f ns per lookup\n",
+	       iterations, nrefs, ns / ((double) iterations * nrefs));
+    }
+
+  dwarf_end (dbg);
+  close (fd);
+  free (refs);
+
+  return res;
+}
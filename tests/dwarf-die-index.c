@@ -0,0 +1,308 @@
+/* Check dwarf_cu_build_die_index and repeated sibling walks.
+   This file is part of elfutils.
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   elfutils is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#include <config.h>
+#include ELFUTILS_HEADER(dw)
+#include <dwarf.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Walks all DIEs with dwarf_child and dwarf_siblingof and checks the
+   DIE index of the unit describes the same tree.  Then walks the
+   children of every DIE with children again, which must give the same
+   DIEs now that the subtree ends are known.  Last the scopes of every
+   DIE and of the start address of every DIE with one are compared
+   with those found in a second Dwarf without DIE indexes.  With -t the
+   walk over the top level DIEs of all units is timed.  */
+
+static const Dwarf_Die_Index *die_index;
+static size_t next_die;
+static int errors;
+
+static void
+error_at (Dwarf_Die *die, const char *what)
+{
+  if (errors++ < 10)
+    printf ("DIE %#" PRIx64 ": %s\n", dwarf_dieoffset (die), what);
+}
+
+/* Checks DIE and its children against the DIE index.  Returns the
+   number of DIE in the index.  */
+static size_t
+check_die (Dwarf_Die *die, size_t parent, unsigned int depth)
+{
+  size_t n = next_die++;
+  if (n >= die_index->count)
+    {
+      error_at (die, "not in index");
+      return n;
+    }
+  if (die_index->offset[n] != dwarf_dieoffset (die))
+    error_at (die, "wrong offset");
+  if (die_index->parent[n] != parent)
+    error_at (die, "wrong parent");
+  if (die_index->tag[n] != dwarf_tag (die))
+    error_at (die, "wrong tag");
+  if (die_index->depth[n] != depth)
+    error_at (die, "wrong depth");
+
+  Dwarf_Die indexed;
+  if (dwarf_die_index_die (die_index, n, &indexed) == NULL
+      || indexed.addr != die->addr
+      || dwarf_haschildren (&indexed) != dwarf_haschildren (die))
+    error_at (die, "wrong DIE");
+
+  Dwarf_Die child;
+  if (dwarf_child (die, &child) == 0)
+    {
+      size_t prev = (size_t) -1;
+      do
+	{
+	  size_t c = check_die (&child, n, depth + 1);
+	  if (prev != (size_t) -1 && die_index->sibling[prev] != c)
+	    error_at (&child, "wrong sibling");
+	  prev = c;
+	}
+      while (dwarf_siblingof (&child, &child) == 0);
+      if (prev != (size_t) -1 && die_index->sibling[prev] != (size_t) -1)
+	error_at (die, "last child has sibling");
+    }
+
+  return n;
+}
+
+/* Walks the children of every DIE with children again and compares
+   with the index.  */
+static void
+check_siblings (Dwarf *dbg, bool types)
+{
+  for (size_t i = 0; i < die_index->count; i++)
+    {
+      Dwarf_Die die, child;
+      if ((types
+	   ? dwarf_offdie_types (dbg, die_index->offset[i], &die)
+	   : dwarf_offdie (dbg, die_index->offset[i], &die)) == NULL)
+	{
+	  printf ("no DIE at %#" PRIx64 "\n", die_index->offset[i]);
+	  errors++;
+	  continue;
+	}
+      if (dwarf_child (&die, &child) != 0)
+	continue;
+      size_t c = i + 1;
+      do
+	{
+	  if (c == (size_t) -1
+	      || dwarf_dieoffset (&child) != die_index->offset[c])
+	    error_at (&child, "wrong sibling on second walk");
+	  else
+	    c = die_index->sibling[c];
+	}
+      while (dwarf_siblingof (&child, &child) == 0);
+      if (c != (size_t) -1)
+	error_at (&die, "missing siblings on second walk");
+    }
+}
+
+static size_t nscopes;
+
+/* Compares scopes found with and without the index.  */
+static void
+compare_scopes (Dwarf_Die *die, const char *what,
+		int n, Dwarf_Die *scopes, int plain_n, Dwarf_Die *plain_scopes)
+{
+  if (n != plain_n)
+    error_at (die, what);
+  else if (n > 0)
+    {
+      for (int i = 0; i < n; i++)
+	if (dwarf_dieoffset (&scopes[i]) != dwarf_dieoffset (&plain_scopes[i]))
+	  {
+	    error_at (die, what);
+	    break;
+	  }
+      nscopes += n;
+    }
+  if (n > 0)
+    free (scopes);
+  if (plain_n > 0)
+    free (plain_scopes);
+}
+
+/* Compares dwarf_getscopes_die for all DIEs and dwarf_getscopes for
+   the low PC of all DIEs that have one with the results from PLAIN,
+   which has no DIE indexes.  */
+static void
+check_scopes (Dwarf *plain, bool types, Dwarf_Die *cudie)
+{
+  Dwarf_Die plain_cudie;
+  if (dwarf_offdie (plain, dwarf_dieoffset (cudie), &plain_cudie) == NULL
+      && dwarf_offdie_types (plain, dwarf_dieoffset (cudie),
+			     &plain_cudie) == NULL)
+    {
+      error_at (cudie, "no plain unit DIE");
+      return;
+    }
+
+  for (size_t i = 0; i < die_index->count; i++)
+    {
+      Dwarf_Die die, plain_die;
+      dwarf_die_index_die (die_index, i, &die);
+      if ((types
+	   ? dwarf_offdie_types (plain, die_index->offset[i], &plain_die)
+	   : dwarf_offdie (plain, die_index->offset[i], &plain_die)) == NULL)
+	{
+	  error_at (&die, "no plain DIE");
+	  continue;
+	}
+
+      Dwarf_Die *scopes, *plain_scopes;
+      int n = dwarf_getscopes_die (&die, &scopes);
+      int plain_n = dwarf_getscopes_die (&plain_die, &plain_scopes);
+      compare_scopes (&die, "wrong DIE scopes", n, scopes,
+		      plain_n, plain_scopes);
+
+      Dwarf_Addr pc;
+      if (dwarf_lowpc (&die, &pc) == 0)
+	{
+	  n = dwarf_getscopes (cudie, pc, &scopes);
+	  plain_n = dwarf_getscopes (&plain_cudie, pc, &plain_scopes);
+	  compare_scopes (&die, "wrong PC scopes", n, scopes,
+			  plain_n, plain_scopes);
+	}
+    }
+}
+
+static size_t
+walk_top (Dwarf *dbg)
+{
+  size_t n = 0;
+  Dwarf_CU *cu = NULL;
+  Dwarf_Die cudie, child;
+  while (dwarf_get_units (dbg, cu, &cu, NULL, NULL, &cudie, NULL) == 0)
+    if (dwarf_child (&cudie, &child) == 0)
+      do
+	n++;
+      while (dwarf_siblingof (&child, &child) == 0);
+  return n;
+}
+
+int
+main (int argc, char *argv[])
+{
+  bool timed = false;
+  int argi = 1;
+  if (argi < argc && strcmp (argv[argi], "-t") == 0)
+    {
+      timed = true;
+      argi++;
+    }
+
+  if (argi >= argc)
+    {
+      printf ("usage: %s [-t] FILE\n", argv[0]);
+      return -1;
+    }
+
+  const char *name = argv[argi];
+  int fd = open (name, O_RDONLY);
+  if (fd < 0)
+    {
+      printf ("Cannnot open '%s': %s\n", name, strerror (errno));
+      return -1;
+    }
+
+  Dwarf *dbg = dwarf_begin (fd, DWARF_C_READ);
+  if (dbg == NULL)
+    {
+      printf ("Not a Dwarf file: %s\n", dwarf_errmsg (-1));
+      return -1;
+    }
+
+  Dwarf *plain = dwarf_begin (fd, DWARF_C_READ);
+  if (plain == NULL)
+    {
+      printf ("Not a Dwarf file: %s\n", dwarf_errmsg (-1));
+      return -1;
+    }
+
+  if (timed)
+    {
+      /* The first walk has to skip over all children, the second
+	 knows where the subtrees end.  */
+      double ns[2];
+      size_t top = 0;
+      for (int i = 0; i < 2; i++)
+	{
+	  struct timespec start, end;
+	  clock_gettime (CLOCK_MONOTONIC, &start);
+	  top = walk_top (dbg);
+	  clock_gettime (CLOCK_MONOTONIC, &end);
+	  ns[i] = ((end.tv_sec - start.tv_sec) * 1e9
+		   + (end.tv_nsec - start.tv_nsec));
+	}
+      fprintf (stderr, "%zu top level DIEs, first walk %.0f us,"
+	       " second walk %.0f us\n", top, ns[0] / 1000, ns[1] / 1000);
+    }
+
+  size_t units = 0;
+  size_t dies = 0;
+  Dwarf_CU *cu = NULL;
+  Dwarf_Half version;
+  uint8_t unit_type;
+  Dwarf_Die cudie;
+  while (dwarf_get_units (dbg, cu, &cu, &version, &unit_type,
+			  &cudie, NULL) == 0)
+    {
+      units++;
+      if (dwarf_cu_die_index (cu) != NULL)
+	error_at (&cudie, "index before it was built");
+      die_index = dwarf_cu_build_die_index (cu);
+      if (die_index == NULL)
+	{
+	  printf ("dwarf_cu_build_die_index: %s\n", dwarf_errmsg (-1));
+	  return -1;
+	}
+      if (dwarf_cu_build_die_index (cu) != die_index
+	  || dwarf_cu_die_index (cu) != die_index)
+	error_at (&cudie, "index built twice");
+
+      next_die = 0;
+      if (dwarf_tag (&cudie) != DW_TAG_invalid)
+	check_die (&cudie, (size_t) -1, 0);
+      if (next_die != die_index->count)
+	error_at (&cudie, "wrong number of DIEs");
+      dies += die_index->count;
+
+      bool types = version < 5 && unit_type == DW_UT_type;
+      check_siblings (dbg, types);
+      check_scopes (plain, types, &cudie);
+    }
+
+  printf ("%zu units, %zu DIEs, %zu scopes\n", units, dies, nscopes);
+
+  dwarf_end (plain);
+  dwarf_end (dbg);
+  close (fd);
+  return errors == 0 ? 0 : -1;
+}
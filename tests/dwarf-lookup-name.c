@@ -0,0 +1,97 @@
+/* Test program for dwarf_lookup_name.
+   This file is part of elfutils.
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   elfutils is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif
+
+#include <fcntl.h>
+#include <libelf.h>
+#include ELFUTILS_HEADER(dw)
+#include <stdio.h>
+#include <unistd.h>
+
+
+static int
+callback (Dwarf *dbg, Dwarf_Global *gl, void *arg __attribute__ ((unused)))
+{
+  int result = DWARF_CB_OK;
+
+  printf (" \"%s\", die: %llu, cu: %llu\n",
+	  gl->name, (unsigned long long int) gl->die_offset,
+	  (unsigned long long int) gl->cu_offset);
+
+  Dwarf_Die cu_die;
+  const char *cuname;
+  if (dwarf_offdie (dbg, gl->cu_offset, &cu_die) == NULL
+      || (cuname = dwarf_diename (&cu_die)) == NULL)
+    {
+      puts ("failed to get CU die");
+      result = DWARF_CB_ABORT;
+    }
+  else
+    printf ("CU name: \"%s\"\n", cuname);
+
+  Dwarf_Die die;
+  if (dwarf_offdie (dbg, gl->die_offset, &die) == NULL)
+    {
+      puts ("failed to get object die");
+      result = DWARF_CB_ABORT;
+    }
+  else
+    printf ("tag: 0x%x\n", dwarf_tag (&die));
+
+  return result;
+}
+
+
+int
+main (int argc, char *argv[])
+{
+  if (argc < 3)
+    {
+      fprintf (stderr, "usage: %s FILE NAME...\n", argv[0]);
+      return 1;
+    }
+
+  int fd = open (argv[1], O_RDONLY);
+  Dwarf *dbg = dwarf_begin (fd, DWARF_C_READ);
+  if (dbg == NULL)
+    {
+      printf ("%s not usable: %s\n", argv[1], dwarf_errmsg (-1));
+      close (fd);
+      return 1;
+    }
+
+  int result = 0;
+  for (int cnt = 2; cnt < argc; ++cnt)
+    {
+      printf ("%s:\n", argv[cnt]);
+      int n = dwarf_lookup_name (dbg, argv[cnt], callback, NULL);
+      if (n < 0)
+	{
+	  printf ("dwarf_lookup_name failed: %s\n", dwarf_errmsg (-1));
+	  result = 1;
+	}
+      else
+	printf ("%d found\n", n);
+    }
+
+  dwarf_end (dbg);
+  close (fd);
+
+  return result;
+}
@@ -0,0 +1,214 @@
+/* Multi-threaded libdw allocation test and benchmark.
+   This file is part of elfutils.
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   elfutils is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#include <config.h>
+#include ELFUTILS_HEADER(dw)
+#include <dwarf.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Threads share one Dwarf and each takes units from a shared counter.
+   For every DIE all location expressions and lists are decoded, which
+   allocates from the thread's libdw memory blocks.  With -t this is
+   repeated with a fresh Dwarf and timed.  */
+
+struct state
+{
+  Dwarf_CU **cus;
+  size_t ncus;
+  size_t next;
+  pthread_mutex_t lock;
+};
+
+struct counts
+{
+  size_t dies;
+  size_t exprs;
+};
+
+static int
+attr_cb (Dwarf_Attribute *attr, void *arg)
+{
+  struct counts *counts = arg;
+  Dwarf_Addr base, start, end;
+  Dwarf_Op *expr;
+  size_t exprlen;
+  ptrdiff_t off = 0;
+  while ((off = dwarf_getlocations (attr, off, &base, &start, &end,
+				    &expr, &exprlen)) > 0)
+    counts->exprs++;
+  return DWARF_CB_OK;
+}
+
+static void
+walk_dies (Dwarf_Die *die, struct counts *counts)
+{
+  do
+    {
+      counts->dies++;
+      dwarf_getattrs (die, attr_cb, counts, 0);
+      Dwarf_Die child;
+      if (dwarf_child (die, &child) == 0)
+	walk_dies (&child, counts);
+    }
+  while (dwarf_siblingof (die, die) == 0);
+}
+
+static void *
+worker (void *arg)
+{
+  struct state *state = arg;
+  struct counts *counts = calloc (1, sizeof *counts);
+  if (counts == NULL)
+    return NULL;
+
+  while (1)
+    {
+      pthread_mutex_lock (&state->lock);
+      size_t idx = state->next++;
+      pthread_mutex_unlock (&state->lock);
+      if (idx >= state->ncus)
+	break;
+
+      Dwarf_Die cudie;
+      if (dwarf_cu_info (state->cus[idx], NULL, NULL, &cudie,
+			 NULL, NULL, NULL, NULL) == 0
+	  && dwarf_tag (&cudie) != DW_TAG_invalid)
+	walk_dies (&cudie, counts);
+    }
+
+  return counts;
+}
+
+static int
+run (int fd, unsigned int nthreads, struct counts *total)
+{
+  Dwarf *dbg = dwarf_begin (fd, DWARF_C_READ);
+  if (dbg == NULL)
+    {
+      printf ("Not a Dwarf file: %s\n", dwarf_errmsg (-1));
+      return -1;
+    }
+
+  struct state state = { .cus = NULL, .ncus = 0, .next = 0 };
+  pthread_mutex_init (&state.lock, NULL);
+  size_t nalloc = 0;
+  Dwarf_CU *cu = NULL;
+  while (dwarf_get_units (dbg, cu, &cu, NULL, NULL, NULL, NULL) == 0)
+    {
+      if (state.ncus == nalloc)
+	{
+	  nalloc = nalloc == 0 ? 64 : 2 * nalloc;
+	  state.cus = realloc (state.cus, nalloc * sizeof state.cus[0]);
+	  if (state.cus == NULL)
+	    {
+	      printf ("Out of memory\n");
+	      return -1;
+	    }
+	}
+      state.cus[state.ncus++] = cu;
+    }
+
+  pthread_t *threads = malloc (nthreads * sizeof threads[0]);
+  if (threads == NULL)
+    {
+      printf ("Out of memory\n");
+      return -1;
+    }
+  for (unsigned int i = 0; i < nthreads; i++)
+    if (pthread_create (&threads[i], NULL, worker, &state) != 0)
+      {
+	printf ("Cannot create thread\n");
+	return -1;
+      }
+
+  total->dies = total->exprs = 0;
+  for (unsigned int i = 0; i < nthreads; i++)
+    {
+      struct counts *counts;
+      pthread_join (threads[i], (void **) &counts);
+      if (counts != NULL)
+	{
+	  total->dies += counts->dies;
+	  total->exprs += counts->exprs;
+	  free (counts);
+	}
+    }
+
+  free (threads);
+  free (state.cus);
+  pthread_mutex_destroy (&state.lock);
+  dwarf_end (dbg);
+  return 0;
+}
+
+int
+main (int argc, char *argv[])
+{
+  bool timed = false;
+  unsigned int nthreads = 4;
+  int argi = 1;
+  while (argi < argc && argv[argi][0] == '-')
+    {
+      if (strcmp (argv[argi], "-t") == 0)
+	timed = true;
+      else if (strcmp (argv[argi], "-j") == 0 && argi + 1 < argc)
+	nthreads = atoi (argv[++argi]);
+      argi++;
+    }
+
+  if (argi >= argc || nthreads == 0)
+    {
+      printf ("usage: %s [-t] [-j THREADS] FILE\n", argv[0]);
+      return -1;
+    }
+
+  const char *name = argv[argi];
+  int fd = open (name, O_RDONLY);
+  if (fd < 0)
+    {
+      printf ("Cannnot open '%s': %s\n", name, strerror (errno));
+      return -1;
+    }
+
+  int iterations = timed ? 20 : 1;
+  struct counts counts;
+  struct timespec start, end;
+  clock_gettime (CLOCK_MONOTONIC, &start);
+  for (int i = 0; i < iterations; i++)
+    if (run (fd, nthreads, &counts) != 0)
+      return -1;
+  clock_gettime (CLOCK_MONOTONIC, &end);
+
+  printf ("%zu DIEs, %zu location expressions\n", counts.dies, counts.exprs);
+  if (timed)
+    {
+      double ms = ((end.tv_sec - start.tv_sec) * 1e3
+		   + (end.tv_nsec - start.tv_nsec) / 1e6);
+      fprintf (stderr, "%d threads, %.2f ms per run\n",
+	       nthreads, ms / iterations);
+    }
+
+  close (fd);
+  return 0;
+}
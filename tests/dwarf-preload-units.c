@@ -0,0 +1,198 @@
+/* Test program for dwarf_preload_units.
+   This file is part of elfutils.
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   elfutils is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#include <config.h>
+#include ELFUTILS_HEADER(dw)
+#include <dwarf.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+/* Compares everything that dwarf_preload_units decodes between a
+   Dwarf that was preloaded and one that wasn't.  With -l only the
+   line tables are preloaded with dwarf_preload_srclines.  */
+
+static size_t
+count_dies (Dwarf_Die *die)
+{
+  size_t n = 0;
+  do
+    {
+      n++;
+      Dwarf_Die child;
+      if (dwarf_child (die, &child) == 0)
+	n += count_dies (&child);
+    }
+  while (dwarf_siblingof (die, die) == 0);
+  return n;
+}
+
+static int
+check_unit (Dwarf_Die *die1, Dwarf_Die *die2,
+	    size_t *ndies, size_t *nlines)
+{
+  if (dwarf_dieoffset (die1) != dwarf_dieoffset (die2)
+      || dwarf_tag (die1) != dwarf_tag (die2))
+    {
+      printf ("units at %" PRIx64 " and %" PRIx64 " differ\n",
+	      dwarf_dieoffset (die1), dwarf_dieoffset (die2));
+      return -1;
+    }
+
+  Dwarf_Die d1 = *die1, d2 = *die2;
+  size_t n1 = count_dies (&d1);
+  size_t n2 = count_dies (&d2);
+  if (n1 != n2)
+    {
+      printf ("unit at %" PRIx64 " has %zu and %zu DIEs\n",
+	      dwarf_dieoffset (die1), n1, n2);
+      return -1;
+    }
+  *ndies += n1;
+
+  Dwarf_Lines *lines1, *lines2;
+  size_t nlines1, nlines2;
+  int res1 = dwarf_getsrclines (die1, &lines1, &nlines1);
+  int res2 = dwarf_getsrclines (die2, &lines2, &nlines2);
+  if (res1 != res2 || (res1 == 0 && nlines1 != nlines2))
+    {
+      printf ("unit at %" PRIx64 " has different lines\n",
+	      dwarf_dieoffset (die1));
+      return -1;
+    }
+
+  if (res1 == 0)
+    for (size_t i = 0; i < nlines1; i++)
+      {
+	Dwarf_Line *l1 = dwarf_onesrcline (lines1, i);
+	Dwarf_Line *l2 = dwarf_onesrcline (lines2, i);
+	Dwarf_Addr a1, a2;
+	int no1, no2;
+	bool end1, end2;
+	if (dwarf_lineaddr (l1, &a1) != 0 || dwarf_lineaddr (l2, &a2) != 0
+	    || dwarf_lineno (l1, &no1) != 0 || dwarf_lineno (l2, &no2) != 0
+	    || dwarf_lineendsequence (l1, &end1) != 0
+	    || dwarf_lineendsequence (l2, &end2) != 0
+	    || a1 != a2 || no1 != no2 || end1 != end2
+	    || strcmp (dwarf_linesrc (l1, NULL, NULL),
+		       dwarf_linesrc (l2, NULL, NULL)) != 0)
+	  {
+	    printf ("unit at %" PRIx64 " line %zu differs\n",
+		    dwarf_dieoffset (die1), i);
+	    return -1;
+	  }
+	(*nlines)++;
+      }
+
+  return 0;
+}
+
+int
+main (int argc, char *argv[])
+{
+  unsigned int nthreads = 0;
+  bool lines_only = false;
+  int argi = 1;
+  if (argi + 1 < argc && strcmp (argv[argi], "-j") == 0)
+    {
+      nthreads = atoi (argv[argi + 1]);
+      argi += 2;
+    }
+  if (argi < argc && strcmp (argv[argi], "-l") == 0)
+    {
+      lines_only = true;
+      argi++;
+    }
+
+  if (argi >= argc)
+    {
+      printf ("No file given.\n");
+      return -1;
+    }
+
+  const char *name = argv[argi];
+  int fd = open (name, O_RDONLY);
+  if (fd < 0)
+    {
+      printf ("Cannnot open '%s': %s\n", name, strerror (errno));
+      return -1;
+    }
+
+  Dwarf *dbg1 = dwarf_begin (fd, DWARF_C_READ);
+  Dwarf *dbg2 = dwarf_begin (fd, DWARF_C_READ);
+  if (dbg1 == NULL || dbg2 == NULL)
+    {
+      printf ("Not a Dwarf file '%s': %s\n", name, dwarf_errmsg (-1));
+      close (fd);
+      return -1;
+    }
+
+  if (lines_only)
+    {
+      if (dwarf_preload_srclines (dbg1, nthreads) != 0)
+	{
+	  printf ("dwarf_preload_srclines failed: %s\n", dwarf_errmsg (-1));
+	  return -1;
+	}
+    }
+  else if (dwarf_preload_units (dbg1, nthreads) != 0)
+    {
+      printf ("dwarf_preload_units failed: %s\n", dwarf_errmsg (-1));
+      return -1;
+    }
+
+  int res = 0;
+  size_t nunits = 0, ndies = 0, nlines = 0;
+  Dwarf_CU *cu1 = NULL, *cu2 = NULL;
+  Dwarf_Die cudie1, cudie2, subdie1, subdie2;
+  uint8_t unit_type;
+  while (res == 0
+	 && dwarf_get_units (dbg1, cu1, &cu1, NULL, &unit_type,
+			     &cudie1, &subdie1) == 0)
+    {
+      if (dwarf_get_units (dbg2, cu2, &cu2, NULL, NULL,
+			   &cudie2, &subdie2) != 0)
+	{
+	  printf ("missing unit\n");
+	  res = -1;
+	  break;
+	}
+
+      nunits++;
+      res = check_unit (&cudie1, &cudie2, &ndies, &nlines);
+
+      /* Also check the split units of skeletons.  */
+      if (res == 0 && unit_type == DW_UT_skeleton
+	  && dwarf_tag (&subdie1) != DW_TAG_invalid)
+	{
+	  nunits++;
+	  res = check_unit (&subdie1, &subdie2, &ndies, &nlines);
+	}
+    }
+
+  if (res == 0)
+    printf ("%zu units, %zu DIEs, %zu lines\n", nunits, ndies, nlines);
+
+  dwarf_end (dbg1);
+  dwarf_end (dbg2);
+  close (fd);
+
+  return res;
+}
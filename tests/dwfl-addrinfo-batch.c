@@ -0,0 +1,176 @@
+/* Test program for dwfl_addrinfo_batch.
+   This file is part of elfutils.
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   elfutils is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#include <config.h>
+#include <assert.h>
+#include <inttypes.h>
+#include ELFUTILS_HEADER(dw)
+#include ELFUTILS_HEADER(dwfl)
+#include <dwarf.h>
+#include <argp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "system.h"
+
+static Dwarf_Addr *addrs;
+static size_t naddrs;
+static size_t addrs_alloc;
+
+static void
+add_addr (Dwarf_Addr addr)
+{
+  if (naddrs == addrs_alloc)
+    {
+      addrs_alloc = addrs_alloc == 0 ? 1024 : 2 * addrs_alloc;
+      addrs = realloc (addrs, addrs_alloc * sizeof addrs[0]);
+      assert (addrs != NULL);
+    }
+  addrs[naddrs++] = addr;
+}
+
+static int
+collect_addrs (Dwfl_Module *mod, void **userdata __attribute__ ((unused)),
+	       const char *name __attribute__ ((unused)),
+	       Dwarf_Addr start, void *arg __attribute__ ((unused)))
+{
+  int syms = dwfl_module_getsymtab (mod);
+  for (int i = 0; i < syms; i++)
+    {
+      GElf_Sym sym;
+      GElf_Addr value;
+      if (dwfl_module_getsym_info (mod, i, &sym, &value,
+				   NULL, NULL, NULL) != NULL)
+	{
+	  add_addr (value);
+	  add_addr (value + 1);
+	}
+    }
+
+  Dwarf_Addr bias;
+  Dwarf_Die *cu = NULL;
+  while ((cu = dwfl_module_nextcu (mod, cu, &bias)) != NULL)
+    {
+      size_t nlines;
+      if (dwfl_getsrclines (cu, &nlines) != 0)
+	continue;
+      for (size_t i = 0; i < nlines; i++)
+	{
+	  Dwarf_Addr addr;
+	  if (dwfl_lineinfo (dwfl_onesrcline (cu, i), &addr,
+			     NULL, NULL, NULL, NULL) != NULL)
+	    {
+	      add_addr (addr);
+	      add_addr (addr + 3);
+	    }
+	}
+    }
+
+  add_addr (start - 1);
+  return DWARF_CB_OK;
+}
+
+/* Check INFO against what the one address at a time functions say.  */
+static void
+check_addr (Dwfl *dwfl, Dwarf_Addr addr, Dwfl_Addrinfo *info)
+{
+  Dwfl_Module *mod = dwfl_addrmodule (dwfl, addr);
+  if (mod != info->module)
+    error (EXIT_FAILURE, 0, "%#" PRIx64 ": module mismatch", addr);
+  if (mod == NULL)
+    {
+      assert (info->symbol == NULL && info->line == NULL);
+      return;
+    }
+
+  GElf_Off off = 0;
+  GElf_Sym sym;
+  const char *name = dwfl_module_addrinfo (mod, addr, &off, &sym,
+					   NULL, NULL, NULL);
+  if (name != info->symbol || (name != NULL && off != info->offset))
+    error (EXIT_FAILURE, 0, "%#" PRIx64 ": symbol mismatch", addr);
+
+  Dwfl_Line *line = dwfl_module_getsrc (mod, addr);
+  if (line != info->line)
+    error (EXIT_FAILURE, 0, "%#" PRIx64 ": line mismatch", addr);
+  if (line != NULL)
+    {
+      int lineno, col;
+      const char *file = dwfl_lineinfo (line, NULL, &lineno, &col,
+					NULL, NULL);
+      if (file != info->file || lineno != info->lineno
+	  || col != info->column)
+	error (EXIT_FAILURE, 0, "%#" PRIx64 ": lineinfo mismatch", addr);
+    }
+
+  Dwarf_Addr bias;
+  Dwarf_Die *cudie = dwfl_module_addrdie (mod, addr, &bias);
+  Dwarf_Die *scopes = NULL;
+  int nscopes = (cudie == NULL ? 0
+		 : dwarf_getscopes (cudie, addr - bias, &scopes));
+  if (nscopes < 0)
+    nscopes = 0;
+  if (nscopes != info->nscopes)
+    error (EXIT_FAILURE, 0, "%#" PRIx64 ": nscopes mismatch", addr);
+  for (int i = 0; i < nscopes; i++)
+    if (dwarf_dieoffset (&scopes[i]) != dwarf_dieoffset (&info->scopes[i]))
+      error (EXIT_FAILURE, 0, "%#" PRIx64 ": scope mismatch", addr);
+  free (scopes);
+}
+
+int
+main (int argc, char *argv[])
+{
+  int remaining;
+  Dwfl *dwfl = NULL;
+  (void) argp_parse (dwfl_standard_argp (), argc, argv, 0, &remaining, &dwfl);
+  assert (dwfl != NULL);
+
+  dwfl_getmodules (dwfl, collect_addrs, NULL, 0);
+
+  /* Lookup the addresses as collected, and then in reverse order with
+     every address duplicated.  */
+  size_t n = naddrs;
+  for (size_t i = n; i-- > 0; )
+    {
+      add_addr (addrs[i]);
+      add_addr (addrs[i]);
+    }
+
+  Dwfl_Addrinfo *info = calloc (naddrs, sizeof info[0]);
+  assert (info != NULL);
+  if (dwfl_addrinfo_batch (dwfl, addrs, naddrs, info, true) != 0)
+    error (EXIT_FAILURE, 0, "dwfl_addrinfo_batch: %s", dwfl_errmsg (-1));
+
+  size_t nsyms = 0, nlines = 0, ninlined = 0;
+  for (size_t i = 0; i < naddrs; i++)
+    {
+      check_addr (dwfl, addrs[i], &info[i]);
+      nsyms += info[i].symbol != NULL;
+      nlines += info[i].line != NULL;
+      for (int s = 0; s < info[i].nscopes; s++)
+	ninlined += dwarf_tag (&info[i].scopes[s]) == DW_TAG_inlined_subroutine;
+      free (info[i].scopes);
+    }
+
+  printf ("%zu addresses, %zu with symbol, %zu with line, %zu inlined scopes\n",
+	  naddrs, nsyms, nlines, ninlined);
+
+  free (info);
+  free (addrs);
+  dwfl_end (dwfl);
+  return 0;
+}
@@ -0,0 +1,332 @@
+/* Test the symbol address index of dwfl_module_addrsym/addrinfo.
+   This file is part of elfutils.
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   elfutils is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+#include <config.h>
+#include <assert.h>
+#include <inttypes.h>
+#include ELFUTILS_HEADER(dwfl)
+#include <argp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "system.h"
+
+/* Looks up the address before, at, inside and just past every symbol,
+   and some addresses no symbol covers, with dwfl_module_addrsym and
+   dwfl_module_addrinfo.  Both must give the same symbol as the linear
+   search over the symbol table they did before they had an index,
+   which is done here the same way.  */
+
+/* The state of the linear search, like search_state in
+   libdwfl/dwfl_module_addrsym.c.  */
+struct ref_state
+{
+  Dwfl_Module *mod;
+  GElf_Addr addr;
+  bool adjust_st_value;
+  bool rel;			/* The module is ET_REL.  */
+
+  const char *closest_name;
+  GElf_Sym closest_sym;
+  GElf_Addr closest_value;
+
+  const char *sizeless_name;
+  GElf_Sym sizeless_sym;
+  GElf_Addr sizeless_value;
+
+  GElf_Addr min_label;
+};
+
+/* The index of the section of ELF containing the module relative
+   address MOD_ADDR, SHN_ABS if there is none.  */
+static GElf_Word
+elf_section (Elf *elf, GElf_Addr mod_addr)
+{
+  Elf_Scn *scn = NULL;
+  while ((scn = elf_nextscn (elf, scn)) != NULL)
+    {
+      GElf_Shdr shdr_mem;
+      GElf_Shdr *shdr = gelf_getshdr (scn, &shdr_mem);
+      if (shdr != NULL && mod_addr >= shdr->sh_addr
+	  && mod_addr < shdr->sh_addr + shdr->sh_size)
+	return elf_ndxscn (scn);
+    }
+  return SHN_ABS;
+}
+
+/* The index of the main file section containing ADDR.  */
+static GElf_Word
+module_section (Dwfl_Module *mod, GElf_Addr addr)
+{
+  Dwarf_Addr bias;
+  Elf_Scn *scn = dwfl_module_address_section (mod, &addr, &bias);
+  return scn != NULL ? elf_ndxscn (scn) : SHN_UNDEF;
+}
+
+static bool
+same_section (struct ref_state *state, GElf_Addr value, Elf *elf,
+	      Dwarf_Addr bias, GElf_Word shndx)
+{
+  if (shndx >= SHN_LORESERVE)
+    return value == state->addr;
+
+  if (! state->adjust_st_value)
+    return (module_section (state->mod, state->addr)
+	    == module_section (state->mod, value));
+
+  return shndx == elf_section (elf, state->addr - bias);
+}
+
+static int
+binding_value (const GElf_Sym *sym)
+{
+  switch (GELF_ST_BIND (sym->st_info))
+    {
+    case STB_GLOBAL:
+      return 3;
+    case STB_WEAK:
+      return 2;
+    case STB_LOCAL:
+      return 1;
+    default:
+      return 0;
+    }
+}
+
+static void
+try_sym (struct ref_state *state, GElf_Addr value, const GElf_Sym *sym,
+	 const char *name, GElf_Word shndx, Elf *elf, Dwarf_Addr bias)
+{
+  if (value + sym->st_size > state->min_label)
+    state->min_label = value + sym->st_size;
+
+  if (sym->st_size != 0 && state->addr - value >= sym->st_size)
+    return;
+
+  if (state->closest_name == NULL
+      || state->closest_value < value
+      || binding_value (&state->closest_sym) < binding_value (sym))
+    {
+      if (sym->st_size != 0)
+	{
+	  state->closest_sym = *sym;
+	  state->closest_value = value;
+	  state->closest_name = name;
+	}
+      else if (state->closest_name == NULL
+	       && value >= state->min_label
+	       && same_section (state, value, elf, bias, shndx))
+	{
+	  state->sizeless_sym = *sym;
+	  state->sizeless_value = value;
+	  state->sizeless_name = name;
+	}
+    }
+  else if (sym->st_size != 0
+	   && state->closest_value == value
+	   && ((state->closest_sym.st_size > sym->st_size
+		&& binding_value (&state->closest_sym) <= binding_value (sym))
+	       || (state->closest_sym.st_size >= sym->st_size
+		   && (binding_value (&state->closest_sym)
+		       < binding_value (sym)))))
+    {
+      state->closest_sym = *sym;
+      state->closest_value = value;
+      state->closest_name = name;
+    }
+}
+
+static void
+ref_table (struct ref_state *state, int start, int end)
+{
+  for (int i = start; i < end; i++)
+    {
+      GElf_Sym sym;
+      GElf_Addr value;
+      GElf_Word shndx;
+      Elf *elf;
+      Dwarf_Addr bias;
+      const char *name = dwfl_module_getsym_info (state->mod, i, &sym,
+						  &value, &shndx, &elf,
+						  &bias);
+      if (name == NULL || name[0] == '\0' || sym.st_shndx == SHN_UNDEF
+	  || GELF_ST_TYPE (sym.st_info) == STT_SECTION
+	  || GELF_ST_TYPE (sym.st_info) == STT_FILE
+	  || GELF_ST_TYPE (sym.st_info) == STT_TLS)
+	continue;
+
+      /* The adjusted st_value, never resolved.  */
+      GElf_Sym adjusted;
+      if (dwfl_module_getsym (state->mod, i, &adjusted, NULL) == NULL)
+	continue;
+
+      if (state->adjust_st_value)
+	{
+	  if (adjusted.st_value <= state->addr)
+	    try_sym (state, adjusted.st_value, &adjusted, name, shndx, elf,
+		     bias);
+	  continue;
+	}
+
+      /* VALUE differs from it when it was resolved through a function
+	 descriptor, then the adjusted st_value is tried too.  */
+      if (value > state->addr)
+	continue;
+      try_sym (state, value, &sym, name, shndx, elf, bias);
+      if (! state->rel && value != adjusted.st_value
+	  && adjusted.st_value <= state->addr)
+	try_sym (state, adjusted.st_value, &sym, name, shndx, elf, bias);
+    }
+}
+
+/* What dwfl_module_addrsym (ADJUST_ST_VALUE) or dwfl_module_addrinfo
+   returned before the index.  */
+static const char *
+ref_addrsym (Dwfl_Module *mod, GElf_Addr addr, bool adjust_st_value,
+	     GElf_Off *off, GElf_Sym *sym)
+{
+  struct ref_state state =
+    {
+      .mod = mod,
+      .addr = addr,
+      .adjust_st_value = adjust_st_value
+    };
+
+  GElf_Addr bias;
+  GElf_Ehdr ehdr_mem;
+  GElf_Ehdr *ehdr = gelf_getehdr (dwfl_module_getelf (mod, &bias),
+				  &ehdr_mem);
+  state.rel = ehdr != NULL && ehdr->e_type == ET_REL;
+
+  int syments = dwfl_module_getsymtab (mod);
+  int first_global = dwfl_module_getsymtab_first_global (mod);
+  assert (syments >= 0 && first_global >= 0);
+
+  ref_table (&state, first_global == 0 ? 1 : first_global, syments);
+  if (state.closest_name == NULL && first_global > 1
+      && (state.sizeless_name == NULL || state.sizeless_value != addr))
+    ref_table (&state, 1, first_global);
+
+  if (state.closest_name == NULL && state.sizeless_name != NULL
+      && state.sizeless_value >= state.min_label)
+    {
+      state.closest_sym = state.sizeless_sym;
+      state.closest_value = state.sizeless_value;
+      state.closest_name = state.sizeless_name;
+    }
+
+  *off = addr - state.closest_value;
+  *sym = state.closest_sym;
+  return state.closest_name;
+}
+
+static int errors;
+static size_t naddrs;
+static size_t nfound;
+
+static void
+check_addr (Dwfl_Module *mod, GElf_Addr addr)
+{
+  naddrs++;
+  for (int adjust = 0; adjust < 2; adjust++)
+    {
+      GElf_Sym sym, ref_sym;
+      GElf_Off off = 0, ref_off;
+      const char *name;
+      if (adjust)
+	{
+	  name = dwfl_module_addrsym (mod, addr, &sym, NULL);
+	  if (name != NULL)
+	    off = addr - sym.st_value;
+	}
+      else
+	name = dwfl_module_addrinfo (mod, addr, &off, &sym, NULL, NULL, NULL);
+      const char *ref_name = ref_addrsym (mod, addr, adjust, &ref_off,
+					  &ref_sym);
+
+      if ((name == NULL) != (ref_name == NULL)
+	  || (name != NULL
+	      && (strcmp (name, ref_name) != 0 || off != ref_off
+		  || sym.st_value != ref_sym.st_value
+		  || sym.st_size != ref_sym.st_size
+		  || sym.st_info != ref_sym.st_info)))
+	{
+	  if (errors++ < 10)
+	    printf ("%#" PRIx64 " (%s): %s+%#" PRIx64 " instead of %s+%#"
+		    PRIx64 "\n", addr,
+		    adjust ? "addrsym" : "addrinfo", name ?: "??",
+		    name != NULL ? off : 0, ref_name ?: "??",
+		    ref_name != NULL ? ref_off : 0);
+	}
+      if (adjust == 0 && name != NULL)
+	nfound++;
+    }
+}
+
+static int
+check_module (Dwfl_Module *mod, void **userdata __attribute__ ((unused)),
+	      const char *name, Dwarf_Addr start,
+	      void *arg __attribute__ ((unused)))
+{
+  int syments = dwfl_module_getsymtab (mod);
+  if (syments < 0)
+    {
+      printf ("%s: %s\n", name, dwfl_errmsg (-1));
+      return DWARF_CB_OK;
+    }
+
+  /* Misses below and far above the module.  */
+  check_addr (mod, 0);
+  if (start > 0)
+    check_addr (mod, start - 1);
+  check_addr (mod, (GElf_Addr) -1);
+
+  for (int i = 1; i < syments; i++)
+    {
+      GElf_Sym sym;
+      GElf_Addr value;
+      if (dwfl_module_getsym_info (mod, i, &sym, &value,
+				   NULL, NULL, NULL) == NULL
+	  || sym.st_shndx == SHN_UNDEF)
+	continue;
+
+      check_addr (mod, value - 1);
+      check_addr (mod, value);
+      if (sym.st_size > 1)
+	{
+	  check_addr (mod, value + sym.st_size / 2);
+	  check_addr (mod, value + sym.st_size - 1);
+	}
+      check_addr (mod, value + sym.st_size);
+    }
+
+  return DWARF_CB_OK;
+}
+
+int
+main (int argc, char *argv[])
+{
+  int remaining;
+  Dwfl *dwfl = NULL;
+  (void) argp_parse (dwfl_standard_argp (), argc, argv, 0, &remaining, &dwfl);
+  assert (dwfl != NULL);
+
+  dwfl_getmodules (dwfl, check_module, NULL, 0);
+
+  printf ("%zu addresses, %zu with symbol\n", naddrs, nfound);
+
+  dwfl_end (dwfl);
+  return errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,152 @@
+/* Test dwfl_set_build_id_index.
+   This file is part of elfutils.
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   elfutils is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#include <config.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include ELFUTILS_HEADER(dwfl)
+#include "system.h"
+
+/* Installs and removes FILE under its build ID in a debuginfo path
+   directory, and checks that every new session using the index sees
+   the change.  */
+
+static char *debuginfo_path;
+
+static const Dwfl_Callbacks build_id_callbacks =
+  {
+    .find_elf = dwfl_build_id_find_elf,
+    .find_debuginfo = dwfl_build_id_find_debuginfo,
+    .debuginfo_path = &debuginfo_path,
+  };
+
+static const Dwfl_Callbacks offline_callbacks =
+  {
+    .find_debuginfo = dwfl_standard_find_debuginfo,
+    .section_address = dwfl_offline_section_address,
+    .debuginfo_path = &debuginfo_path,
+  };
+
+static unsigned char build_id[64];
+static int build_id_len;
+
+/* Whether a module with FILE's build ID finds its ELF file.  */
+static bool
+find (bool index)
+{
+  Dwfl *dwfl = dwfl_begin (&build_id_callbacks);
+  if (dwfl == NULL)
+    error (EXIT_FAILURE, 0, "dwfl_begin: %s", dwfl_errmsg (-1));
+  if (dwfl_set_build_id_index (dwfl, index) != 0)
+    error (EXIT_FAILURE, 0, "dwfl_set_build_id_index: %s", dwfl_errmsg (-1));
+  dwfl_report_begin (dwfl);
+  Dwfl_Module *mod = dwfl_report_module (dwfl, "test", 0x10000, 0x20000);
+  if (mod == NULL)
+    error (EXIT_FAILURE, 0, "dwfl_report_module: %s", dwfl_errmsg (-1));
+  if (dwfl_module_report_build_id (mod, build_id, build_id_len, 0) != 0)
+    error (EXIT_FAILURE, 0, "dwfl_module_report_build_id: %s",
+	   dwfl_errmsg (-1));
+  if (dwfl_report_end (dwfl, NULL, NULL) != 0)
+    error (EXIT_FAILURE, 0, "dwfl_report_end: %s", dwfl_errmsg (-1));
+  GElf_Addr bias;
+  bool found = dwfl_module_getelf (mod, &bias) != NULL;
+  dwfl_end (dwfl);
+  return found;
+}
+
+static void
+check (const char *what)
+{
+  bool indexed = find (true);
+  bool probed = find (false);
+  printf ("%s: %s\n", what, indexed ? "found" : "not found");
+  if (indexed != probed)
+    error (EXIT_FAILURE, 0, "index differs from probing");
+}
+
+int
+main (int argc, char **argv)
+{
+  if (argc != 2)
+    error (EXIT_FAILURE, 0, "usage: dwfl-build-id-index FILE");
+  char *file = realpath (argv[1], NULL);
+  if (file == NULL)
+    error (EXIT_FAILURE, errno, "realpath %s", argv[1]);
+
+  Dwfl *dwfl = dwfl_begin (&offline_callbacks);
+  if (dwfl == NULL)
+    error (EXIT_FAILURE, 0, "dwfl_begin: %s", dwfl_errmsg (-1));
+  Dwfl_Module *mod = dwfl_report_offline (dwfl, file, file, -1);
+  if (mod == NULL)
+    error (EXIT_FAILURE, 0, "dwfl_report_offline: %s", dwfl_errmsg (-1));
+  const unsigned char *bits;
+  GElf_Addr vaddr;
+  build_id_len = dwfl_module_build_id (mod, &bits, &vaddr);
+  if (build_id_len <= 0 || build_id_len > (int) sizeof build_id)
+    {
+      printf ("no build ID\n");
+      return 77;
+    }
+  memcpy (build_id, bits, build_id_len);
+  dwfl_end (dwfl);
+
+  char dir[] = "build-id-index-XXXXXX";
+  if (mkdtemp (dir) == NULL)
+    error (EXIT_FAILURE, errno, "mkdtemp");
+  debuginfo_path = realpath (dir, NULL);
+  if (debuginfo_path == NULL)
+    error (EXIT_FAILURE, errno, "realpath %s", dir);
+
+  char *build_id_dir, *subdir, *link;
+  if (asprintf (&build_id_dir, "%s/.build-id", debuginfo_path) < 0
+      || asprintf (&subdir, "%s/%02x", build_id_dir, build_id[0]) < 0)
+    error (EXIT_FAILURE, errno, "asprintf");
+  link = malloc (strlen (subdir) + 2 + 2 * build_id_len);
+  if (link == NULL)
+    error (EXIT_FAILURE, errno, "malloc");
+  char *p = link + sprintf (link, "%s/", subdir);
+  for (int i = 1; i < build_id_len; i++)
+    p += sprintf (p, "%02x", build_id[i]);
+
+  check ("no .build-id");
+
+  if (mkdir (build_id_dir, 0700) != 0 || mkdir (subdir, 0700) != 0)
+    error (EXIT_FAILURE, errno, "mkdir %s", subdir);
+  check ("empty subdirectory");
+
+  if (symlink (file, link) != 0)
+    error (EXIT_FAILURE, errno, "symlink %s", link);
+  check ("installed");
+  check ("installed again");
+
+  if (unlink (link) != 0)
+    error (EXIT_FAILURE, errno, "unlink %s", link);
+  check ("removed");
+
+  rmdir (subdir);
+  rmdir (build_id_dir);
+  rmdir (debuginfo_path);
+  free (link);
+  free (subdir);
+  free (build_id_dir);
+  free (debuginfo_path);
+  free (file);
+  return 0;
+}
@@ -0,0 +1,175 @@
+/* Test the CFI register rules handle_cfi evaluates without expr_eval.
+   This file is part of elfutils.
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   elfutils is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+#include <config.h>
+#include <assert.h>
+#include <inttypes.h>
+#include ELFUTILS_HEADER(dwfl)
+#include <argp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "system.h"
+
+/* Every function NAME_fast in testfile-cfi-rules has a partner
+   NAME_slow whose return address rule computes the same value through
+   expr_eval.  Each function gets a thread with the same registers and
+   memory, starting at the function, and is unwound one frame.  The
+   return addresses of both must match.  */
+
+struct func
+{
+  const char *name;
+  GElf_Addr pc;
+  unsigned frames;
+  Dwarf_Addr ra;
+};
+
+static struct func funcs[64];
+static size_t nfuncs;
+
+/* x86_64 DWARF register numbers.  */
+#define NREGS 17
+#define RSP_REGNO 7
+#define RIP_REGNO 16
+#define STACK 0x7ff000
+
+static int
+collect_funcs (Dwfl_Module *mod, void **userdata __attribute__ ((unused)),
+	       const char *name __attribute__ ((unused)),
+	       Dwarf_Addr start __attribute__ ((unused)),
+	       void *arg __attribute__ ((unused)))
+{
+  int syms = dwfl_module_getsymtab (mod);
+  for (int i = 0; i < syms; i++)
+    {
+      GElf_Sym sym;
+      GElf_Addr value;
+      const char *symname = dwfl_module_getsym_info (mod, i, &sym, &value,
+						     NULL, NULL, NULL);
+      if (symname != NULL && GELF_ST_TYPE (sym.st_info) == STT_FUNC)
+	{
+	  assert (nfuncs < sizeof funcs / sizeof funcs[0]);
+	  funcs[nfuncs].name = symname;
+	  funcs[nfuncs].pc = value;
+	  nfuncs++;
+	}
+    }
+  return DWARF_CB_OK;
+}
+
+static pid_t
+next_thread (Dwfl *dwfl __attribute__ ((unused)),
+	     void *dwfl_arg __attribute__ ((unused)), void **thread_argp)
+{
+  /* Thread TID starts in funcs[TID - 1].  */
+  uintptr_t tid = (uintptr_t) *thread_argp + 1;
+  if (tid > nfuncs)
+    return 0;
+  *thread_argp = (void *) tid;
+  return tid;
+}
+
+static bool
+memory_read (Dwfl *dwfl __attribute__ ((unused)), Dwarf_Addr addr,
+	     Dwarf_Word *result, void *dwfl_arg __attribute__ ((unused)))
+{
+  /* Any word is readable, and tells where it was read from.  */
+  *result = 0x100000 + addr;
+  return true;
+}
+
+static bool
+set_initial_registers (Dwfl_Thread *thread,
+		       void *thread_arg __attribute__ ((unused)))
+{
+  Dwarf_Word regs[NREGS];
+  for (int i = 0; i < NREGS; i++)
+    regs[i] = 0x1000 * (i + 1);
+  regs[RSP_REGNO] = STACK;
+  regs[RIP_REGNO] = funcs[dwfl_thread_tid (thread) - 1].pc;
+  return dwfl_thread_state_registers (thread, 0, NREGS, regs);
+}
+
+static const Dwfl_Thread_Callbacks callbacks =
+{
+  .next_thread = next_thread,
+  .memory_read = memory_read,
+  .set_initial_registers = set_initial_registers,
+};
+
+static int
+frame_callback (Dwfl_Frame *state, void *arg)
+{
+  struct func *func = arg;
+  Dwarf_Addr pc;
+  if (! dwfl_frame_pc (state, &pc, NULL))
+    error (EXIT_FAILURE, 0, "%s: dwfl_frame_pc: %s", func->name,
+	   dwfl_errmsg (-1));
+
+  /* The first frame is the function itself.  */
+  if (func->frames++ == 0)
+    return DWARF_CB_OK;
+
+  func->ra = pc;
+  return DWARF_CB_ABORT;
+}
+
+int
+main (int argc, char *argv[])
+{
+  int remaining;
+  Dwfl *dwfl = NULL;
+  (void) argp_parse (dwfl_standard_argp (), argc, argv, 0, &remaining, &dwfl);
+  assert (dwfl != NULL);
+
+  dwfl_getmodules (dwfl, collect_funcs, NULL, 0);
+  if (! dwfl_attach_state (dwfl, NULL, 1, &callbacks, NULL))
+    error (EXIT_FAILURE, 0, "dwfl_attach_state: %s", dwfl_errmsg (-1));
+
+  for (size_t i = 0; i < nfuncs; i++)
+    if (dwfl_getthread_frames (dwfl, i + 1, frame_callback, &funcs[i]) < 0
+	|| funcs[i].frames != 2)
+      error (EXIT_FAILURE, 0, "%s not unwound: %s", funcs[i].name,
+	     dwfl_errmsg (-1));
+
+  int result = 0;
+  for (size_t i = 0; i < nfuncs; i++)
+    {
+      size_t len = strlen (funcs[i].name);
+      if (len < 5 || strcmp (funcs[i].name + len - 5, "_fast") != 0)
+	continue;
+
+      size_t j;
+      for (j = 0; j < nfuncs; j++)
+	if (strncmp (funcs[j].name, funcs[i].name, len - 5) == 0
+	    && strcmp (funcs[j].name + len - 5, "_slow") == 0)
+	  break;
+      if (j == nfuncs)
+	error (EXIT_FAILURE, 0, "no slow version of %s", funcs[i].name);
+
+      printf ("%.*s: %#" PRIx64, (int) (len - 5), funcs[i].name,
+	      funcs[i].ra);
+      if (funcs[j].ra != funcs[i].ra)
+	{
+	  printf (", expr_eval gives %#" PRIx64, funcs[j].ra);
+	  result = 1;
+	}
+      printf ("\n");
+    }
+
+  dwfl_end (dwfl);
+  return result;
+}
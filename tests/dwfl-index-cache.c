@@ -0,0 +1,257 @@
+/* Test dwfl_set_index_cache.
+   This file is part of elfutils.
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   elfutils is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#include <config.h>
+#include <dirent.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include ELFUTILS_HEADER(dwfl)
+#include "system.h"
+
+/* Looks up the addresses around every symbol of FILE with and without
+   an index cache.  The first cached lookup writes the cache files, the
+   second one at the same address maps them, the third one at another
+   address has to move the cached addresses.  All must give the same
+   symbols and CUs as no cache, and the files must not be written
+   again.  */
+
+static char *debuginfo_path = NULL;
+
+static const Dwfl_Callbacks offline_callbacks =
+  {
+    .find_debuginfo = dwfl_standard_find_debuginfo,
+    .section_address = dwfl_offline_section_address,
+    .debuginfo_path = &debuginfo_path,
+  };
+
+#define BASE1 0x10000
+#define BASE2 0x7f0000000000
+
+static Dwfl_Module *
+report (const char *file, GElf_Addr base, const char *cache, Dwfl **dwflp)
+{
+  Dwfl *dwfl = dwfl_begin (&offline_callbacks);
+  if (dwfl == NULL)
+    error (EXIT_FAILURE, 0, "dwfl_begin: %s", dwfl_errmsg (-1));
+  if (dwfl_set_index_cache (dwfl, cache) != 0)
+    error (EXIT_FAILURE, 0, "dwfl_set_index_cache: %s", dwfl_errmsg (-1));
+  Dwfl_Module *mod = dwfl_report_elf (dwfl, file, file, -1, base, false);
+  if (mod == NULL)
+    error (EXIT_FAILURE, 0, "dwfl_report_elf: %s", dwfl_errmsg (-1));
+  if (dwfl_report_end (dwfl, NULL, NULL) != 0)
+    error (EXIT_FAILURE, 0, "dwfl_report_end: %s", dwfl_errmsg (-1));
+  *dwflp = dwfl;
+  return mod;
+}
+
+/* The address of MOD relative to its start.  */
+static GElf_Addr
+module_start (Dwfl_Module *mod)
+{
+  Dwarf_Addr start;
+  dwfl_module_info (mod, NULL, &start, NULL, NULL, NULL, NULL, NULL);
+  return start;
+}
+
+/* Compare the symbols found for ADDR (relative to the module start) in
+   MOD and REF.  */
+static int
+compare (Dwfl_Module *ref, Dwfl_Module *mod, GElf_Addr addr)
+{
+  GElf_Addr ref_addr = module_start (ref) + addr;
+  GElf_Addr mod_addr = module_start (mod) + addr;
+  int errors = 0;
+  for (int adjust = 0; adjust < 2; adjust++)
+    {
+      GElf_Sym sym;
+      GElf_Off ref_off = 0, mod_off = 0;
+      const char *ref_name, *mod_name;
+      if (adjust)
+	{
+	  ref_name = dwfl_module_addrsym (ref, ref_addr, &sym, NULL);
+	  mod_name = dwfl_module_addrsym (mod, mod_addr, &sym, NULL);
+	}
+      else
+	{
+	  ref_name = dwfl_module_addrinfo (ref, ref_addr, &ref_off, &sym,
+					   NULL, NULL, NULL);
+	  mod_name = dwfl_module_addrinfo (mod, mod_addr, &mod_off, &sym,
+					   NULL, NULL, NULL);
+	}
+      if ((ref_name == NULL) != (mod_name == NULL)
+	  || (ref_name != NULL && (strcmp (ref_name, mod_name) != 0
+				   || ref_off != mod_off)))
+	{
+	  printf ("%#" PRIx64 ": %s+%#" PRIx64 " != %s+%#" PRIx64 "\n",
+		  addr, ref_name ?: "??", ref_off, mod_name ?: "??", mod_off);
+	  errors++;
+	}
+    }
+
+  Dwarf_Addr bias;
+  Dwarf_Die *ref_cu = dwfl_module_addrdie (ref, ref_addr, &bias);
+  Dwarf_Die *mod_cu = dwfl_module_addrdie (mod, mod_addr, &bias);
+  if ((ref_cu == NULL) != (mod_cu == NULL)
+      || (ref_cu != NULL
+	  && dwarf_dieoffset (ref_cu) != dwarf_dieoffset (mod_cu)))
+    {
+      printf ("%#" PRIx64 ": CU %#" PRIx64 " != %#" PRIx64 "\n", addr,
+	      ref_cu != NULL ? dwarf_dieoffset (ref_cu) : (Dwarf_Off) -1,
+	      mod_cu != NULL ? dwarf_dieoffset (mod_cu) : (Dwarf_Off) -1);
+      errors++;
+    }
+  return errors;
+}
+
+/* Adds up the inode numbers of the files in DIR, which changes when
+   one of them is written again.  Counts files not readable by all as
+   far as the umask allows in *ERRORS.  */
+static ino_t
+file_ids (const char *dir, int *errors)
+{
+  mode_t mask = umask (0);
+  umask (mask);
+
+  DIR *d = opendir (dir);
+  if (d == NULL)
+    error (EXIT_FAILURE, errno, "opendir %s", dir);
+  ino_t ids = 0;
+  struct dirent *de;
+  while ((de = readdir (d)) != NULL)
+    if (de->d_name[0] != '.')
+      {
+	struct stat st;
+	if (fstatat (dirfd (d), de->d_name, &st, 0) != 0)
+	  error (EXIT_FAILURE, errno, "stat %s", de->d_name);
+	if ((st.st_mode & 0777) != (0644 & ~mask))
+	  {
+	    printf ("%s: mode %#o\n", de->d_name, st.st_mode & 0777);
+	    (*errors)++;
+	  }
+	ids += st.st_ino;
+      }
+  closedir (d);
+  return ids;
+}
+
+static int
+count_files (const char *dir, bool remove)
+{
+  DIR *d = opendir (dir);
+  if (d == NULL)
+    error (EXIT_FAILURE, errno, "opendir %s", dir);
+  int n = 0;
+  struct dirent *de;
+  while ((de = readdir (d)) != NULL)
+    if (de->d_name[0] != '.')
+      {
+	n++;
+	if (remove)
+	  {
+	    char *name;
+	    if (asprintf (&name, "%s/%s", dir, de->d_name) < 0)
+	      error (EXIT_FAILURE, errno, "asprintf");
+	    unlink (name);
+	    free (name);
+	  }
+      }
+  closedir (d);
+  return n;
+}
+
+int
+main (int argc, char **argv)
+{
+  if (argc != 2)
+    error (EXIT_FAILURE, 0, "usage: dwfl-index-cache FILE");
+  const char *file = argv[1];
+
+  char dir[] = "index-cache-XXXXXX";
+  if (mkdtemp (dir) == NULL)
+    error (EXIT_FAILURE, errno, "mkdtemp");
+
+  Dwfl *ref_dwfl, *dwfl1, *dwfl2, *dwfl3;
+  Dwfl_Module *ref = report (file, BASE1, NULL, &ref_dwfl);
+
+  const unsigned char *bits;
+  GElf_Addr vaddr;
+  dwfl_module_getelf (ref, &vaddr);
+  if (dwfl_module_build_id (ref, &bits, &vaddr) <= 0)
+    {
+      printf ("no build ID\n");
+      rmdir (dir);
+      return 77;
+    }
+
+  int nsyms = dwfl_module_getsymtab (ref);
+  if (nsyms <= 0)
+    error (EXIT_FAILURE, 0, "no symbols: %s", dwfl_errmsg (-1));
+
+  /* There is a file for each symbol index and one for the CU map.  */
+  Dwarf_Addr bias;
+  int nfiles = 2 + (dwfl_module_getdwarf (ref, &bias) != NULL);
+
+  int errors = 0;
+  ino_t ids = 0;
+  Dwfl_Module *mods[3];
+  mods[0] = report (file, BASE1, dir, &dwfl1);
+  mods[1] = report (file, BASE1, dir, &dwfl2);
+  mods[2] = report (file, BASE2, dir, &dwfl3);
+  for (int m = 0; m < 3; m++)
+    {
+      for (int i = 1; i < nsyms; i++)
+	{
+	  GElf_Sym sym;
+	  GElf_Addr addr;
+	  if (dwfl_module_getsym_info (ref, i, &sym, &addr, NULL, NULL,
+				       NULL) == NULL
+	      || GELF_ST_TYPE (sym.st_info) == STT_TLS
+	      || sym.st_shndx == SHN_UNDEF || sym.st_shndx == SHN_ABS)
+	    continue;
+	  GElf_Addr rel = addr - module_start (ref);
+	  errors += compare (ref, mods[m], rel);
+	  errors += compare (ref, mods[m], rel + 1);
+	  if (sym.st_size > 0)
+	    errors += compare (ref, mods[m], rel + sym.st_size);
+	}
+      if (m == 0 && count_files (dir, false) != nfiles)
+	{
+	  printf ("%d cache files\n", count_files (dir, false));
+	  errors++;
+	}
+      if (m == 0)
+	ids = file_ids (dir, &errors);
+    }
+  if (file_ids (dir, &errors) != ids)
+    {
+      printf ("cache files written again\n");
+      errors++;
+    }
+
+  dwfl_end (ref_dwfl);
+  dwfl_end (dwfl1);
+  dwfl_end (dwfl2);
+  dwfl_end (dwfl3);
+  count_files (dir, true);
+  rmdir (dir);
+
+  printf ("%d symbols, %d errors\n", nsyms, errors);
+  return errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,148 @@
+/* Test dwfl_module_build_line_index.
+   This file is part of elfutils.
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   elfutils is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+#include <config.h>
+#include <assert.h>
+#include <inttypes.h>
+#include ELFUTILS_HEADER(dwfl)
+#include <argp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "system.h"
+
+/* Looks up the start, the start plus one and the address before the
+   start of every line and every symbol with dwfl_module_getsrc, then
+   builds the line index and checks dwfl_module_getsrc finds the same
+   lines through it.  */
+
+struct lookup
+{
+  Dwfl_Module *mod;
+  Dwarf_Addr addr;
+  Dwfl_Line *line;
+};
+
+static struct lookup *lookups;
+static size_t nlookups;
+static size_t lookups_alloc;
+
+static void
+add_lookup (Dwfl_Module *mod, Dwarf_Addr addr)
+{
+  if (nlookups == lookups_alloc)
+    {
+      lookups_alloc = lookups_alloc == 0 ? 1024 : 2 * lookups_alloc;
+      lookups = realloc (lookups, lookups_alloc * sizeof lookups[0]);
+      assert (lookups != NULL);
+    }
+  lookups[nlookups].mod = mod;
+  lookups[nlookups].addr = addr;
+  lookups[nlookups].line = dwfl_module_getsrc (mod, addr);
+  nlookups++;
+}
+
+static int
+collect_lines (Dwfl_Module *mod, void **userdata __attribute__ ((unused)),
+	       const char *name __attribute__ ((unused)),
+	       Dwarf_Addr start __attribute__ ((unused)),
+	       void *arg __attribute__ ((unused)))
+{
+  int syms = dwfl_module_getsymtab (mod);
+  for (int i = 0; i < syms; i++)
+    {
+      GElf_Sym sym;
+      GElf_Addr value;
+      if (dwfl_module_getsym_info (mod, i, &sym, &value,
+				   NULL, NULL, NULL) != NULL)
+	add_lookup (mod, value);
+    }
+
+  Dwarf_Addr bias;
+  Dwarf_Die *cu = NULL;
+  while ((cu = dwfl_module_nextcu (mod, cu, &bias)) != NULL)
+    {
+      size_t nlines;
+      if (dwfl_getsrclines (cu, &nlines) != 0)
+	continue;
+      for (size_t i = 0; i < nlines; i++)
+	{
+	  Dwarf_Addr addr;
+	  if (dwfl_lineinfo (dwfl_onesrcline (cu, i), &addr,
+			     NULL, NULL, NULL, NULL) != NULL)
+	    {
+	      add_lookup (mod, addr);
+	      add_lookup (mod, addr + 1);
+	      add_lookup (mod, addr - 1);
+	    }
+	}
+    }
+
+  return DWARF_CB_OK;
+}
+
+static int
+build_index (Dwfl_Module *mod, void **userdata __attribute__ ((unused)),
+	     const char *name __attribute__ ((unused)),
+	     Dwarf_Addr start __attribute__ ((unused)), void *arg)
+{
+  size_t *total = arg;
+  size_t size;
+  if (dwfl_module_build_line_index (mod, 2, &size) != 0)
+    error (EXIT_FAILURE, 0, "dwfl_module_build_line_index: %s",
+	   dwfl_errmsg (-1));
+
+  /* A second call just reports the size.  */
+  size_t again;
+  if (dwfl_module_build_line_index (mod, 2, &again) != 0 || again != size)
+    error (EXIT_FAILURE, 0, "index built twice");
+
+  *total += size;
+  return DWARF_CB_OK;
+}
+
+int
+main (int argc, char *argv[])
+{
+  int remaining;
+  Dwfl *dwfl = NULL;
+  (void) argp_parse (dwfl_standard_argp (), argc, argv, 0, &remaining, &dwfl);
+  assert (dwfl != NULL);
+
+  dwfl_getmodules (dwfl, collect_lines, NULL, 0);
+
+  size_t size = 0;
+  dwfl_getmodules (dwfl, build_index, &size, 0);
+
+  size_t nfound = 0;
+  for (size_t i = 0; i < nlookups; i++)
+    {
+      Dwfl_Line *line = dwfl_module_getsrc (lookups[i].mod,
+					    lookups[i].addr);
+      if (line != lookups[i].line)
+	error (EXIT_FAILURE, 0, "%#" PRIx64 ": line mismatch",
+	       lookups[i].addr);
+      nfound += line != NULL;
+    }
+
+  if (nfound > 0 && size == 0)
+    error (EXIT_FAILURE, 0, "lines found, but index is empty");
+
+  printf ("%zu addresses, %zu with line\n", nlookups, nfound);
+
+  free (lookups);
+  dwfl_end (dwfl);
+  return 0;
+}
@@ -0,0 +1,134 @@
+/* Test dwfl_preload_modules.
+   This file is part of elfutils.
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   elfutils is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#include <config.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include ELFUTILS_HEADER(dwfl)
+#include "system.h"
+
+/* Reports the modules of this process twice, loads them one by one in
+   the first Dwfl and all at once in the second, and checks that both
+   found the same files and symbols.  */
+
+#define JOBS 4
+
+static char *debuginfo_path = NULL;
+
+static const Dwfl_Callbacks proc_callbacks =
+  {
+    .find_elf = dwfl_linux_proc_find_elf,
+    .find_debuginfo = dwfl_standard_find_debuginfo,
+    .debuginfo_path = &debuginfo_path,
+  };
+
+static Dwfl *
+report (void)
+{
+  Dwfl *dwfl = dwfl_begin (&proc_callbacks);
+  if (dwfl == NULL)
+    error (EXIT_FAILURE, 0, "dwfl_begin: %s", dwfl_errmsg (-1));
+  if (dwfl_linux_proc_report (dwfl, getpid ()) != 0)
+    error (EXIT_FAILURE, 0, "dwfl_linux_proc_report: %s", dwfl_errmsg (-1));
+  if (dwfl_report_end (dwfl, NULL, NULL) != 0)
+    error (EXIT_FAILURE, 0, "dwfl_report_end: %s", dwfl_errmsg (-1));
+  return dwfl;
+}
+
+static int
+nmodules (Dwfl_Module *mod __attribute__ ((unused)),
+	  void **userdata __attribute__ ((unused)),
+	  const char *name __attribute__ ((unused)),
+	  Dwarf_Addr start __attribute__ ((unused)),
+	  void *arg)
+{
+  ++*(int *) arg;
+  return DWARF_CB_OK;
+}
+
+struct compare
+{
+  Dwfl *other;
+  int preloaded;
+  int errors;
+};
+
+static int
+compare_module (Dwfl_Module *mod, void **userdata __attribute__ ((unused)),
+		const char *name, Dwarf_Addr start, void *arg)
+{
+  struct compare *compare = arg;
+  Dwfl_Module *other = dwfl_addrmodule (compare->other, start);
+  if (other == NULL)
+    error (EXIT_FAILURE, 0, "no module at %#" PRIx64, start);
+
+  /* Before dwfl_module_getsymtab could load them.  */
+  const char *mainfile, *debugfile, *other_mainfile, *other_debugfile;
+  dwfl_module_info (other, NULL, NULL, NULL, NULL, NULL,
+		    &other_mainfile, &other_debugfile);
+  if (other_mainfile != NULL)
+    compare->preloaded++;
+
+  Dwarf_Addr bias;
+  dwfl_module_getdwarf (mod, &bias);
+  int syms = dwfl_module_getsymtab (mod);
+  int other_syms = dwfl_module_getsymtab (other);
+  dwfl_module_info (mod, NULL, NULL, NULL, NULL, NULL,
+		    &mainfile, &debugfile);
+  if ((mainfile == NULL) != (other_mainfile == NULL)
+      || (mainfile != NULL && strcmp (mainfile, other_mainfile) != 0)
+      || (debugfile == NULL) != (other_debugfile == NULL)
+      || (debugfile != NULL && strcmp (debugfile, other_debugfile) != 0)
+      || syms != other_syms)
+    {
+      printf ("%s: %s %s %d != %s %s %d\n", name,
+	      mainfile ?: "-", debugfile ?: "-", syms,
+	      other_mainfile ?: "-", other_debugfile ?: "-", other_syms);
+      compare->errors++;
+    }
+  return DWARF_CB_OK;
+}
+
+int
+main (void)
+{
+  Dwfl *dwfl = report ();
+  Dwfl *preloaded = report ();
+
+  int n = 0;
+  dwfl_getmodules (dwfl, nmodules, &n, 0);
+  if (n < 2)
+    error (EXIT_FAILURE, 0, "only %d modules", n);
+
+  if (dwfl_preload_modules (preloaded, JOBS) != 0)
+    error (EXIT_FAILURE, 0, "dwfl_preload_modules: %s", dwfl_errmsg (-1));
+
+  struct compare compare = { .other = preloaded, .preloaded = 0,
+			     .errors = 0 };
+  dwfl_getmodules (dwfl, compare_module, &compare, 0);
+  if (compare.preloaded == 0)
+    {
+      printf ("nothing preloaded\n");
+      compare.errors++;
+    }
+
+  dwfl_end (dwfl);
+  dwfl_end (preloaded);
+  return compare.errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,136 @@
+/* A child process for the dwfl_linux_proc_attach tests.
+   This file is part of elfutils.
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   elfutils is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+#include <config.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <pthread.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include "dwfl-proc-child.h"
+#endif
+#include "system.h"
+
+#ifdef __linux__
+
+/* Written to once by every thread that reached its deepest frame.  */
+static int ready_fd;
+
+int __attribute__ ((noinline, optimize ("no-omit-frame-pointer")))
+child_recurse (int depth)
+{
+  if (depth == 0)
+    {
+      char c = 0;
+      if (write (ready_fd, &c, 1) != 1)
+	_exit (1);
+      /* Until killed by the parent.  */
+      pause ();
+      return 0;
+    }
+  int res = child_recurse (depth - 1);
+  /* Keep the frame, no tail call.  */
+  asm volatile ("" : : "r" (&res) : "memory");
+  return res;
+}
+
+static void *
+child_thread (void *arg)
+{
+  child_recurse ((intptr_t) arg);
+  return NULL;
+}
+
+pid_t
+start_child (int depth, int nthreads)
+{
+  int fds[2];
+  if (pipe (fds) != 0)
+    error (-1, errno, "pipe");
+
+  pid_t pid = fork ();
+  if (pid < 0)
+    error (-1, errno, "fork");
+  if (pid == 0)
+    {
+      close (fds[0]);
+      ready_fd = fds[1];
+      if (nthreads == 0)
+	child_recurse (depth);
+      for (int i = 0; i < nthreads; i++)
+	{
+	  pthread_t thread;
+	  if (pthread_create (&thread, NULL, child_thread,
+			      (void *) (intptr_t) depth) != 0)
+	    _exit (1);
+	}
+      pause ();
+      _exit (0);
+    }
+
+  close (fds[1]);
+  for (int i = 0; i < (nthreads == 0 ? 1 : nthreads); i++)
+    {
+      char c;
+      if (read (fds[0], &c, 1) != 1)
+	error (-1, errno, "child did not start");
+    }
+  close (fds[0]);
+  return pid;
+}
+
+static char *debuginfo_path = NULL;
+
+static const Dwfl_Callbacks proc_callbacks =
+  {
+    .find_elf = dwfl_linux_proc_find_elf,
+    .find_debuginfo = dwfl_standard_find_debuginfo,
+    .debuginfo_path = &debuginfo_path,
+  };
+
+Dwfl *
+report_child (pid_t pid)
+{
+  Dwfl *dwfl = dwfl_begin (&proc_callbacks);
+  if (dwfl == NULL)
+    error (-1, 0, "dwfl_begin: %s", dwfl_errmsg (-1));
+  if (dwfl_linux_proc_report (dwfl, pid) != 0)
+    error (-1, 0, "dwfl_linux_proc_report: %s", dwfl_errmsg (-1));
+  if (dwfl_report_end (dwfl, NULL, NULL) != 0)
+    error (-1, 0, "dwfl_report_end: %s", dwfl_errmsg (-1));
+  return dwfl;
+}
+
+void
+end_child (Dwfl *dwfl, pid_t pid)
+{
+  dwfl_end (dwfl);
+  kill (pid, SIGKILL);
+  waitpid (pid, NULL, 0);
+}
+
+int
+count_frame (Dwfl_Frame *state __attribute__ ((unused)), void *arg)
+{
+  int *frames = arg;
+  (*frames)++;
+  return DWARF_CB_OK;
+}
+
+#endif /* __linux__ */
@@ -0,0 +1,43 @@
+/* A child process for the dwfl_linux_proc_attach tests.
+   This file is part of elfutils.
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   elfutils is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#ifndef DWFL_PROC_CHILD_H
+#define DWFL_PROC_CHILD_H 1
+
+#include <sys/types.h>
+#include ELFUTILS_HEADER(dwfl)
+
+/* Recurses DEPTH times, then sleeps until killed.  Every frame has a
+   frame pointer.  */
+extern int child_recurse (int depth);
+
+/* Forks a child that sleeps DEPTH calls of child_recurse deep.  With
+   NTHREADS zero the main thread does that, otherwise NTHREADS threads
+   do and the main thread just sleeps.  Returns once all of them went
+   to sleep.  */
+extern pid_t start_child (int depth, int nthreads);
+
+/* Returns a Dwfl with the modules of the child PID reported, but not
+   attached yet.  */
+extern Dwfl *report_child (pid_t pid);
+
+/* Ends DWFL and kills the child PID.  */
+extern void end_child (Dwfl *dwfl, pid_t pid);
+
+/* Frame callback counting the frames in the int ARG points to.  */
+extern int count_frame (Dwfl_Frame *state, void *arg);
+
+#endif /* DWFL_PROC_CHILD_H */
@@ -0,0 +1,79 @@
+/* Test the remote memory cache of dwfl_linux_proc_attach.
+   This file is part of elfutils.
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   elfutils is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+#include <config.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#ifdef __linux__
+#include "dwfl-proc-child.h"
+#endif
+#include "system.h"
+
+#ifndef __linux__
+int
+main (int argc __attribute__ ((unused)), char **argv __attribute__ ((unused)))
+{
+  printf ("dwfl_linux_proc_attach unsupported.\n");
+  return 77;
+}
+#else /* __linux__ */
+
+/* Unwinds a child process sleeping deep in recursion.  The return
+   addresses of all frames are on a few stack pages, so most memory
+   reads must be served without a syscall.  */
+
+#define DEPTH 32
+
+int
+main (int argc __attribute__ ((unused)),
+      char **argv __attribute__ ((unused)))
+{
+  pid_t pid = start_child (DEPTH, 0);
+  Dwfl *dwfl = report_child (pid);
+
+  if (dwfl_linux_proc_memory_stats (dwfl, NULL, NULL) == 0)
+    error (-1, 0, "dwfl_linux_proc_memory_stats works without attaching");
+
+  if (dwfl_linux_proc_attach (dwfl, pid, false) != 0)
+    error (-1, 0, "dwfl_linux_proc_attach pid %d: %s", pid,
+	   dwfl_errmsg (-1));
+
+  int result = 0;
+  int frames = 0;
+  if (dwfl_getthread_frames (dwfl, pid, count_frame, &frames) != 0
+      && frames == 0)
+    {
+      /* Probably not allowed to ptrace.  */
+      printf ("dwfl_getthread_frames: %s\n", dwfl_errmsg (-1));
+      result = 77;
+    }
+  else
+    {
+      uint64_t reads, syscalls;
+      if (dwfl_linux_proc_memory_stats (dwfl, &reads, &syscalls) != 0)
+	error (-1, 0, "dwfl_linux_proc_memory_stats: %s", dwfl_errmsg (-1));
+      printf ("%d frames, %" PRIu64 " reads, %" PRIu64 " syscalls\n",
+	      frames, reads, syscalls);
+      if (frames < DEPTH || reads < (uint64_t) DEPTH
+	  || syscalls == 0 || syscalls * 4 > reads)
+	result = -1;
+    }
+
+  end_child (dwfl, pid);
+  return result;
+}
+
+#endif /* __linux__ */
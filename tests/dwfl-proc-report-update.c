@@ -0,0 +1,238 @@
+/* Test dwfl_linux_proc_report_update.
+   This file is part of elfutils.
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   elfutils is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#include <config.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/mman.h>
+#include ELFUTILS_HEADER(dwfl)
+#endif
+#include "system.h"
+
+#ifndef __linux__
+int
+main (int argc __attribute__ ((unused)), char **argv __attribute__ ((unused)))
+{
+  printf ("dwfl_linux_proc_report unsupported.\n");
+  return 77;
+}
+#else /* __linux__ */
+
+/* Maps and unmaps a file in this process and checks that updating the
+   modules finds the same ones as reporting all of them again, while the
+   modules that stayed are not touched.  */
+
+static char *debuginfo_path = NULL;
+
+static const Dwfl_Callbacks proc_callbacks =
+  {
+    .find_elf = dwfl_linux_proc_find_elf,
+    .find_debuginfo = dwfl_standard_find_debuginfo,
+    .debuginfo_path = &debuginfo_path,
+  };
+
+struct modules
+{
+  int n;
+  Dwarf_Addr last;
+  bool sorted;
+  char list[4096];
+  size_t len;
+};
+
+static int
+list_module (Dwfl_Module *mod, void **userdata __attribute__ ((unused)),
+	     const char *name, Dwarf_Addr start, void *arg)
+{
+  struct modules *modules = arg;
+  Dwarf_Addr end;
+  dwfl_module_info (mod, NULL, NULL, &end, NULL, NULL, NULL, NULL);
+  if (modules->n++ > 0 && start < modules->last)
+    modules->sorted = false;
+  modules->last = start;
+  int len = snprintf (&modules->list[modules->len],
+		      sizeof modules->list - modules->len,
+		      "%" PRIx64 "-%" PRIx64 " %s\n", start, end, name);
+  if (len > 0 && modules->len + len < sizeof modules->list)
+    modules->len += len;
+  return DWARF_CB_OK;
+}
+
+static void
+list (Dwfl *dwfl, struct modules *modules)
+{
+  modules->n = 0;
+  modules->sorted = true;
+  modules->len = 0;
+  modules->list[0] = '\0';
+  dwfl_getmodules (dwfl, list_module, modules, 0);
+}
+
+/* Check DWFL against a fresh report of all modules.  */
+static int
+check (Dwfl *dwfl, const char *what)
+{
+  Dwfl *ref = dwfl_begin (&proc_callbacks);
+  if (ref == NULL)
+    error (EXIT_FAILURE, 0, "dwfl_begin: %s", dwfl_errmsg (-1));
+  if (dwfl_linux_proc_report (ref, getpid ()) != 0)
+    error (EXIT_FAILURE, 0, "dwfl_linux_proc_report: %s", dwfl_errmsg (-1));
+  if (dwfl_report_end (ref, NULL, NULL) != 0)
+    error (EXIT_FAILURE, 0, "dwfl_report_end: %s", dwfl_errmsg (-1));
+
+  int result = dwfl_linux_proc_report_update (dwfl, getpid ());
+  if (result != 0)
+    error (EXIT_FAILURE, result == -1 ? 0 : result,
+	   "dwfl_linux_proc_report_update: %s",
+	   result == -1 ? dwfl_errmsg (-1) : "");
+
+  static struct modules modules, ref_modules;
+  list (dwfl, &modules);
+  list (ref, &ref_modules);
+  dwfl_end (ref);
+
+  printf ("%s: %s\n", what,
+	  strcmp (modules.list, ref_modules.list) == 0 ? "same" : "different");
+  if (strcmp (modules.list, ref_modules.list) != 0)
+    {
+      printf ("%s---\n%s", modules.list, ref_modules.list);
+      return 1;
+    }
+  if (! modules.sorted)
+    {
+      printf ("not sorted\n");
+      return 1;
+    }
+  return 0;
+}
+
+/* Creates a file of SIZE bytes of its own, so it cannot be merged with
+   another module.  */
+static int
+temp_file (char *name, size_t size)
+{
+  int fd = mkstemp (name);
+  if (fd < 0)
+    error (EXIT_FAILURE, errno, "mkstemp");
+  if (ftruncate (fd, size) != 0)
+    error (EXIT_FAILURE, errno, "ftruncate %s", name);
+  return fd;
+}
+
+static void
+map_at (void *addr, size_t size, int fd, const char *name)
+{
+  if (mmap (addr, size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) != addr)
+    error (EXIT_FAILURE, errno, "mmap %s", name);
+}
+
+int
+main (void)
+{
+  Dwfl *dwfl = dwfl_begin (&proc_callbacks);
+  if (dwfl == NULL)
+    error (EXIT_FAILURE, 0, "dwfl_begin: %s", dwfl_errmsg (-1));
+
+  int errors = check (dwfl, "initial");
+
+  /* The module of this program, with its symbols loaded.  */
+  Dwfl_Module *self = dwfl_addrmodule (dwfl, (uintptr_t) &main);
+  if (self == NULL || dwfl_module_getsymtab (self) <= 0)
+    error (EXIT_FAILURE, 0, "no symbols for main: %s", dwfl_errmsg (-1));
+
+  errors += check (dwfl, "unchanged");
+
+  char name[] = "proc-report-update-XXXXXX";
+  int fd = temp_file (name, 4096);
+  void *map = mmap (NULL, 4096, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (map == MAP_FAILED)
+    error (EXIT_FAILURE, errno, "mmap %s", name);
+  close (fd);
+  errors += check (dwfl, "mapped");
+  if (dwfl_addrmodule (dwfl, (uintptr_t) map) == NULL)
+    {
+      printf ("no module for the new mapping\n");
+      errors++;
+    }
+
+  munmap (map, 4096);
+  unlink (name);
+  errors += check (dwfl, "unmapped");
+  if (dwfl_addrmodule (dwfl, (uintptr_t) map) != NULL)
+    {
+      printf ("module for the removed mapping\n");
+      errors++;
+    }
+
+  /* The same file mapped twice, with another file in between so the
+     mappings are not merged, gives two modules of the same name.  */
+  size_t page = sysconf (_SC_PAGESIZE);
+  char name1[] = "proc-report-update-XXXXXX";
+  char name2[] = "proc-report-update-XXXXXX";
+  int fd1 = temp_file (name1, page);
+  int fd2 = temp_file (name2, page);
+  char *area = mmap (NULL, 3 * page, PROT_NONE,
+		     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (area == MAP_FAILED)
+    error (EXIT_FAILURE, errno, "mmap");
+  map_at (area, page, fd1, name1);
+  map_at (area + page, page, fd2, name2);
+  map_at (area + 2 * page, page, fd1, name1);
+  errors += check (dwfl, "mapped twice");
+  Dwfl_Module *first = dwfl_addrmodule (dwfl, (uintptr_t) area);
+  Dwfl_Module *second = dwfl_addrmodule (dwfl, (uintptr_t) area + 2 * page);
+  if (first == NULL || second == NULL || first == second)
+    {
+      printf ("no separate modules for both mappings\n");
+      errors++;
+    }
+
+  /* The second mapping goes away, the modules before it stay.  */
+  Dwfl_Module *between = dwfl_addrmodule (dwfl, (uintptr_t) area + page);
+  munmap (area + 2 * page, page);
+  errors += check (dwfl, "unmapped second");
+  /* AREA + 2 * PAGE itself is the end of the module between.  */
+  if (dwfl_addrmodule (dwfl, (uintptr_t) area) != first
+      || dwfl_addrmodule (dwfl, (uintptr_t) area + page) != between
+      || dwfl_addrmodule (dwfl, (uintptr_t) area + 2 * page + 1) != NULL)
+    {
+      printf ("modules of the remaining mappings were replaced\n");
+      errors++;
+    }
+
+  munmap (area, 3 * page);
+  close (fd1);
+  close (fd2);
+  unlink (name1);
+  unlink (name2);
+  errors += check (dwfl, "unmapped both");
+
+  if (dwfl_addrmodule (dwfl, (uintptr_t) &main) != self)
+    {
+      printf ("module of main was replaced\n");
+      errors++;
+    }
+
+  dwfl_end (dwfl);
+  return errors == 0 ? 0 : 1;
+}
+
+#endif /* __linux__ */
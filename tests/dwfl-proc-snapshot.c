@@ -0,0 +1,120 @@
+/* Test unwinding from a snapshot with dwfl_linux_proc_set_snapshot.
+   This file is part of elfutils.
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   elfutils is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+#include <config.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#ifdef __linux__
+#include "dwfl-proc-child.h"
+#endif
+#include "system.h"
+
+#ifndef __linux__
+int
+main (int argc __attribute__ ((unused)), char **argv __attribute__ ((unused)))
+{
+  printf ("dwfl_linux_proc_attach unsupported.\n");
+  return 77;
+}
+#else /* __linux__ */
+
+/* Unwinds a child process sleeping deep in recursion from a snapshot.
+   The child must not be stopped anymore while it is unwound, and all
+   frames must be found in the copied stack.  */
+
+#define DEPTH 32
+
+/* Whether the thread is in "t (tracing stop)".  */
+static bool
+tracing_stopped (pid_t tid)
+{
+  char buffer[64];
+  snprintf (buffer, sizeof (buffer), "/proc/%ld/status", (long) tid);
+  FILE *f = fopen (buffer, "r");
+  if (f == NULL)
+    error (-1, errno, "fopen %s", buffer);
+  bool stopped = false;
+  while (fgets (buffer, sizeof (buffer), f) != NULL)
+    if (strncmp (buffer, "State:", 6) == 0)
+      {
+	stopped = strstr (buffer, "t (tracing stop)") != NULL;
+	break;
+      }
+  fclose (f);
+  return stopped;
+}
+
+struct frames
+{
+  pid_t tid;
+  int frames;
+  bool stopped;
+};
+
+static int
+frame_callback (Dwfl_Frame *state __attribute__ ((unused)), void *arg)
+{
+  struct frames *frames = arg;
+  if (frames->frames++ == 0)
+    frames->stopped = tracing_stopped (frames->tid);
+  return DWARF_CB_OK;
+}
+
+int
+main (int argc __attribute__ ((unused)),
+      char **argv __attribute__ ((unused)))
+{
+  pid_t pid = start_child (DEPTH, 0);
+  Dwfl *dwfl = report_child (pid);
+
+  if (dwfl_linux_proc_set_snapshot (dwfl, 64 * 1024) == 0)
+    error (-1, 0, "dwfl_linux_proc_set_snapshot works without attaching");
+
+  if (dwfl_linux_proc_attach (dwfl, pid, false) != 0)
+    error (-1, 0, "dwfl_linux_proc_attach pid %d: %s", pid,
+	   dwfl_errmsg (-1));
+  if (dwfl_linux_proc_set_snapshot (dwfl, 64 * 1024) != 0)
+    error (-1, 0, "dwfl_linux_proc_set_snapshot: %s", dwfl_errmsg (-1));
+
+  int result = 0;
+  struct frames frames = { .tid = pid, .frames = 0, .stopped = false };
+  if (dwfl_getthread_frames (dwfl, pid, frame_callback, &frames) != 0
+      && frames.frames == 0)
+    {
+      /* Probably not allowed to ptrace.  */
+      printf ("dwfl_getthread_frames: %s\n", dwfl_errmsg (-1));
+      result = 77;
+    }
+  else
+    {
+      uint64_t reads, syscalls;
+      if (dwfl_linux_proc_memory_stats (dwfl, &reads, &syscalls) != 0)
+	error (-1, 0, "dwfl_linux_proc_memory_stats: %s", dwfl_errmsg (-1));
+      printf ("%d frames, %s, %" PRIu64 " reads, %" PRIu64 " syscalls\n",
+	      frames.frames, frames.stopped ? "stopped" : "running",
+	      reads, syscalls);
+      if (frames.frames < DEPTH || frames.stopped
+	  || reads < (uint64_t) DEPTH || syscalls * 4 > reads)
+	result = -1;
+    }
+
+  end_child (dwfl, pid);
+  return result;
+}
+
+#endif /* __linux__ */
@@ -0,0 +1,117 @@
+/* Test unwinding several threads at the same time with dwfl_getthreads_parallel.
+   This file is part of elfutils.
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   elfutils is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#ifdef __linux__
+#include <pthread.h>
+#include "dwfl-proc-child.h"
+#endif
+#include "system.h"
+
+#ifndef __linux__
+int
+main (int argc __attribute__ ((unused)), char **argv __attribute__ ((unused)))
+{
+  printf ("dwfl_linux_proc_attach unsupported.\n");
+  return 77;
+}
+#else /* __linux__ */
+
+/* Unwinds a child process with several threads sleeping in recursion,
+   using more unwinding threads than there are CPUs to make sure they
+   really run concurrently somewhere.  */
+
+#define NTHREADS 8
+#define DEPTH 16
+#define JOBS 4
+
+struct counts
+{
+  pthread_mutex_t lock;
+  int threads;
+  int deep_threads;
+  int failed_threads;
+};
+
+static int
+thread_callback (Dwfl_Thread *thread, void *arg)
+{
+  struct counts *counts = arg;
+  int frames = 0;
+  int res = dwfl_thread_getframes (thread, count_frame, &frames);
+
+  pthread_mutex_lock (&counts->lock);
+  counts->threads++;
+  if (frames > DEPTH)
+    counts->deep_threads++;
+  else if (res != 0 && frames == 0)
+    counts->failed_threads++;
+  pthread_mutex_unlock (&counts->lock);
+  return DWARF_CB_OK;
+}
+
+static int
+abort_callback (Dwfl_Thread *thread __attribute__ ((unused)),
+		void *arg __attribute__ ((unused)))
+{
+  return DWARF_CB_ABORT;
+}
+
+int
+main (int argc __attribute__ ((unused)),
+      char **argv __attribute__ ((unused)))
+{
+  pid_t pid = start_child (DEPTH, NTHREADS);
+  Dwfl *dwfl = report_child (pid);
+  if (dwfl_linux_proc_attach (dwfl, pid, false) != 0)
+    error (-1, 0, "dwfl_linux_proc_attach pid %d: %s", pid,
+	   dwfl_errmsg (-1));
+
+  int result = 0;
+  struct counts counts = { .threads = 0, .deep_threads = 0,
+			   .failed_threads = 0 };
+  pthread_mutex_init (&counts.lock, NULL);
+  if (dwfl_getthreads_parallel (dwfl, JOBS, thread_callback, &counts) != 0)
+    error (-1, 0, "dwfl_getthreads_parallel: %s", dwfl_errmsg (-1));
+  pthread_mutex_destroy (&counts.lock);
+
+  if (counts.failed_threads == counts.threads)
+    {
+      /* Probably not allowed to ptrace.  */
+      printf ("no thread could be unwound\n");
+      result = 77;
+    }
+  else
+    {
+      printf ("%d threads, %d deep\n", counts.threads, counts.deep_threads);
+      if (counts.threads != NTHREADS + 1 || counts.deep_threads != NTHREADS)
+	result = -1;
+
+      /* Stops at the first callback that doesn't return DWARF_CB_OK.  */
+      int res = dwfl_getthreads_parallel (dwfl, JOBS, abort_callback, NULL);
+      if (res != DWARF_CB_ABORT)
+	{
+	  printf ("abort_callback: %d\n", res);
+	  result = -1;
+	}
+    }
+
+  end_child (dwfl, pid);
+  return result;
+}
+
+#endif /* __linux__ */
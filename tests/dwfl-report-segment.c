@@ -0,0 +1,209 @@
+/* Test dwfl_report_segment with many segments out of order.
+   This file is part of elfutils.
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   elfutils is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#include <config.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include ELFUTILS_HEADER(dwfl)
+#include "system.h"
+
+/* Reports segments with gaps between them in a shuffled order, and
+   modules covering some runs of whole segments or lying inside a single
+   segment.  Then looks up the addresses around every boundary and
+   compares with a linear search.  */
+
+#define NSEGMENTS 20000
+#define PAGE 0x1000
+
+struct range
+{
+  GElf_Addr start, end;
+};
+
+static struct range segments[NSEGMENTS];
+static struct range modules[NSEGMENTS];
+static int nmodules;
+
+static unsigned int seed = 1;
+
+static unsigned int
+next_random (void)
+{
+  seed = seed * 1103515245 + 12345;
+  return (seed >> 16) & 0x7fff;
+}
+
+static int
+expected_segment (GElf_Addr addr)
+{
+  for (int i = 0; i < NSEGMENTS; i++)
+    if (addr >= segments[i].start && addr < segments[i].end)
+      return i;
+  return -1;
+}
+
+static int
+expected_module (GElf_Addr addr)
+{
+  for (int i = 0; i < nmodules; i++)
+    if (addr >= modules[i].start && addr < modules[i].end)
+      return i;
+  return -1;
+}
+
+static const Dwfl_Callbacks callbacks =
+  {
+    .find_elf = dwfl_build_id_find_elf,
+    .find_debuginfo = dwfl_standard_find_debuginfo,
+  };
+
+int
+main (void)
+{
+  GElf_Addr addr = 0x10000;
+  for (int i = 0; i < NSEGMENTS; i++)
+    {
+      /* Some segments directly follow the one before.  */
+      if (next_random () % 4 != 0)
+	addr += (1 + next_random () % 16) * PAGE;
+      segments[i].start = addr;
+      addr += (1 + next_random () % 16) * PAGE;
+      segments[i].end = addr;
+    }
+
+  for (int i = 0; i < NSEGMENTS; )
+    {
+      int kind = next_random () % 3;
+      if (kind == 0)
+	{
+	  /* Whole segments, from one start to a later end.  */
+	  int n = 1 + next_random () % 4;
+	  if (i + n > NSEGMENTS)
+	    n = NSEGMENTS - i;
+	  modules[nmodules].start = segments[i].start;
+	  modules[nmodules].end = segments[i + n - 1].end;
+	  nmodules++;
+	  i += n;
+	}
+      else if (kind == 1 && segments[i].end - segments[i].start >= 3 * PAGE)
+	{
+	  /* Inside a segment.  */
+	  modules[nmodules].start = segments[i].start + PAGE;
+	  modules[nmodules].end = segments[i].end - PAGE;
+	  nmodules++;
+	  i++;
+	}
+      else
+	i++;
+    }
+
+  Dwfl *dwfl = dwfl_begin (&callbacks);
+  if (dwfl == NULL)
+    error (EXIT_FAILURE, 0, "dwfl_begin: %s", dwfl_errmsg (-1));
+  dwfl_report_begin (dwfl);
+
+  /* Every segment once, in a shuffled order.  */
+  int *order = malloc (NSEGMENTS * sizeof order[0]);
+  if (order == NULL)
+    error (EXIT_FAILURE, errno, "malloc");
+  for (int i = 0; i < NSEGMENTS; i++)
+    order[i] = i;
+  for (int i = NSEGMENTS - 1; i > 0; i--)
+    {
+      int j = ((next_random () << 15) | next_random ()) % (i + 1);
+      int tmp = order[i];
+      order[i] = order[j];
+      order[j] = tmp;
+    }
+  for (int i = 0; i < NSEGMENTS; i++)
+    {
+      const struct range *seg = &segments[order[i]];
+      GElf_Phdr phdr =
+	{
+	  .p_type = PT_LOAD,
+	  .p_vaddr = seg->start,
+	  .p_memsz = seg->end - seg->start,
+	};
+      if (dwfl_report_segment (dwfl, order[i], &phdr, 0, NULL) != order[i])
+	error (EXIT_FAILURE, 0, "dwfl_report_segment: %s", dwfl_errmsg (-1));
+    }
+  free (order);
+
+  for (int i = 0; i < nmodules; i++)
+    {
+      char name[32];
+      snprintf (name, sizeof name, "module%d", i);
+      if (dwfl_report_module (dwfl, name, modules[i].start,
+			      modules[i].end) == NULL)
+	error (EXIT_FAILURE, 0, "dwfl_report_module: %s", dwfl_errmsg (-1));
+    }
+  if (dwfl_report_end (dwfl, NULL, NULL) != 0)
+    error (EXIT_FAILURE, 0, "dwfl_report_end: %s", dwfl_errmsg (-1));
+
+  /* Segments without modules first, modules get their boundaries added
+     to the table.  */
+  int errors = 0;
+  for (int i = 0; i < NSEGMENTS; i++)
+    {
+      GElf_Addr probes[] = { segments[i].start - 1, segments[i].start,
+			     segments[i].end - 1, segments[i].end };
+      for (size_t p = 0; p < sizeof probes / sizeof probes[0]; p++)
+	{
+	  int expected = expected_segment (probes[p]);
+	  int segndx = dwfl_addrsegment (dwfl, probes[p], NULL);
+	  /* The end of a segment is still found for it.  */
+	  if (segndx != expected
+	      && ! (expected == -1 && p == 3 && segndx == i))
+	    {
+	      printf ("%#" PRIx64 ": segment %d, expected %d\n",
+		      probes[p], segndx, expected);
+	      errors++;
+	    }
+	}
+    }
+
+  for (int i = 0; i < nmodules; i++)
+    {
+      GElf_Addr probes[] = { modules[i].start - 1, modules[i].start,
+			     modules[i].end - 1, modules[i].end };
+      for (size_t p = 0; p < sizeof probes / sizeof probes[0]; p++)
+	{
+	  int expected = expected_module (probes[p]);
+	  Dwfl_Module *mod = dwfl_addrmodule (dwfl, probes[p]);
+	  const char *name = (mod == NULL ? NULL
+			      : dwfl_module_info (mod, NULL, NULL, NULL,
+						  NULL, NULL, NULL, NULL));
+	  int found = name == NULL ? -1 : atoi (name + strlen ("module"));
+	  /* The end of a module is still found for it.  */
+	  if (found != expected
+	      && ! (expected == -1 && p == 3 && found == i))
+	    {
+	      printf ("%#" PRIx64 ": module %d, expected %d\n",
+		      probes[p], found, expected);
+	      errors++;
+	    }
+	}
+    }
+
+  dwfl_end (dwfl);
+
+  printf ("%d segments, %d modules, %d errors\n",
+	  NSEGMENTS, nmodules, errors);
+  return errors == 0 ? 0 : 1;
+}
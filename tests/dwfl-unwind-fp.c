@@ -0,0 +1,98 @@
+/* Test frame pointer unwinding with dwfl_set_unwind_policy.
+   This file is part of elfutils.
+
+   This file is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   elfutils is distributed in the hope that it will be useful, but
+   WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#ifdef __linux__
+#include "dwfl-proc-child.h"
+#endif
+#include "system.h"
+
+#if !defined __linux__ || !(defined __x86_64__ || defined __aarch64__)
+int
+main (int argc __attribute__ ((unused)), char **argv __attribute__ ((unused)))
+{
+  printf ("frame pointer unwinding not tested here.\n");
+  return 77;
+}
+#else
+
+/* Unwinds a child process sleeping deep in recursion, whose frames
+   all have a frame pointer, with the frame pointer only.  */
+
+#define DEPTH 32
+
+static int
+count_frames (Dwfl *dwfl, pid_t pid, int policy)
+{
+  if (dwfl_set_unwind_policy (dwfl, policy) != 0)
+    error (-1, 0, "dwfl_set_unwind_policy: %s", dwfl_errmsg (-1));
+  int frames = 0;
+  dwfl_getthread_frames (dwfl, pid, count_frame, &frames);
+  return frames;
+}
+
+int
+main (int argc __attribute__ ((unused)),
+      char **argv __attribute__ ((unused)))
+{
+  pid_t pid = start_child (DEPTH, 0);
+  Dwfl *dwfl = report_child (pid);
+  if (dwfl_linux_proc_attach (dwfl, pid, false) != 0)
+    error (-1, 0, "dwfl_linux_proc_attach pid %d: %s", pid,
+	   dwfl_errmsg (-1));
+
+  int result = 0;
+  if (dwfl_set_unwind_policy (dwfl, DWFL_UNWIND_FP_ONLY + 1) == 0)
+    {
+      printf ("invalid policy accepted\n");
+      result = -1;
+    }
+
+  int fp_frames = count_frames (dwfl, pid, DWFL_UNWIND_FP_ONLY);
+  int cfi_frames = count_frames (dwfl, pid, DWFL_UNWIND_CFI_FIRST);
+  if (cfi_frames == 0)
+    {
+      /* Probably not allowed to ptrace.  */
+      printf ("dwfl_getthread_frames: %s\n", dwfl_errmsg (-1));
+      result = 77;
+    }
+  else
+    {
+      /* pause might not set up a frame, in which case following the frame
+	 pointer skips the innermost child_recurse call.  */
+      printf ("%d fp-only frames, %d cfi frames\n", fp_frames, cfi_frames);
+      if (fp_frames < DEPTH || fp_frames > cfi_frames)
+	result = -1;
+
+      /* The frames in the executable are unwound with CFI first for the
+	 executable, still following the frame pointer elsewhere.  */
+      Dwfl_Module *mod = dwfl_addrmodule (dwfl,
+					  (Dwarf_Addr) &child_recurse);
+      if (mod == NULL
+	  || dwfl_module_set_unwind_policy (mod, DWFL_UNWIND_CFI_FIRST) != 0)
+	error (-1, 0, "dwfl_module_set_unwind_policy: %s", dwfl_errmsg (-1));
+      int mixed_frames = count_frames (dwfl, pid, DWFL_UNWIND_FP_ONLY);
+      printf ("%d mixed frames\n", mixed_frames);
+      if (mixed_frames < DEPTH)
+	result = -1;
+    }
+
+  end_child (dwfl, pid);
+  return result;
+}
+
+#endif
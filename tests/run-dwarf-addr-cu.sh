@@ -0,0 +1,108 @@
+#! /bin/sh
+# This file is part of elfutils.
+#
+# This file is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 3 of the License, or
+# (at your option) any later version.
+#
+# elfutils is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+. $srcdir/test-subr.sh
+
+# dwarf_addrdie must find all units, also the ones .debug_aranges
+# doesn't describe.
+
+# see tests/testfile-dwarf-45.source
+testfiles testfile-dwarf-4 testfile-dwarf-5
+testfiles testfile-splitdwarf-5 testfile-hello5.dwo testfile-world5.dwo
+
+testrun_compare ${abs_builddir}/dwarf-addr-cu testfile-dwarf-4 <<\EOF
+2 units, 3 ranges, 0 units without aranges
+EOF
+
+testrun_compare ${abs_builddir}/dwarf-addr-cu testfile-dwarf-5 <<\EOF
+2 units, 3 ranges, 0 units without aranges
+EOF
+
+testrun_compare ${abs_builddir}/dwarf-addr-cu testfile-splitdwarf-5 <<\EOF
+2 units, 3 ranges, 0 units without aranges
+EOF
+
+# No .debug_aranges at all, see run-readelf-line.sh.
+testfiles testfile-ppc64-min-instr
+
+testrun_compare ${abs_builddir}/dwarf-addr-cu testfile-ppc64-min-instr <<\EOF
+1 units, 1 ranges, 1 units without aranges
+EOF
+
+testrun_compare ${abs_top_builddir}/src/addr2line -f -e testfile-ppc64-min-instr 0x100005a4 0x100005f4 <<\EOF
+main
+/home/fedora/mjw/hello.c:6:27
+main
+/home/fedora/mjw/hello.c:8:3
+EOF
+
+# .debug_aranges only describes the first of two units.
+testfiles testfile-strtab
+
+testrun_compare ${abs_builddir}/dwarf-addr-cu testfile-strtab <<\EOF
+2 units, 2 ranges, 1 units without aranges
+EOF
+
+# The code of unused was dropped by the linker, its ranges start at
+# zero and cover main and used.
+#
+# m.c:
+# extern int used (int);
+#
+# int
+# main (int argc, char **argv)
+# {
+#   return used (argc);
+# }
+#
+# b.c:
+# #define S4(x) x x x x
+# volatile int sink;
+#
+# int
+# unused (int i)
+# {
+#   S4 (S4 (S4 (S4 (S4 (sink = sink * i + 3;)))))
+#   return sink;
+# }
+#
+# int
+# used (int i)
+# {
+#   return i + 1;
+# }
+#
+# gcc -g -O2 -ffunction-sections -Wl,--gc-sections \
+#   -o testfile-gc-sections m.c b.c
+testfiles testfile-gc-sections
+
+testrun_compare ${abs_builddir}/dwarf-addr-cu testfile-gc-sections <<\EOF
+2 units, 2 ranges, 0 units without aranges
+EOF
+
+testrun_compare ${abs_top_builddir}/src/addr2line -f -e testfile-gc-sections 0x1040 0x1044 0x1140 <<\EOF
+main
+/tmp/gc/m.c:6:10
+main
+/tmp/gc/m.c:6:10
+used
+/tmp/gc/b.c:14:12
+EOF
+
+# Self test
+testrun_on_self_quiet ${abs_builddir}/dwarf-addr-cu
+
+exit 0
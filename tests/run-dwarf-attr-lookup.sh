@@ -0,0 +1,47 @@
+#! /bin/sh
+# This file is part of elfutils.
+#
+# This file is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 3 of the License, or
+# (at your option) any later version.
+#
+# elfutils is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+. $srcdir/test-subr.sh
+
+# dwarf_attr must find the same attribute values as dwarf_getattrs,
+# both for fixed and variable length forms and DW_FORM_implicit_const.
+
+# see tests/testfile-dwarf-45.source
+testfiles testfile-dwarf-4 testfile-splitdwarf-5 testfile-hello5.dwo
+
+# DW_FORM_implicit_const, see run-readelf-const-values.sh
+testfiles testfile-const-values.debug
+
+testrun_compare ${abs_builddir}/dwarf-attr-lookup testfile-dwarf-4 <<\EOF
+74 DIEs, 317 attributes
+EOF
+
+testrun_compare ${abs_builddir}/dwarf-attr-lookup testfile-splitdwarf-5 <<\EOF
+2 DIEs, 15 attributes
+EOF
+
+testrun_compare ${abs_builddir}/dwarf-attr-lookup testfile-hello5.dwo <<\EOF
+38 DIEs, 158 attributes
+EOF
+
+testrun_compare ${abs_builddir}/dwarf-attr-lookup testfile-const-values.debug <<\EOF
+31 DIEs, 126 attributes
+EOF
+
+# Self test
+testrun_on_self_quiet ${abs_builddir}/dwarf-attr-lookup
+
+exit 0
@@ -0,0 +1,56 @@
+#! /bin/sh
+# This file is part of elfutils.
+#
+# This file is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 3 of the License, or
+# (at your option) any later version.
+#
+# elfutils is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+. $srcdir/test-subr.sh
+
+# All threads walk all units of the same Dwarf, filling the location,
+# line, macro and split unit caches concurrently.
+
+# see tests/testfile-dwarf-45.source
+testfiles testfile-splitdwarf-4 testfile-hello4.dwo testfile-world4.dwo
+testfiles testfile-splitdwarf-5 testfile-hello5.dwo testfile-world5.dwo
+
+testrun_compare ${abs_builddir}/dwarf-cache-threads -j 8 testfile-splitdwarf-4 <<\EOF
+4 units, 76 DIEs, 33 location expressions
+114 lines, 16 files, 26 decl_files
+0 macros, 3 aranges
+EOF
+
+testrun_compare ${abs_builddir}/dwarf-cache-threads -j 8 testfile-splitdwarf-5 <<\EOF
+4 units, 76 DIEs, 33 location expressions
+114 lines, 16 files, 26 decl_files
+0 macros, 3 aranges
+EOF
+
+# see run-dwarf-getmacros.sh
+testfiles testfile51 testfile-macros
+
+testrun_compare ${abs_builddir}/dwarf-cache-threads -j 8 testfile51 <<\EOF
+2 units, 7 DIEs, 9 location expressions
+8 lines, 4 files, 3 decl_files
+264 macros, 2 aranges
+EOF
+
+testrun_compare ${abs_builddir}/dwarf-cache-threads -j 8 testfile-macros <<\EOF
+1 units, 11 DIEs, 3 location expressions
+4 lines, 11 files, 3 decl_files
+429 macros, 1 aranges
+EOF
+
+# Self test
+testrun_on_self_quiet ${abs_builddir}/dwarf-cache-threads -j 8
+
+exit 0
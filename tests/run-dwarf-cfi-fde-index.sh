@@ -0,0 +1,85 @@
+#! /bin/sh
+# This file is part of elfutils.
+#
+# This file is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 3 of the License, or
+# (at your option) any later version.
+#
+# elfutils is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+. $srcdir/test-subr.sh
+
+# Looking up FDEs through the index must give the same frames as
+# reading the CFI entries in order or using .eh_frame_hdr.
+
+# See run-dwarfcfi.sh
+testfiles testfile11-debugframe testfile12-debugframe
+
+testrun_compare ${abs_builddir}/dwarf-cfi-fde-index testfile11-debugframe <<\EOF
+.eh_frame: none
+.debug_frame: 75 addresses, 26 with frame
+EOF
+
+testrun_compare ${abs_builddir}/dwarf-cfi-fde-index testfile12-debugframe <<\EOF
+.eh_frame: none
+.debug_frame: 35 addresses, 3 with frame
+EOF
+
+# Both .eh_frame and .debug_frame, see run-addrcfi.sh
+testfiles testfile11
+
+testrun_compare ${abs_builddir}/dwarf-cfi-fde-index testfile11 <<\EOF
+.eh_frame: 75 addresses, 14 with frame
+.debug_frame: 75 addresses, 26 with frame
+EOF
+
+# The linker leaves the .debug_frame FDE of unused at zero, covering
+# main and used.  It must not hide their FDEs.
+#
+# u.c:
+# volatile int v;
+#
+# int
+# unused (void)
+# {
+# #define A v++; v++; v++; v++; v++; v++; v++; v++;
+# #define B A A A A A A A A
+#   B B B B B B B B
+#   return v;
+# }
+#
+# int
+# used (int i)
+# {
+#   return v + i;
+# }
+#
+# m.c:
+# extern int used (int);
+#
+# int
+# main (void)
+# {
+#   return used (1);
+# }
+#
+# gcc -g -O0 -fno-asynchronous-unwind-tables -ffunction-sections -c u.c m.c
+# gcc -nostartfiles -e main -Wl,--gc-sections -o testfile-gc-frames m.o u.o
+testfiles testfile-gc-frames
+
+testrun_compare ${abs_builddir}/dwarf-cfi-fde-index testfile-gc-frames <<\EOF
+.eh_frame: none
+.debug_frame: 10 addresses, 8 with frame
+EOF
+
+# Self test
+testrun_on_self_quiet ${abs_builddir}/dwarf-cfi-fde-index
+
+exit 0
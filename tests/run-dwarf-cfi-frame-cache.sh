@@ -0,0 +1,43 @@
+#! /bin/sh
+# This file is part of elfutils.
+#
+# This file is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 3 of the License, or
+# (at your option) any later version.
+#
+# elfutils is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+# The second lookup of each address must be answered from the frames
+# remembered by the first, as long as they all fit in the cache.
+
+# See run-dwarfcfi.sh
+testfiles testfile11-debugframe testfile12-debugframe
+
+testrun_compare ${abs_builddir}/dwarf-cfi-frame-cache testfile11-debugframe <<\EOF
+.eh_frame: none
+.debug_frame: 30 addresses, 16 with frame, 0 and 16 hits
+EOF
+
+testrun_compare ${abs_builddir}/dwarf-cfi-frame-cache testfile12-debugframe <<\EOF
+.eh_frame: none
+.debug_frame: 14 addresses, 2 with frame, 0 and 2 hits
+EOF
+
+# Both .eh_frame and .debug_frame, see run-addrcfi.sh
+testfiles testfile11
+
+testrun_compare ${abs_builddir}/dwarf-cfi-frame-cache testfile11 <<\EOF
+.eh_frame: 30 addresses, 8 with frame, 0 and 8 hits
+.debug_frame: 30 addresses, 16 with frame, 0 and 16 hits
+EOF
+
+# Self test, more frames than fit in the cache
+testrun_on_self_quiet ${abs_builddir}/dwarf-cfi-frame-cache
+
+exit 0
@@ -0,0 +1,40 @@
+#! /bin/sh
+# This file is part of elfutils.
+#
+# This file is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 3 of the License, or
+# (at your option) any later version.
+#
+# elfutils is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+. $srcdir/test-subr.sh
+
+# See run-typeiter.sh
+testfiles testfile-debug-types
+
+testrun_compare ${abs_builddir}/dwarf-cu-lookup testfile-debug-types <<\EOF
+testfile-debug-types: 3 units, 13 DIEs
+EOF
+
+# see tests/testfile-dwarf-45.source
+testfiles testfile-dwarf-4 testfile-dwarf-5
+
+testrun_compare ${abs_builddir}/dwarf-cu-lookup testfile-dwarf-4 <<\EOF
+testfile-dwarf-4: 2 units, 74 DIEs
+EOF
+
+testrun_compare ${abs_builddir}/dwarf-cu-lookup testfile-dwarf-5 <<\EOF
+testfile-dwarf-5: 2 units, 74 DIEs
+EOF
+
+# Self test, libdw.so has a couple of hundred CUs.
+testrun_on_self ${abs_builddir}/dwarf-cu-lookup
+
+exit 0
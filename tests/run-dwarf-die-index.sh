@@ -0,0 +1,61 @@
+#! /bin/sh
+# This file is part of elfutils.
+#
+# This file is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 3 of the License, or
+# (at your option) any later version.
+#
+# elfutils is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+. $srcdir/test-subr.sh
+
+# The DIE index must describe the same tree as dwarf_child and
+# dwarf_siblingof, also when walking siblings a second time.
+# dwarf_getscopes and dwarf_getscopes_die must give the same
+# results with and without the index.
+
+# see tests/testfile-dwarf-45.source
+testfiles testfile-dwarf-4 testfile-dwarf-5
+testfiles testfile-splitdwarf-5 testfile-hello5.dwo testfile-world5.dwo
+
+# .debug_types, see run-typeiter.sh
+testfiles testfile-debug-types
+
+testrun_compare ${abs_builddir}/dwarf-die-index testfile-dwarf-4 <<\EOF
+2 units, 74 DIEs, 235 scopes
+EOF
+
+testrun_compare ${abs_builddir}/dwarf-die-index testfile-dwarf-5 <<\EOF
+2 units, 74 DIEs, 230 scopes
+EOF
+
+testrun_compare ${abs_builddir}/dwarf-die-index testfile-splitdwarf-5 <<\EOF
+2 units, 2 DIEs, 0 scopes
+EOF
+
+testrun_compare ${abs_builddir}/dwarf-die-index testfile-hello5.dwo <<\EOF
+1 units, 38 DIEs, 113 scopes
+EOF
+
+testrun_compare ${abs_builddir}/dwarf-die-index testfile-debug-types <<\EOF
+3 units, 13 DIEs, 27 scopes
+EOF
+
+# Inlined functions, see run-addrscopes.sh
+testfiles testfile24
+
+testrun_compare ${abs_builddir}/dwarf-die-index testfile24 <<\EOF
+1 units, 18 DIEs, 57 scopes
+EOF
+
+# Self test
+testrun_on_self_quiet ${abs_builddir}/dwarf-die-index
+
+exit 0
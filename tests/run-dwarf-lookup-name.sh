@@ -0,0 +1,208 @@
+#! /bin/sh
+# This file is part of elfutils.
+#
+# This file is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 3 of the License, or
+# (at your option) any later version.
+#
+# elfutils is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+. $srcdir/test-subr.sh
+
+# See run-readelf-gdb_index.sh for how testfilegdbindex7 was built.
+testfiles testfilegdbindex7
+
+# Only CUs are reported, foo is only defined in a type unit.
+
+testrun_compare ${abs_builddir}/dwarf-lookup-name testfilegdbindex7 \
+	main say global hello foo nosuchname <<\EOF
+main:
+ "main", die: 11, cu: 11
+CU name: "hello.c"
+tag: 0x11
+1 found
+say:
+ "say", die: 195, cu: 195
+CU name: "world.c"
+tag: 0x11
+1 found
+global:
+ "global", die: 195, cu: 195
+CU name: "world.c"
+tag: 0x11
+1 found
+hello:
+ "hello", die: 11, cu: 11
+CU name: "hello.c"
+tag: 0x11
+ "hello", die: 195, cu: 195
+CU name: "world.c"
+tag: 0x11
+2 found
+foo:
+0 found
+nosuchname:
+0 found
+EOF
+
+# No index section, all DIEs are scanned.  Like .debug_names the scan
+# finds the inlined instances of fubar, but not its abstract instance.
+# See run-addr2line-i-test.sh for how testfile-inlines was built.
+testfiles testfile-inlines
+
+testrun_compare ${abs_builddir}/dwarf-lookup-name testfile-inlines \
+	fubar fu nosuchname <<\EOF
+fubar:
+ "fubar", die: 104, cu: 11
+CU name: "x.cpp"
+tag: 0x2e
+ "fubar", die: 205, cu: 11
+CU name: "x.cpp"
+tag: 0x1d
+ "fubar", die: 337, cu: 11
+CU name: "x.cpp"
+tag: 0x1d
+ "fubar", die: 391, cu: 11
+CU name: "x.cpp"
+tag: 0x1d
+4 found
+fu:
+ "fu", die: 362, cu: 11
+CU name: "x.cpp"
+tag: 0x2e
+1 found
+nosuchname:
+0 found
+EOF
+
+# A DWARF5 .debug_names index as LLVM writes it.  The same file without
+# the section is scanned, both must give the same answers.  square is
+# only found as inlined subroutine, the local variable p not at all.
+#
+# t.rs:
+# #![no_std]
+# #![no_main]
+#
+# pub struct Point {
+#     pub x: i32,
+#     pub y: i32,
+# }
+#
+# #[no_mangle]
+# pub static mut COUNTER: i32 = 0;
+#
+# #[inline(always)]
+# fn square(v: i32) -> i32 {
+#     v * v
+# }
+#
+# #[inline(never)]
+# fn length(p: &Point) -> i32 {
+#     square(p.x) + square(p.y)
+# }
+#
+# #[no_mangle]
+# pub extern "C" fn main(argc: i32, _argv: *const *const u8) -> i32 {
+#     let p = Point { x: argc, y: 2 };
+#     unsafe { COUNTER += 1; }
+#     length(&p)
+# }
+#
+# #[panic_handler]
+# fn panic(_: &core::panic::PanicInfo) -> ! {
+#     loop {}
+# }
+#
+# rustc -O -g -C panic=abort -C dwarf-version=5 \
+#   -C llvm-args=-accel-tables=Dwarf -C link-arg=-nostartfiles \
+#   -C link-arg=-Wl,-e,main -o testfile-debug-names t.rs
+# objcopy --remove-section=.debug_names testfile-debug-names \
+#   testfile-debug-names-noindex
+testfiles testfile-debug-names testfile-debug-names-noindex
+
+for file in testfile-debug-names testfile-debug-names-noindex; do
+  testrun_compare ${abs_builddir}/dwarf-lookup-name $file \
+	main length square _ZN1t6length17h04918b6932da5db8E \
+	_ZN1t6square17hf6db4628471ea600E COUNTER Point panic t i32 p argc \
+	nosuchname <<\EOF
+main:
+ "main", die: 126, cu: 12
+CU name: "t.rs/@/t.23a8a0dd14af99bc-cgu.0"
+tag: 0x2e
+1 found
+length:
+ "length", die: 79, cu: 12
+CU name: "t.rs/@/t.23a8a0dd14af99bc-cgu.0"
+tag: 0x2e
+1 found
+square:
+ "square", die: 104, cu: 12
+CU name: "t.rs/@/t.23a8a0dd14af99bc-cgu.0"
+tag: 0x1d
+1 found
+_ZN1t6length17h04918b6932da5db8E:
+ "_ZN1t6length17h04918b6932da5db8E", die: 79, cu: 12
+CU name: "t.rs/@/t.23a8a0dd14af99bc-cgu.0"
+tag: 0x2e
+1 found
+_ZN1t6square17hf6db4628471ea600E:
+ "_ZN1t6square17hf6db4628471ea600E", die: 104, cu: 12
+CU name: "t.rs/@/t.23a8a0dd14af99bc-cgu.0"
+tag: 0x1d
+1 found
+COUNTER:
+ "COUNTER", die: 49, cu: 12
+CU name: "t.rs/@/t.23a8a0dd14af99bc-cgu.0"
+tag: 0x34
+1 found
+Point:
+ "Point", die: 201, cu: 12
+CU name: "t.rs/@/t.23a8a0dd14af99bc-cgu.0"
+tag: 0x13
+1 found
+panic:
+ "panic", die: 179, cu: 12
+CU name: "t.rs/@/t.23a8a0dd14af99bc-cgu.0"
+tag: 0x2e
+ "panic", die: 276, cu: 12
+CU name: "t.rs/@/t.23a8a0dd14af99bc-cgu.0"
+tag: 0x39
+2 found
+t:
+ "t", die: 47, cu: 12
+CU name: "t.rs/@/t.23a8a0dd14af99bc-cgu.0"
+tag: 0x39
+1 found
+i32:
+ "i32", die: 226, cu: 12
+CU name: "t.rs/@/t.23a8a0dd14af99bc-cgu.0"
+tag: 0x24
+1 found
+p:
+0 found
+argc:
+0 found
+nosuchname:
+0 found
+EOF
+done
+
+# testfile-inlines with the abbrev code of DIE 0x36 changed to 0x7f,
+# which is not in .debug_abbrev.  The scan must report the bad DWARF,
+# not running out of memory.
+testfiles testfile-lookup-name-invalid
+
+testrun_compare ${abs_builddir}/dwarf-lookup-name \
+	testfile-lookup-name-invalid fubar <<\EOF
+fubar:
+dwarf_lookup_name failed: invalid DWARF
+EOF
+
+exit 0
@@ -0,0 +1,33 @@
+#! /bin/sh
+# This file is part of elfutils.
+#
+# This file is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 3 of the License, or
+# (at your option) any later version.
+#
+# elfutils is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+. $srcdir/test-subr.sh
+
+# see tests/testfile-dwarf-45.source
+testfiles testfile-dwarf-4 testfile-dwarf-5
+
+testrun_compare ${abs_builddir}/dwarf-mt-alloc -j 4 testfile-dwarf-4 <<\EOF
+74 DIEs, 33 location expressions
+EOF
+
+testrun_compare ${abs_builddir}/dwarf-mt-alloc -j 4 testfile-dwarf-5 <<\EOF
+74 DIEs, 33 location expressions
+EOF
+
+# Self test
+testrun_on_self ${abs_builddir}/dwarf-mt-alloc -j 8
+
+exit 0
@@ -0,0 +1,54 @@
+#! /bin/sh
+# This file is part of elfutils.
+#
+# This file is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 3 of the License, or
+# (at your option) any later version.
+#
+# elfutils is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+. $srcdir/test-subr.sh
+
+# see tests/testfile-dwarf-45.source
+testfiles testfile-splitdwarf-4 testfile-hello4.dwo testfile-world4.dwo
+testfiles testfile-splitdwarf-5 testfile-hello5.dwo testfile-world5.dwo
+
+testrun_compare ${abs_builddir}/dwarf-preload-units -j 2 testfile-splitdwarf-4 <<\EOF
+4 units, 76 DIEs, 114 lines
+EOF
+
+testrun_compare ${abs_builddir}/dwarf-preload-units -j 2 testfile-splitdwarf-5 <<\EOF
+4 units, 76 DIEs, 114 lines
+EOF
+
+# Only the line tables, the split units use those of their skeleton.
+testrun_compare ${abs_builddir}/dwarf-preload-units -j 2 -l testfile-splitdwarf-5 <<\EOF
+4 units, 76 DIEs, 114 lines
+EOF
+
+# See run-typeiter.sh
+testfiles testfile-debug-types
+
+testrun_compare ${abs_builddir}/dwarf-preload-units -j 2 testfile-debug-types <<\EOF
+3 units, 13 DIEs, 9 lines
+EOF
+
+# see run-readelf-dwz-multi.sh
+testfiles testfile_multi_main testfile_multi.dwz
+
+testrun_compare ${abs_builddir}/dwarf-preload-units -j 2 testfile_multi_main <<\EOF
+1 units, 8 DIEs, 6 lines
+EOF
+
+# Self test
+testrun_on_self ${abs_builddir}/dwarf-preload-units -j 4
+testrun_on_self ${abs_builddir}/dwarf-preload-units -j 4 -l
+
+exit 0
@@ -0,0 +1,72 @@
+#! /bin/sh
+# This file is part of elfutils.
+#
+# This file is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 3 of the License, or
+# (at your option) any later version.
+#
+# elfutils is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+. $srcdir/test-subr.sh
+
+# The testfiles are those of run-dwflsyms.sh: a full symtab, separate
+# debuginfo, only a dynsym, a minidebuginfo aux symtab, ppc64 function
+# descriptors and a relocatable kernel module.
+
+testfiles testfilebaztab
+testfiles testfilebazdbg testfilebazdbg.debug
+testfiles testfilebazdyn
+testfiles testfilebazmdb
+testfiles testfilebazmin
+testfiles testfilebaxmin
+testfiles testfile66 testfile66.core
+testfiles hello_ppc64.ko
+
+testrun_compare ${abs_builddir}/dwfl-addrsym-index -e testfilebaztab <<\EOF
+225 addresses, 125 with symbol
+EOF
+
+testrun_compare ${abs_builddir}/dwfl-addrsym-index -e testfilebazdbg <<\EOF
+225 addresses, 125 with symbol
+EOF
+
+testrun_compare ${abs_builddir}/dwfl-addrsym-index -e testfilebazdyn <<\EOF
+29 addresses, 16 with symbol
+EOF
+
+testrun_compare ${abs_builddir}/dwfl-addrsym-index -e testfilebazmdb <<\EOF
+225 addresses, 125 with symbol
+EOF
+
+testrun_compare ${abs_builddir}/dwfl-addrsym-index -e testfilebazmin <<\EOF
+150 addresses, 67 with symbol
+EOF
+
+testrun_compare ${abs_builddir}/dwfl-addrsym-index -e testfilebaxmin <<\EOF
+136 addresses, 60 with symbol
+EOF
+
+testrun_compare ${abs_builddir}/dwfl-addrsym-index -e testfile66 <<\EOF
+52 addresses, 17 with symbol
+EOF
+
+testrun_compare ${abs_builddir}/dwfl-addrsym-index -e testfile66 --core=testfile66.core <<\EOF
+ld64.so.1: Callback returned failure
+105 addresses, 51 with symbol
+EOF
+
+testrun_compare ${abs_builddir}/dwfl-addrsym-index -e hello_ppc64.ko <<\EOF
+120 addresses, 70 with symbol
+EOF
+
+# Check against ourselves.
+testrun ${abs_builddir}/dwfl-addrsym-index -e ${abs_builddir}/dwfl-addrsym-index
+
+exit 0
@@ -0,0 +1,33 @@
+#! /bin/sh
+# This file is part of elfutils.
+#
+# This file is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 3 of the License, or
+# (at your option) any later version.
+#
+# elfutils is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+. $srcdir/test-subr.sh
+
+# See testfile-cfi-rules.s for how it was built.  The return address
+# of each rule evaluated without expr_eval must be the one expr_eval
+# gives.  The registers start out as 0x1000 * (regno + 1), rsp as
+# 0x7ff000, and memory at ADDR holds 0x100000 + ADDR.
+testfiles testfile-cfi-rules
+
+testrun_compare ${abs_builddir}/dwfl-frame-rules -e testfile-cfi-rules <<\EOF
+register: 0x4000
+breg_offset: 0x8ff018
+same_value: 0x401006
+breg_deref: 0x8ff020
+val_offset: 0x7ff000
+val_breg_offset: 0x4008
+offset: 0x8ff000
+cfa_deref: 0x9ff020
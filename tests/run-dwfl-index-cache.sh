@@ -0,0 +1,28 @@
+#! /bin/sh
+# This file is part of elfutils.
+#
+# This file is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 3 of the License, or
+# (at your option) any later version.
+#
+# elfutils is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+. $srcdir/test-subr.sh
+
+testfiles testfile_nested_funcs
+
+testrun_compare ${abs_builddir}/dwfl-index-cache testfile_nested_funcs <<\EOF
+71 symbols, 0 errors
+EOF
+
+# Check against ourselves, with many more symbols.
+testrun ${abs_builddir}/dwfl-index-cache ${abs_builddir}/dwfl-index-cache > /dev/null
+
+exit 0
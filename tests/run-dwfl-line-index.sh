@@ -0,0 +1,49 @@
+#! /bin/sh
+# This file is part of elfutils.
+#
+# This file is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 3 of the License, or
+# (at your option) any later version.
+#
+# elfutils is distributed in the hope that it will be useful, but
+# WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+. $srcdir/test-subr.sh
+
+# See run-addr2line-i-test.sh for how testfile-inlines was built.
+testfiles testfile-inlines testfile_nested_funcs
+
+testrun_compare ${abs_builddir}/dwfl-line-index -e testfile-inlines <<\EOF
+132 addresses, 67 with line
+EOF
+
+testrun_compare ${abs_builddir}/dwfl-line-index -e testfile_nested_funcs <<\EOF
+104 addresses, 33 with line
+EOF
+
+# see tests/testfile-dwarf-45.source
+testfiles testfile-splitdwarf-5 testfile-hello5.dwo testfile-world5.dwo
+
+testrun_compare ${abs_builddir}/dwfl-line-index -e testfile-splitdwarf-5 <<\EOF
+246 addresses, 160 with line
+EOF
+
+# Lines of code the linker dropped start at zero, they must not be
+# found through the index when they aren't without it.
+# See run-dwarf-addr-cu.sh for how testfile-gc-sections was built.
+testfiles testfile-gc-sections
+
+testrun_compare ${abs_builddir}/dwfl-line-index -e testfile-gc-sections <<\EOF
+3157 addresses, 21 with line
+EOF
+
+# Check against ourselves.
+testrun ${abs_builddir}/dwfl-line-index -e ${abs_builddir}/dwfl-line-index
+
+exit 0
@@ -0,0 +1,170 @@
+# CFI register rules for run-dwfl-frame-rules.sh.
+#
+# gcc -nostdlib -no-pie -o testfile-cfi-rules testfile-cfi-rules.s
+#
+# handle_cfi evaluates the rule of each _fast function without
+# expr_eval.  The _slow function after it has the same rule written
+# as an expression fast_expr_eval does not take, so expr_eval
+# computes it.
+
+	.text
+	.globl	_start
+_start:
+
+# offset(-16): rip is saved at CFA - 16.
+	.globl	offset_fast
+	.type	offset_fast, @function
+offset_fast:
+	.cfi_startproc
+	.cfi_def_cfa rsp, 16
+	.cfi_offset rip, -16
+	nop
+	.cfi_endproc
+	.size	offset_fast, .-offset_fast
+	.globl	offset_slow
+	.type	offset_slow, @function
+offset_slow:
+	.cfi_startproc
+	.cfi_def_cfa rsp, 16
+# expression: lit16, minus
+	.cfi_escape 0x10, 0x10, 2, 0x40, 0x1c
+	nop
+	.cfi_endproc
+	.size	offset_slow, .-offset_slow
+
+# val_offset(-16): rip is CFA - 16.
+	.globl	val_offset_fast
+	.type	val_offset_fast, @function
+val_offset_fast:
+	.cfi_startproc
+	.cfi_def_cfa rsp, 16
+	.cfi_escape 0x14, 0x10, 2
+	nop
+	.cfi_endproc
+	.size	val_offset_fast, .-val_offset_fast
+	.globl	val_offset_slow
+	.type	val_offset_slow, @function
+val_offset_slow:
+	.cfi_startproc
+	.cfi_def_cfa rsp, 16
+# val_expression: lit16, minus
+	.cfi_escape 0x16, 0x10, 2, 0x40, 0x1c
+	nop
+	.cfi_endproc
+	.size	val_offset_slow, .-val_offset_slow
+
+# register(rbx): rip is in rbx.
+	.globl	register_fast
+	.type	register_fast, @function
+register_fast:
+	.cfi_startproc
+	.cfi_register rip, rbx
+	nop
+	.cfi_endproc
+	.size	register_fast, .-register_fast
+	.globl	register_slow
+	.type	register_slow, @function
+register_slow:
+	.cfi_startproc
+# val_expression: breg3 0, lit0, plus
+	.cfi_escape 0x16, 0x10, 4, 0x73, 0, 0x30, 0x22
+	nop
+	.cfi_endproc
+	.size	register_slow, .-register_slow
+
+# same_value: rip is unchanged.
+	.globl	same_value_fast
+	.type	same_value_fast, @function
+same_value_fast:
+	.cfi_startproc
+	.cfi_same_value rip
+	nop
+	.cfi_endproc
+	.size	same_value_fast, .-same_value_fast
+	.globl	same_value_slow
+	.type	same_value_slow, @function
+same_value_slow:
+	.cfi_startproc
+# val_expression: bregx 16 -1, lit0, plus
+# same_value_fast is the one byte before.
+	.cfi_escape 0x16, 0x10, 5, 0x92, 0x10, 0x7f, 0x30, 0x22
+	nop
+	.cfi_endproc
+	.size	same_value_slow, .-same_value_slow
+
+# expression(breg7 24): rip is saved at rsp + 24.
+	.globl	breg_offset_fast
+	.type	breg_offset_fast, @function
+breg_offset_fast:
+	.cfi_startproc
+	.cfi_escape 0x10, 0x10, 2, 0x77, 24
+	nop
+	.cfi_endproc
+	.size	breg_offset_fast, .-breg_offset_fast
+	.globl	breg_offset_slow
+	.type	breg_offset_slow, @function
+breg_offset_slow:
+	.cfi_startproc
+# expression: breg7 0, plus_uconst 24
+	.cfi_escape 0x10, 0x10, 4, 0x77, 0, 0x23, 24
+	nop
+	.cfi_endproc
+	.size	breg_offset_slow, .-breg_offset_slow
+
+# val_expression(breg3 8): rip is rbx + 8.
+	.globl	val_breg_offset_fast
+	.type	val_breg_offset_fast, @function
+val_breg_offset_fast:
+	.cfi_startproc
+	.cfi_escape 0x16, 0x10, 2, 0x73, 8
+	nop
+	.cfi_endproc
+	.size	val_breg_offset_fast, .-val_breg_offset_fast
+	.globl	val_breg_offset_slow
+	.type	val_breg_offset_slow, @function
+val_breg_offset_slow:
+	.cfi_startproc
+# val_expression: breg3 0, plus_uconst 8
+	.cfi_escape 0x16, 0x10, 4, 0x73, 0, 0x23, 8
+	nop
+	.cfi_endproc
+	.size	val_breg_offset_slow, .-val_breg_offset_slow
+
+# val_expression(breg7 32, deref): rip is read from rsp + 32.
+	.globl	breg_deref_fast
+	.type	breg_deref_fast, @function
+breg_deref_fast:
+	.cfi_startproc
+	.cfi_escape 0x16, 0x10, 3, 0x77, 32, 0x06
+	nop
+	.cfi_endproc
+	.size	breg_deref_fast, .-breg_deref_fast
+	.globl	breg_deref_slow
+	.type	breg_deref_slow, @function
+breg_deref_slow:
+	.cfi_startproc
+# val_expression: breg7 0, plus_uconst 32, deref
+	.cfi_escape 0x16, 0x10, 5, 0x77, 0, 0x23, 32, 0x06
+	nop
+	.cfi_endproc
+	.size	breg_deref_slow, .-breg_deref_slow
+
+# def_cfa_expression(breg7 40, deref), like a signal frame: the
+# CFA is read from rsp + 40, rip is saved at CFA - 8.
+	.globl	cfa_deref_fast
+	.type	cfa_deref_fast, @function
+cfa_deref_fast:
+	.cfi_startproc
+	.cfi_escape 0x0f, 3, 0x77, 40, 0x06
+	nop
+	.cfi_endproc
+	.size	cfa_deref_fast, .-cfa_deref_fast
+	.globl	cfa_deref_slow
+	.type	cfa_deref_slow, @function
+cfa_deref_slow:
+	.cfi_startproc
+# def_cfa_expression: breg7 0, plus_uconst 40, deref
+	.cfi_escape 0x0f, 5, 0x77, 0, 0x23, 40, 0x06
+	nop
+	.cfi_endproc
+	.size	cfa_deref_slow, .-cfa_deref_slow